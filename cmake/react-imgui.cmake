@@ -43,6 +43,11 @@ This will create an executable named 'jsdemo' that:
 2. Compiles the bundle based on REACT_BUNDLE_MODE
 3. Links with imgui-runtime and Hermes
 4. Defines REACT_BUNDLE_MODE and REACT_BUNDLE_PATH macros
+
+When IMGUI_RUNTIME_HEADLESS is ON, a second executable '<target>-headless' is
+built from the same sources and bundle. It links imgui-runtime-headless, needs
+no display or GPU, runs a fixed number of frames and writes per-phase frame
+timings as JSON (see lib/imgui-runtime/HeadlessMain.cpp for its options).
 ]]
 function(add_react_imgui_app)
     # Parse arguments
@@ -182,9 +187,11 @@ function(add_react_imgui_app)
         add_executable(${ARG_TARGET} ${APP_TARGET_SOURCES})
     endif()
 
-    if(REACT_BUNDLE_MODE EQUAL 0)
+    if(REACT_BUNDLE_MODE EQUAL 0 AND NOT IMGUI_RUNTIME_HEADLESS)
         # React native object already part of sources
     else()
+        # Also needed in mode 0 when the headless target shares the object, so
+        # that only one target owns the custom command
         add_custom_target(${ARG_TARGET}_react_unit DEPENDS ${REACT_UNIT_OUTPUT})
         add_dependencies(${ARG_TARGET} ${ARG_TARGET}_react_unit)
     endif()
@@ -205,4 +212,118 @@ function(add_react_imgui_app)
 
     # Link libraries
     target_link_libraries(${ARG_TARGET} imgui-runtime)
+
+    # Headless benchmark executable
+    if(IMGUI_RUNTIME_HEADLESS AND TARGET imgui-runtime-headless)
+        set(HEADLESS_TARGET ${ARG_TARGET}-headless)
+        add_executable(${HEADLESS_TARGET} ${APP_TARGET_SOURCES})
+        add_dependencies(${HEADLESS_TARGET} ${ARG_TARGET}_react_unit)
+        target_compile_definitions(${HEADLESS_TARGET} PRIVATE
+            REACT_BUNDLE_MODE=${REACT_BUNDLE_MODE}
+            REACT_BUNDLE_PATH="${REACT_UNIT_OUTPUT}"
+        )
+        target_link_libraries(${HEADLESS_TARGET} imgui-runtime-headless)
+    endif()
+endfunction()
+
+#[[
+Embed an image in an executable, decoded at build time
+
+The image is decoded by imgui-image-bake into raw RGBA8 pixels (see
+lib/imgui-runtime/RawImage.h) and embedded with embed_resource.cmake, so the
+runtime uploads it straight from the executable's read-only data instead of
+inflating a PNG at startup. It is found by KEY (and every ALIAS) wherever an
+image path is accepted: Textures.load(), load_image() (draw small images
+with image_uv0()/image_uv1(), they may share an atlas page) or the window
+iconPath.
+
+Usage:
+  imgui_embed_image(
+    TARGET <target-name>
+    INPUT <image-file>
+    KEY <key>
+    [ALIAS <alias>...]
+    [MIPMAPS]
+    [ENCODED]
+  )
+
+Arguments:
+  TARGET      - Executable to add the image to; its '<target>-headless'
+                benchmark executable, if any, gets the image as well, so the
+                bundle behaves the same under the benchmark
+  INPUT       - PNG, JPEG, BMP, TGA, GIF or other image stb_image decodes
+  KEY         - Name the image is registered under (e.g. icon.png)
+  ALIAS       - Additional names (e.g. ./icon.png)
+  MIPMAPS     - Also embed mip levels down to 1x1, downsampled in linear light
+                and weighted by alpha; images drawn smaller than their size
+                then stay sharp without aliasing, and a window icon offers
+                every level of at least 16x16 to the platform
+  ENCODED     - Embed the file as is and decode it at runtime, which keeps
+                the executable smaller
+]]
+function(imgui_embed_image)
+    cmake_parse_arguments(
+        ARG
+        "MIPMAPS;ENCODED"
+        "TARGET;INPUT;KEY"
+        "ALIAS"
+        ${ARGN}
+    )
+
+    if(NOT ARG_TARGET)
+        message(FATAL_ERROR "imgui_embed_image: TARGET is required")
+    endif()
+    if(NOT ARG_INPUT)
+        message(FATAL_ERROR "imgui_embed_image: INPUT is required")
+    endif()
+    if(NOT ARG_KEY)
+        message(FATAL_ERROR "imgui_embed_image: KEY is required")
+    endif()
+
+    get_filename_component(INPUT_PATH ${ARG_INPUT} ABSOLUTE)
+    string(MAKE_C_IDENTIFIER "${ARG_TARGET}_${ARG_KEY}" EMBED_SYMBOL)
+    set(EMBED_CPP ${CMAKE_CURRENT_BINARY_DIR}/${EMBED_SYMBOL}_embed.cpp)
+
+    if(ARG_ENCODED)
+        set(EMBED_INPUT ${INPUT_PATH})
+        set(EMBED_DEPENDS ${INPUT_PATH})
+    else()
+        set(EMBED_INPUT ${CMAKE_CURRENT_BINARY_DIR}/${EMBED_SYMBOL}.rimg)
+        set(BAKE_FLAGS)
+        if(ARG_MIPMAPS)
+            list(APPEND BAKE_FLAGS --mipmaps)
+        endif()
+        add_custom_command(
+            OUTPUT ${EMBED_INPUT}
+            COMMAND imgui-image-bake ${INPUT_PATH} ${EMBED_INPUT} ${BAKE_FLAGS}
+            DEPENDS ${INPUT_PATH} imgui-image-bake
+            COMMENT "Pre-decoding ${ARG_KEY}"
+            VERBATIM
+        )
+        set(EMBED_DEPENDS ${EMBED_INPUT})
+    endif()
+
+    add_custom_command(
+        OUTPUT ${EMBED_CPP}
+        COMMAND ${CMAKE_COMMAND}
+            -DINPUT=${EMBED_INPUT}
+            -DOUTPUT=${EMBED_CPP}
+            -DSYMBOL=${EMBED_SYMBOL}
+            -DKEY=${ARG_KEY}
+            "-DALIAS=${ARG_ALIAS}"
+            -P ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/embed_resource.cmake
+        DEPENDS ${EMBED_DEPENDS} ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/embed_resource.cmake
+        COMMENT "Embedding ${ARG_KEY} into ${ARG_TARGET}"
+        VERBATIM
+    )
+
+    target_sources(${ARG_TARGET} PRIVATE ${EMBED_CPP})
+    if(TARGET ${ARG_TARGET}-headless)
+        # One target owns the generated file so that Makefile builds do not
+        # run the commands once per executable.
+        add_custom_target(${EMBED_SYMBOL}_embed DEPENDS ${EMBED_CPP})
+        add_dependencies(${ARG_TARGET} ${EMBED_SYMBOL}_embed)
+        add_dependencies(${ARG_TARGET}-headless ${EMBED_SYMBOL}_embed)
+        target_sources(${ARG_TARGET}-headless PRIVATE ${EMBED_CPP})
+    endif()
 endfunction()
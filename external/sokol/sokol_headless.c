@@ -0,0 +1,24 @@
+/*
+* Copyright (c) Tzvetan Mikov.
+*
+* This source code is licensed under the MIT license found in the
+* LICENSE file in the root directory of this source tree.
+ */
+
+// Headless build of sokol for benchmarking on machines without a display or
+// GPU. The gfx calls go to the dummy backend and sokol_app is not compiled at
+// all; the runtime supplies the handful of sapp_* entry points it uses.
+
+#define SOKOL_IMPL
+#include "sokol_gfx.h"
+#include "sokol_log.h"
+#include "sokol_time.h"
+
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include "cimgui.h"
+#define SOKOL_IMGUI_IMPL
+#define SOKOL_IMGUI_NO_SOKOL_APP
+#include "sokol_imgui.h"
+
+// Must be separate to avoid reordering.
+#include "sokol_debugtext.h"
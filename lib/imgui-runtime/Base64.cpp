@@ -0,0 +1,487 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "Base64.h"
+#include "CpuFeatures.h"
+
+#include <array>
+#include <atomic>
+
+namespace {
+
+const char kStandardAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char kUrlAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/// Decode table entries that are not a 6-bit value.
+enum : uint8_t {
+  kPadding = 0xFD,
+  kWhitespace = 0xFE,
+  kInvalid = 0xFF,
+};
+
+/// Both alphabets decode, so base64url input is accepted everywhere.
+const std::array<uint8_t, 256> &decodeTable() {
+  static const std::array<uint8_t, 256> table = [] {
+    std::array<uint8_t, 256> table{};
+    table.fill(kInvalid);
+    for (uint8_t i = 0; i < 64; ++i) {
+      table[static_cast<uint8_t>(kStandardAlphabet[i])] = i;
+      table[static_cast<uint8_t>(kUrlAlphabet[i])] = i;
+    }
+    for (char ch : {' ', '\t', '\n', '\r', '\f', '\v'}) {
+      table[static_cast<uint8_t>(ch)] = kWhitespace;
+    }
+    table['='] = kPadding;
+    return table;
+  }();
+  return table;
+}
+
+/// Encode as many whole blocks of \p input as the kernel handles and return
+/// the number of bytes consumed (a multiple of 3); 4/3 as many characters
+/// were written to \p output.
+using EncodeBlocksFn = size_t (*)(const uint8_t *input, size_t size,
+                                  char *output, bool url);
+/// Decode whole blocks of \p input until one holds a character other than
+/// the standard alphabet, or fewer than a block's worth of characters or
+/// \p capacity bytes of output remain. Returns the number of characters
+/// consumed (a multiple of 4); 3/4 as many bytes were written.
+using DecodeBlocksFn = size_t (*)(const char *input, size_t length,
+                                  uint8_t *output, size_t capacity);
+
+size_t encodeBlocksScalar(const uint8_t *, size_t, char *, bool) { return 0; }
+size_t decodeBlocksScalar(const char *, size_t, uint8_t *, size_t) {
+  return 0;
+}
+
+#if defined(IMGUI_RUNTIME_X86)
+
+// The x86 kernels follow Wojciech Muła's and Alfred Klomp's base64 work:
+// bytes are spread over 32-bit lanes with pshufb, split into 6-bit indices
+// with multiplies, and mapped to characters by adding a per-range offset.
+
+IMGUI_RUNTIME_TARGET("ssse3")
+size_t encodeBlocksSsse3(const uint8_t *input, size_t size, char *output,
+                         bool url) {
+  const __m128i shuffle =
+      _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m128i offsets = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, (url ? '-' : '+') - 62,
+      (url ? '_' : '/') - 63, 'A', 0, 0);
+  size_t consumed = 0;
+  // Each block reads 16 bytes and encodes the first 12.
+  while (size - consumed >= 16) {
+    __m128i in = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(input + consumed));
+    in = _mm_shuffle_epi8(in, shuffle);
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(t1, t3);
+
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    __m128i chars =
+        _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output), chars);
+    consumed += 12;
+    output += 16;
+  }
+  return consumed;
+}
+
+IMGUI_RUNTIME_TARGET("avx2")
+size_t encodeBlocksAvx2(const uint8_t *input, size_t size, char *output,
+                        bool url) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5,
+      4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i offsets = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, (url ? '-' : '+') - 62,
+      (url ? '_' : '/') - 63, 'A', 0, 0));
+  size_t consumed = 0;
+  // Each block encodes 24 bytes, loaded as two overlapping 16-byte halves.
+  while (size - consumed >= 28) {
+    __m128i low = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(input + consumed));
+    __m128i high = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(input + consumed + 12));
+    __m256i in =
+        _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+    in = _mm256_shuffle_epi8(in, shuffle);
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range =
+        _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    __m256i chars =
+        _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output), chars);
+    consumed += 24;
+    output += 32;
+  }
+  return consumed;
+}
+
+// Decoding classifies each character by its high and low nibble; a
+// character is valid when the two lookups share no bit.
+#define BASE64_DECODE_LUT_LO                                                   \
+  0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,      \
+      0x1B, 0x1B, 0x1B, 0x1A
+#define BASE64_DECODE_LUT_HI                                                   \
+  0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,      \
+      0x10, 0x10, 0x10, 0x10
+#define BASE64_DECODE_LUT_ROLL                                                 \
+  0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+
+IMGUI_RUNTIME_TARGET("ssse3")
+size_t decodeBlocksSsse3(const char *input, size_t length, uint8_t *output,
+                         size_t capacity) {
+  const __m128i lutLo = _mm_setr_epi8(BASE64_DECODE_LUT_LO);
+  const __m128i lutHi = _mm_setr_epi8(BASE64_DECODE_LUT_HI);
+  const __m128i lutRoll = _mm_setr_epi8(BASE64_DECODE_LUT_ROLL);
+  const __m128i mask2F = _mm_set1_epi8(0x2F);
+  const __m128i pack =
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t consumed = 0;
+  // Each block decodes 16 characters and stores 16 bytes, 12 of them valid.
+  while (length - consumed >= 16 && capacity >= 16) {
+    __m128i str = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(input + consumed));
+    __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+    __m128i loNibbles = _mm_and_si128(str, mask2F);
+    __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi),
+                                         _mm_setzero_si128())) != 0) {
+      break;
+    }
+    __m128i eq2F = _mm_cmpeq_epi8(str, mask2F);
+    __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+    str = _mm_add_epi8(str, roll);
+
+    __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+    __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output),
+                     _mm_shuffle_epi8(packed, pack));
+    consumed += 16;
+    output += 12;
+    capacity -= 12;
+  }
+  return consumed;
+}
+
+IMGUI_RUNTIME_TARGET("avx2")
+size_t decodeBlocksAvx2(const char *input, size_t length, uint8_t *output,
+                        size_t capacity) {
+  const __m256i lutLo =
+      _mm256_setr_epi8(BASE64_DECODE_LUT_LO, BASE64_DECODE_LUT_LO);
+  const __m256i lutHi =
+      _mm256_setr_epi8(BASE64_DECODE_LUT_HI, BASE64_DECODE_LUT_HI);
+  const __m256i lutRoll =
+      _mm256_setr_epi8(BASE64_DECODE_LUT_ROLL, BASE64_DECODE_LUT_ROLL);
+  const __m256i mask2F = _mm256_set1_epi8(0x2F);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5,
+      4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  size_t consumed = 0;
+  // Each block decodes 32 characters and stores 32 bytes, 24 of them valid.
+  while (length - consumed >= 32 && capacity >= 32) {
+    __m256i str = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(input + consumed));
+    __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+    __m256i loNibbles = _mm256_and_si256(str, mask2F);
+    __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      break;
+    }
+    __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+    __m256i roll =
+        _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+    str = _mm256_add_epi8(str, roll);
+
+    __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+    __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(packed, pack),
+                                         gather);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output), packed);
+    consumed += 32;
+    output += 24;
+    capacity -= 24;
+  }
+  return consumed;
+}
+
+#undef BASE64_DECODE_LUT_LO
+#undef BASE64_DECODE_LUT_HI
+#undef BASE64_DECODE_LUT_ROLL
+
+#endif // IMGUI_RUNTIME_X86
+
+#if defined(IMGUI_RUNTIME_NEON)
+
+size_t encodeBlocksNeon(const uint8_t *input, size_t size, char *output,
+                        bool url) {
+  const char *alphabet = url ? kUrlAlphabet : kStandardAlphabet;
+  uint8x16x4_t table;
+  for (int i = 0; i < 4; ++i) {
+    table.val[i] =
+        vld1q_u8(reinterpret_cast<const uint8_t *>(alphabet) + 16 * i);
+  }
+  const uint8x16_t mask = vdupq_n_u8(0x3F);
+  size_t consumed = 0;
+  // vld3 splits 48 bytes into the first, second and third byte of each
+  // triple; vst4 interleaves the four index lookups back.
+  while (size - consumed >= 48) {
+    uint8x16x3_t in = vld3q_u8(input + consumed);
+    uint8x16x4_t indices;
+    indices.val[0] = vshrq_n_u8(in.val[0], 2);
+    indices.val[1] = vandq_u8(
+        vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask);
+    indices.val[2] = vandq_u8(
+        vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask);
+    indices.val[3] = vandq_u8(in.val[2], mask);
+    uint8x16x4_t chars;
+    for (int i = 0; i < 4; ++i) {
+      chars.val[i] = vqtbl4q_u8(table, indices.val[i]);
+    }
+    vst4q_u8(reinterpret_cast<uint8_t *>(output), chars);
+    consumed += 48;
+    output += 64;
+  }
+  return consumed;
+}
+
+/// 6-bit values of the characters in \p chars; lanes holding anything but
+/// the standard alphabet are flagged in \p invalid.
+inline uint8x16_t decodeNeon(uint8x16_t chars, uint8x16_t &invalid) {
+  uint8x16_t upper =
+      vcltq_u8(vsubq_u8(chars, vdupq_n_u8('A')), vdupq_n_u8(26));
+  uint8x16_t lower =
+      vcltq_u8(vsubq_u8(chars, vdupq_n_u8('a')), vdupq_n_u8(26));
+  uint8x16_t digit =
+      vcltq_u8(vsubq_u8(chars, vdupq_n_u8('0')), vdupq_n_u8(10));
+  uint8x16_t plus = vceqq_u8(chars, vdupq_n_u8('+'));
+  uint8x16_t slash = vceqq_u8(chars, vdupq_n_u8('/'));
+  uint8x16_t delta = vandq_u8(upper, vdupq_n_u8(static_cast<uint8_t>(-'A')));
+  delta = vorrq_u8(
+      delta, vandq_u8(lower, vdupq_n_u8(static_cast<uint8_t>(26 - 'a'))));
+  delta = vorrq_u8(
+      delta, vandq_u8(digit, vdupq_n_u8(static_cast<uint8_t>(52 - '0'))));
+  delta = vorrq_u8(delta, vandq_u8(plus, vdupq_n_u8(62 - '+')));
+  delta = vorrq_u8(delta, vandq_u8(slash, vdupq_n_u8(63 - '/')));
+  uint8x16_t valid =
+      vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, slash)));
+  invalid = vorrq_u8(invalid, vmvnq_u8(valid));
+  return vaddq_u8(chars, delta);
+}
+
+size_t decodeBlocksNeon(const char *input, size_t length, uint8_t *output,
+                        size_t capacity) {
+  size_t consumed = 0;
+  while (length - consumed >= 64 && capacity >= 48) {
+    uint8x16x4_t chars =
+        vld4q_u8(reinterpret_cast<const uint8_t *>(input + consumed));
+    uint8x16_t invalid = vdupq_n_u8(0);
+    uint8x16_t a = decodeNeon(chars.val[0], invalid);
+    uint8x16_t b = decodeNeon(chars.val[1], invalid);
+    uint8x16_t c = decodeNeon(chars.val[2], invalid);
+    uint8x16_t d = decodeNeon(chars.val[3], invalid);
+    if (vmaxvq_u8(invalid) != 0) {
+      break;
+    }
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(output, bytes);
+    consumed += 64;
+    output += 48;
+    capacity -= 48;
+  }
+  return consumed;
+}
+
+#endif // IMGUI_RUNTIME_NEON
+
+bool alwaysSupported() { return true; }
+
+struct Implementation {
+  const char *name;
+  EncodeBlocksFn encodeBlocks;
+  DecodeBlocksFn decodeBlocks;
+  bool (*supported)();
+};
+
+/// In order of preference.
+const Implementation kImplementations[] = {
+#if defined(IMGUI_RUNTIME_X86)
+    {"avx2", encodeBlocksAvx2, decodeBlocksAvx2, cpuHasAvx2},
+    {"ssse3", encodeBlocksSsse3, decodeBlocksSsse3, cpuHasSsse3},
+#endif
+#if defined(IMGUI_RUNTIME_NEON)
+    {"neon", encodeBlocksNeon, decodeBlocksNeon, alwaysSupported},
+#endif
+    {"scalar", encodeBlocksScalar, decodeBlocksScalar, alwaysSupported},
+};
+
+std::atomic<const Implementation *> s_implementation{nullptr};
+
+const Implementation &implementation() {
+  const Implementation *current =
+      s_implementation.load(std::memory_order_relaxed);
+  if (!current) {
+    for (const auto &candidate : kImplementations) {
+      if (candidate.supported()) {
+        current = &candidate;
+        break;
+      }
+    }
+    s_implementation.store(current, std::memory_order_relaxed);
+  }
+  return *current;
+}
+
+/// After a block fails to decode, this many characters go through the scalar
+/// loop before the vector kernel is tried again.
+constexpr size_t kScalarStretch = 16;
+
+} // namespace
+
+size_t base64EncodedLength(size_t size, bool url) {
+  if (url) {
+    return size / 3 * 4 + (size % 3 == 0 ? 0 : size % 3 + 1);
+  }
+  return (size + 2) / 3 * 4;
+}
+
+size_t base64Encode(const uint8_t *input, size_t size, char *output,
+                    bool url) {
+  const char *alphabet = url ? kUrlAlphabet : kStandardAlphabet;
+  size_t i = implementation().encodeBlocks(input, size, output, url);
+  char *out = output + i / 3 * 4;
+  for (; size - i >= 3; i += 3) {
+    uint32_t triple = (uint32_t(input[i]) << 16) |
+                      (uint32_t(input[i + 1]) << 8) | input[i + 2];
+    out[0] = alphabet[triple >> 18];
+    out[1] = alphabet[(triple >> 12) & 0x3F];
+    out[2] = alphabet[(triple >> 6) & 0x3F];
+    out[3] = alphabet[triple & 0x3F];
+    out += 4;
+  }
+  if (i < size) {
+    uint32_t triple = uint32_t(input[i]) << 16;
+    bool two = size - i == 2;
+    if (two) {
+      triple |= uint32_t(input[i + 1]) << 8;
+    }
+    *out++ = alphabet[triple >> 18];
+    *out++ = alphabet[(triple >> 12) & 0x3F];
+    if (two) {
+      *out++ = alphabet[(triple >> 6) & 0x3F];
+    }
+    if (!url) {
+      if (!two) {
+        *out++ = '=';
+      }
+      *out++ = '=';
+    }
+  }
+  return out - output;
+}
+
+std::string base64Encode(const uint8_t *input, size_t size, bool url) {
+  std::string encoded(base64EncodedLength(size, url), '\0');
+  base64Encode(input, size, encoded.data(), url);
+  return encoded;
+}
+
+std::optional<size_t> base64Decode(const char *input, size_t length,
+                                   uint8_t *output, bool strict) {
+  const auto &table = decodeTable();
+  DecodeBlocksFn decodeBlocks = implementation().decodeBlocks;
+  size_t capacity = base64DecodedCapacity(length);
+  size_t i = 0;
+  size_t o = 0;
+  size_t scalarUntil = 0;
+  uint32_t accumulator = 0;
+  unsigned quantum = 0;
+  bool padded = false;
+  while (i < length) {
+    if (quantum == 0 && i >= scalarUntil) {
+      size_t consumed =
+          decodeBlocks(input + i, length - i, output + o, capacity - o);
+      i += consumed;
+      o += consumed / 4 * 3;
+      scalarUntil = i + kScalarStretch;
+      if (i == length) {
+        break;
+      }
+    }
+    uint8_t value = table[static_cast<uint8_t>(input[i++])];
+    if (value < 64) {
+      accumulator = (accumulator << 6) | value;
+      if (++quantum == 4) {
+        output[o++] = static_cast<uint8_t>(accumulator >> 16);
+        output[o++] = static_cast<uint8_t>(accumulator >> 8);
+        output[o++] = static_cast<uint8_t>(accumulator);
+        accumulator = 0;
+        quantum = 0;
+      }
+    } else if (value == kPadding) {
+      padded = true;
+      break;
+    } else if (value == kInvalid && strict) {
+      return std::nullopt;
+    }
+  }
+  if (padded && strict) {
+    for (; i < length; ++i) {
+      uint8_t value = table[static_cast<uint8_t>(input[i])];
+      if (value != kPadding && value != kWhitespace) {
+        return std::nullopt;
+      }
+    }
+  }
+  switch (quantum) {
+  case 1:
+    if (strict) {
+      return std::nullopt;
+    }
+    break;
+  case 2:
+    output[o++] = static_cast<uint8_t>(accumulator >> 4);
+    break;
+  case 3:
+    output[o++] = static_cast<uint8_t>(accumulator >> 10);
+    output[o++] = static_cast<uint8_t>(accumulator >> 2);
+    break;
+  }
+  return o;
+}
+
+const char *base64Implementation() { return implementation().name; }
+
+bool base64SelectImplementation(const std::string &name) {
+  for (const auto &candidate : kImplementations) {
+    if (name == candidate.name && candidate.supported()) {
+      s_implementation.store(&candidate, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
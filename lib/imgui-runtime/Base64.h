@@ -0,0 +1,47 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/// Base64 codec shared by the fs bindings and the Buffer polyfill. Whole
+/// blocks are converted with AVX2, SSSE3 or NEON when the CPU has them (picked
+/// once at runtime on x86); the remainder, and everything on other CPUs, goes
+/// through a scalar loop.
+
+/// Characters needed to encode \p size bytes. base64url output is unpadded.
+size_t base64EncodedLength(size_t size, bool url = false);
+
+/// Upper bound of the bytes \p length characters decode to.
+inline size_t base64DecodedCapacity(size_t length) {
+  return (length + 3) / 4 * 3;
+}
+
+/// Encode \p size bytes into \p output, which must have room for
+/// base64EncodedLength(size, url) characters; returns that length. With
+/// \p url, the base64url alphabet is used and no padding is written.
+size_t base64Encode(const uint8_t *input, size_t size, char *output,
+                    bool url = false);
+std::string base64Encode(const uint8_t *input, size_t size, bool url = false);
+
+/// Decode standard or URL-safe base64 into \p output, which must have room for
+/// base64DecodedCapacity(length) bytes, and return the decoded size.
+/// Whitespace is skipped and decoding stops at the first '='. Other characters
+/// outside the alphabet are skipped too, like Node's Buffer.from(s, 'base64')
+/// does, unless \p strict is set: then they, a dangling sixth of a byte or
+/// anything but padding after the first '=' make it return std::nullopt.
+std::optional<size_t> base64Decode(const char *input, size_t length,
+                                   uint8_t *output, bool strict = false);
+
+/// The implementation in use: "avx2", "ssse3", "neon" or "scalar".
+const char *base64Implementation();
+
+/// Switch to the implementation called \p name. Returns false, leaving the
+/// current one in place, if it was not built in or the CPU lacks it. Meant for
+/// benchmarks.
+bool base64SelectImplementation(const std::string &name);
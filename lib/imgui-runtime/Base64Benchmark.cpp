@@ -0,0 +1,104 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+// Throughput benchmark of the base64 codec (built with IMGUI_RUNTIME_HEADLESS).
+//
+// Usage: base64-benchmark [--size BYTES] [--seconds S]
+//
+// Encodes and decodes a buffer of random bytes (default 1 MiB) with every
+// implementation this CPU supports, plus MIME-style input with a line break
+// every 76 characters, and prints the throughput of each in MB/s of binary
+// data.
+
+#include "Base64.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Run \p fn repeatedly for about \p seconds and return MB/s over \p bytes
+/// per call.
+template <typename Fn> double measure(size_t bytes, double seconds, Fn fn) {
+  fn();
+  size_t iterations = 0;
+  auto start = Clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    fn();
+    ++iterations;
+    elapsed = Clock::now() - start;
+  } while (elapsed.count() < seconds);
+  return static_cast<double>(bytes) * iterations / elapsed.count() / 1e6;
+}
+
+std::string withLineBreaks(const std::string &encoded) {
+  std::string wrapped;
+  wrapped.reserve(encoded.size() + encoded.size() / 76 * 2);
+  for (size_t i = 0; i < encoded.size(); i += 76) {
+    wrapped.append(encoded, i, 76);
+    wrapped += "\r\n";
+  }
+  return wrapped;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  size_t size = 1 << 20;
+  double seconds = 0.5;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      size = std::max<long long>(1, atoll(argv[++i]));
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = std::max(0.01, atof(argv[++i]));
+    } else {
+      fprintf(stderr, "Usage: %s [--size BYTES] [--seconds S]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<uint8_t> input(size);
+  std::mt19937 rng(42);
+  for (auto &byte : input) {
+    byte = static_cast<uint8_t>(rng());
+  }
+  std::string encoded = base64Encode(input.data(), input.size());
+  std::string wrapped = withLineBreaks(encoded);
+  std::vector<uint8_t> decoded(base64DecodedCapacity(wrapped.size()));
+
+  printf("%zu bytes, %.2f s per measurement\n", size, seconds);
+  printf("%-8s %12s %12s %12s\n", "impl", "encode MB/s", "decode MB/s",
+         "mime MB/s");
+  std::string output(encoded.size(), '\0');
+  for (const char *name : {"avx2", "ssse3", "neon", "scalar"}) {
+    if (!base64SelectImplementation(name)) {
+      continue;
+    }
+    double encode = measure(size, seconds, [&] {
+      base64Encode(input.data(), input.size(), output.data());
+    });
+    double decode = measure(size, seconds, [&] {
+      base64Decode(encoded.data(), encoded.size(), decoded.data());
+    });
+    double mime = measure(size, seconds, [&] {
+      base64Decode(wrapped.data(), wrapped.size(), decoded.data());
+    });
+    bool ok = output == encoded &&
+              base64Decode(wrapped.data(), wrapped.size(), decoded.data()) ==
+                  size &&
+              std::equal(input.begin(), input.end(), decoded.begin());
+    printf("%-8s %12.0f %12.0f %12.0f%s\n", name, encode, decode, mime,
+           ok ? "" : "  (MISMATCH)");
+  }
+  return 0;
+}
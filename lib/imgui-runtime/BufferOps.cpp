@@ -0,0 +1,189 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "BufferOps.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr std::array<char, 512> makeHexPairs() {
+  std::array<char, 512> pairs{};
+  const char *digits = "0123456789abcdef";
+  for (int i = 0; i < 256; ++i) {
+    pairs[i * 2] = digits[i >> 4];
+    pairs[i * 2 + 1] = digits[i & 15];
+  }
+  return pairs;
+}
+
+constexpr std::array<int8_t, 256> makeHexValues() {
+  std::array<int8_t, 256> values{};
+  for (int i = 0; i < 256; ++i) {
+    values[i] = -1;
+  }
+  for (int i = 0; i < 10; ++i) {
+    values['0' + i] = static_cast<int8_t>(i);
+  }
+  for (int i = 0; i < 6; ++i) {
+    values['a' + i] = static_cast<int8_t>(10 + i);
+    values['A' + i] = static_cast<int8_t>(10 + i);
+  }
+  return values;
+}
+
+constexpr std::array<char, 512> kHexPairs = makeHexPairs();
+constexpr std::array<int8_t, 256> kHexValues = makeHexValues();
+
+ptrdiff_t findForward(const uint8_t *haystack, size_t size,
+                      const uint8_t *needle, size_t needleSize, size_t from) {
+  if (needleSize > size || from > size - needleSize) {
+    return -1;
+  }
+#if defined(__GLIBC__)
+  auto *found = static_cast<const uint8_t *>(
+      memmem(haystack + from, size - from, needle, needleSize));
+  return found ? found - haystack : -1;
+#else
+  // Candidates come from memchr on the first byte; only those are compared.
+  const uint8_t *end = haystack + size - needleSize + 1;
+  const uint8_t *cursor = haystack + from;
+  while (cursor < end) {
+    auto *candidate = static_cast<const uint8_t *>(
+        memchr(cursor, needle[0], static_cast<size_t>(end - cursor)));
+    if (!candidate) {
+      return -1;
+    }
+    if (memcmp(candidate + 1, needle + 1, needleSize - 1) == 0) {
+      return candidate - haystack;
+    }
+    cursor = candidate + 1;
+  }
+  return -1;
+#endif
+}
+
+ptrdiff_t findBackward(const uint8_t *haystack, size_t size,
+                       const uint8_t *needle, size_t needleSize, size_t from) {
+  if (needleSize > size) {
+    return -1;
+  }
+  size_t start = std::min(from, size - needleSize);
+  for (size_t i = start + 1; i-- > 0;) {
+#if defined(__GLIBC__)
+    auto *candidate =
+        static_cast<const uint8_t *>(memrchr(haystack, needle[0], i + 1));
+    if (!candidate) {
+      return -1;
+    }
+    i = static_cast<size_t>(candidate - haystack);
+#else
+    if (haystack[i] != needle[0]) {
+      continue;
+    }
+#endif
+    if (memcmp(haystack + i + 1, needle + 1, needleSize - 1) == 0) {
+      return static_cast<ptrdiff_t>(i);
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+void hexEncode(const uint8_t *input, size_t size, char *output) {
+  for (size_t i = 0; i < size; ++i) {
+    memcpy(output + i * 2, &kHexPairs[input[i] * 2], 2);
+  }
+}
+
+size_t hexDecode(const char *input, size_t length, uint8_t *output) {
+  size_t pairs = length / 2;
+  for (size_t i = 0; i < pairs; ++i) {
+    int high = kHexValues[static_cast<uint8_t>(input[i * 2])];
+    int low = kHexValues[static_cast<uint8_t>(input[i * 2 + 1])];
+    if ((high | low) < 0) {
+      return i;
+    }
+    output[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+  return pairs;
+}
+
+ptrdiff_t findBytes(const uint8_t *haystack, size_t size,
+                    const uint8_t *needle, size_t needleSize, size_t from,
+                    bool last) {
+  if (needleSize == 0) {
+    return static_cast<ptrdiff_t>(std::min(from, size));
+  }
+  return last ? findBackward(haystack, size, needle, needleSize, from)
+              : findForward(haystack, size, needle, needleSize, from);
+}
+
+void fillPattern(uint8_t *output, size_t size, const uint8_t *pattern,
+                 size_t patternSize) {
+  if (size == 0 || patternSize == 0) {
+    return;
+  }
+  if (patternSize == 1) {
+    memset(output, pattern[0], size);
+    return;
+  }
+  size_t filled = std::min(patternSize, size);
+  // memmove: the pattern may be another view of the same buffer.
+  memmove(output, pattern, filled);
+  // Whatever is filled so far is whole repetitions, so copying it doubles
+  // the run.
+  while (filled < size) {
+    size_t chunk = std::min(filled, size - filled);
+    memcpy(output + filled, output, chunk);
+    filled += chunk;
+  }
+}
+
+std::string latin1ToUtf8(const uint8_t *input, size_t size) {
+  std::string out;
+  out.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t byte = input[i];
+    if (byte < 0x80) {
+      out += static_cast<char>(byte);
+    } else {
+      out += static_cast<char>(0xC0 | byte >> 6);
+      out += static_cast<char>(0x80 | (byte & 0x3F));
+    }
+  }
+  return out;
+}
+
+size_t latin1FromUtf8(const char *input, size_t length, uint8_t *output) {
+  auto *bytes = reinterpret_cast<const uint8_t *>(input);
+  size_t written = 0;
+  size_t i = 0;
+  while (i < length) {
+    uint8_t lead = bytes[i];
+    if (lead < 0x80) {
+      output[written++] = lead;
+      ++i;
+      continue;
+    }
+    size_t extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : 1;
+    uint32_t code = lead & (0x3F >> extra);
+    for (size_t k = 1; k <= extra && i + k < length; ++k) {
+      code = code << 6 | (bytes[i + k] & 0x3F);
+    }
+    i += extra + 1;
+    if (code > 0xFFFF) {
+      // Both halves of the surrogate pair.
+      code -= 0x10000;
+      output[written++] = static_cast<uint8_t>(0xD800 + (code >> 10));
+      output[written++] = static_cast<uint8_t>(0xDC00 + (code & 0x3FF));
+    } else {
+      output[written++] = static_cast<uint8_t>(code);
+    }
+  }
+  return written;
+}
@@ -0,0 +1,46 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Byte operations behind the Buffer polyfill's search, fill and hex/latin1
+/// conversions, so they run over the ArrayBuffer memory with memchr/memcmp/
+/// memcpy instead of per-byte JS loops.
+
+/// Write the lowercase hex digits of \p size bytes (2 * size characters) to
+/// \p output.
+void hexEncode(const uint8_t *input, size_t size, char *output);
+
+/// Decode hex digit pairs into \p output, which must have room for length / 2
+/// bytes, and return the decoded size. Like Buffer.from(s, 'hex'), decoding
+/// stops at the first pair that is not two hex digits, and a trailing odd
+/// digit is ignored.
+size_t hexDecode(const char *input, size_t length, uint8_t *output);
+
+/// Offset of the first occurrence of \p needle in \p haystack that starts at
+/// or after \p from, or with \p last the final one that starts at or before
+/// \p from; -1 if there is none. An empty needle matches at
+/// min(from, size).
+ptrdiff_t findBytes(const uint8_t *haystack, size_t size,
+                    const uint8_t *needle, size_t needleSize, size_t from,
+                    bool last);
+
+/// Fill \p size bytes at \p output with repetitions of \p pattern, truncating
+/// the last one. Memory is set with memset for one-byte patterns and
+/// otherwise with memcpy of a doubling prefix. \p pattern may overlap
+/// \p output.
+void fillPattern(uint8_t *output, size_t size, const uint8_t *pattern,
+                 size_t patternSize);
+
+/// UTF-8 for \p size latin1 bytes (each byte is the code point).
+std::string latin1ToUtf8(const uint8_t *input, size_t size);
+
+/// Encode UTF-8 \p input as latin1 into \p output, which must have room for
+/// \p length bytes, and return the encoded size: every UTF-16 code unit of the
+/// text becomes its low byte, as Buffer.from(s, 'latin1') does.
+size_t latin1FromUtf8(const char *input, size_t length, uint8_t *output);
@@ -0,0 +1,57 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+/// Support for the SIMD kernels (Base64, Utf8). On x86 they are compiled for
+/// their instruction set with IMGUI_RUNTIME_TARGET and chosen at runtime with
+/// cpuHasSsse3()/cpuHasAvx2(), so the binary still runs on older CPUs. NEON is
+/// part of the AArch64 baseline and needs neither.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||             \
+    defined(_M_IX86)
+#define IMGUI_RUNTIME_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC accepts any intrinsic in any function.
+#define IMGUI_RUNTIME_TARGET(isa)
+#else
+#define IMGUI_RUNTIME_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IMGUI_RUNTIME_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(IMGUI_RUNTIME_X86)
+
+#if defined(_MSC_VER) && !defined(__clang__)
+inline bool cpuHasSsse3() {
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 9)) != 0;
+}
+
+inline bool cpuHasAvx2() {
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  // The OS must save the YMM registers too.
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+}
+#else
+inline bool cpuHasSsse3() { return __builtin_cpu_supports("ssse3"); }
+inline bool cpuHasAvx2() { return __builtin_cpu_supports("avx2"); }
+#endif
+
+#endif // IMGUI_RUNTIME_X86
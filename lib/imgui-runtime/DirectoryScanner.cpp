@@ -0,0 +1,293 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "DirectoryScanner.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#if defined(_WIN32)
+#include <chrono>
+#include <filesystem>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+enum : uint8_t {
+  kUnknown = 0,
+  kFile = 1,
+  kDirectory = 2,
+  kSymlink = 3,
+  kOther = 4,
+};
+
+/// The entries of one directory.
+struct Listing {
+  std::string path;
+  std::vector<std::string> names;
+  std::vector<uint8_t> types;
+  std::vector<double> sizes;
+  std::vector<double> mtimes;
+  /// (entry index, listing) of the subdirectories that were scanned.
+  std::vector<std::pair<uint32_t, Listing *>> children;
+
+  void add(std::string name, uint8_t type, double size, double mtime) {
+    names.push_back(std::move(name));
+    types.push_back(type);
+    sizes.push_back(size);
+    mtimes.push_back(mtime);
+  }
+};
+
+#if defined(_WIN32)
+
+bool readListing(Listing &listing, bool withStat, std::error_code &ec) {
+  namespace fs = std::filesystem;
+  fs::directory_iterator it(fs::u8path(listing.path), ec);
+  if (ec) {
+    return false;
+  }
+  for (fs::directory_iterator end; it != end; it.increment(ec)) {
+    if (ec) {
+      break;
+    }
+    std::error_code entryEc;
+    auto status = it->symlink_status(entryEc);
+    uint8_t type = kUnknown;
+    if (!entryEc) {
+      type = fs::is_symlink(status)     ? kSymlink
+             : fs::is_regular_file(status) ? kFile
+             : fs::is_directory(status)   ? kDirectory
+                                          : kOther;
+    }
+    double size = 0;
+    double mtime = 0;
+    if (withStat && type == kFile) {
+      size = static_cast<double>(it->file_size(entryEc));
+    }
+    if (withStat) {
+      auto written = it->last_write_time(entryEc);
+      if (!entryEc) {
+        auto adjusted = written - fs::file_time_type::clock::now() +
+                        std::chrono::system_clock::now();
+        mtime = static_cast<double>(
+            std::chrono::time_point_cast<std::chrono::milliseconds>(adjusted)
+                .time_since_epoch()
+                .count());
+      }
+    }
+    listing.add(it->path().filename().u8string(), type, size, mtime);
+  }
+  ec.clear();
+  return true;
+}
+
+std::string joinPath(const std::string &directory, const std::string &name) {
+  return (std::filesystem::u8path(directory) / std::filesystem::u8path(name))
+      .u8string();
+}
+
+#else
+
+uint8_t typeOfMode(mode_t mode) {
+  if (S_ISREG(mode)) {
+    return kFile;
+  }
+  if (S_ISDIR(mode)) {
+    return kDirectory;
+  }
+  if (S_ISLNK(mode)) {
+    return kSymlink;
+  }
+  return kOther;
+}
+
+/// readdir() plus, when \p withStat is set or the file system does not
+/// report types, one fstatat() per entry.
+bool readListing(Listing &listing, bool withStat, std::error_code &ec) {
+  DIR *dir = ::opendir(listing.path.c_str());
+  if (!dir) {
+    ec = std::error_code(errno, std::generic_category());
+    return false;
+  }
+  int fd = ::dirfd(dir);
+  while (struct dirent *entry = ::readdir(dir)) {
+    const char *name = entry->d_name;
+    if (name[0] == '.' &&
+        (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+      continue;
+    }
+    uint8_t type;
+    switch (entry->d_type) {
+    case DT_REG:
+      type = kFile;
+      break;
+    case DT_DIR:
+      type = kDirectory;
+      break;
+    case DT_LNK:
+      type = kSymlink;
+      break;
+    case DT_UNKNOWN:
+      type = kUnknown;
+      break;
+    default:
+      type = kOther;
+      break;
+    }
+    double size = 0;
+    double mtime = 0;
+    if (withStat || type == kUnknown) {
+      struct stat st;
+      if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        type = typeOfMode(st.st_mode);
+        if (withStat) {
+          if (S_ISREG(st.st_mode)) {
+            size = static_cast<double>(st.st_size);
+          }
+#if defined(__APPLE__)
+          const struct timespec &modified = st.st_mtimespec;
+#else
+          const struct timespec &modified = st.st_mtim;
+#endif
+          mtime = modified.tv_sec * 1000.0 + modified.tv_nsec / 1e6;
+        }
+      }
+    }
+    listing.add(name, type, size, mtime);
+  }
+  ::closedir(dir);
+  return true;
+}
+
+std::string joinPath(const std::string &directory, const std::string &name) {
+  if (!directory.empty() && directory.back() == '/') {
+    return directory + name;
+  }
+  return directory + "/" + name;
+}
+
+#endif
+
+/// List every directory below \p root on options.threads threads. Listings
+/// live in a deque so the ones being filled in never move.
+void walk(std::deque<Listing> &listings, const DirectoryScanOptions &options) {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::vector<Listing *> queue;
+  size_t active = 0;
+
+  // Called with the lock held.
+  auto expand = [&](Listing &listing) {
+    for (uint32_t i = 0; i < listing.types.size(); ++i) {
+      if (listing.types[i] != kDirectory) {
+        continue;
+      }
+      Listing &child = listings.emplace_back();
+      child.path = joinPath(listing.path, listing.names[i]);
+      listing.children.emplace_back(i, &child);
+      queue.push_back(&child);
+    }
+  };
+
+  auto work = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [&] { return !queue.empty() || active == 0; });
+      if (queue.empty()) {
+        return;
+      }
+      Listing *listing = queue.back();
+      queue.pop_back();
+      ++active;
+      lock.unlock();
+      std::error_code ec;
+      // Unreadable subdirectories keep their entry but stay empty.
+      bool listed = readListing(*listing, options.stat, ec);
+      lock.lock();
+      --active;
+      if (listed) {
+        expand(*listing);
+      }
+      wake.notify_all();
+    }
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    expand(listings.front());
+  }
+  std::vector<std::thread> helpers;
+  unsigned threads = std::max(1u, options.threads);
+  for (unsigned i = 1; i < threads; ++i) {
+    helpers.emplace_back(work);
+  }
+  work();
+  for (auto &helper : helpers) {
+    helper.join();
+  }
+}
+
+/// Concatenate the listings depth first, so that each directory's entry
+/// precedes its contents.
+DirectoryScanResult flatten(std::deque<Listing> &listings) {
+  DirectoryScanResult result;
+  size_t total = 0;
+  for (const auto &listing : listings) {
+    total += listing.types.size();
+  }
+  result.parents.reserve(total);
+  result.types.reserve(total);
+  result.sizes.reserve(total);
+  result.mtimes.reserve(total);
+
+  std::vector<std::pair<Listing *, int32_t>> stack{{&listings.front(), -1}};
+  while (!stack.empty()) {
+    auto [listing, parent] = stack.back();
+    stack.pop_back();
+    auto base = static_cast<int32_t>(result.size());
+    for (size_t i = 0; i < listing->types.size(); ++i) {
+      if (!result.types.empty()) {
+        result.names.push_back('\0');
+      }
+      result.names += listing->names[i];
+      result.parents.push_back(parent);
+      result.types.push_back(listing->types[i]);
+      result.sizes.push_back(listing->sizes[i]);
+      result.mtimes.push_back(listing->mtimes[i]);
+    }
+    for (auto it = listing->children.rbegin(); it != listing->children.rend();
+         ++it) {
+      stack.emplace_back(it->second, base + static_cast<int32_t>(it->first));
+    }
+    *listing = Listing();
+  }
+  return result;
+}
+
+} // namespace
+
+DirectoryScanResult scanDirectory(const std::string &root,
+                                  const DirectoryScanOptions &options) {
+  std::deque<Listing> listings(1);
+  listings.front().path = root;
+  std::error_code ec;
+  if (!readListing(listings.front(), options.stat, ec)) {
+    throw std::system_error(ec, "scandir '" + root + "'");
+  }
+  if (options.recursive) {
+    walk(listings, options);
+  }
+  return flatten(listings);
+}
@@ -0,0 +1,45 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Options of scanDirectory().
+struct DirectoryScanOptions {
+  /// Descend into subdirectories. Symbolic links are reported, not followed.
+  bool recursive = false;
+  /// Fill in sizes and modification times (one lstat per entry). Types are
+  /// known without it on most file systems.
+  bool stat = true;
+  /// Directories listed concurrently; 1 walks the tree on the calling thread.
+  unsigned threads = 1;
+};
+
+/// Entries of a directory tree in columns. Entry i is called names[i] (the
+/// names are stored back to back, separated by NUL) and lives in the directory
+/// of entry parents[i], or in the scanned root when that is -1. A directory's
+/// entry always precedes its contents.
+struct DirectoryScanResult {
+  std::string names;
+  std::vector<int32_t> parents;
+  /// Numbered like the `type` of stat objects: 1 file, 2 directory,
+  /// 3 symbolic link, 4 other, 0 unknown.
+  std::vector<uint8_t> types;
+  /// Bytes for regular files, 0 otherwise or without DirectoryScanOptions::stat.
+  std::vector<double> sizes;
+  /// Milliseconds since the epoch, 0 without DirectoryScanOptions::stat.
+  std::vector<double> mtimes;
+
+  size_t size() const { return types.size(); }
+};
+
+/// List \p root, and with options.recursive everything below it. Throws
+/// std::system_error if \p root cannot be listed; unreadable subdirectories
+/// are reported as entries but not descended into.
+DirectoryScanResult scanDirectory(const std::string &root,
+                                  const DirectoryScanOptions &options);
@@ -0,0 +1,876 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "FetchClient.h"
+#include "HttpStrings.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+
+namespace {
+
+/// Per-host connection limit, matching what browsers do for HTTP/1.1.
+/// HTTP/2 requests are multiplexed over a single connection instead.
+constexpr long kMaxHostConnections = 6;
+/// Idle connections kept alive in the connection cache.
+constexpr long kMaxCachedConnections = 32;
+/// Upper bound for how long the I/O thread sleeps when nothing happens.
+constexpr int kPollTimeoutMs = 1000;
+/// Largest Content-Length trusted for reserving the body buffer up front.
+constexpr unsigned long long kMaxBodyReserve = 256ull << 20;
+
+std::string defaultReasonPhrase(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 201:
+    return "Created";
+  case 202:
+    return "Accepted";
+  case 204:
+    return "No Content";
+  case 301:
+    return "Moved Permanently";
+  case 302:
+    return "Found";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 401:
+    return "Unauthorized";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 408:
+    return "Request Timeout";
+  case 409:
+    return "Conflict";
+  case 410:
+    return "Gone";
+  case 413:
+    return "Payload Too Large";
+  case 415:
+    return "Unsupported Media Type";
+  case 500:
+    return "Internal Server Error";
+  case 501:
+    return "Not Implemented";
+  case 502:
+    return "Bad Gateway";
+  case 503:
+    return "Service Unavailable";
+  default:
+    break;
+  }
+  return "";
+}
+
+bool isRedirectStatus(int status) {
+  return status == 301 || status == 302 || status == 303 || status == 307 ||
+         status == 308;
+}
+
+bool hasHeader(const std::vector<std::pair<std::string, std::string>> &headers,
+               const char *name) {
+  return std::any_of(headers.begin(), headers.end(),
+                     [name](const std::pair<std::string, std::string> &header) {
+                       return equalsIgnoreCase(header.first, name);
+                     });
+}
+
+/// Requests with the same key get the same response: URL plus headers,
+/// compared case-insensitively by name and independent of their order, and
+/// the options that change how the response is obtained (redirect handling,
+/// timeout and cache mode).
+std::string dedupKey(const NativeFetchRequest &request) {
+  std::vector<std::string> lines;
+  lines.reserve(request.headers.size());
+  for (const auto &header : request.headers) {
+    std::string line = toLower(header.first);
+    line += ':';
+    line += header.second;
+    lines.push_back(std::move(line));
+  }
+  std::sort(lines.begin(), lines.end());
+  std::string key = request.url;
+  key += '\n';
+  key += request.followRedirects ? "follow" : "manual";
+  key += ' ';
+  key += std::to_string(request.timeoutMs);
+  key += ' ';
+  key += request.cacheMode;
+  for (const std::string &line : lines) {
+    key += '\n';
+    key += line;
+  }
+  return key;
+}
+
+} // namespace
+
+struct FetchClient::Transfer {
+  FetchClient *client;
+  NativeFetchRequest request;
+  NativeFetchResult result;
+  CURL *easy = nullptr;
+  struct curl_slist *headerList = nullptr;
+  char errorBuffer[CURL_ERROR_SIZE];
+
+  /// Whether a Location header was seen in the current header block.
+  bool hasLocation = false;
+  bool headDelivered = false;
+  bool streaming = false;
+  bool paused = false;
+  /// Streamed bytes not acknowledged by the consumer yet.
+  size_t unacknowledgedBytes = 0;
+  /// Whether the Head event has been emitted; deliverHead() holds it back
+  /// for a 304 answering a revalidation.
+  bool headForwarded = false;
+  /// Keep the whole body in result.body while streaming, for followers.
+  bool retainBody = false;
+
+  /// The response may be stored in (and was looked up from) the cache.
+  bool cacheable = false;
+  /// Key in FetchClient::leaders_, if identical requests may join this one.
+  std::string dedupKey;
+  /// Waiting in FetchClient::loadingFromDisk_ for the disk tier of the
+  /// cache to be searched.
+  bool loadingFromDisk = false;
+  /// Ids of the requests that joined this one.
+  std::vector<int> followers;
+  /// The request itself was cancelled, but followers still wait for the
+  /// response. Its own events are no longer emitted.
+  bool detached = false;
+  /// Stored response being revalidated by this request.
+  HttpCache::EntryPtr revalidating;
+  /// When the request was sent, in seconds since the epoch.
+  int64_t requestTime = 0;
+
+  Transfer(FetchClient *client, NativeFetchRequest &&req)
+      : client(client), request(std::move(req)) {
+    result.id = request.id;
+    result.url = request.url;
+    errorBuffer[0] = '\0';
+  }
+
+  bool bodyComplete() const { return !streaming || retainBody; }
+
+  NativeFetchResult makeHead(int id) const {
+    NativeFetchResult head;
+    head.kind = NativeFetchResult::Kind::Head;
+    head.id = id;
+    head.ok = result.ok;
+    head.status = result.status;
+    head.statusText = result.statusText;
+    head.url = result.url;
+    head.headers = result.headers;
+    return head;
+  }
+
+  ~Transfer() {
+    if (headerList) {
+      curl_slist_free_all(headerList);
+    }
+    if (easy) {
+      curl_easy_cleanup(easy);
+    }
+  }
+
+  /// Create and configure the easy handle. Returns false on failure.
+  bool prepare() {
+    easy = curl_easy_init();
+    if (!easy) {
+      return false;
+    }
+
+    curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION,
+                     request.followRedirects ? 1L : 0L);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, writeBodyCallback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, this);
+    curl_easy_setopt(easy, CURLOPT_USERAGENT, "imgui-react-runtime/1.0");
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, errorBuffer);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+
+    // Prefer HTTP/2 over TLS and wait for an existing connection to the same
+    // origin rather than opening a new one, so requests get multiplexed.
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    if (request.timeoutMs >= 0) {
+      curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, request.timeoutMs);
+    }
+
+    if (!request.headers.empty()) {
+      for (const auto &header : request.headers) {
+        std::string headerLine = header.first + ": " + header.second;
+        headerList = curl_slist_append(headerList, headerLine.c_str());
+      }
+      curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headerList);
+    }
+
+    if (request.method == "GET") {
+      curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+    } else if (request.method == "POST") {
+      curl_easy_setopt(easy, CURLOPT_POST, 1L);
+    } else {
+      curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+    }
+
+    if (request.hasBody) {
+      // curl reads the body straight from the request; it is not copied.
+      static const char kEmptyBody[] = "";
+      curl_easy_setopt(easy, CURLOPT_POSTFIELDS,
+                       request.body.empty()
+                           ? kEmptyBody
+                           : reinterpret_cast<const char *>(request.body.data()));
+      curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE,
+                       static_cast<curl_off_t>(request.body.size()));
+    }
+    return true;
+  }
+
+  /// Send the Head event once the final response head is known.
+  void deliverHead() {
+    if (headDelivered) {
+      return;
+    }
+    headDelivered = true;
+
+    long statusCode = 0;
+    if (curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &statusCode) ==
+            CURLE_OK &&
+        statusCode != 0) {
+      result.status = static_cast<int>(statusCode);
+    }
+    result.ok = result.status >= 200 && result.status < 300;
+    if (result.statusText.empty()) {
+      result.statusText = defaultReasonPhrase(result.status);
+    }
+    char *effectiveUrl = nullptr;
+    if (curl_easy_getinfo(easy, CURLINFO_EFFECTIVE_URL, &effectiveUrl) ==
+            CURLE_OK &&
+        effectiveUrl) {
+      result.url = effectiveUrl;
+    }
+
+    if (revalidating && result.status == 304) {
+      // Answered from the cache once the transfer is done.
+      return;
+    }
+    headForwarded = true;
+    for (int follower : followers) {
+      client->onEvent_(makeHead(follower));
+    }
+    if (!detached) {
+      client->onEvent_(makeHead(result.id));
+    }
+  }
+
+  /// Hand \p bytes to the consumer as a Data event.
+  void deliverChunk(std::vector<unsigned char> &&bytes) {
+    unacknowledgedBytes += bytes.size();
+    NativeFetchResult chunk;
+    chunk.kind = NativeFetchResult::Kind::Data;
+    chunk.id = result.id;
+    chunk.body = std::move(bytes);
+    client->onEvent_(std::move(chunk));
+  }
+
+  size_t onBody(const unsigned char *data, size_t size) {
+    deliverHead();
+    if (!streaming) {
+      result.body.insert(result.body.end(), data, data + size);
+      return size;
+    }
+    if (unacknowledgedBytes > 0 &&
+        unacknowledgedBytes + size > kStreamWindowBytes) {
+      // The consumer is behind; curl keeps this chunk and delivers it again
+      // after curl_easy_pause(CURLPAUSE_CONT).
+      paused = true;
+      return CURL_WRITEFUNC_PAUSE;
+    }
+    if (retainBody) {
+      result.body.insert(result.body.end(), data, data + size);
+    }
+    deliverChunk(std::vector<unsigned char>(data, data + size));
+    return size;
+  }
+
+  void onHeaderLine(std::string line) {
+    while (!line.empty() &&
+           (line.back() == '\r' || line.back() == '\n')) {
+      line.pop_back();
+    }
+
+    if (line.empty()) {
+      // End of a header block. Informational responses and redirects that
+      // curl is about to follow are followed by another block.
+      bool intermediate =
+          (result.status >= 100 && result.status < 200) ||
+          (request.followRedirects && hasLocation &&
+           isRedirectStatus(result.status));
+      if (!intermediate && result.status != 0) {
+        deliverHead();
+      }
+      return;
+    }
+
+    if (headDelivered) {
+      // Trailers are not exposed.
+      return;
+    }
+
+    if (line.rfind("HTTP/", 0) == 0) {
+      // Status line, reset headers for final response segment
+      result.headers.clear();
+      hasLocation = false;
+      size_t firstSpace = line.find(' ');
+      if (firstSpace != std::string::npos) {
+        size_t secondSpace = line.find(' ', firstSpace + 1);
+        std::string statusCodeStr =
+            line.substr(firstSpace + 1, secondSpace == std::string::npos
+                                            ? std::string::npos
+                                            : secondSpace - firstSpace - 1);
+        try {
+          result.status = std::stoi(statusCodeStr);
+        } catch (...) {
+          result.status = 0;
+        }
+        // HTTP/2 status lines have no reason phrase.
+        result.statusText = secondSpace == std::string::npos
+                                ? std::string()
+                                : trim(line.substr(secondSpace + 1));
+      }
+    } else {
+      size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        std::string key = trim(line.substr(0, colon));
+        std::string value = trim(line.substr(colon + 1));
+        if (equalsIgnoreCase(key, "content-length")) {
+          // Size the body up front so it is written without reallocations.
+          unsigned long long length = strtoull(value.c_str(), nullptr, 10);
+          if (length > 0 && length <= kMaxBodyReserve) {
+            result.body.reserve((size_t)length);
+          }
+        } else if (equalsIgnoreCase(key, "location")) {
+          hasLocation = true;
+        }
+        result.headers.emplace_back(std::move(key), std::move(value));
+      }
+    }
+  }
+
+  static size_t writeBodyCallback(void *contents, size_t size, size_t nmemb,
+                                  void *userp) {
+    return static_cast<Transfer *>(userp)->onBody(
+        static_cast<const unsigned char *>(contents), size * nmemb);
+  }
+
+  static size_t headerCallback(char *buffer, size_t size, size_t nitems,
+                               void *userp) {
+    size_t total = size * nitems;
+    static_cast<Transfer *>(userp)->onHeaderLine(std::string(buffer, total));
+    return total;
+  }
+};
+
+FetchClient::FetchClient(EventCallback onEvent)
+    : onEvent_(std::move(onEvent)), multi_(curl_multi_init()) {
+  if (multi_) {
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS,
+                      kMaxHostConnections);
+    curl_multi_setopt(multi_, CURLMOPT_MAXCONNECTS, kMaxCachedConnections);
+  }
+}
+
+FetchClient::~FetchClient() { shutdown(); }
+
+void FetchClient::start(NativeFetchRequest &&request) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopping_ && multi_) {
+      pending_.push_back(std::move(request));
+      ++inFlight_;
+      if (!thread_.joinable()) {
+        thread_ = std::thread(&FetchClient::run, this);
+      }
+      curl_multi_wakeup(multi_);
+      return;
+    }
+  }
+
+  NativeFetchResult result;
+  result.id = request.id;
+  result.url = request.url;
+  result.errorMessage = "Failed to initialize CURL";
+  onEvent_(std::move(result));
+}
+
+void FetchClient::streamBody(int id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (multi_) {
+    commands_.push_back(Command{Command::Type::StreamBody, id});
+    curl_multi_wakeup(multi_);
+  }
+}
+
+void FetchClient::acknowledge(int id, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (multi_) {
+    commands_.push_back(Command{Command::Type::Acknowledge, id, bytes});
+    curl_multi_wakeup(multi_);
+  }
+}
+
+void FetchClient::cancel(int id, const std::string &reason) {
+  NativeFetchRequest cancelled;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!multi_) {
+      return;
+    }
+    auto it = std::find_if(pending_.begin(), pending_.end(),
+                           [id](const NativeFetchRequest &request) {
+                             return request.id == id;
+                           });
+    if (it == pending_.end()) {
+      commands_.push_back(Command{Command::Type::Cancel, id, 0, reason});
+      curl_multi_wakeup(multi_);
+      return;
+    }
+    // Not handed to curl yet.
+    cancelled = std::move(*it);
+    pending_.erase(it);
+  }
+  completeWithError(cancelled.id, std::move(cancelled.url), reason);
+}
+
+void FetchClient::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!multi_) {
+      return;
+    }
+    stopping_ = true;
+    curl_multi_wakeup(multi_);
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  // Finishes the cache writes; lookups still queued report into loaded_,
+  // which nobody reads anymore.
+  cache_.shutdown();
+  std::lock_guard<std::mutex> lock(mutex_);
+  curl_multi_cleanup(multi_);
+  multi_ = nullptr;
+}
+
+size_t FetchClient::activeTransfers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return inFlight_;
+}
+
+void FetchClient::run() {
+  traceSetThreadName("fetch I/O");
+
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) {
+        break;
+      }
+    }
+    addPendingTransfers();
+    resumeLoadedTransfers();
+    applyCommands();
+
+    int running = 0;
+    curl_multi_perform(multi_, &running);
+
+    CURLMsg *message;
+    int remaining = 0;
+    while ((message = curl_multi_info_read(multi_, &remaining))) {
+      if (message->msg == CURLMSG_DONE) {
+        finishTransfer(message->easy_handle, message->data.result);
+      }
+    }
+
+    // Sleeps until a socket is ready, a curl timeout expires or another
+    // thread calls curl_multi_wakeup().
+    curl_multi_poll(multi_, nullptr, 0, kPollTimeoutMs, nullptr);
+  }
+
+  for (auto &entry : active_) {
+    curl_multi_remove_handle(multi_, entry.first);
+  }
+  active_.clear();
+  loadingFromDisk_.clear();
+  easyById_.clear();
+  leaders_.clear();
+  followerOf_.clear();
+}
+
+void FetchClient::addPendingTransfers() {
+  std::vector<NativeFetchRequest> requests;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests.swap(pending_);
+  }
+
+  for (auto &request : requests) {
+    auto transfer = std::make_unique<Transfer>(this, std::move(request));
+    if (!serveFromCache(*transfer)) {
+      startTransfer(std::move(transfer));
+    } else if (transfer->loadingFromDisk) {
+      int id = transfer->result.id;
+      loadingFromDisk_.emplace(id, std::move(transfer));
+    }
+  }
+}
+
+void FetchClient::resumeLoadedTransfers() {
+  std::vector<std::pair<int, HttpCache::EntryPtr>> loaded;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loaded.swap(loaded_);
+  }
+
+  for (auto &item : loaded) {
+    auto it = loadingFromDisk_.find(item.first);
+    if (it == loadingFromDisk_.end()) {
+      continue; // cancelled meanwhile
+    }
+    std::unique_ptr<Transfer> transfer = std::move(it->second);
+    loadingFromDisk_.erase(it);
+    transfer->loadingFromDisk = false;
+    std::string key = std::move(transfer->dedupKey);
+    if (!useCachedEntry(*transfer, std::move(item.second), std::move(key))) {
+      startTransfer(std::move(transfer));
+    }
+  }
+}
+
+void FetchClient::startTransfer(std::unique_ptr<Transfer> transfer) {
+  transfer->requestTime = (int64_t)std::time(nullptr);
+  if (!transfer->prepare() ||
+      curl_multi_add_handle(multi_, transfer->easy) != CURLM_OK) {
+    completeWithError(transfer->result.id, std::move(transfer->result.url),
+                      "Failed to initialize CURL");
+    return;
+  }
+  CURL *easy = transfer->easy;
+  easyById_[transfer->result.id] = easy;
+  if (!transfer->dedupKey.empty()) {
+    leaders_[transfer->dedupKey] = easy;
+  }
+  active_.emplace(easy, std::move(transfer));
+}
+
+bool FetchClient::serveFromCache(Transfer &transfer) {
+  NativeFetchRequest &request = transfer.request;
+  const std::string &mode = request.cacheMode;
+  if (request.method != "GET" || request.hasBody || mode == "no-store" ||
+      !cache_.enabled() || HttpCache::requestForbidsStore(request.headers)) {
+    return false;
+  }
+
+  std::string key = dedupKey(request);
+  auto leaderIt = leaders_.find(key);
+  if (leaderIt != leaders_.end()) {
+    Transfer &leader = *active_.at(leaderIt->second);
+    // A streamed body is only complete if it is retained for followers.
+    if (leader.bodyComplete()) {
+      leader.followers.push_back(request.id);
+      followerOf_[request.id] = leader.easy;
+      cache_.countDeduplicated();
+      if (leader.headForwarded) {
+        onEvent_(leader.makeHead(request.id));
+      }
+      return true;
+    }
+  }
+
+  HttpCache::EntryPtr cached;
+  if (mode != "reload") {
+    cached = cache_.lookup(request.url, request.headers);
+    if (!cached) {
+      // Disk reads stay off this thread; resumeLoadedTransfers() picks the
+      // request up again when the cache worker is done.
+      int id = request.id;
+      transfer.loadingFromDisk = cache_.lookupDisk(
+          request.url, request.headers, [this, id](HttpCache::EntryPtr entry) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            loaded_.emplace_back(id, std::move(entry));
+            if (multi_) {
+              curl_multi_wakeup(multi_);
+            }
+          });
+      if (transfer.loadingFromDisk) {
+        transfer.dedupKey = std::move(key);
+        return true;
+      }
+    }
+  }
+  return useCachedEntry(transfer, std::move(cached), std::move(key));
+}
+
+bool FetchClient::useCachedEntry(Transfer &transfer,
+                                 HttpCache::EntryPtr cached, std::string key) {
+  NativeFetchRequest &request = transfer.request;
+  const std::string &mode = request.cacheMode;
+  if (cached) {
+    bool revalidate = mode == "no-cache" ||
+                      HttpCache::requestRequiresRevalidation(request.headers);
+    if (mode == "force-cache" ||
+        (!revalidate && cached->isFresh((int64_t)std::time(nullptr)))) {
+      cache_.countHit();
+      completeFromCache(request.id, *cached);
+      return true;
+    }
+    // Conditional headers set by the caller are passed through as is.
+    if (cached->hasValidators() && !hasHeader(request.headers, "if-none-match") &&
+        !hasHeader(request.headers, "if-modified-since")) {
+      if (!cached->etag.empty()) {
+        request.headers.emplace_back("If-None-Match", cached->etag);
+      }
+      if (!cached->lastModified.empty()) {
+        request.headers.emplace_back("If-Modified-Since", cached->lastModified);
+      }
+      transfer.revalidating = cached;
+    }
+  }
+  transfer.cacheable = true;
+  transfer.dedupKey = std::move(key);
+  return false;
+}
+
+void FetchClient::applyCommands() {
+  std::vector<Command> commands;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands.swap(commands_);
+  }
+
+  for (Command &command : commands) {
+    auto loadingIt = loadingFromDisk_.find(command.id);
+    if (loadingIt != loadingFromDisk_.end()) {
+      // Not sent yet, so nothing was buffered or streamed.
+      Transfer &transfer = *loadingIt->second;
+      if (command.type == Command::Type::StreamBody) {
+        transfer.streaming = true;
+      } else if (command.type == Command::Type::Cancel) {
+        std::string url = std::move(transfer.request.url);
+        loadingFromDisk_.erase(loadingIt);
+        completeWithError(command.id, std::move(url), command.reason);
+      }
+      continue;
+    }
+    if (command.type == Command::Type::Cancel) {
+      auto followerIt = followerOf_.find(command.id);
+      if (followerIt != followerOf_.end()) {
+        Transfer &leader = *active_.at(followerIt->second);
+        followerOf_.erase(followerIt);
+        leader.followers.erase(std::remove(leader.followers.begin(),
+                                           leader.followers.end(), command.id),
+                               leader.followers.end());
+        completeWithError(command.id, leader.request.url, command.reason);
+        continue;
+      }
+    }
+
+    auto idIt = easyById_.find(command.id);
+    if (idIt == easyById_.end()) {
+      continue; // already finished
+    }
+    CURL *easy = idIt->second;
+    Transfer &transfer = *active_.at(easy);
+
+    switch (command.type) {
+    case Command::Type::StreamBody:
+      if (!transfer.streaming) {
+        transfer.streaming = true;
+        if (!transfer.followers.empty()) {
+          // Followers get the whole body with End.
+          transfer.retainBody = true;
+          if (!transfer.result.body.empty()) {
+            transfer.deliverChunk(std::vector<unsigned char>(
+                transfer.result.body.begin(), transfer.result.body.end()));
+          }
+        } else if (!transfer.result.body.empty()) {
+          transfer.deliverChunk(std::move(transfer.result.body));
+          transfer.result.body = {};
+        }
+      }
+      break;
+    case Command::Type::Acknowledge:
+      transfer.unacknowledgedBytes -=
+          std::min(transfer.unacknowledgedBytes, command.bytes);
+      if (transfer.paused &&
+          transfer.unacknowledgedBytes <= kStreamWindowBytes / 2) {
+        transfer.paused = false;
+        // May call the write callback right away with the held chunk.
+        curl_easy_pause(easy, CURLPAUSE_CONT);
+      }
+      break;
+    case Command::Type::Cancel:
+      if (transfer.followers.empty()) {
+        finishTransfer(easy, CURLE_ABORTED_BY_CALLBACK, command.reason);
+      } else {
+        detachLeader(transfer, command.reason);
+      }
+      break;
+    }
+  }
+}
+
+void FetchClient::detachLeader(Transfer &transfer, const std::string &reason) {
+  transfer.detached = true;
+  easyById_.erase(transfer.result.id);
+  if (transfer.streaming) {
+    // Nobody acknowledges chunks anymore; buffer the rest for the followers.
+    transfer.streaming = false;
+    transfer.unacknowledgedBytes = 0;
+    if (transfer.paused) {
+      transfer.paused = false;
+      curl_easy_pause(transfer.easy, CURLPAUSE_CONT);
+    }
+  }
+  completeWithError(transfer.result.id, transfer.request.url, reason);
+}
+
+void FetchClient::finishTransfer(CURL *easy, CURLcode code,
+                                 const std::string &errorOverride) {
+  auto it = active_.find(easy);
+  if (it == active_.end()) {
+    return;
+  }
+  std::unique_ptr<Transfer> transfer = std::move(it->second);
+  active_.erase(it);
+  if (!transfer->detached) {
+    easyById_.erase(transfer->result.id);
+  }
+  auto leaderIt = leaders_.find(transfer->dedupKey);
+  if (leaderIt != leaders_.end() && leaderIt->second == easy) {
+    leaders_.erase(leaderIt);
+  }
+  for (int follower : transfer->followers) {
+    followerOf_.erase(follower);
+  }
+  curl_multi_remove_handle(multi_, easy);
+
+  NativeFetchResult &result = transfer->result;
+  if (!errorOverride.empty()) {
+    result.errorMessage = errorOverride;
+  } else if (code != CURLE_OK) {
+    if (transfer->errorBuffer[0] != '\0') {
+      result.errorMessage = transfer->errorBuffer;
+    } else {
+      result.errorMessage = curl_easy_strerror(code);
+    }
+  } else {
+    transfer->deliverHead();
+    if (transfer->revalidating && result.status == 304) {
+      HttpCache::EntryPtr entry =
+          cache_.refresh(transfer->revalidating, result.headers,
+                         transfer->requestTime, (int64_t)std::time(nullptr));
+      cache_.countRevalidated();
+      for (int follower : transfer->followers) {
+        completeFromCache(follower, *entry);
+      }
+      if (!transfer->detached) {
+        completeFromCache(result.id, *entry);
+      }
+      return;
+    }
+    if (transfer->cacheable) {
+      cache_.countMiss();
+      bool stored =
+          transfer->bodyComplete() &&
+          cache_.store(transfer->request.url, transfer->request.headers,
+                       result.status, result.statusText, result.headers,
+                       result.body, transfer->requestTime,
+                       (int64_t)std::time(nullptr));
+      if (!stored && transfer->revalidating) {
+        // The stored response was replaced by one that cannot be cached.
+        cache_.invalidate(transfer->request.url);
+      }
+    } else if (transfer->request.method != "GET" &&
+               transfer->request.method != "HEAD" && result.status < 400 &&
+               cache_.enabled()) {
+      cache_.invalidate(transfer->request.url);
+    }
+  }
+
+  std::string error = std::move(result.errorMessage);
+  std::vector<unsigned char> body;
+  if (error.empty() && transfer->bodyComplete()) {
+    body = std::move(result.body);
+  }
+  int id = result.id;
+  bool detached = transfer->detached;
+  std::vector<int> followers = std::move(transfer->followers);
+  transfer.reset();
+
+  for (int follower : followers) {
+    NativeFetchResult end;
+    end.id = follower;
+    end.errorMessage = error;
+    end.body = body;
+    complete(std::move(end));
+  }
+  if (!detached) {
+    NativeFetchResult end;
+    end.id = id;
+    end.errorMessage = std::move(error);
+    end.body = std::move(body);
+    complete(std::move(end));
+  }
+}
+
+void FetchClient::completeWithError(int id, std::string url,
+                                    std::string message) {
+  NativeFetchResult result;
+  result.id = id;
+  result.url = std::move(url);
+  result.errorMessage = std::move(message);
+  complete(std::move(result));
+}
+
+void FetchClient::completeFromCache(int id, const HttpCache::Entry &entry) {
+  NativeFetchResult head;
+  head.kind = NativeFetchResult::Kind::Head;
+  head.id = id;
+  head.ok = entry.status >= 200 && entry.status < 300;
+  head.status = entry.status;
+  head.statusText = entry.statusText;
+  head.url = entry.url;
+  head.headers = entry.headers;
+  onEvent_(std::move(head));
+
+  NativeFetchResult end;
+  end.id = id;
+  end.body = entry.body;
+  complete(std::move(end));
+}
+
+void FetchClient::complete(NativeFetchResult &&end) {
+  end.kind = NativeFetchResult::Kind::End;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --inFlight_;
+  }
+  onEvent_(std::move(end));
+}
@@ -0,0 +1,179 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include "HttpCache.h"
+
+#include <curl/curl.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct NativeFetchRequest {
+  int id = 0;
+  std::string url;
+  std::string method = "GET";
+  std::vector<std::pair<std::string, std::string>> headers;
+  /// Request body bytes; strings are sent as UTF-8.
+  std::vector<unsigned char> body;
+  bool hasBody = false;
+  long timeoutMs = -1;
+  bool followRedirects = true;
+  /// fetch() `cache` mode: "default", "no-store", "reload", "no-cache" or
+  /// "force-cache". Only used when the HttpCache is enabled.
+  std::string cacheMode;
+};
+
+/// One step of a fetch, delivered in order per request id:
+///  - Head: the final response head (status, headers, url) is known.
+///  - Data: a chunk of a streamed body (see FetchClient::streamBody()).
+///  - End: the transfer is over. Carries the buffered body, or errorMessage
+///    if it failed. An End with an error and no preceding Head means the
+///    request failed before a response arrived.
+struct NativeFetchResult {
+  enum class Kind { Head, Data, End };
+
+  Kind kind = Kind::End;
+  int id = 0;
+  bool ok = false;
+  int status = 0;
+  std::string statusText;
+  std::string url;
+  std::string errorMessage;
+  std::vector<std::pair<std::string, std::string>> headers;
+  /// Raw response body; handed to JS as an ArrayBuffer without copying.
+  std::vector<unsigned char> body;
+};
+
+/// Runs all native fetches on a single I/O thread driving a curl multi handle.
+///
+/// Sharing one multi handle gives every request the same connection and DNS
+/// cache, so keep-alive connections are reused across requests and HTTP/2
+/// requests to the same origin are multiplexed over one connection instead of
+/// paying for a new TCP/TLS handshake each time.
+///
+/// Bodies are buffered natively and delivered with End, unless the consumer
+/// switches the transfer to streaming. Streamed chunks count against a
+/// bounded window until acknowledged; when the window is full the transfer is
+/// paused (CURL_WRITEFUNC_PAUSE) until the consumer catches up.
+///
+/// With the cache enabled, GET requests are answered from it when possible,
+/// stale entries are revalidated with a conditional request, and a GET that
+/// is identical to one already in flight joins it instead of opening another
+/// transfer: it receives copies of the Head and End of that request. The I/O
+/// thread only consults the cache's memory index; disk lookups run on the
+/// cache's worker and hand the request back when done.
+///
+/// The client does not know about JS: events are handed to the callback on
+/// the I/O thread, which is expected to queue them for the main thread and
+/// wake it up.
+class FetchClient {
+public:
+  using EventCallback = std::function<void(NativeFetchResult &&)>;
+
+  /// Unacknowledged streamed bytes after which a transfer is paused.
+  static constexpr size_t kStreamWindowBytes = 1 << 20;
+
+  explicit FetchClient(EventCallback onEvent);
+  /// Stops the I/O thread. Transfers still in flight are dropped without
+  /// invoking the callback.
+  ~FetchClient();
+
+  FetchClient(const FetchClient &) = delete;
+  FetchClient &operator=(const FetchClient &) = delete;
+
+  /// Queue a request. Thread-safe; the I/O thread is started on first use.
+  void start(NativeFetchRequest &&request);
+
+  /// Deliver the rest of the body of request \p id as Data events instead of
+  /// buffering it for End. Whatever was buffered so far becomes the first
+  /// chunk. Thread-safe.
+  void streamBody(int id);
+
+  /// Report that \p bytes of streamed data of request \p id were consumed,
+  /// resuming the transfer if it was paused. Thread-safe.
+  void acknowledge(int id, size_t bytes);
+
+  /// Abort request \p id. It ends with \p reason as its error unless it has
+  /// already completed. Thread-safe.
+  void cancel(int id, const std::string &reason);
+
+  /// Stop the I/O thread and drop pending transfers. Called by the
+  /// destructor, but may be called earlier (e.g. before curl_global_cleanup).
+  void shutdown();
+
+  /// Number of transfers queued or in flight.
+  size_t activeTransfers() const;
+
+  /// HTTP cache consulted for GET requests; disabled by default.
+  HttpCache &cache() { return cache_; }
+
+private:
+  struct Transfer;
+
+  struct Command {
+    enum class Type { StreamBody, Acknowledge, Cancel };
+    Command(Type type, int id, size_t bytes = 0, std::string reason = {})
+        : type(type), id(id), bytes(bytes), reason(std::move(reason)) {}
+
+    Type type;
+    int id;
+    size_t bytes;
+    std::string reason;
+  };
+
+  void run();
+  void addPendingTransfers();
+  void applyCommands();
+  void finishTransfer(CURL *easy, CURLcode code,
+                      const std::string &errorOverride = {});
+  void completeWithError(int id, std::string url, std::string message);
+  void completeFromCache(int id, const HttpCache::Entry &entry);
+  /// Emit \p end and account for the request being done.
+  void complete(NativeFetchResult &&end);
+  /// Consult the cache for the request of \p transfer. Returns true if it was
+  /// answered from the cache, joined a transfer in flight or waits for the
+  /// disk tier (Transfer::loadingFromDisk).
+  bool serveFromCache(Transfer &transfer);
+  /// Answer the request of \p transfer with \p cached if it is fresh, or
+  /// prepare its revalidation. Returns true if it was answered.
+  bool useCachedEntry(Transfer &transfer, HttpCache::EntryPtr cached,
+                      std::string key);
+  /// Continue the requests whose disk lookups completed.
+  void resumeLoadedTransfers();
+  /// Hand \p transfer to curl.
+  void startTransfer(std::unique_ptr<Transfer> transfer);
+  /// Detach a cancelled leader from the followers still waiting for it.
+  void detachLeader(Transfer &transfer, const std::string &reason);
+
+  EventCallback onEvent_;
+  HttpCache cache_;
+  CURLM *multi_ = nullptr;
+  std::thread thread_;
+
+  mutable std::mutex mutex_;
+  std::vector<NativeFetchRequest> pending_;
+  std::vector<Command> commands_;
+  /// Disk lookups done by the cache worker: request id -> entry or null.
+  std::vector<std::pair<int, HttpCache::EntryPtr>> loaded_;
+  size_t inFlight_ = 0;
+  bool stopping_ = false;
+
+  /// Transfers attached to the multi handle, only touched by the I/O thread.
+  std::unordered_map<CURL *, std::unique_ptr<Transfer>> active_;
+  /// Requests waiting for HttpCache::lookupDisk(), by id.
+  std::unordered_map<int, std::unique_ptr<Transfer>> loadingFromDisk_;
+  std::unordered_map<int, CURL *> easyById_;
+  /// Deduplication key -> transfer that identical GETs can join.
+  std::unordered_map<std::string, CURL *> leaders_;
+  /// Id of a request that joined another transfer -> that transfer.
+  std::unordered_map<int, CURL *> followerOf_;
+};
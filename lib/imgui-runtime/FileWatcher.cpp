@@ -0,0 +1,451 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "FileWatcher.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// Upper bound on how long events for one entry are held back.
+constexpr auto kMaxDelay = std::chrono::seconds(1);
+
+#if !defined(__linux__)
+constexpr auto kPollInterval = std::chrono::milliseconds(250);
+#endif
+
+std::string joinRelative(const std::string &directory,
+                         const std::string &name) {
+  if (directory.empty()) {
+    return name;
+  }
+  if (name.empty()) {
+    return directory;
+  }
+  return directory + "/" + name;
+}
+
+} // namespace
+
+FileWatcher::FileWatcher(Callback callback) : callback_(std::move(callback)) {}
+
+FileWatcher::~FileWatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+#if defined(__linux__)
+  for (int fd : {inotifyFd_, wakePipe_[0], wakePipe_[1]}) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+#endif
+}
+
+int FileWatcher::watch(const std::string &path, bool recursive,
+                       int debounceMs, bool mustExist) {
+  std::error_code ec;
+  auto status = fs::status(path, ec);
+  bool exists = !ec && fs::exists(status);
+  if (!exists && mustExist) {
+    throw std::system_error(
+        std::make_error_code(std::errc::no_such_file_or_directory),
+        "watch '" + path + "'");
+  }
+
+  Watch watch;
+  fs::path target(path);
+  if (exists && fs::is_directory(status)) {
+    watch.root = path;
+    watch.recursive = recursive;
+  } else {
+    watch.root = target.has_parent_path() ? target.parent_path().string() : ".";
+    watch.fileName = target.filename().string();
+  }
+  watch.debounce = std::chrono::milliseconds(std::max(debounceMs, 0));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  start();
+  int id = nextId_++;
+  auto &added = watches_.emplace(id, std::move(watch)).first->second;
+  try {
+#if defined(__linux__)
+    if (added.recursive) {
+      addTree(id, added.root, "");
+    } else {
+      addDirectory(id, added.root, "");
+    }
+#else
+    scan(id, added, Clock::now(), false);
+#endif
+  } catch (...) {
+    removeWatch(id);
+    throw;
+  }
+  return id;
+}
+
+void FileWatcher::unwatch(int id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  removeWatch(id);
+}
+
+void FileWatcher::removeWatch(int id) {
+  auto it = watches_.find(id);
+  if (it == watches_.end()) {
+    return;
+  }
+#if defined(__linux__)
+  for (int wd : it->second.descriptors) {
+    auto directory = directories_.find(wd);
+    if (directory == directories_.end()) {
+      continue;
+    }
+    auto &users = directory->second;
+    users.erase(std::remove_if(users.begin(), users.end(),
+                               [id](const DirectoryUser &user) {
+                                 return user.watchId == id;
+                               }),
+                users.end());
+    if (users.empty()) {
+      inotify_rm_watch(inotifyFd_, wd);
+      directories_.erase(directory);
+      directoryPaths_.erase(wd);
+    }
+  }
+#endif
+  watches_.erase(it);
+  for (auto pending = pending_.begin(); pending != pending_.end();) {
+    if (pending->second.event.watchId == id) {
+      pending = pending_.erase(pending);
+    } else {
+      ++pending;
+    }
+  }
+}
+
+void FileWatcher::start() {
+  if (thread_.joinable()) {
+    return;
+  }
+#if defined(__linux__)
+  inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "inotify_init1");
+  }
+  if (::pipe2(wakePipe_, O_NONBLOCK | O_CLOEXEC) != 0) {
+    int error = errno;
+    ::close(inotifyFd_);
+    inotifyFd_ = -1;
+    throw std::system_error(error, std::generic_category(), "pipe2");
+  }
+#endif
+  thread_ = std::thread(&FileWatcher::run, this);
+}
+
+void FileWatcher::wake() {
+#if defined(__linux__)
+  if (wakePipe_[1] >= 0) {
+    char byte = 1;
+    (void)!::write(wakePipe_[1], &byte, 1);
+  }
+#else
+  wakeCv_.notify_all();
+#endif
+}
+
+void FileWatcher::queue(int watchId, const char *type, std::string filename,
+                        Clock::time_point now) {
+  auto watch = watches_.find(watchId);
+  if (watch == watches_.end()) {
+    return;
+  }
+  std::string key = std::to_string(watchId);
+  key += '\0';
+  key += type;
+  key += '\0';
+  key += filename;
+  auto [it, inserted] = pending_.try_emplace(std::move(key));
+  Pending &pending = it->second;
+  if (inserted) {
+    pending.event.watchId = watchId;
+    pending.event.type = type;
+    pending.event.filename = std::move(filename);
+    pending.first = now;
+  }
+  pending.due = std::min(now + watch->second.debounce, pending.first + kMaxDelay);
+}
+
+FileWatcher::Clock::time_point
+FileWatcher::deliver(std::unique_lock<std::mutex> &lock) {
+  auto now = Clock::now();
+  auto next = Clock::time_point::max();
+  std::vector<Event> ready;
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    if (it->second.due <= now) {
+      ready.push_back(std::move(it->second.event));
+      it = pending_.erase(it);
+    } else {
+      next = std::min(next, it->second.due);
+      ++it;
+    }
+  }
+  if (!ready.empty()) {
+    lock.unlock();
+    for (auto &event : ready) {
+      callback_(std::move(event));
+    }
+    lock.lock();
+  }
+  return next;
+}
+
+#if defined(__linux__)
+
+void FileWatcher::run() {
+  traceSetThreadName("file watcher");
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    auto next = deliver(lock);
+    if (stopping_) {
+      break;
+    }
+    int timeout = -1;
+    if (next != Clock::time_point::max()) {
+      auto wait = std::chrono::ceil<std::chrono::milliseconds>(next -
+                                                               Clock::now());
+      timeout = static_cast<int>(std::max<long long>(wait.count(), 0));
+    }
+
+    lock.unlock();
+    pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakePipe_[0], POLLIN, 0}};
+    int ready = ::poll(fds, 2, timeout);
+    lock.lock();
+
+    if (ready <= 0) {
+      continue;
+    }
+    if (fds[1].revents & POLLIN) {
+      char drain[64];
+      while (::read(wakePipe_[0], drain, sizeof(drain)) > 0) {
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      readEvents();
+    }
+  }
+}
+
+void FileWatcher::addDirectory(int watchId, const std::string &path,
+                               const std::string &relative) {
+  constexpr uint32_t kMask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+                             IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                             IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                             IN_ONLYDIR;
+  int wd = inotify_add_watch(inotifyFd_, path.c_str(), kMask);
+  if (wd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "watch '" + path + "'");
+  }
+  directories_[wd].push_back({watchId, relative});
+  directoryPaths_[wd] = path;
+  watches_[watchId].descriptors.push_back(wd);
+}
+
+void FileWatcher::addTree(int watchId, const std::string &path,
+                          const std::string &relative) {
+  addDirectory(watchId, path, relative);
+  std::error_code ec;
+  for (fs::recursive_directory_iterator
+           it(path, fs::directory_options::skip_permission_denied, ec),
+       end;
+       !ec && it != end; it.increment(ec)) {
+    std::error_code entryEc;
+    if (it->is_symlink(entryEc) || !it->is_directory(entryEc)) {
+      continue;
+    }
+    std::string sub = joinRelative(
+        relative, it->path().lexically_relative(path).generic_string());
+    try {
+      addDirectory(watchId, it->path().string(), sub);
+    } catch (const std::system_error &) {
+      // Removed or unreadable since it was listed.
+    }
+  }
+}
+
+void FileWatcher::readEvents() {
+  alignas(struct inotify_event) char buffer[16384];
+  auto now = Clock::now();
+  for (;;) {
+    ssize_t length = ::read(inotifyFd_, buffer, sizeof(buffer));
+    if (length <= 0) {
+      return;
+    }
+    for (char *cursor = buffer; cursor < buffer + length;) {
+      auto *event = reinterpret_cast<struct inotify_event *>(cursor);
+      cursor += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        for (auto &entry : watches_) {
+          queue(entry.first, "rename", "", now);
+        }
+        continue;
+      }
+      auto directory = directories_.find(event->wd);
+      if (directory == directories_.end()) {
+        continue;
+      }
+      if (event->mask & IN_IGNORED) {
+        // The directory is gone and the kernel dropped its watch.
+        for (const auto &user : directory->second) {
+          auto watch = watches_.find(user.watchId);
+          if (watch != watches_.end()) {
+            auto &wds = watch->second.descriptors;
+            wds.erase(std::remove(wds.begin(), wds.end(), event->wd),
+                      wds.end());
+          }
+        }
+        directories_.erase(directory);
+        directoryPaths_.erase(event->wd);
+        continue;
+      }
+
+      std::string name = event->len ? event->name : "";
+      const char *type =
+          (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                          IN_DELETE_SELF | IN_MOVE_SELF))
+              ? "rename"
+              : "change";
+      bool newDirectory = (event->mask & IN_ISDIR) &&
+                          (event->mask & (IN_CREATE | IN_MOVED_TO));
+      // Copied: adding watches for a new subdirectory may rehash the map.
+      auto users = directory->second;
+      std::string directoryPath = directoryPaths_[event->wd];
+      for (const auto &user : users) {
+        auto watch = watches_.find(user.watchId);
+        if (watch == watches_.end()) {
+          continue;
+        }
+        if (!watch->second.fileName.empty()) {
+          if (name == watch->second.fileName) {
+            queue(user.watchId, type, name, now);
+          }
+          continue;
+        }
+        // Subdirectories report their own removal through their parent.
+        if (name.empty() && !user.relative.empty()) {
+          continue;
+        }
+        std::string filename = joinRelative(user.relative, name);
+        if (filename.empty()) {
+          filename = fs::path(watch->second.root).filename().string();
+        }
+        if (newDirectory && watch->second.recursive) {
+          try {
+            addTree(user.watchId, directoryPath + "/" + name, filename);
+          } catch (const std::system_error &) {
+            // Already gone again.
+          }
+        }
+        queue(user.watchId, type, std::move(filename), now);
+      }
+    }
+  }
+}
+
+#else
+
+void FileWatcher::run() {
+  traceSetThreadName("file watcher");
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto lastScan = Clock::now();
+  while (!stopping_) {
+    auto next = deliver(lock);
+    if (stopping_) {
+      break;
+    }
+    wakeCv_.wait_until(lock, std::min(next, lastScan + kPollInterval));
+    auto now = Clock::now();
+    if (!stopping_ && now >= lastScan + kPollInterval) {
+      for (auto &entry : watches_) {
+        scan(entry.first, entry.second, now, true);
+      }
+      lastScan = now;
+    }
+  }
+}
+
+void FileWatcher::scan(int watchId, Watch &watch, Clock::time_point now,
+                       bool report) {
+  decltype(watch.snapshot) current;
+  auto record = [&current](const fs::path &path, std::string name) {
+    std::error_code ec;
+    auto status = fs::status(path, ec);
+    if (ec || !fs::exists(status)) {
+      return;
+    }
+    long long mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    unsigned long long size =
+        fs::is_regular_file(status) ? fs::file_size(path, ec) : 0;
+    current[std::move(name)] = {mtime, size};
+  };
+
+  std::error_code ec;
+  if (!watch.fileName.empty()) {
+    record(fs::path(watch.root) / watch.fileName, watch.fileName);
+  } else if (watch.recursive) {
+    for (fs::recursive_directory_iterator
+             it(watch.root, fs::directory_options::skip_permission_denied, ec),
+         end;
+         !ec && it != end; it.increment(ec)) {
+      record(it->path(),
+             it->path().lexically_relative(watch.root).generic_string());
+    }
+  } else {
+    for (fs::directory_iterator it(watch.root, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      record(it->path(), it->path().filename().string());
+    }
+  }
+
+  if (report) {
+    for (const auto &[name, info] : current) {
+      auto previous = watch.snapshot.find(name);
+      if (previous == watch.snapshot.end()) {
+        queue(watchId, "rename", name, now);
+      } else if (previous->second != info) {
+        queue(watchId, "change", name, now);
+      }
+    }
+    for (const auto &entry : watch.snapshot) {
+      if (!current.count(entry.first)) {
+        queue(watchId, "rename", entry.first, now);
+      }
+    }
+  }
+  watch.snapshot = std::move(current);
+}
+
+#endif
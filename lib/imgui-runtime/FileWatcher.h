@@ -0,0 +1,118 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// Watches files and directories for changes on one background thread.
+///
+/// On Linux this uses inotify; a file is watched through its parent directory
+/// so that editors and bundlers replacing it with a rename are still seen.
+/// Other platforms compare modification times and sizes a few times a second.
+///
+/// Events for the same entry are debounced: they are delivered once nothing
+/// has happened to it for the watch's debounce interval (but at most a second
+/// after the first one), so a burst of writes produces a single event. The
+/// callback runs on the watcher thread.
+class FileWatcher {
+public:
+  struct Event {
+    int watchId = 0;
+    /// "rename" when an entry appeared or disappeared, "change" otherwise.
+    const char *type = "change";
+    /// The affected entry, relative to the watched directory; the file name
+    /// when a file is watched. Empty if the kernel dropped events.
+    std::string filename;
+  };
+  using Callback = std::function<void(Event)>;
+
+  explicit FileWatcher(Callback callback);
+  /// Stops the thread; pending events are dropped.
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  /// Start watching \p path, a file or a directory (with \p recursive, its
+  /// whole tree). With \p mustExist false a missing file is watched until it
+  /// appears. Returns the id events are reported with; throws
+  /// std::system_error on failure.
+  int watch(const std::string &path, bool recursive, int debounceMs,
+            bool mustExist = true);
+
+  /// Stop reporting events for \p id. Thread-safe.
+  void unwatch(int id);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Watch {
+    std::string root;
+    /// Set when a single file is watched through its parent directory.
+    std::string fileName;
+    bool recursive = false;
+    Clock::duration debounce{};
+#if defined(__linux__)
+    std::vector<int> descriptors;
+#else
+    /// Entry -> (mtime, size) at the last scan.
+    std::unordered_map<std::string, std::pair<long long, unsigned long long>>
+        snapshot;
+#endif
+  };
+
+  struct Pending {
+    Event event;
+    Clock::time_point first;
+    Clock::time_point due;
+  };
+
+  void start();
+  void run();
+  void wake();
+  /// Drop watch \p id and its pending events. Called with the lock held.
+  void removeWatch(int id);
+  void queue(int watchId, const char *type, std::string filename,
+             Clock::time_point now);
+  /// Hand the due events to the callback. Called with \p lock held; releases
+  /// it while the callback runs. Returns the time the next event is due.
+  Clock::time_point deliver(std::unique_lock<std::mutex> &lock);
+
+#if defined(__linux__)
+  void addDirectory(int watchId, const std::string &path,
+                    const std::string &relative);
+  void addTree(int watchId, const std::string &path,
+               const std::string &relative);
+  void readEvents();
+
+  struct DirectoryUser {
+    int watchId;
+    /// Directory relative to the watch root.
+    std::string relative;
+  };
+  int inotifyFd_ = -1;
+  int wakePipe_[2] = {-1, -1};
+  std::unordered_map<int, std::vector<DirectoryUser>> directories_;
+  std::unordered_map<int, std::string> directoryPaths_;
+#else
+  void scan(int watchId, Watch &watch, Clock::time_point now, bool report);
+  std::condition_variable wakeCv_;
+#endif
+
+  Callback callback_;
+  std::mutex mutex_;
+  std::thread thread_;
+  bool stopping_ = false;
+  int nextId_ = 1;
+  std::unordered_map<int, Watch> watches_;
+  std::unordered_map<std::string, Pending> pending_;
+};
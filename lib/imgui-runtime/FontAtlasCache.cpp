@@ -0,0 +1,355 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "FontAtlasCache.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[4] = {'I', 'F', 'A', 'C'};
+constexpr uint32_t kVersion = 1;
+constexpr const char *kSuffix = ".fontatlas";
+constexpr int kLineUvCount = IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1;
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  /// sizeof(ImFontGlyph); the glyphs are stored as ImGui lays them out.
+  uint32_t glyphSize;
+  int32_t texWidth;
+  int32_t texHeight;
+  uint32_t fontCount;
+  uint32_t customRectCount;
+  int32_t packIdMouseCursors;
+  int32_t packIdLines;
+  float texUvWhitePixel[2];
+  float texUvLines[kLineUvCount][4];
+};
+
+struct CachedRect {
+  uint16_t width, height, x, y;
+  uint32_t glyphId;
+  float glyphAdvanceX;
+  float glyphOffset[2];
+  /// Index of the font the glyph belongs to, or -1.
+  int32_t font;
+};
+
+struct CachedFont {
+  float fontSize;
+  float ascent;
+  float descent;
+  int32_t metricsTotalSurface;
+  uint32_t glyphCount;
+};
+
+/// FNV-1a, as used for the file names of the HTTP cache.
+struct Hasher {
+  uint64_t hash = 0xcbf29ce484222325ull;
+
+  void bytes(const void *data, size_t size) {
+    auto *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= p[i];
+      hash *= 0x100000001b3ull;
+    }
+  }
+  template <typename T> void value(const T &v) { bytes(&v, sizeof(v)); }
+};
+
+int fontIndex(const ImFontAtlas &atlas, const ImFont *font) {
+  for (int i = 0; i < atlas.Fonts.Size; ++i) {
+    if (atlas.Fonts[i] == font) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+struct Cursor {
+  const uint8_t *data;
+  size_t size;
+  size_t offset = 0;
+
+  bool read(void *out, size_t bytes) {
+    if (size - offset < bytes) {
+      return false;
+    }
+    memcpy(out, data + offset, bytes);
+    offset += bytes;
+    return true;
+  }
+};
+
+} // namespace
+
+uint64_t fontAtlasCacheKey(const ImFontAtlas &atlas) {
+  Hasher hasher;
+  hasher.value(kVersion);
+  hasher.value(IMGUI_VERSION_NUM);
+  hasher.value(sizeof(ImFontGlyph));
+  hasher.value(sizeof(ImWchar));
+  hasher.value(atlas.Flags);
+  hasher.value(atlas.TexDesiredWidth);
+  hasher.value(atlas.TexGlyphPadding);
+  hasher.value(atlas.FontBuilderFlags);
+  hasher.value(atlas.Fonts.Size);
+  hasher.value(atlas.ConfigData.Size);
+  for (const ImFontConfig &config : atlas.ConfigData) {
+    hasher.value(config.FontDataSize);
+    hasher.bytes(config.FontData, static_cast<size_t>(config.FontDataSize));
+    hasher.value(config.FontNo);
+    hasher.value(config.SizePixels);
+    hasher.value(config.OversampleH);
+    hasher.value(config.OversampleV);
+    hasher.value(config.PixelSnapH);
+    hasher.value(config.GlyphExtraSpacing);
+    hasher.value(config.GlyphOffset);
+    hasher.value(config.GlyphMinAdvanceX);
+    hasher.value(config.GlyphMaxAdvanceX);
+    hasher.value(config.MergeMode);
+    hasher.value(config.FontBuilderFlags);
+    hasher.value(config.RasterizerMultiply);
+    hasher.value(config.EllipsisChar);
+    hasher.value(fontIndex(atlas, config.DstFont));
+    // Null ranges select the default ranges when the atlas is built.
+    const ImWchar *ranges =
+        config.GlyphRanges
+            ? config.GlyphRanges
+            : const_cast<ImFontAtlas &>(atlas).GetGlyphRangesDefault();
+    for (; *ranges; ++ranges) {
+      hasher.value(*ranges);
+    }
+    hasher.value(ImWchar(0));
+  }
+  return hasher.hash;
+}
+
+std::string fontAtlasCacheFileName(uint64_t key) {
+  char name[40];
+  snprintf(name, sizeof(name), "%016llx%s", (unsigned long long)key, kSuffix);
+  return name;
+}
+
+bool writeFontAtlasCache(const ImFontAtlas &atlas, uint64_t key,
+                         const std::string &path) {
+  if (!atlas.TexReady || !atlas.TexPixelsAlpha8 || atlas.TexWidth <= 0 ||
+      atlas.TexHeight <= 0) {
+    return false;
+  }
+
+  Header header{};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.key = key;
+  header.glyphSize = sizeof(ImFontGlyph);
+  header.texWidth = atlas.TexWidth;
+  header.texHeight = atlas.TexHeight;
+  header.fontCount = static_cast<uint32_t>(atlas.Fonts.Size);
+  header.customRectCount = static_cast<uint32_t>(atlas.CustomRects.Size);
+  header.packIdMouseCursors = atlas.PackIdMouseCursors;
+  header.packIdLines = atlas.PackIdLines;
+  header.texUvWhitePixel[0] = atlas.TexUvWhitePixel.x;
+  header.texUvWhitePixel[1] = atlas.TexUvWhitePixel.y;
+  for (int i = 0; i < kLineUvCount; ++i) {
+    const ImVec4 &uv = atlas.TexUvLines[i];
+    header.texUvLines[i][0] = uv.x;
+    header.texUvLines[i][1] = uv.y;
+    header.texUvLines[i][2] = uv.z;
+    header.texUvLines[i][3] = uv.w;
+  }
+
+  std::error_code ec;
+  fs::path target(path);
+  if (target.has_parent_path()) {
+    fs::create_directories(target.parent_path(), ec);
+  }
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const ImFontAtlasCustomRect &rect : atlas.CustomRects) {
+      CachedRect cached{};
+      cached.width = rect.Width;
+      cached.height = rect.Height;
+      cached.x = rect.X;
+      cached.y = rect.Y;
+      cached.glyphId = rect.GlyphID;
+      cached.glyphAdvanceX = rect.GlyphAdvanceX;
+      cached.glyphOffset[0] = rect.GlyphOffset.x;
+      cached.glyphOffset[1] = rect.GlyphOffset.y;
+      cached.font = rect.Font ? fontIndex(atlas, rect.Font) : -1;
+      out.write(reinterpret_cast<const char *>(&cached), sizeof(cached));
+    }
+    for (const ImFont *font : atlas.Fonts) {
+      CachedFont cached{};
+      cached.fontSize = font->FontSize;
+      cached.ascent = font->Ascent;
+      cached.descent = font->Descent;
+      cached.metricsTotalSurface = font->MetricsTotalSurface;
+      cached.glyphCount = static_cast<uint32_t>(font->Glyphs.Size);
+      out.write(reinterpret_cast<const char *>(&cached), sizeof(cached));
+      out.write(reinterpret_cast<const char *>(font->Glyphs.Data),
+                sizeof(ImFontGlyph) * font->Glyphs.Size);
+    }
+    out.write(reinterpret_cast<const char *>(atlas.TexPixelsAlpha8),
+              (std::streamsize)atlas.TexWidth * atlas.TexHeight);
+    if (!out) {
+      out.close();
+      fs::remove(tempPath, ec);
+      return false;
+    }
+  }
+  fs::rename(tempPath, path, ec);
+  if (ec) {
+    fs::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+bool readFontAtlasCache(ImFontAtlas &atlas, uint64_t key, const uint8_t *data,
+                        size_t size) {
+  Cursor cursor{data, size};
+  Header header;
+  if (!cursor.read(&header, sizeof(header)) ||
+      memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.key != key ||
+      header.glyphSize != sizeof(ImFontGlyph) || header.texWidth <= 0 ||
+      header.texHeight <= 0 ||
+      header.fontCount != static_cast<uint32_t>(atlas.Fonts.Size)) {
+    return false;
+  }
+
+  // Parse everything before touching the atlas, so a truncated or corrupt
+  // file leaves it ready for Build().
+  if (header.customRectCount > (size - cursor.offset) / sizeof(CachedRect)) {
+    return false;
+  }
+  std::vector<CachedRect> rects(header.customRectCount);
+  for (CachedRect &rect : rects) {
+    if (!cursor.read(&rect, sizeof(rect)) || rect.font < -1 ||
+        rect.font >= atlas.Fonts.Size) {
+      return false;
+    }
+  }
+  std::vector<CachedFont> fonts(header.fontCount);
+  std::vector<std::vector<ImFontGlyph>> glyphs(header.fontCount);
+  for (uint32_t i = 0; i < header.fontCount; ++i) {
+    if (!cursor.read(&fonts[i], sizeof(CachedFont)) ||
+        fonts[i].glyphCount == 0 || fonts[i].glyphCount >= 0xFFFF) {
+      return false;
+    }
+    glyphs[i].resize(fonts[i].glyphCount);
+    if (!cursor.read(glyphs[i].data(),
+                     sizeof(ImFontGlyph) * glyphs[i].size())) {
+      return false;
+    }
+    for (const ImFontGlyph &glyph : glyphs[i]) {
+      if (glyph.Codepoint > IM_UNICODE_CODEPOINT_MAX) {
+        return false;
+      }
+    }
+  }
+  size_t pixelCount = (size_t)header.texWidth * header.texHeight;
+  if (size - cursor.offset != pixelCount) {
+    return false;
+  }
+  const uint8_t *pixels = data + cursor.offset;
+
+  atlas.ClearTexData();
+  atlas.TexWidth = header.texWidth;
+  atlas.TexHeight = header.texHeight;
+  atlas.TexUvScale = ImVec2(1.0f / header.texWidth, 1.0f / header.texHeight);
+  atlas.TexUvWhitePixel =
+      ImVec2(header.texUvWhitePixel[0], header.texUvWhitePixel[1]);
+  for (int i = 0; i < kLineUvCount; ++i) {
+    const float *uv = header.texUvLines[i];
+    atlas.TexUvLines[i] = ImVec4(uv[0], uv[1], uv[2], uv[3]);
+  }
+  atlas.CustomRects.resize(static_cast<int>(rects.size()));
+  for (size_t i = 0; i < rects.size(); ++i) {
+    ImFontAtlasCustomRect &rect = atlas.CustomRects[static_cast<int>(i)];
+    rect.Width = rects[i].width;
+    rect.Height = rects[i].height;
+    rect.X = rects[i].x;
+    rect.Y = rects[i].y;
+    rect.GlyphID = rects[i].glyphId;
+    rect.GlyphAdvanceX = rects[i].glyphAdvanceX;
+    rect.GlyphOffset = ImVec2(rects[i].glyphOffset[0], rects[i].glyphOffset[1]);
+    rect.Font = rects[i].font >= 0 ? atlas.Fonts[rects[i].font] : nullptr;
+  }
+  atlas.PackIdMouseCursors = header.packIdMouseCursors;
+  atlas.PackIdLines = header.packIdLines;
+
+  // What ImFontAtlasBuildSetupFont() and the glyph registration of the
+  // builder do; the lookup tables, fallback and ellipsis are derived from
+  // the glyphs.
+  for (int i = 0; i < atlas.Fonts.Size; ++i) {
+    ImFont *font = atlas.Fonts[i];
+    font->ClearOutputData();
+    font->FontSize = fonts[i].fontSize;
+    font->Ascent = fonts[i].ascent;
+    font->Descent = fonts[i].descent;
+    font->MetricsTotalSurface = fonts[i].metricsTotalSurface;
+    font->ContainerAtlas = &atlas;
+    font->ConfigData = nullptr;
+    font->ConfigDataCount = 0;
+    for (ImFontConfig &config : atlas.ConfigData) {
+      if (config.DstFont == font) {
+        if (!font->ConfigData) {
+          font->ConfigData = &config;
+        }
+        ++font->ConfigDataCount;
+      }
+    }
+    font->Glyphs.resize(static_cast<int>(glyphs[i].size()));
+    memcpy(font->Glyphs.Data, glyphs[i].data(),
+           sizeof(ImFontGlyph) * glyphs[i].size());
+    font->BuildLookupTable();
+  }
+
+  // ImGui owns and eventually frees the pixels, so they are copied out of
+  // the mapping.
+  atlas.TexPixelsAlpha8 = static_cast<unsigned char *>(IM_ALLOC(pixelCount));
+  memcpy(atlas.TexPixelsAlpha8, pixels, pixelCount);
+  atlas.TexReady = true;
+  return true;
+}
+
+void pruneFontAtlasCache(const std::string &directory, size_t keep) {
+  std::error_code ec;
+  std::vector<std::pair<fs::file_time_type, fs::path>> files;
+  for (auto it = fs::directory_iterator(directory, ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    if (it->path().extension() != kSuffix) {
+      continue;
+    }
+    auto time = it->last_write_time(ec);
+    if (!ec) {
+      files.emplace_back(time, it->path());
+    }
+  }
+  if (files.size() <= keep) {
+    return;
+  }
+  std::sort(files.begin(), files.end(),
+            [](const auto &a, const auto &b) { return a.first > b.first; });
+  for (size_t i = keep; i < files.size(); ++i) {
+    fs::remove(files[i].second, ec);
+  }
+}
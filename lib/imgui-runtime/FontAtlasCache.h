@@ -0,0 +1,47 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct ImFontAtlas;
+
+/// On-disk copy of a built ImGui font atlas, so that an app configuring the
+/// same fonts again restores the atlas instead of rasterizing every glyph
+/// with stb_truetype, which takes hundreds of milliseconds for CJK ranges.
+///
+/// A cache file holds the alpha pixels of the atlas, the glyph table and
+/// metrics of every font and the rectangles ImGui reserves for mouse cursors
+/// and anti-aliased lines. It is only valid for an atlas with the same fonts
+/// added in the same order, which the key captures: it hashes every
+/// ImFontConfig (font bytes, size, oversampling, glyph ranges and the other
+/// rasterizer settings) together with the atlas settings and the ImGui
+/// version. Files are written in native byte order and only read back on the
+/// machine that wrote them.
+
+/// Key of the atlas that Build() would produce from the fonts added to
+/// \p atlas.
+uint64_t fontAtlasCacheKey(const ImFontAtlas &atlas);
+
+/// File name of the cache entry of \p key.
+std::string fontAtlasCacheFileName(uint64_t key);
+
+/// Write the built \p atlas to \p path, through a temporary file so that a
+/// reader never sees a partial file. Returns false on failure.
+bool writeFontAtlasCache(const ImFontAtlas &atlas, uint64_t key,
+                         const std::string &path);
+
+/// Restore \p atlas, with its fonts added but not built, from the cache file
+/// in \p data. The atlas is left untouched and false returned if the data is
+/// not a valid entry for \p key; otherwise the atlas is ready for
+/// GetTexDataAsRGBA32() as if Build() had run.
+bool readFontAtlasCache(ImFontAtlas &atlas, uint64_t key, const uint8_t *data,
+                        size_t size);
+
+/// Delete all but the \p keep most recently written cache files of
+/// \p directory.
+void pruneFontAtlasCache(const std::string &directory, size_t keep);
@@ -0,0 +1,37 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstdint>
+
+/// Wall-clock duration of the phases of a single app_frame() call, in
+/// milliseconds. "frame" covers the whole call, so it also includes the work
+/// that is not broken out separately (fetch results, window metrics, etc.).
+struct FramePhaseTimings {
+  double macrotasksMs = 0;
+  double flushRafMs = 0;
+  double onFrameMs = 0;
+  double simguiRenderMs = 0;
+  double frameMs = 0;
+};
+
+/// Timings of the most recently completed frame.
+const FramePhaseTimings &imgui_runtime_frame_timings();
+
+/// How often the per-frame JS work budget (fetch completions and macrotasks)
+/// was exceeded. A frame overruns when the work it started took longer than
+/// the budget; work that did not fit is deferred to the next frame.
+struct FrameBudgetStats {
+  /// Configured budget in milliseconds, 0 if disabled.
+  double budgetMs = 0;
+  uint64_t overrunFrames = 0;
+  double overrunTotalMs = 0;
+  double overrunMaxMs = 0;
+  /// Frames that carried work over to the next frame.
+  uint64_t deferredFrames = 0;
+};
+
+/// Budget statistics accumulated since startup (or the last reset).
+const FrameBudgetStats &imgui_runtime_frame_budget_stats();
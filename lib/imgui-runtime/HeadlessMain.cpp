@@ -0,0 +1,236 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+// Entry point of the headless benchmark build (IMGUI_RUNTIME_HEADLESS).
+//
+// sokol_app is not linked in this configuration. Instead of handing the
+// sapp_desc returned by sokol_main() to sapp_run(), main() calls its
+// init/frame/cleanup callbacks directly from a plain loop, and the sapp_*
+// queries used by the runtime are answered from a fixed virtual window.
+//
+// Usage: <app>-headless [--frames N] [--warmup N] [--width W] [--height H]
+//                       [--dpi-scale S] [--output FILE] [--trace FILE]
+//
+// Per-phase timings of the measured frames are written as JSON to FILE
+// (default: frame-timings.json, "-" for stdout). With --trace, a Chrome trace
+// of the whole run is written as well.
+
+#include "FrameTimings.h"
+#include "Trace.h"
+
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_time.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct HeadlessOptions {
+  int frames = 300;
+  int warmupFrames = 30;
+  int width = 1280;
+  int height = 720;
+  float dpiScale = 1.0f;
+  std::string outputPath = "frame-timings.json";
+  std::string tracePath;
+};
+
+HeadlessOptions s_options;
+double s_frameDuration = 1.0 / 60.0;
+bool s_quitRequested = false;
+
+/// Remove the headless options from argv so that the rest of the command line
+/// reaches imgui_main() unchanged.
+HeadlessOptions parseOptions(int &argc, char *argv[]) {
+  HeadlessOptions options;
+  int out = 1;
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    auto takeValue = [&]() -> const char * {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Missing value for %s\n", arg);
+        exit(1);
+      }
+      return argv[++i];
+    };
+    auto readInt = [&](int &field, int minValue) {
+      field = std::max(minValue, atoi(takeValue()));
+    };
+
+    if (strcmp(arg, "--frames") == 0) {
+      readInt(options.frames, 1);
+    } else if (strcmp(arg, "--warmup") == 0) {
+      readInt(options.warmupFrames, 0);
+    } else if (strcmp(arg, "--width") == 0) {
+      readInt(options.width, 1);
+    } else if (strcmp(arg, "--height") == 0) {
+      readInt(options.height, 1);
+    } else if (strcmp(arg, "--dpi-scale") == 0) {
+      options.dpiScale = std::max(0.1f, (float)atof(takeValue()));
+    } else if (strcmp(arg, "--output") == 0) {
+      options.outputPath = takeValue();
+    } else if (strcmp(arg, "--trace") == 0) {
+      options.tracePath = takeValue();
+    } else {
+      argv[out++] = argv[i];
+    }
+  }
+  argc = out;
+  argv[argc] = nullptr;
+  return options;
+}
+
+struct PhaseSamples {
+  const char *name;
+  double FramePhaseTimings::*field;
+  std::vector<double> samples;
+};
+
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t index = (size_t)std::lround(p * (double)(sorted.size() - 1));
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void writePhase(FILE *out, const PhaseSamples &phase, bool last) {
+  std::vector<double> sorted = phase.samples;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0;
+  for (double v : sorted)
+    total += v;
+  double mean = sorted.empty() ? 0 : total / (double)sorted.size();
+
+  fprintf(out, "    \"%s\": {\n", phase.name);
+  fprintf(out,
+          "      \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+          "\"p99\": %.4f, \"max\": %.4f,\n",
+          mean, sorted.empty() ? 0 : sorted.front(), percentile(sorted, 0.50),
+          percentile(sorted, 0.95), percentile(sorted, 0.99),
+          sorted.empty() ? 0 : sorted.back());
+  fprintf(out, "      \"samples\": [");
+  for (size_t i = 0; i < phase.samples.size(); ++i) {
+    fprintf(out, i ? ", %.4f" : "%.4f", phase.samples[i]);
+  }
+  fprintf(out, "]\n    }%s\n", last ? "" : ",");
+}
+
+void writeReport(FILE *out, const std::vector<PhaseSamples> &phases,
+                 int measuredFrames, double wallMs) {
+  fprintf(out, "{\n");
+  fprintf(out, "  \"width\": %d,\n", s_options.width);
+  fprintf(out, "  \"height\": %d,\n", s_options.height);
+  fprintf(out, "  \"dpiScale\": %.3f,\n", s_options.dpiScale);
+  fprintf(out, "  \"warmupFrames\": %d,\n", s_options.warmupFrames);
+  fprintf(out, "  \"frames\": %d,\n", measuredFrames);
+  fprintf(out, "  \"wallMs\": %.4f,\n", wallMs);
+  fprintf(out, "  \"unit\": \"ms\",\n");
+  const FrameBudgetStats &budget = imgui_runtime_frame_budget_stats();
+  fprintf(out,
+          "  \"jsBudget\": {\"budgetMs\": %.3f, \"overrunFrames\": %llu, "
+          "\"overrunTotalMs\": %.4f, \"overrunMaxMs\": %.4f, "
+          "\"deferredFrames\": %llu},\n",
+          budget.budgetMs, (unsigned long long)budget.overrunFrames,
+          budget.overrunTotalMs, budget.overrunMaxMs,
+          (unsigned long long)budget.deferredFrames);
+  fprintf(out, "  \"phases\": {\n");
+  for (size_t i = 0; i < phases.size(); ++i) {
+    writePhase(out, phases[i], i + 1 == phases.size());
+  }
+  fprintf(out, "  }\n}\n");
+}
+
+} // namespace
+
+// The sokol_app queries used by the runtime, answered from the virtual window.
+extern "C" {
+int sapp_width(void) { return s_options.width; }
+float sapp_widthf(void) { return (float)s_options.width; }
+int sapp_height(void) { return s_options.height; }
+float sapp_heightf(void) { return (float)s_options.height; }
+float sapp_dpi_scale(void) { return s_options.dpiScale; }
+double sapp_frame_duration(void) { return s_frameDuration; }
+void sapp_request_quit(void) { s_quitRequested = true; }
+#if defined(__APPLE__)
+const void *sapp_macos_get_window(void) { return nullptr; }
+#endif
+#if defined(_WIN32)
+const void *sapp_win32_get_hwnd(void) { return nullptr; }
+#endif
+sg_context_desc sapp_sgcontext(void) { return sg_context_desc{}; }
+}
+
+int main(int argc, char *argv[]) {
+  s_options = parseOptions(argc, argv);
+  if (!s_options.tracePath.empty()) {
+    traceSetEnabled(true);
+  }
+
+  sapp_desc desc = sokol_main(argc, argv);
+  desc.init_cb();
+
+  std::vector<PhaseSamples> phases = {
+      {"macrotasks", &FramePhaseTimings::macrotasksMs, {}},
+      {"flushRaf", &FramePhaseTimings::flushRafMs, {}},
+      {"onFrame", &FramePhaseTimings::onFrameMs, {}},
+      {"simguiRender", &FramePhaseTimings::simguiRenderMs, {}},
+      {"frame", &FramePhaseTimings::frameMs, {}},
+  };
+  for (auto &phase : phases) {
+    phase.samples.reserve(s_options.frames);
+  }
+
+  int totalFrames = s_options.warmupFrames + s_options.frames;
+  int measuredFrames = 0;
+  uint64_t measureStart = 0;
+  uint64_t lastFrame = stm_now();
+  for (int i = 0; i < totalFrames && !s_quitRequested; ++i) {
+    if (i == s_options.warmupFrames) {
+      measureStart = stm_now();
+    }
+    desc.frame_cb();
+    s_frameDuration = std::max(stm_sec(stm_laptime(&lastFrame)), 1e-6);
+
+    if (i < s_options.warmupFrames)
+      continue;
+    const FramePhaseTimings &timings = imgui_runtime_frame_timings();
+    for (auto &phase : phases) {
+      phase.samples.push_back(timings.*phase.field);
+    }
+    ++measuredFrames;
+  }
+  double wallMs = measureStart ? stm_ms(stm_since(measureStart)) : 0;
+
+  desc.cleanup_cb();
+
+  if (!s_options.tracePath.empty() &&
+      !traceWriteJson(s_options.tracePath.c_str())) {
+    fprintf(stderr, "Failed to write trace to '%s'\n",
+            s_options.tracePath.c_str());
+  }
+
+  FILE *out = stdout;
+  if (s_options.outputPath != "-") {
+    out = fopen(s_options.outputPath.c_str(), "w");
+    if (!out) {
+      fprintf(stderr, "Failed to open '%s' for writing\n",
+              s_options.outputPath.c_str());
+      return 1;
+    }
+  }
+  writeReport(out, phases, measuredFrames, wallMs);
+  if (out != stdout) {
+    fclose(out);
+    printf("Frame timings written to '%s'\n", s_options.outputPath.c_str());
+  }
+  return 0;
+}
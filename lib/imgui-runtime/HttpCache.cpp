@@ -0,0 +1,745 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "HttpCache.h"
+#include "HttpStrings.h"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint32_t kDiskMagic = 0x43485249; // "IRHC"
+constexpr uint32_t kDiskVersion = 1;
+constexpr const char *kDiskSuffix = ".cache";
+/// Upper bound for the Last-Modified freshness heuristic.
+constexpr int64_t kMaxHeuristicLifetime = 24 * 60 * 60;
+
+/// Comma-joined values of every header named \p name; false if absent.
+bool findHeader(const HttpCache::HeaderList &headers, const char *name,
+                std::string &value) {
+  bool found = false;
+  for (const auto &header : headers) {
+    if (equalsIgnoreCase(header.first, name)) {
+      if (found) {
+        value += ", ";
+        value += header.second;
+      } else {
+        value = header.second;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+/// Split a comma separated header value into trimmed, non-empty items.
+std::vector<std::string> splitList(const std::string &value) {
+  std::vector<std::string> items;
+  size_t start = 0;
+  bool quoted = false;
+  for (size_t i = 0; i <= value.size(); ++i) {
+    if (i < value.size() && value[i] == '"') {
+      quoted = !quoted;
+    }
+    if (i == value.size() || (value[i] == ',' && !quoted)) {
+      std::string item = trim(value.substr(start, i - start));
+      if (!item.empty()) {
+        items.push_back(std::move(item));
+      }
+      start = i + 1;
+    }
+  }
+  return items;
+}
+
+struct CacheControl {
+  bool noStore = false;
+  bool noCache = false;
+  int64_t maxAge = -1;
+};
+
+CacheControl parseCacheControl(const HttpCache::HeaderList &headers) {
+  CacheControl result;
+  std::string value;
+  if (findHeader(headers, "cache-control", value)) {
+    for (const std::string &item : splitList(value)) {
+      size_t equals = item.find('=');
+      std::string name = toLower(trim(item.substr(0, equals)));
+      if (name == "no-store") {
+        result.noStore = true;
+      } else if (name == "no-cache") {
+        result.noCache = true;
+      } else if (name == "max-age" && equals != std::string::npos) {
+        std::string argument = trim(item.substr(equals + 1));
+        if (!argument.empty() && argument.front() == '"' &&
+            argument.size() >= 2) {
+          argument = argument.substr(1, argument.size() - 2);
+        }
+        char *end = nullptr;
+        long long seconds = strtoll(argument.c_str(), &end, 10);
+        if (end != argument.c_str() && seconds >= 0) {
+          result.maxAge = seconds;
+        }
+      }
+    }
+  }
+  if (findHeader(headers, "pragma", value) &&
+      toLower(value).find("no-cache") != std::string::npos) {
+    result.noCache = true;
+  }
+  return result;
+}
+
+/// HTTP-date in seconds since the epoch, or -1.
+int64_t parseDate(const std::string &value) {
+  time_t parsed = curl_getdate(value.c_str(), nullptr);
+  return parsed < 0 ? -1 : (int64_t)parsed;
+}
+
+bool isCacheableStatus(int status) {
+  switch (status) {
+  case 200:
+  case 203:
+  case 204:
+  case 300:
+  case 301:
+  case 308:
+  case 404:
+  case 410:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Fill in the fields derived from the headers and timestamps of \p entry.
+void computeFreshness(HttpCache::Entry &entry) {
+  CacheControl cacheControl = parseCacheControl(entry.headers);
+  entry.noCache = cacheControl.noCache;
+
+  std::string value;
+  int64_t date = -1;
+  if (findHeader(entry.headers, "date", value)) {
+    date = parseDate(value);
+  }
+  if (date < 0) {
+    date = entry.responseTime;
+  }
+  int64_t ageValue = 0;
+  if (findHeader(entry.headers, "age", value)) {
+    ageValue = std::max(0ll, strtoll(value.c_str(), nullptr, 10));
+  }
+  int64_t apparentAge = std::max<int64_t>(0, entry.responseTime - date);
+  int64_t correctedAge =
+      ageValue + std::max<int64_t>(0, entry.responseTime - entry.requestTime);
+  entry.initialAge = std::max(apparentAge, correctedAge);
+
+  entry.etag.clear();
+  entry.lastModified.clear();
+  findHeader(entry.headers, "etag", entry.etag);
+  findHeader(entry.headers, "last-modified", entry.lastModified);
+
+  entry.freshnessLifetime = 0;
+  if (cacheControl.maxAge >= 0) {
+    entry.freshnessLifetime = cacheControl.maxAge;
+  } else if (findHeader(entry.headers, "expires", value)) {
+    // An invalid Expires means "already expired".
+    int64_t expires = parseDate(value);
+    if (expires >= 0) {
+      entry.freshnessLifetime = std::max<int64_t>(0, expires - date);
+    }
+  } else if (!entry.lastModified.empty()) {
+    int64_t lastModified = parseDate(entry.lastModified);
+    if (lastModified >= 0 && lastModified < date) {
+      entry.freshnessLifetime =
+          std::min(kMaxHeuristicLifetime, (date - lastModified) / 10);
+    }
+  }
+}
+
+bool varyMatches(const HttpCache::Entry &entry,
+                 const HttpCache::HeaderList &requestHeaders) {
+  for (const auto &vary : entry.varyRequestHeaders) {
+    std::string value;
+    findHeader(requestHeaders, vary.first.c_str(), value);
+    if (value != vary.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t fnv1a64(const std::string &value) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char ch : value) {
+    hash ^= ch;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+void writeU32(std::ostream &out, uint32_t value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void writeI64(std::ostream &out, int64_t value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void writeString(std::ostream &out, const std::string &value) {
+  writeU32(out, (uint32_t)value.size());
+  out.write(value.data(), (std::streamsize)value.size());
+}
+
+void writeHeaders(std::ostream &out, const HttpCache::HeaderList &headers) {
+  writeU32(out, (uint32_t)headers.size());
+  for (const auto &header : headers) {
+    writeString(out, header.first);
+    writeString(out, header.second);
+  }
+}
+
+/// Bounds-checked reader over a cache file loaded into memory.
+struct Reader {
+  const std::vector<char> &data;
+  size_t offset = 0;
+
+  bool read(void *out, size_t size) {
+    if (data.size() - offset < size) {
+      return false;
+    }
+    memcpy(out, data.data() + offset, size);
+    offset += size;
+    return true;
+  }
+
+  bool readString(std::string &out) {
+    uint32_t size;
+    if (!read(&size, sizeof(size)) || data.size() - offset < size) {
+      return false;
+    }
+    out.assign(data.data() + offset, size);
+    offset += size;
+    return true;
+  }
+
+  bool readHeaders(HttpCache::HeaderList &out) {
+    uint32_t count;
+    if (!read(&count, sizeof(count))) {
+      return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      std::string name, value;
+      if (!readString(name) || !readString(value)) {
+        return false;
+      }
+      out.emplace_back(std::move(name), std::move(value));
+    }
+    return true;
+  }
+};
+
+} // namespace
+
+int64_t HttpCache::Entry::currentAge(int64_t now) const {
+  return initialAge + std::max<int64_t>(0, now - responseTime);
+}
+
+bool HttpCache::Entry::isFresh(int64_t now) const {
+  return !noCache && freshnessLifetime > currentAge(now);
+}
+
+size_t HttpCache::Entry::byteSize() const {
+  size_t size = sizeof(Entry) + url.size() + statusText.size() + body.size() +
+                etag.size() + lastModified.size();
+  for (const auto &header : headers) {
+    size += header.first.size() + header.second.size();
+  }
+  for (const auto &header : varyRequestHeaders) {
+    size += header.first.size() + header.second.size();
+  }
+  return size;
+}
+
+HttpCache::HttpCache() : diskWorker_("http cache", 1) {}
+
+HttpCache::~HttpCache() { shutdown(); }
+
+void HttpCache::configure(const Options &options) {
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool directoryChanged = options.directory != options_.directory;
+    options_ = options;
+    if (!options_.enabled) {
+      entries_.clear();
+      lru_.clear();
+      stats_.memoryBytes = 0;
+      stats_.memoryEntries = 0;
+    } else {
+      trimMemory();
+    }
+    if (options_.directory.empty()) {
+      stats_.diskBytes = 0;
+      return;
+    }
+    if (!directoryChanged && !options_.enabled) {
+      return;
+    }
+    directory = options_.directory;
+  }
+  diskWorker_.post([this, directory] {
+    scanDisk(directory);
+    trimDisk(directory);
+  });
+}
+
+HttpCache::Options HttpCache::options() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return options_;
+}
+
+bool HttpCache::enabled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return options_.enabled;
+}
+
+HttpCache::EntryPtr HttpCache::lookup(const std::string &url,
+                                      const HeaderList &requestHeaders) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!options_.enabled) {
+    return nullptr;
+  }
+  auto it = entries_.find(url);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru);
+  if (!varyMatches(*it->second.entry, requestHeaders)) {
+    return nullptr;
+  }
+  return it->second.entry;
+}
+
+bool HttpCache::lookupDisk(const std::string &url,
+                           const HeaderList &requestHeaders,
+                           std::function<void(EntryPtr)> done) {
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!options_.enabled || options_.directory.empty()) {
+      return false;
+    }
+    directory = options_.directory;
+  }
+  return diskWorker_.post(
+      [this, directory, url, requestHeaders, done = std::move(done)] {
+        std::shared_ptr<Entry> entry = loadFromDisk(directory, url);
+        if (entry) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (options_.enabled && options_.directory == directory) {
+            insertMemory(entry);
+          }
+        }
+        if (entry && !varyMatches(*entry, requestHeaders)) {
+          entry = nullptr;
+        }
+        done(std::move(entry));
+      });
+}
+
+bool HttpCache::store(const std::string &url, const HeaderList &requestHeaders,
+                      int status, const std::string &statusText,
+                      const HeaderList &headers,
+                      const std::vector<unsigned char> &body,
+                      int64_t requestTime, int64_t responseTime) {
+  if (!isCacheableStatus(status) || requestForbidsStore(requestHeaders) ||
+      parseCacheControl(headers).noStore) {
+    return false;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  std::string vary;
+  if (findHeader(headers, "vary", vary)) {
+    for (const std::string &name : splitList(vary)) {
+      if (name == "*") {
+        return false;
+      }
+      std::string value;
+      findHeader(requestHeaders, name.c_str(), value);
+      entry->varyRequestHeaders.emplace_back(toLower(name), std::move(value));
+    }
+  }
+  entry->url = url;
+  entry->status = status;
+  entry->statusText = statusText;
+  entry->headers = headers;
+  entry->requestTime = requestTime;
+  entry->responseTime = responseTime;
+  computeFreshness(*entry);
+  if (entry->freshnessLifetime <= 0 && !entry->hasValidators()) {
+    return false; // could never be used
+  }
+  entry->body = body;
+
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!options_.enabled) {
+      return false;
+    }
+    insertMemory(entry);
+    ++stats_.stores;
+    directory = options_.directory;
+  }
+  if (!directory.empty()) {
+    diskWorker_.post([this, directory, entry] { writeToDisk(directory, *entry); });
+  }
+  return true;
+}
+
+HttpCache::EntryPtr HttpCache::refresh(const EntryPtr &entry,
+                                       const HeaderList &notModifiedHeaders,
+                                       int64_t requestTime,
+                                       int64_t responseTime) {
+  auto updated = std::make_shared<Entry>(*entry);
+  for (const auto &header : notModifiedHeaders) {
+    if (equalsIgnoreCase(header.first, "content-length") ||
+        equalsIgnoreCase(header.first, "transfer-encoding")) {
+      continue;
+    }
+    std::string name = toLower(header.first);
+    updated->headers.erase(
+        std::remove_if(updated->headers.begin(), updated->headers.end(),
+                       [&](const std::pair<std::string, std::string> &old) {
+                         return equalsIgnoreCase(old.first, name.c_str());
+                       }),
+        updated->headers.end());
+  }
+  for (const auto &header : notModifiedHeaders) {
+    if (!equalsIgnoreCase(header.first, "content-length") &&
+        !equalsIgnoreCase(header.first, "transfer-encoding")) {
+      updated->headers.push_back(header);
+    }
+  }
+  updated->requestTime = requestTime;
+  updated->responseTime = responseTime;
+  computeFreshness(*updated);
+
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!options_.enabled) {
+      return updated;
+    }
+    insertMemory(updated);
+    directory = options_.directory;
+  }
+  if (!directory.empty()) {
+    diskWorker_.post(
+        [this, directory, updated] { writeToDisk(directory, *updated); });
+  }
+  return updated;
+}
+
+void HttpCache::invalidate(const std::string &url) {
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    eraseMemory(url);
+    directory = options_.directory;
+  }
+  if (!directory.empty()) {
+    diskWorker_.post([this, directory, url] { removeFromDisk(directory, url); });
+  }
+}
+
+void HttpCache::clear() {
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    stats_.memoryBytes = 0;
+    stats_.memoryEntries = 0;
+    directory = options_.directory;
+  }
+  if (directory.empty()) {
+    return;
+  }
+  diskWorker_.post([this, directory] {
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      if (it->path().extension() == kDiskSuffix) {
+        fs::remove(it->path(), ec);
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.diskBytes = 0;
+  });
+}
+
+void HttpCache::shutdown() { diskWorker_.shutdown(true); }
+
+void HttpCache::countHit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.hits;
+}
+
+void HttpCache::countRevalidated() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.revalidated;
+}
+
+void HttpCache::countMiss() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.misses;
+}
+
+void HttpCache::countDeduplicated() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.deduplicated;
+}
+
+HttpCache::Stats HttpCache::stats(bool reset) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats result = stats_;
+  if (reset) {
+    Stats cleared;
+    cleared.memoryBytes = stats_.memoryBytes;
+    cleared.memoryEntries = stats_.memoryEntries;
+    cleared.diskBytes = stats_.diskBytes;
+    stats_ = cleared;
+  }
+  return result;
+}
+
+bool HttpCache::requestForbidsStore(const HeaderList &requestHeaders) {
+  return parseCacheControl(requestHeaders).noStore;
+}
+
+bool HttpCache::requestRequiresRevalidation(const HeaderList &requestHeaders) {
+  CacheControl cacheControl = parseCacheControl(requestHeaders);
+  return cacheControl.noCache || cacheControl.maxAge == 0;
+}
+
+void HttpCache::insertMemory(std::shared_ptr<Entry> entry) {
+  eraseMemory(entry->url);
+  size_t size = entry->byteSize();
+  if (size > options_.maxMemoryBytes) {
+    return; // only kept on disk
+  }
+  lru_.push_front(entry->url);
+  entries_[lru_.front()] = Slot{std::move(entry), lru_.begin()};
+  stats_.memoryBytes += size;
+  ++stats_.memoryEntries;
+  trimMemory();
+}
+
+void HttpCache::eraseMemory(const std::string &url) {
+  auto it = entries_.find(url);
+  if (it == entries_.end()) {
+    return;
+  }
+  stats_.memoryBytes -= it->second.entry->byteSize();
+  --stats_.memoryEntries;
+  lru_.erase(it->second.lru);
+  entries_.erase(it);
+}
+
+void HttpCache::trimMemory() {
+  while (stats_.memoryBytes > options_.maxMemoryBytes && !lru_.empty()) {
+    // Copy: eraseMemory() destroys the list node.
+    std::string url = lru_.back();
+    eraseMemory(url);
+    ++stats_.evictions;
+  }
+}
+
+std::string HttpCache::diskPath(const std::string &directory,
+                                const std::string &url) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx%s", (unsigned long long)fnv1a64(url),
+           kDiskSuffix);
+  return (fs::path(directory) / name).string();
+}
+
+std::shared_ptr<HttpCache::Entry>
+HttpCache::loadFromDisk(const std::string &directory,
+                        const std::string &url) {
+  if (directory.empty()) {
+    return nullptr;
+  }
+  std::ifstream in(diskPath(directory, url), std::ios::binary);
+  if (!in) {
+    return nullptr;
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  Reader reader{data};
+  uint32_t magic = 0, version = 0;
+  int32_t status = 0;
+  uint64_t bodySize = 0;
+  auto entry = std::make_shared<Entry>();
+  if (!reader.read(&magic, sizeof(magic)) || magic != kDiskMagic ||
+      !reader.read(&version, sizeof(version)) || version != kDiskVersion ||
+      !reader.read(&entry->requestTime, sizeof(entry->requestTime)) ||
+      !reader.read(&entry->responseTime, sizeof(entry->responseTime)) ||
+      !reader.read(&status, sizeof(status)) || !reader.readString(entry->url) ||
+      !reader.readString(entry->statusText) ||
+      !reader.readHeaders(entry->headers) ||
+      !reader.readHeaders(entry->varyRequestHeaders) ||
+      !reader.read(&bodySize, sizeof(bodySize)) ||
+      data.size() - reader.offset != bodySize) {
+    return nullptr;
+  }
+  if (entry->url != url) {
+    return nullptr; // hash collision
+  }
+  entry->status = status;
+  entry->body.assign(data.begin() + (ptrdiff_t)reader.offset, data.end());
+  computeFreshness(*entry);
+  return entry;
+}
+
+void HttpCache::writeToDisk(const std::string &directory,
+                            const Entry &entry) {
+  if (directory.empty()) {
+    return;
+  }
+  std::string path = diskPath(directory, entry.url);
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return;
+    }
+    writeU32(out, kDiskMagic);
+    writeU32(out, kDiskVersion);
+    writeI64(out, entry.requestTime);
+    writeI64(out, entry.responseTime);
+    writeU32(out, (uint32_t)entry.status);
+    writeString(out, entry.url);
+    writeString(out, entry.statusText);
+    writeHeaders(out, entry.headers);
+    writeHeaders(out, entry.varyRequestHeaders);
+    uint64_t bodySize = entry.body.size();
+    out.write(reinterpret_cast<const char *>(&bodySize), sizeof(bodySize));
+    out.write(reinterpret_cast<const char *>(entry.body.data()),
+              (std::streamsize)entry.body.size());
+    if (!out) {
+      out.close();
+      std::error_code ec;
+      fs::remove(tempPath, ec);
+      return;
+    }
+  }
+
+  // Replace atomically so a crash never leaves a truncated entry behind.
+  std::error_code ec;
+  uintmax_t oldSize = fs::file_size(path, ec);
+  if (ec) {
+    oldSize = 0;
+  }
+  uintmax_t newSize = fs::file_size(tempPath, ec);
+  fs::rename(tempPath, path, ec);
+  if (ec) {
+    fs::remove(tempPath, ec);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.diskBytes = stats_.diskBytes - std::min<size_t>(stats_.diskBytes,
+                                                            (size_t)oldSize) +
+                       (size_t)newSize;
+  }
+  trimDisk(directory);
+}
+
+void HttpCache::removeFromDisk(const std::string &directory,
+                               const std::string &url) {
+  std::error_code ec;
+  std::string path = diskPath(directory, url);
+  uintmax_t size = fs::file_size(path, ec);
+  if (!ec && fs::remove(path, ec)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.diskBytes -= std::min<size_t>(stats_.diskBytes, (size_t)size);
+  }
+}
+
+void HttpCache::scanDisk(const std::string &directory) {
+  size_t diskBytes = 0;
+  std::error_code ec;
+  fs::create_directories(directory, ec);
+  for (fs::directory_iterator it(directory, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (it->path().extension() == kDiskSuffix) {
+      std::error_code sizeError;
+      uintmax_t size = it->file_size(sizeError);
+      if (!sizeError) {
+        diskBytes += (size_t)size;
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.diskBytes = diskBytes;
+}
+
+void HttpCache::trimDisk(const std::string &directory) {
+  size_t diskBytes, maxDiskBytes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    diskBytes = stats_.diskBytes;
+    maxDiskBytes = options_.maxDiskBytes;
+  }
+  if (diskBytes <= maxDiskBytes) {
+    return;
+  }
+  struct File {
+    fs::path path;
+    fs::file_time_type written;
+    uintmax_t size;
+  };
+  std::vector<File> files;
+  std::error_code ec;
+  for (fs::directory_iterator it(directory, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (it->path().extension() != kDiskSuffix) {
+      continue;
+    }
+    std::error_code statError;
+    File file{it->path(), it->last_write_time(statError),
+              it->file_size(statError)};
+    if (!statError) {
+      files.push_back(std::move(file));
+    }
+  }
+  std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+    return a.written < b.written;
+  });
+  uint64_t evictions = 0;
+  for (const File &file : files) {
+    if (diskBytes <= maxDiskBytes) {
+      break;
+    }
+    if (fs::remove(file.path, ec)) {
+      diskBytes -= std::min<size_t>(diskBytes, (size_t)file.size);
+      ++evictions;
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.diskBytes = diskBytes;
+  stats_.evictions += evictions;
+}
@@ -0,0 +1,179 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include "WorkerPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Private HTTP cache for native fetch (RFC 9111), kept in memory and
+/// optionally on disk.
+///
+/// Responses to GET requests are stored keyed by URL, one variant per URL;
+/// a Vary header makes a stored response match only requests with the same
+/// values for the listed headers. Fresh responses are served without touching
+/// the network; stale ones with an ETag or Last-Modified are revalidated with
+/// a conditional request by FetchClient.
+///
+/// The memory tier is an LRU bounded by maxMemoryBytes. The disk tier stores
+/// one file per URL in `directory` and drops the least recently written files
+/// once maxDiskBytes is exceeded. All methods are thread-safe and only touch
+/// the in-memory index: reading, writing, scanning and trimming the disk tier
+/// run in order on a worker thread of the cache, so a slow disk never stalls
+/// the fetch I/O thread or the JS thread.
+class HttpCache {
+public:
+  using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+  struct Options {
+    bool enabled = false;
+    size_t maxMemoryBytes = 32u << 20;
+    /// Directory of the disk tier; empty keeps the cache in memory only.
+    std::string directory;
+    size_t maxDiskBytes = 256u << 20;
+  };
+
+  struct Stats {
+    /// Requests served from the cache without a network round trip.
+    uint64_t hits = 0;
+    /// Requests answered by a 304 and served from the cache.
+    uint64_t revalidated = 0;
+    /// Requests that went to the network with a full response.
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    /// Requests that joined an identical request already in flight.
+    uint64_t deduplicated = 0;
+    uint64_t evictions = 0;
+    size_t memoryBytes = 0;
+    size_t memoryEntries = 0;
+    /// Measured on the disk worker after configure().
+    size_t diskBytes = 0;
+  };
+
+  struct Entry {
+    std::string url;
+    int status = 0;
+    std::string statusText;
+    HeaderList headers;
+    /// Lowercased request header names listed in Vary, with the values the
+    /// stored response was selected by.
+    HeaderList varyRequestHeaders;
+    std::vector<unsigned char> body;
+    /// Seconds since the epoch.
+    int64_t requestTime = 0;
+    int64_t responseTime = 0;
+    /// From Cache-Control/Expires or the Last-Modified heuristic, in seconds.
+    int64_t freshnessLifetime = 0;
+    /// corrected_initial_age of RFC 9111 section 4.2.3.
+    int64_t initialAge = 0;
+    /// Cache-Control: no-cache; the entry must be revalidated on every use.
+    bool noCache = false;
+    std::string etag;
+    std::string lastModified;
+
+    int64_t currentAge(int64_t now) const;
+    bool isFresh(int64_t now) const;
+    bool hasValidators() const {
+      return !etag.empty() || !lastModified.empty();
+    }
+    size_t byteSize() const;
+  };
+
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+  HttpCache();
+  /// Finishes the queued disk work, see shutdown().
+  ~HttpCache();
+
+  void configure(const Options &options);
+  Options options() const;
+  bool enabled() const;
+
+  /// The response for \p url matching \p requestHeaders held in memory, fresh
+  /// or not.
+  EntryPtr lookup(const std::string &url, const HeaderList &requestHeaders);
+
+  /// Look \p url up in the disk tier on the disk worker, keep what is found
+  /// in memory and pass it to \p done on that thread, or null if there is no
+  /// stored response matching \p requestHeaders. Returns false, without
+  /// calling \p done, if there is no disk tier to look in or after
+  /// shutdown().
+  bool lookupDisk(const std::string &url, const HeaderList &requestHeaders,
+                  std::function<void(EntryPtr)> done);
+
+  /// Store a full response if it is cacheable. Returns whether it was stored.
+  bool store(const std::string &url, const HeaderList &requestHeaders,
+             int status, const std::string &statusText,
+             const HeaderList &headers, const std::vector<unsigned char> &body,
+             int64_t requestTime, int64_t responseTime);
+
+  /// Update \p entry with the headers of a 304 response and return the
+  /// refreshed entry.
+  EntryPtr refresh(const EntryPtr &entry, const HeaderList &notModifiedHeaders,
+                   int64_t requestTime, int64_t responseTime);
+
+  /// Drop the stored response for \p url, e.g. after a successful unsafe
+  /// request (POST, PUT, DELETE) to it.
+  void invalidate(const std::string &url);
+
+  /// Drop every entry in memory and on disk.
+  void clear();
+
+  /// Run the queued disk work and stop the disk worker; later disk work is
+  /// dropped.
+  void shutdown();
+
+  void countHit();
+  void countRevalidated();
+  void countMiss();
+  void countDeduplicated();
+
+  /// Current statistics; \p reset zeroes the counters afterwards.
+  Stats stats(bool reset);
+
+  /// Whether the request headers forbid serving (no-store) or require
+  /// revalidating (no-cache) a stored response.
+  static bool requestForbidsStore(const HeaderList &requestHeaders);
+  static bool requestRequiresRevalidation(const HeaderList &requestHeaders);
+
+private:
+  struct Slot {
+    std::shared_ptr<Entry> entry;
+    std::list<std::string>::iterator lru;
+  };
+
+  void insertMemory(std::shared_ptr<Entry> entry);
+  void eraseMemory(const std::string &url);
+  void trimMemory();
+  static std::shared_ptr<Entry> loadFromDisk(const std::string &directory,
+                                             const std::string &url);
+  // The disk helpers below run on diskWorker_.
+  void writeToDisk(const std::string &directory, const Entry &entry);
+  void removeFromDisk(const std::string &directory, const std::string &url);
+  void scanDisk(const std::string &directory);
+  void trimDisk(const std::string &directory);
+  static std::string diskPath(const std::string &directory,
+                              const std::string &url);
+
+  /// Guards options_, stats_ and the memory tier.
+  mutable std::mutex mutex_;
+  Options options_;
+  Stats stats_;
+  std::unordered_map<std::string, Slot> entries_;
+  /// Most recently used first.
+  std::list<std::string> lru_;
+  /// One thread, so disk operations apply in the order they were queued.
+  /// Declared last: its jobs use the members above.
+  WorkerPool diskWorker_;
+};
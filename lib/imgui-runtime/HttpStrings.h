@@ -0,0 +1,43 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <string>
+
+/// ASCII string helpers shared by FetchClient and HttpCache for header names
+/// and values.
+
+/// Whether \p a equals \p b, ignoring ASCII case.
+inline bool equalsIgnoreCase(const std::string &a, const char *b) {
+  size_t i = 0;
+  for (; i < a.size() && b[i]; ++i) {
+    if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i]))
+      return false;
+  }
+  return i == a.size() && !b[i];
+}
+
+/// \p value without leading and trailing whitespace.
+inline std::string trim(const std::string &value) {
+  size_t start = 0;
+  size_t end = value.size();
+  while (start < end && std::isspace((unsigned char)value[start])) {
+    ++start;
+  }
+  while (end > start && std::isspace((unsigned char)value[end - 1])) {
+    --end;
+  }
+  return value.substr(start, end - start);
+}
+
+/// \p value with ASCII letters lowercased.
+inline std::string toLower(std::string value) {
+  for (auto &ch : value) {
+    ch = (char)std::tolower((unsigned char)ch);
+  }
+  return value;
+}
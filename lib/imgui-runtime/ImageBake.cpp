@@ -0,0 +1,150 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+// imgui-image-bake: decodes an image at build time into the RawImage
+// container that the runtime uploads without decoding.
+//
+//   imgui-image-bake <input> <output> [--mipmaps]
+//
+// --mipmaps adds every mip level down to 1x1. Levels are downsampled in
+// linear light and weighted by alpha, so that transparent pixels do not
+// darken the edges of shrunk images.
+
+#include "RawImage.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+float srgbToLinear(uint8_t value) {
+  float c = value / 255.0f;
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+uint8_t linearToSrgb(float value) {
+  float c = value <= 0.0031308f ? value * 12.92f
+                                : 1.055f * std::pow(value, 1 / 2.4f) - 0.055f;
+  return static_cast<uint8_t>(std::lround(std::fmin(std::fmax(c, 0.0f), 1.0f) *
+                                          255.0f));
+}
+
+/// Halve \p pixels (\p width x \p height RGBA8) with a 2x2 box filter.
+std::vector<uint8_t> downsample(const std::vector<uint8_t> &pixels, int width,
+                                int height, const float *toLinear) {
+  int outWidth = width > 1 ? width / 2 : 1;
+  int outHeight = height > 1 ? height / 2 : 1;
+  std::vector<uint8_t> out((size_t)outWidth * outHeight * 4);
+  for (int y = 0; y < outHeight; ++y) {
+    for (int x = 0; x < outWidth; ++x) {
+      float color[3] = {};
+      float colorUnweighted[3] = {};
+      float alpha = 0;
+      for (int dy = 0; dy < 2; ++dy) {
+        for (int dx = 0; dx < 2; ++dx) {
+          int sx = std::min(x * 2 + dx, width - 1);
+          int sy = std::min(y * 2 + dy, height - 1);
+          const uint8_t *p = &pixels[((size_t)sy * width + sx) * 4];
+          float a = p[3] / 255.0f;
+          for (int c = 0; c < 3; ++c) {
+            color[c] += toLinear[p[c]] * a;
+            colorUnweighted[c] += toLinear[p[c]];
+          }
+          alpha += a;
+        }
+      }
+      uint8_t *o = &out[((size_t)y * outWidth + x) * 4];
+      for (int c = 0; c < 3; ++c) {
+        o[c] = linearToSrgb(alpha > 0 ? color[c] / alpha
+                                      : colorUnweighted[c] / 4);
+      }
+      o[3] = static_cast<uint8_t>(std::lround(alpha / 4 * 255.0f));
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const char *input = nullptr;
+  const char *output = nullptr;
+  bool mipmaps = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--mipmaps") == 0) {
+      mipmaps = true;
+    } else if (!input) {
+      input = argv[i];
+    } else if (!output) {
+      output = argv[i];
+    } else {
+      input = nullptr;
+      break;
+    }
+  }
+  if (!input || !output) {
+    fprintf(stderr, "usage: %s <input> <output> [--mipmaps]\n", argv[0]);
+    return 2;
+  }
+
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  stbi_uc *decoded = stbi_load(input, &width, &height, &channels, 4);
+  if (!decoded) {
+    fprintf(stderr, "%s: %s\n", input, stbi_failure_reason());
+    return 1;
+  }
+  std::vector<uint8_t> level(decoded, decoded + (size_t)width * height * 4);
+  stbi_image_free(decoded);
+
+  float toLinear[256];
+  for (int i = 0; i < 256; ++i) {
+    toLinear[i] = srgbToLinear(static_cast<uint8_t>(i));
+  }
+
+  std::vector<std::vector<uint8_t>> levels;
+  int levelWidth = width;
+  int levelHeight = height;
+  levels.push_back(level);
+  while (mipmaps && (levelWidth > 1 || levelHeight > 1) &&
+         levels.size() < kRawImageMaxLevels) {
+    levels.push_back(
+        downsample(levels.back(), levelWidth, levelHeight, toLinear));
+    levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+    levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+  }
+  RawImageHeader header;
+  memcpy(header.magic, kRawImageMagic, sizeof(header.magic));
+  header.version = kRawImageVersion;
+  header.width = static_cast<uint32_t>(width);
+  header.height = static_cast<uint32_t>(height);
+  header.levels = static_cast<uint32_t>(levels.size());
+  header.flags = 0;
+  uint8_t encoded[kRawImageHeaderSize];
+  writeRawImageHeader(header, encoded);
+
+  FILE *file = fopen(output, "wb");
+  if (!file) {
+    perror(output);
+    return 1;
+  }
+  bool ok = fwrite(encoded, sizeof(encoded), 1, file) == 1;
+  for (const auto &pixels : levels) {
+    ok = ok && fwrite(pixels.data(), 1, pixels.size(), file) == pixels.size();
+  }
+  ok = fclose(file) == 0 && ok;
+  if (!ok) {
+    fprintf(stderr, "%s: write failed\n", output);
+    remove(output);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,196 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "ImageLoader.h"
+#include "RawImage.h"
+#include "Trace.h"
+
+#include "stb_image.h"
+
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+/// Take ownership of \p pixels from stb_image, or report its failure.
+bool adoptPixels(stbi_uc *pixels, int width, int height, DecodedImage &image,
+                 std::string &error) {
+  if (!pixels) {
+    const char *reason = stbi_failure_reason();
+    error = std::string("Failed to decode image: ") +
+            (reason ? reason : "unknown error");
+    return false;
+  }
+  image.width = width;
+  image.height = height;
+  image.pixels = std::shared_ptr<const uint8_t>(
+      pixels, [](const uint8_t *data) {
+        stbi_image_free(const_cast<uint8_t *>(data));
+      });
+  return true;
+}
+
+/// Point \p image at the levels of the pre-decoded container in \p data,
+/// copying them unless \p inPlace.
+bool adoptRawImage(const uint8_t *data, size_t size, bool inPlace,
+                   DecodedImage &image, std::string &error) {
+  RawImage raw;
+  if (!parseRawImage(data, size, raw, error)) {
+    error = "Failed to decode image: " + error;
+    return false;
+  }
+  image.width = raw.width;
+  image.height = raw.height;
+  image.levels = raw.levelCount;
+  const uint8_t *levels = raw.levels[0];
+  size_t levelsSize = static_cast<size_t>(
+      raw.levels[raw.levelCount - 1] + raw.levelSizes[raw.levelCount - 1] -
+      levels);
+  if (inPlace) {
+    image.pixels =
+        std::shared_ptr<const uint8_t>(levels, [](const uint8_t *) {});
+  } else {
+    std::shared_ptr<uint8_t> copy(new uint8_t[levelsSize],
+                                  std::default_delete<uint8_t[]>());
+    memcpy(copy.get(), levels, levelsSize);
+    image.pixels = std::move(copy);
+  }
+  return true;
+}
+
+} // namespace
+
+size_t DecodedImage::byteSize() const {
+  size_t size = 0;
+  for (int level = 0; level < levels; ++level) {
+    size += (size_t)rawImageLevelSize(width, level) *
+            rawImageLevelSize(height, level) * 4;
+  }
+  return size;
+}
+
+bool decodeImage(const uint8_t *data, size_t size, DecodedImage &image,
+                 std::string &error) {
+  if (isRawImage(data, size)) {
+    return adoptRawImage(data, size, false, image, error);
+  }
+  if (size == 0 || size > INT_MAX) {
+    error = "Failed to decode image: invalid data size";
+    return false;
+  }
+  TraceScope trace("decodeImage", "image");
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  stbi_uc *pixels = stbi_load_from_memory(data, static_cast<int>(size), &width,
+                                          &height, &channels, 4);
+  return adoptPixels(pixels, width, height, image, error);
+}
+
+bool decodeStaticImage(const uint8_t *data, size_t size, DecodedImage &image,
+                       std::string &error) {
+  if (isRawImage(data, size)) {
+    return adoptRawImage(data, size, true, image, error);
+  }
+  return decodeImage(data, size, image, error);
+}
+
+bool decodeImageFile(const std::string &path, DecodedImage &image,
+                     std::string &error) {
+  TraceScope trace("decodeImageFile", "image");
+  {
+    // Pre-decoded containers can also be shipped next to the executable.
+    char magic[sizeof(kRawImageMagic)] = {};
+    std::ifstream file(path, std::ios::binary);
+    if (file.read(magic, sizeof(magic)) &&
+        memcmp(magic, kRawImageMagic, sizeof(magic)) == 0) {
+      file.seekg(0);
+      std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+      if (!decodeImage(bytes.data(), bytes.size(), image, error)) {
+        error += " (" + path + ")";
+        return false;
+      }
+      return true;
+    }
+  }
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  stbi_uc *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+  if (!adoptPixels(pixels, width, height, image, error)) {
+    error += " (" + path + ")";
+    return false;
+  }
+  return true;
+}
+
+ImageLoader::ImageLoader(size_t threadCount, std::function<void()> ready)
+    : workers_("image-decode", threadCount), readyCallback_(std::move(ready)) {}
+
+void ImageLoader::decodeFile(int id, std::string path) {
+  workers_.post([this, id, path = std::move(path)] {
+    Result result;
+    result.id = id;
+    decodeImageFile(path, result.image, result.error);
+    finish(std::move(result));
+  });
+}
+
+void ImageLoader::decodeStatic(int id, const uint8_t *data, size_t size) {
+  workers_.post([this, id, data, size] {
+    Result result;
+    result.id = id;
+    decodeStaticImage(data, size, result.image, result.error);
+    finish(std::move(result));
+  });
+}
+
+void ImageLoader::decodeBuffer(int id, std::vector<uint8_t> bytes) {
+  workers_.post([this, id, bytes = std::move(bytes)] {
+    Result result;
+    result.id = id;
+    decodeImage(bytes.data(), bytes.size(), result.image, result.error);
+    finish(std::move(result));
+  });
+}
+
+void ImageLoader::finish(Result result) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    results_.push_back(std::move(result));
+  }
+  if (readyCallback_) {
+    readyCallback_();
+  }
+}
+
+std::vector<ImageLoader::Result> ImageLoader::takeResults(size_t byteBudget) {
+  std::vector<Result> taken;
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t bytes = 0;
+  while (!results_.empty()) {
+    size_t size = results_.front().image.byteSize();
+    if (!taken.empty() && byteBudget > 0 && bytes + size > byteBudget) {
+      break;
+    }
+    bytes += size;
+    taken.push_back(std::move(results_.front()));
+    results_.pop_front();
+  }
+  return taken;
+}
+
+size_t ImageLoader::ready() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return results_.size();
+}
+
+void ImageLoader::shutdown() {
+  workers_.shutdown();
+  std::lock_guard<std::mutex> lock(mutex_);
+  results_.clear();
+}
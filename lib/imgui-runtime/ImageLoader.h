@@ -0,0 +1,95 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include "WorkerPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// RGBA8 pixels of a decoded image.
+struct DecodedImage {
+  int width = 0;
+  int height = 0;
+  /// Mip levels in pixels, one after another from level 0 (width * height *
+  /// 4 bytes), each half the size of the previous; only pre-decoded images
+  /// (RawImage.h) have more than one.
+  int levels = 1;
+  /// Freed the way they were allocated.
+  std::shared_ptr<const uint8_t> pixels;
+
+  /// Size of all the levels.
+  size_t byteSize() const;
+};
+
+/// Decode a PNG, JPEG, BMP, TGA, GIF (first frame) or other stb_image format
+/// into RGBA8, or copy the pixels of a pre-decoded RawImage container.
+/// Returns false and sets \p error on failure. Thread-safe.
+bool decodeImage(const uint8_t *data, size_t size, DecodedImage &image,
+                 std::string &error);
+/// Like decodeImage() for \p data that outlives \p image, such as an image
+/// embedded in the executable: the pixels of a pre-decoded container are
+/// used in place.
+bool decodeStaticImage(const uint8_t *data, size_t size, DecodedImage &image,
+                       std::string &error);
+bool decodeImageFile(const std::string &path, DecodedImage &image,
+                     std::string &error);
+
+/// Decodes images on worker threads and hands them back to the frame loop,
+/// which uploads a bounded number of bytes per frame so that a screen full of
+/// thumbnails neither stalls the main thread on decoding nor spikes a single
+/// frame with uploads.
+class ImageLoader {
+public:
+  struct Result {
+    /// The id the decode was requested with.
+    int id = 0;
+    DecodedImage image;
+    /// Empty on success.
+    std::string error;
+  };
+
+  /// \p ready runs on a worker thread whenever a result is queued, to wake
+  /// the frame loop.
+  ImageLoader(size_t threadCount, std::function<void()> ready);
+
+  ImageLoader(const ImageLoader &) = delete;
+  ImageLoader &operator=(const ImageLoader &) = delete;
+
+  /// Decode the file at \p path.
+  void decodeFile(int id, std::string path);
+  /// Decode \p size bytes at \p data, which must outlive the decode (for
+  /// images embedded in the executable).
+  void decodeStatic(int id, const uint8_t *data, size_t size);
+  /// Decode \p bytes, which the loader keeps until it is done.
+  void decodeBuffer(int id, std::vector<uint8_t> bytes);
+
+  /// Take finished results in completion order until their pixels add up to
+  /// \p byteBudget (0 means no limit). At least one result is returned when
+  /// any is ready, however large, so every image eventually gets through.
+  std::vector<Result> takeResults(size_t byteBudget);
+
+  /// Decodes queued or running.
+  size_t decoding() const { return workers_.pendingJobs(); }
+  /// Results waiting in takeResults().
+  size_t ready() const;
+
+  /// Stop the workers and drop queued decodes and results.
+  void shutdown();
+
+private:
+  void finish(Result result);
+
+  WorkerPool workers_;
+  std::function<void()> readyCallback_;
+  mutable std::mutex mutex_;
+  std::deque<Result> results_;
+};
@@ -75,9 +75,39 @@ private:
   size_t size_ = 0;       // Size to report (may include null terminator)
 };
 
+// Private writable mapping handed to JS as an ArrayBuffer.
+class CopyOnWriteFileBuffer : public facebook::jsi::MutableBuffer {
+public:
+  CopyOnWriteFileBuffer(uint8_t *data, size_t size)
+      : data_(data), size_(size) {}
+
+  ~CopyOnWriteFileBuffer() override { munmap(data_, size_); }
+
+  size_t size() const override { return size_; }
+  uint8_t *data() override { return data_; }
+
+private:
+  uint8_t *data_;
+  size_t size_;
+};
+
 }
 
 std::shared_ptr<facebook::jsi::Buffer>
 mapFileBuffer(const char *path, bool attemptTrailingZero) {
   return std::make_shared<MappedFileBuffer>(path, attemptTrailingZero);
 }
+
+std::shared_ptr<facebook::jsi::MutableBuffer> mapFileCopyOnWrite(int fd,
+                                                                 size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+  void *data =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  return std::make_shared<CopyOnWriteFileBuffer>(static_cast<uint8_t *>(data),
+                                                 size);
+}
@@ -15,3 +15,11 @@
 /// @return memory mapped buffer
 std::shared_ptr<facebook::jsi::Buffer>
 mapFileBuffer(const char *path, bool attemptTrailingZero = false);
+
+/// Map \p size bytes of the open file \p fd privately and writably, as the
+/// backing store of an ArrayBuffer. Writes through the buffer never reach the
+/// file, and the mapping stays valid after \p fd is closed.
+///
+/// @return the buffer, or null if the file could not be mapped
+std::shared_ptr<facebook::jsi::MutableBuffer> mapFileCopyOnWrite(int fd,
+                                                                 size_t size);
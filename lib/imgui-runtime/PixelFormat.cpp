@@ -0,0 +1,47 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "PixelFormat.h"
+
+#include <cstring>
+
+bool parsePixelFormat(std::string_view name, PixelFormat &format) {
+  if (name == "rgba8") {
+    format = PixelFormat::RGBA8;
+  } else if (name == "bgra8") {
+    format = PixelFormat::BGRA8;
+  } else if (name == "gray8") {
+    format = PixelFormat::Gray8;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+size_t bytesPerPixel(PixelFormat format) {
+  return format == PixelFormat::Gray8 ? 1 : 4;
+}
+
+void convertToRgba8(PixelFormat format, const uint8_t *input, uint8_t *output,
+                    size_t pixels) {
+  switch (format) {
+  case PixelFormat::RGBA8:
+    memcpy(output, input, pixels * 4);
+    break;
+  case PixelFormat::BGRA8:
+    for (size_t i = 0; i < pixels; ++i, input += 4, output += 4) {
+      output[0] = input[2];
+      output[1] = input[1];
+      output[2] = input[0];
+      output[3] = input[3];
+    }
+    break;
+  case PixelFormat::Gray8:
+    for (size_t i = 0; i < pixels; ++i, output += 4) {
+      output[0] = output[1] = output[2] = input[i];
+      output[3] = 255;
+    }
+    break;
+  }
+}
@@ -0,0 +1,30 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/// Layout of the pixels JS hands to a dynamic texture. Textures are always
+/// RGBA8 on the GPU, which is what the ImGui shader samples, so other
+/// layouts are converted when they are uploaded.
+enum class PixelFormat {
+  /// 4 bytes per pixel, stored as is.
+  RGBA8,
+  /// 4 bytes per pixel in the order most cameras and video decoders produce.
+  BGRA8,
+  /// 1 byte of luminance per pixel, drawn as opaque gray.
+  Gray8,
+};
+
+/// Parse "rgba8", "bgra8" or "gray8". Returns false for anything else.
+bool parsePixelFormat(std::string_view name, PixelFormat &format);
+
+size_t bytesPerPixel(PixelFormat format);
+
+/// Convert \p pixels pixels of \p format at \p input to RGBA8 at \p output.
+void convertToRgba8(PixelFormat format, const uint8_t *input, uint8_t *output,
+                    size_t pixels);
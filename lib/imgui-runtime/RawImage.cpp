@@ -0,0 +1,78 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "RawImage.h"
+
+#include <cstring>
+
+namespace {
+
+void writeU32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint32_t readU32(const uint8_t *in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 |
+         (uint32_t)in[3] << 24;
+}
+
+} // namespace
+
+bool isRawImage(const uint8_t *data, size_t size) {
+  return size >= kRawImageHeaderSize &&
+         memcmp(data, kRawImageMagic, sizeof(kRawImageMagic)) == 0;
+}
+
+void writeRawImageHeader(const RawImageHeader &header, uint8_t *out) {
+  memcpy(out, header.magic, sizeof(header.magic));
+  writeU32(out + 4, header.version);
+  writeU32(out + 8, header.width);
+  writeU32(out + 12, header.height);
+  writeU32(out + 16, header.levels);
+  writeU32(out + 20, header.flags);
+}
+
+bool parseRawImage(const uint8_t *data, size_t size, RawImage &image,
+                   std::string &error) {
+  if (!isRawImage(data, size)) {
+    error = "Not a pre-decoded image";
+    return false;
+  }
+  RawImageHeader header;
+  memcpy(header.magic, data, sizeof(header.magic));
+  header.version = readU32(data + 4);
+  header.width = readU32(data + 8);
+  header.height = readU32(data + 12);
+  header.levels = readU32(data + 16);
+  header.flags = readU32(data + 20);
+  if (header.version != kRawImageVersion) {
+    error = "Unsupported pre-decoded image version " +
+            std::to_string(header.version);
+    return false;
+  }
+  if (header.width == 0 || header.height == 0 || header.width > 16384 ||
+      header.height > 16384 || header.levels == 0 ||
+      header.levels > kRawImageMaxLevels || header.flags != 0) {
+    error = "Malformed pre-decoded image header";
+    return false;
+  }
+  image.width = static_cast<int>(header.width);
+  image.height = static_cast<int>(header.height);
+  image.levelCount = static_cast<int>(header.levels);
+  size_t offset = kRawImageHeaderSize;
+  for (int level = 0; level < image.levelCount; ++level) {
+    size_t levelSize = (size_t)rawImageLevelSize(image.width, level) *
+                       rawImageLevelSize(image.height, level) * 4;
+    if (size - offset < levelSize) {
+      error = "Truncated pre-decoded image";
+      return false;
+    }
+    image.levels[level] = data + offset;
+    image.levelSizes[level] = levelSize;
+    offset += levelSize;
+  }
+  return true;
+}
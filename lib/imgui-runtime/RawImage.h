@@ -0,0 +1,63 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Container of an image decoded at build time by imgui-image-bake, so that
+/// embedded images are uploaded from the executable's read-only data without
+/// decoding anything at startup.
+///
+/// A RawImageHeader is followed by the RGBA8 pixels of each mip level, level
+/// 0 first and each following level half the size of the previous one
+/// (rounded down, at least 1), tightly packed. The colors are straight
+/// (not premultiplied) alpha, as the ImGui pipeline blends them. The header
+/// fields are stored little-endian whatever the host's byte order; use
+/// writeRawImageHeader() and parseRawImage() rather than copying the struct.
+struct RawImageHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t levels;
+  /// Reserved, 0.
+  uint32_t flags;
+};
+
+/// Size of the encoded header; the pixels start at this offset.
+constexpr size_t kRawImageHeaderSize = 24;
+
+constexpr char kRawImageMagic[4] = {'R', 'I', 'M', 'G'};
+constexpr uint32_t kRawImageVersion = 1;
+/// The most mip levels a container holds, as many as sokol_gfx accepts.
+constexpr int kRawImageMaxLevels = 16;
+
+/// A parsed container, pointing into its bytes.
+struct RawImage {
+  int width = 0;
+  int height = 0;
+  int levelCount = 0;
+  const uint8_t *levels[kRawImageMaxLevels] = {};
+  size_t levelSizes[kRawImageMaxLevels] = {};
+};
+
+/// Whether \p data starts like a container (as opposed to PNG, JPEG, ...).
+bool isRawImage(const uint8_t *data, size_t size);
+
+/// Encode \p header into the first kRawImageHeaderSize bytes of \p out.
+void writeRawImageHeader(const RawImageHeader &header, uint8_t *out);
+
+/// Check the container in \p data and point \p image at its levels. Returns
+/// false and sets \p error if it is malformed or truncated.
+bool parseRawImage(const uint8_t *data, size_t size, RawImage &image,
+                   std::string &error);
+
+/// Width or height of mip \p level of an image \p size pixels across.
+inline int rawImageLevelSize(int size, int level) {
+  int scaled = size >> level;
+  return scaled > 0 ? scaled : 1;
+}
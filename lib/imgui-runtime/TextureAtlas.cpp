@@ -0,0 +1,233 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "TextureAtlas.h"
+#include "Trace.h"
+
+// imgui_draw.cpp compiles its copy of the packer as static functions.
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/// Pixels of edge copied around every image.
+constexpr int kBorder = 1;
+
+/// Skyline state of a page. The context points into itself and the nodes,
+/// so it stays on the heap and is replaced as a whole.
+struct Packer {
+  stbrp_context context;
+  std::vector<stbrp_node> nodes;
+
+  explicit Packer(int size) : nodes(size) {
+    stbrp_init_target(&context, size, size, nodes.data(),
+                      static_cast<int>(nodes.size()));
+  }
+};
+
+} // namespace
+
+struct TextureAtlas::Page {
+  /// Empty while the page holds no images.
+  std::vector<uint8_t> pixels;
+  std::unique_ptr<Packer> packer;
+  std::vector<int> handles;
+  /// Area, border included, of the images removed since the page was packed.
+  size_t freedArea = 0;
+  bool dirty = false;
+};
+
+TextureAtlas::TextureAtlas(int pageSize, int maxImageSize, size_t maxPages)
+    : pageSize_(pageSize), maxImageSize_(maxImageSize), maxPages_(maxPages) {}
+
+TextureAtlas::~TextureAtlas() = default;
+
+bool TextureAtlas::accepts(int width, int height) const {
+  int limit = std::min(maxImageSize_, pageSize_ - 2 * kBorder);
+  return width > 0 && height > 0 && width <= limit && height <= limit;
+}
+
+bool TextureAtlas::insert(int handle, const uint8_t *pixels, int width,
+                          int height) {
+  if (!accepts(width, height) || rects_.count(handle)) {
+    return false;
+  }
+  Rect rect;
+  for (size_t i = 0; i < pages_.size() && rect.page < 0; ++i) {
+    if (!pages_[i]->pixels.empty() &&
+        pack(*pages_[i], handle, width, height, rect)) {
+      rect.page = static_cast<int>(i);
+    }
+  }
+  if (rect.page < 0) {
+    // Reuse an emptied page before adding one.
+    auto empty = std::find_if(pages_.begin(), pages_.end(),
+                              [](const auto &page) {
+                                return page->pixels.empty();
+                              });
+    if (empty == pages_.end()) {
+      if (pages_.size() >= maxPages_) {
+        return false;
+      }
+      pages_.push_back(std::make_unique<Page>());
+      empty = pages_.end() - 1;
+    }
+    Page &page = **empty;
+    page.pixels.assign((size_t)pageSize_ * pageSize_ * 4, 0);
+    page.packer = std::make_unique<Packer>(pageSize_);
+    page.freedArea = 0;
+    if (!pack(page, handle, width, height, rect)) {
+      return false;
+    }
+    rect.page = static_cast<int>(empty - pages_.begin());
+  }
+  Page &page = *pages_[rect.page];
+  page.handles.push_back(handle);
+  copyImage(page, rect, pixels, (size_t)width * 4);
+  page.dirty = true;
+  rects_[handle] = rect;
+  return true;
+}
+
+void TextureAtlas::remove(int handle) {
+  auto found = rects_.find(handle);
+  if (found == rects_.end()) {
+    return;
+  }
+  Rect rect = found->second;
+  rects_.erase(found);
+  Page &page = *pages_[rect.page];
+  page.handles.erase(
+      std::find(page.handles.begin(), page.handles.end(), handle));
+  if (page.handles.empty()) {
+    page.pixels.clear();
+    page.pixels.shrink_to_fit();
+    page.packer.reset();
+    page.freedArea = 0;
+    page.dirty = true;
+    return;
+  }
+  page.freedArea +=
+      (size_t)(rect.width + 2 * kBorder) * (rect.height + 2 * kBorder);
+}
+
+const TextureAtlas::Rect *TextureAtlas::find(int handle) const {
+  auto found = rects_.find(handle);
+  return found != rects_.end() ? &found->second : nullptr;
+}
+
+std::vector<int> TextureAtlas::compact() {
+  std::vector<int> moved;
+  size_t threshold = (size_t)pageSize_ * pageSize_ / 4;
+  for (size_t i = 0; i < pages_.size(); ++i) {
+    if (!pages_[i]->pixels.empty() && pages_[i]->freedArea >= threshold) {
+      repack(static_cast<int>(i), moved);
+    }
+  }
+  return moved;
+}
+
+std::vector<int> TextureAtlas::takeDirtyPages() {
+  std::vector<int> dirty;
+  for (size_t i = 0; i < pages_.size(); ++i) {
+    if (pages_[i]->dirty) {
+      pages_[i]->dirty = false;
+      dirty.push_back(static_cast<int>(i));
+    }
+  }
+  return dirty;
+}
+
+const uint8_t *TextureAtlas::pagePixels(int page) const {
+  const auto &pixels = pages_[page]->pixels;
+  return pixels.empty() ? nullptr : pixels.data();
+}
+
+bool TextureAtlas::pack(Page &page, int handle, int width, int height,
+                        Rect &rect) {
+  stbrp_rect packed{};
+  packed.id = handle;
+  packed.w = width + 2 * kBorder;
+  packed.h = height + 2 * kBorder;
+  if (!stbrp_pack_rects(&page.packer->context, &packed, 1)) {
+    return false;
+  }
+  rect.x = packed.x + kBorder;
+  rect.y = packed.y + kBorder;
+  rect.width = width;
+  rect.height = height;
+  return true;
+}
+
+void TextureAtlas::repack(int pageIndex, std::vector<int> &moved) {
+  TraceScope trace("repackAtlasPage", "image");
+  Page &page = *pages_[pageIndex];
+  std::vector<stbrp_rect> packed(page.handles.size());
+  for (size_t i = 0; i < packed.size(); ++i) {
+    const Rect &rect = rects_.at(page.handles[i]);
+    packed[i].id = page.handles[i];
+    packed[i].w = rect.width + 2 * kBorder;
+    packed[i].h = rect.height + 2 * kBorder;
+  }
+  // Packing everything at once sorts by height, which usually fits better
+  // than the original order of arrival; if it does not, keep the old layout
+  // until more images are removed.
+  auto packer = std::make_unique<Packer>(pageSize_);
+  if (!stbrp_pack_rects(&packer->context, packed.data(),
+                        static_cast<int>(packed.size()))) {
+    page.freedArea = 0;
+    return;
+  }
+
+  std::vector<uint8_t> pixels((size_t)pageSize_ * pageSize_ * 4, 0);
+  size_t pitch = (size_t)pageSize_ * 4;
+  for (const stbrp_rect &to : packed) {
+    Rect &rect = rects_.at(to.id);
+    int fromX = rect.x - kBorder;
+    int fromY = rect.y - kBorder;
+    size_t rowBytes = (size_t)to.w * 4;
+    for (int row = 0; row < to.h; ++row) {
+      memcpy(&pixels[(to.y + row) * pitch + (size_t)to.x * 4],
+             &page.pixels[(fromY + row) * pitch + (size_t)fromX * 4],
+             rowBytes);
+    }
+    if (to.x != fromX || to.y != fromY) {
+      rect.x = to.x + kBorder;
+      rect.y = to.y + kBorder;
+      moved.push_back(to.id);
+    }
+  }
+  page.pixels.swap(pixels);
+  page.packer = std::move(packer);
+  page.freedArea = 0;
+  page.dirty = true;
+}
+
+void TextureAtlas::copyImage(Page &page, const Rect &rect,
+                             const uint8_t *pixels, size_t stride) {
+  size_t pitch = (size_t)pageSize_ * 4;
+  size_t rowBytes = (size_t)rect.width * 4;
+  auto row = [&](int y) { return &page.pixels[y * pitch]; };
+  for (int y = 0; y < rect.height; ++y) {
+    uint8_t *out = row(rect.y + y) + (size_t)rect.x * 4;
+    memcpy(out, pixels + y * stride, rowBytes);
+    // Extend the first and last columns into the border.
+    for (int b = 1; b <= kBorder; ++b) {
+      memcpy(out - b * 4, out, 4);
+      memcpy(out + rowBytes + (b - 1) * 4, out + rowBytes - 4, 4);
+    }
+  }
+  // Then the first and last rows, corners included.
+  size_t borderedBytes = rowBytes + 2 * kBorder * 4;
+  size_t left = (size_t)(rect.x - kBorder) * 4;
+  for (int b = 1; b <= kBorder; ++b) {
+    memcpy(row(rect.y - b) + left, row(rect.y) + left, borderedBytes);
+    memcpy(row(rect.y + rect.height - 1 + b) + left,
+           row(rect.y + rect.height - 1) + left, borderedBytes);
+  }
+}
@@ -0,0 +1,89 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/// Packs small images (icons, thumbnails) into shared RGBA8 pages so that
+/// they are drawn from one texture, which lets ImGui merge their draws
+/// instead of switching textures for every image.
+///
+/// Pages are packed with imstb_rectpack. Each image is surrounded by a copy
+/// of its edge pixels so that linear filtering never samples a neighbour.
+/// The packer cannot reuse the space of removed images, so once the removed
+/// images of a page add up to a quarter of it, compact() packs its remaining
+/// images again from scratch and moves them, which changes their rectangles.
+/// Images that fit in no page are left to the caller to upload on their own.
+///
+/// The atlas keeps the pixels of every page in memory; the owner uploads the
+/// pages takeDirtyPages() returns. Not thread-safe: it is used from the frame
+/// loop.
+class TextureAtlas {
+public:
+  struct Rect {
+    int page = -1;
+    /// The image, without its border, in page pixels.
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  TextureAtlas(int pageSize, int maxImageSize, size_t maxPages);
+  ~TextureAtlas();
+
+  TextureAtlas(const TextureAtlas &) = delete;
+  TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+  int pageSize() const { return pageSize_; }
+  int maxImageSize() const { return maxImageSize_; }
+  /// Images larger than \p size in either dimension are not packed; 0 stops
+  /// packing new images.
+  void setMaxImageSize(int size) { maxImageSize_ = size; }
+
+  /// Whether an image of this size belongs in the atlas.
+  bool accepts(int width, int height) const;
+
+  /// Copy \p pixels (RGBA8, \p width * \p height) into a page under
+  /// \p handle. Returns false if no page has room and no page can be added.
+  bool insert(int handle, const uint8_t *pixels, int width, int height);
+
+  /// Forget \p handle; its space is reclaimed when its page is repacked or
+  /// becomes empty.
+  void remove(int handle);
+
+  /// The rectangle of \p handle, or null if it is not in the atlas.
+  const Rect *find(int handle) const;
+
+  /// Repack the pages with too much removed space and return the handles
+  /// whose rectangles moved.
+  std::vector<int> compact();
+
+  /// Pages whose pixels changed since the last call, or that became empty
+  /// (pagePixels() returns null for those).
+  std::vector<int> takeDirtyPages();
+
+  size_t pageCount() const { return pages_.size(); }
+  /// RGBA8 pixels of \p page, or null if the page holds no images.
+  const uint8_t *pagePixels(int page) const;
+
+private:
+  struct Page;
+
+  bool pack(Page &page, int handle, int width, int height, Rect &rect);
+  void repack(int pageIndex, std::vector<int> &moved);
+  void copyImage(Page &page, const Rect &rect, const uint8_t *pixels,
+                 size_t stride);
+
+  int pageSize_;
+  int maxImageSize_;
+  size_t maxPages_;
+  std::vector<std::unique_ptr<Page>> pages_;
+  std::unordered_map<int, Rect> rects_;
+};
@@ -0,0 +1,123 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "TextureCache.h"
+
+TextureCache::Reference TextureCache::acquire(const std::string &key) {
+  if (!key.empty()) {
+    auto found = handles_.find(key);
+    if (found != handles_.end()) {
+      Entry &entry = entries_.at(found->second);
+      if (entry.refs++ == 0 && entry.resident) {
+        unused_.erase(entry.unused);
+      }
+      ++hits_;
+      return {found->second, true};
+    }
+  }
+  int handle = nextHandle_++;
+  Entry &entry = entries_[handle];
+  entry.key = key;
+  entry.refs = 1;
+  if (!key.empty()) {
+    handles_[key] = handle;
+  }
+  ++misses_;
+  return {handle, false};
+}
+
+int TextureCache::release(int handle) {
+  auto found = entries_.find(handle);
+  if (found == entries_.end()) {
+    return -1;
+  }
+  Entry &entry = found->second;
+  if (entry.refs == 0) {
+    return 0;
+  }
+  if (--entry.refs > 0) {
+    return entry.refs;
+  }
+  if (!entry.resident) {
+    erase(handle);
+  } else if (entry.key.empty()) {
+    orphans_.push_back(handle);
+  } else {
+    unused_.push_front(handle);
+    entry.unused = unused_.begin();
+  }
+  return 0;
+}
+
+bool TextureCache::setResident(int handle, size_t bytes) {
+  auto found = entries_.find(handle);
+  if (found == entries_.end() || found->second.resident) {
+    return false;
+  }
+  found->second.resident = true;
+  found->second.bytes = bytes;
+  residentBytes_ += bytes;
+  ++residentTextures_;
+  return true;
+}
+
+void TextureCache::remove(int handle) {
+  auto found = entries_.find(handle);
+  if (found == entries_.end()) {
+    return;
+  }
+  if (found->second.resident && found->second.refs == 0 &&
+      !found->second.key.empty()) {
+    unused_.erase(found->second.unused);
+  }
+  erase(handle);
+}
+
+std::vector<int> TextureCache::evict() {
+  std::vector<int> evicted;
+  evicted.swap(orphans_);
+  for (int handle : evicted) {
+    erase(handle);
+  }
+  while (residentBytes_ > maxBytes_ && !unused_.empty()) {
+    int handle = unused_.back();
+    unused_.pop_back();
+    erase(handle);
+    evicted.push_back(handle);
+    ++evictions_;
+  }
+  return evicted;
+}
+
+TextureCache::Stats TextureCache::stats(bool reset) {
+  Stats stats;
+  stats.residentBytes = residentBytes_;
+  stats.residentTextures = residentTextures_;
+  stats.unusedTextures = unused_.size();
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  if (reset) {
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+  }
+  return stats;
+}
+
+void TextureCache::erase(int handle) {
+  auto found = entries_.find(handle);
+  if (found == entries_.end()) {
+    return;
+  }
+  Entry &entry = found->second;
+  if (entry.resident) {
+    residentBytes_ -= entry.bytes;
+    --residentTextures_;
+  }
+  if (!entry.key.empty()) {
+    handles_.erase(entry.key);
+  }
+  entries_.erase(found);
+}
@@ -0,0 +1,108 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Bookkeeping of the textures loaded by path or embedded image key, so that
+/// the same source is decoded and uploaded once and textures nobody uses any
+/// more are freed.
+///
+/// Every load acquires a reference to the handle of its key and every
+/// release drops one. A texture whose last reference is dropped stays
+/// resident, so loading it again is a hit, until the textures without
+/// references no longer fit in maxBytes; they are then evicted least
+/// recently released first. Textures that are referenced are never evicted,
+/// so the resident size can exceed maxBytes while they are all in use.
+/// Textures without a key (decoded from memory) cannot be found again and
+/// are freed as soon as they are released.
+///
+/// Handles are never reused. The cache only tracks sizes and references;
+/// the owner of the GPU images frees those evict() returns. Not thread-safe:
+/// it is used from the frame loop.
+class TextureCache {
+public:
+  struct Stats {
+    size_t residentBytes = 0;
+    size_t residentTextures = 0;
+    /// Resident textures without references, kept for reuse.
+    size_t unusedTextures = 0;
+    /// Loads of a key that was already loading or resident.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    /// Unused textures freed to stay within maxBytes.
+    uint64_t evictions = 0;
+  };
+
+  struct Reference {
+    int handle = 0;
+    /// Whether the handle already existed, loading or resident.
+    bool hit = false;
+  };
+
+  explicit TextureCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+  size_t maxBytes() const { return maxBytes_; }
+  /// Takes effect with the next evict().
+  void setMaxBytes(size_t maxBytes) { maxBytes_ = maxBytes; }
+
+  /// Add a reference to the texture of \p key, creating a handle on a miss.
+  /// An empty \p key always creates a new handle.
+  Reference acquire(const std::string &key);
+
+  /// Drop a reference to \p handle and return how many remain, or -1 if the
+  /// handle is unknown. A texture that is still loading is forgotten when its
+  /// last reference goes.
+  int release(int handle);
+
+  /// Record that the texture of \p handle was uploaded with \p bytes. Returns
+  /// false if the handle is gone, i.e. it was released while loading and the
+  /// upload should be discarded.
+  bool setResident(int handle, size_t bytes);
+
+  /// Forget \p handle, e.g. because it failed to load.
+  void remove(int handle);
+
+  bool contains(int handle) const { return entries_.count(handle) != 0; }
+
+  /// Remove the resident textures that must be freed: released ones without
+  /// a key, then the least recently released until the rest fit in maxBytes.
+  /// Returns their handles.
+  std::vector<int> evict();
+
+  /// Current statistics; \p reset zeroes the counters afterwards.
+  Stats stats(bool reset);
+
+private:
+  struct Entry {
+    std::string key;
+    size_t bytes = 0;
+    int refs = 0;
+    bool resident = false;
+    /// Position in unused_ while the entry is resident without references.
+    std::list<int>::iterator unused;
+  };
+
+  void erase(int handle);
+
+  size_t maxBytes_;
+  int nextHandle_ = 1;
+  std::unordered_map<int, Entry> entries_;
+  std::unordered_map<std::string, int> handles_;
+  /// Resident textures without references, most recently released first.
+  std::list<int> unused_;
+  /// Released textures without a key, waiting for evict().
+  std::vector<int> orphans_;
+  size_t residentBytes_ = 0;
+  size_t residentTextures_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
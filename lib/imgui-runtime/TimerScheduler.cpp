@@ -0,0 +1,128 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "TimerScheduler.h"
+
+#include <cmath>
+
+void TimerScheduler::advance(double nowMs) {
+  if (nowMs > nowMs_)
+    nowMs_ = nowMs;
+}
+
+TimerScheduler::TimerId TimerScheduler::schedule(double delayMs,
+                                                 double intervalMs) {
+  if (!(delayMs > 0))
+    delayMs = 0;
+  if (!(intervalMs > 0))
+    intervalMs = 0;
+  else if (intervalMs < 1)
+    intervalMs = 1;
+
+  TimerId id = nextTimerId_++;
+  size_t index = heap_.size();
+  heap_.push_back(Entry{nowMs_ + delayMs, nextSeq_++, id, intervalMs});
+  positions_[id] = index;
+  siftUp(index);
+  return id;
+}
+
+bool TimerScheduler::cancel(TimerId id) {
+  auto it = positions_.find(id);
+  if (it == positions_.end())
+    return false;
+  removeAt(it->second);
+  return true;
+}
+
+bool TimerScheduler::popExpired(TimerId &id) {
+  if (heap_.empty() || heap_.front().deadline > nowMs_)
+    return false;
+
+  Entry &top = heap_.front();
+  id = top.id;
+  if (top.intervalMs <= 0) {
+    removeAt(0);
+    return true;
+  }
+
+  double next = top.deadline + top.intervalMs;
+  if (next <= nowMs_) {
+    double missed = std::floor((nowMs_ - top.deadline) / top.intervalMs);
+    next = top.deadline + (missed + 1) * top.intervalMs;
+    // Guard against rounding landing exactly on nowMs_.
+    if (next <= nowMs_)
+      next += top.intervalMs;
+  }
+  top.deadline = next;
+  top.seq = nextSeq_++;
+  siftDown(0);
+  return true;
+}
+
+TimerScheduler::TimerId TimerScheduler::requestAnimationFrame() {
+  TimerId id = nextFrameId_++;
+  animationFrames_.insert(id);
+  return id;
+}
+
+bool TimerScheduler::cancelAnimationFrame(TimerId id) {
+  return animationFrames_.erase(id) != 0;
+}
+
+std::vector<TimerScheduler::TimerId> TimerScheduler::takeAnimationFrames() {
+  std::vector<TimerId> ids(animationFrames_.begin(), animationFrames_.end());
+  animationFrames_.clear();
+  return ids;
+}
+
+void TimerScheduler::place(size_t index, const Entry &entry) {
+  heap_[index] = entry;
+  positions_[entry.id] = index;
+}
+
+void TimerScheduler::siftUp(size_t index) {
+  Entry entry = heap_[index];
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!before(entry, heap_[parent]))
+      break;
+    place(index, heap_[parent]);
+    index = parent;
+  }
+  place(index, entry);
+}
+
+void TimerScheduler::siftDown(size_t index) {
+  Entry entry = heap_[index];
+  size_t count = heap_.size();
+  for (;;) {
+    size_t child = 2 * index + 1;
+    if (child >= count)
+      break;
+    if (child + 1 < count && before(heap_[child + 1], heap_[child]))
+      ++child;
+    if (!before(heap_[child], entry))
+      break;
+    place(index, heap_[child]);
+    index = child;
+  }
+  place(index, entry);
+}
+
+void TimerScheduler::removeAt(size_t index) {
+  positions_.erase(heap_[index].id);
+  size_t last = heap_.size() - 1;
+  if (index != last) {
+    Entry moved = heap_[last];
+    heap_.pop_back();
+    place(index, moved);
+    if (index > 0 && before(moved, heap_[(index - 1) / 2]))
+      siftUp(index);
+    else
+      siftDown(index);
+  } else {
+    heap_.pop_back();
+  }
+}
@@ -0,0 +1,91 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/// Native backing store for setTimeout/setInterval/requestAnimationFrame.
+///
+/// Timers live in an indexed binary min-heap ordered by (deadline, insertion
+/// order), so scheduling and cancelling are O(log n) regardless of how many
+/// timers are live. The callbacks themselves stay in JS; the scheduler only
+/// deals in ids.
+///
+/// All deadlines are relative to the scheduler's current time, which the frame
+/// loop advances once per frame. This mirrors the previous JS implementation:
+/// a timer scheduled while the frame runs is based on the frame start time.
+class TimerScheduler {
+public:
+  using TimerId = uint64_t;
+
+  /// Set the current time in milliseconds. Time never moves backwards.
+  void advance(double nowMs);
+  double nowMs() const { return nowMs_; }
+
+  /// Schedule a timer firing \p delayMs from now. If \p intervalMs is
+  /// positive, the timer repeats with that period (clamped to at least 1ms)
+  /// until cancelled.
+  TimerId schedule(double delayMs, double intervalMs = 0);
+
+  /// Cancel a pending timer. Returns false if it already fired (one-shot
+  /// timers) or was never scheduled.
+  bool cancel(TimerId id);
+
+  /// Deadline of the earliest pending timer, or -1 if there is none.
+  double nextDeadline() const {
+    return heap_.empty() ? -1 : heap_.front().deadline;
+  }
+
+  size_t size() const { return heap_.size(); }
+
+  /// If the earliest timer is due at the current time, store its id in \p id
+  /// and return true. One-shot timers are removed; interval timers are
+  /// rescheduled on their original grid (deadline + k * interval), skipping
+  /// the periods that were missed, so they do not drift and fire at most once
+  /// per advance().
+  bool popExpired(TimerId &id);
+
+  /// Register an animation frame callback id. Ids increase monotonically, so
+  /// callbacks run in request order.
+  TimerId requestAnimationFrame();
+  bool cancelAnimationFrame(TimerId id);
+  bool hasAnimationFrames() const { return !animationFrames_.empty(); }
+
+  /// Take the pending animation frame ids. Frames requested while these run
+  /// are deferred to the next call.
+  std::vector<TimerId> takeAnimationFrames();
+
+private:
+  struct Entry {
+    double deadline;
+    /// Insertion sequence; keeps timers with equal deadlines FIFO.
+    uint64_t seq;
+    TimerId id;
+    double intervalMs;
+  };
+
+  static bool before(const Entry &a, const Entry &b) {
+    return a.deadline < b.deadline ||
+           (a.deadline == b.deadline && a.seq < b.seq);
+  }
+
+  void place(size_t index, const Entry &entry);
+  void siftUp(size_t index);
+  void siftDown(size_t index);
+  void removeAt(size_t index);
+
+  double nowMs_ = 0;
+  uint64_t nextSeq_ = 0;
+  TimerId nextTimerId_ = 1;
+  TimerId nextFrameId_ = 1;
+  std::vector<Entry> heap_;
+  /// Timer id -> position in heap_.
+  std::unordered_map<TimerId, size_t> positions_;
+  std::set<TimerId> animationFrames_;
+};
@@ -0,0 +1,211 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// One ring buffer slot. Each field is an atomic so that a concurrent dump
+/// never reads torn values; \c seq acts as a per-slot sequence lock: it is
+/// odd while the slot is being written and 2 * (index + 1) once event
+/// \c index is complete.
+struct TraceSlot {
+  std::atomic<uint64_t> seq{0};
+  std::atomic<uint64_t> timestampNs{0};
+  std::atomic<const char *> name{nullptr};
+  std::atomic<const char *> category{nullptr};
+  /// Thread id in the low 24 bits, phase character in the high 8 bits.
+  std::atomic<uint32_t> threadAndPhase{0};
+};
+
+struct TraceEvent {
+  uint64_t timestampNs;
+  const char *name;
+  const char *category;
+  uint32_t threadId;
+  char phase;
+};
+
+std::atomic<bool> s_enabled{false};
+std::atomic<uint64_t> s_writeIndex{0};
+std::unique_ptr<TraceSlot[]> s_slots;
+size_t s_mask = 0;
+std::once_flag s_allocateOnce;
+
+const auto s_epoch = std::chrono::steady_clock::now();
+
+std::mutex s_namesMutex;
+std::unordered_map<std::string, std::unique_ptr<std::string>> s_internedNames;
+std::unordered_map<uint32_t, const char *> s_threadNames;
+
+std::atomic<uint32_t> s_nextThreadId{1};
+
+uint32_t currentThreadId() {
+  thread_local uint32_t id = s_nextThreadId.fetch_add(1);
+  return id;
+}
+
+uint64_t nowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - s_epoch)
+      .count();
+}
+
+void record(char phase, const char *name, const char *category) {
+  uint64_t index = s_writeIndex.fetch_add(1, std::memory_order_relaxed);
+  TraceSlot &slot = s_slots[index & s_mask];
+  slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestampNs.store(nowNs(), std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.category.store(category, std::memory_order_relaxed);
+  slot.threadAndPhase.store((currentThreadId() & 0xFFFFFFu) |
+                                ((uint32_t)(uint8_t)phase << 24),
+                            std::memory_order_relaxed);
+  slot.seq.store(2 * index + 2, std::memory_order_release);
+}
+
+/// Copy the complete events out of the ring buffer, oldest first.
+std::vector<TraceEvent> snapshot() {
+  std::vector<TraceEvent> events;
+  if (!s_slots)
+    return events;
+
+  uint64_t end = s_writeIndex.load(std::memory_order_acquire);
+  uint64_t capacity = s_mask + 1;
+  uint64_t begin = end > capacity ? end - capacity : 0;
+  events.reserve((size_t)(end - begin));
+  for (uint64_t index = begin; index < end; ++index) {
+    const TraceSlot &slot = s_slots[index & s_mask];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * index + 2)
+      continue; // still being written, or already overwritten
+    TraceEvent event;
+    event.timestampNs = slot.timestampNs.load(std::memory_order_relaxed);
+    event.name = slot.name.load(std::memory_order_relaxed);
+    event.category = slot.category.load(std::memory_order_relaxed);
+    uint32_t threadAndPhase =
+        slot.threadAndPhase.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq)
+      continue;
+    event.threadId = threadAndPhase & 0xFFFFFFu;
+    event.phase = (char)(threadAndPhase >> 24);
+    events.push_back(event);
+  }
+  return events;
+}
+
+void writeJsonString(FILE *out, const char *str) {
+  fputc('"', out);
+  for (const char *p = str ? str : ""; *p; ++p) {
+    unsigned char c = (unsigned char)*p;
+    if (c == '"' || c == '\\') {
+      fputc('\\', out);
+      fputc(c, out);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+} // namespace
+
+void traceSetEnabled(bool enabled, size_t capacity) {
+  if (enabled) {
+    std::call_once(s_allocateOnce, [capacity] {
+      size_t size = 1024;
+      while (size < capacity)
+        size <<= 1;
+      s_slots.reset(new TraceSlot[size]);
+      s_mask = size - 1;
+    });
+  }
+  s_enabled.store(enabled, std::memory_order_release);
+}
+
+bool traceEnabled() { return s_enabled.load(std::memory_order_acquire); }
+
+void traceBegin(const char *name, const char *category) {
+  if (traceEnabled())
+    record('B', name, category);
+}
+
+void traceEnd(const char *name, const char *category) {
+  if (traceEnabled())
+    record('E', name, category);
+}
+
+void traceSetThreadName(const char *name) {
+  std::lock_guard<std::mutex> lock(s_namesMutex);
+  s_threadNames[currentThreadId()] = name;
+}
+
+const char *traceIntern(const std::string &name) {
+  // JS spans intern the same few names on every React commit; after the
+  // first time they are found without taking s_namesMutex.
+  thread_local std::unordered_map<std::string, const char *> t_interned;
+  auto cached = t_interned.find(name);
+  if (cached != t_interned.end())
+    return cached->second;
+
+  const char *interned;
+  {
+    std::lock_guard<std::mutex> lock(s_namesMutex);
+    auto &entry = s_internedNames[name];
+    if (!entry)
+      entry = std::make_unique<std::string>(name);
+    interned = entry->c_str();
+  }
+  t_interned.emplace(name, interned);
+  return interned;
+}
+
+bool traceWriteJson(const char *path) {
+  FILE *out = fopen(path, "w");
+  if (!out)
+    return false;
+
+  std::vector<TraceEvent> events = snapshot();
+
+  fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  {
+    std::lock_guard<std::mutex> lock(s_namesMutex);
+    for (const auto &[threadId, threadName] : s_threadNames) {
+      fprintf(out,
+              "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+              "\"args\":{\"name\":",
+              first ? "" : ",\n", threadId);
+      writeJsonString(out, threadName);
+      fprintf(out, "}}");
+      first = false;
+    }
+  }
+  for (const TraceEvent &event : events) {
+    fprintf(out, "%s{\"name\":", first ? "" : ",\n");
+    writeJsonString(out, event.name);
+    fprintf(out, ",\"cat\":");
+    writeJsonString(out, event.category);
+    fprintf(out, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+            event.phase, (double)event.timestampNs / 1000.0, event.threadId);
+    first = false;
+  }
+  fprintf(out, "\n]}\n");
+  bool ok = ferror(out) == 0;
+  fclose(out);
+  return ok;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// Lightweight tracing of runtime phases in the Chrome trace-event format
+/// (loadable in Perfetto or chrome://tracing).
+///
+/// Events are recorded into a fixed-size lock-free ring buffer, so recording is
+/// safe from any thread and never blocks; when the buffer wraps the oldest
+/// events are overwritten. Event names and categories are stored as pointers
+/// and must outlive the trace: use string literals or traceIntern().
+
+/// Enable or disable recording. The ring buffer is allocated the first time
+/// tracing is enabled; \p capacity (rounded up to a power of two) is only used
+/// at that point.
+void traceSetEnabled(bool enabled, size_t capacity = 1u << 16);
+
+/// Whether events are currently being recorded.
+bool traceEnabled();
+
+/// Record the beginning/end of a span on the calling thread.
+void traceBegin(const char *name, const char *category);
+void traceEnd(const char *name, const char *category);
+
+/// Name the calling thread in the trace output.
+void traceSetThreadName(const char *name);
+
+/// Return a pointer with static lifetime for a dynamic event name. Names seen
+/// before on the calling thread are found without locking.
+const char *traceIntern(const std::string &name);
+
+/// Write the events currently in the ring buffer as Chrome trace-event JSON.
+/// @return false if the file could not be written.
+bool traceWriteJson(const char *path);
+
+/// Records a begin event on construction and the matching end event on
+/// destruction, so spans stay balanced when exceptions propagate.
+class TraceScope {
+public:
+  TraceScope(const char *name, const char *category)
+      : name_(name), category_(category), active_(traceEnabled()) {
+    if (active_)
+      traceBegin(name_, category_);
+  }
+  ~TraceScope() {
+    if (active_)
+      traceEnd(name_, category_);
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+  const char *name_;
+  const char *category_;
+  bool active_;
+};
@@ -0,0 +1,403 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "Utf8.h"
+#include "CpuFeatures.h"
+
+#include <cstring>
+
+namespace {
+
+/// Length of the ASCII run at the start of \p data, a word at a time.
+size_t asciiPrefix(const uint8_t *data, size_t size) {
+  size_t i = 0;
+  for (; size - i >= 8; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    if (word & 0x8080808080808080ull) {
+      break;
+    }
+  }
+  while (i < size && data[i] < 0x80) {
+    ++i;
+  }
+  return i;
+}
+
+/// Bounds of the second byte of a sequence started by \p lead, per the
+/// well-formed byte sequences table of the Unicode standard; the remaining
+/// bytes are always 0x80-0xBF. Returns the number of continuation bytes, or
+/// -1 if \p lead cannot start a sequence.
+int sequenceShape(uint8_t lead, uint8_t &lower, uint8_t &upper) {
+  lower = 0x80;
+  upper = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    return 1;
+  }
+  if (lead >= 0xE0 && lead <= 0xEF) {
+    if (lead == 0xE0) {
+      lower = 0xA0;
+    } else if (lead == 0xED) {
+      upper = 0x9F;
+    }
+    return 2;
+  }
+  if (lead >= 0xF0 && lead <= 0xF4) {
+    if (lead == 0xF0) {
+      lower = 0x90;
+    } else if (lead == 0xF4) {
+      upper = 0x8F;
+    }
+    return 3;
+  }
+  return -1;
+}
+
+/// Length of the well-formed sequence at \p data[i], or 0 if it is not one;
+/// \p end receives the end of its maximal valid subpart.
+size_t sequenceAt(const uint8_t *data, size_t size, size_t i, size_t &end) {
+  uint8_t lower;
+  uint8_t upper;
+  int continuation = sequenceShape(data[i], lower, upper);
+  end = i + 1;
+  if (continuation < 0) {
+    return 0;
+  }
+  for (int k = 0; k < continuation; ++k) {
+    if (end == size || data[end] < lower || data[end] > upper) {
+      return 0;
+    }
+    ++end;
+    lower = 0x80;
+    upper = 0xBF;
+  }
+  return end - i;
+}
+
+bool validateScalar(const uint8_t *data, size_t size) {
+  size_t i = 0;
+  while (i < size) {
+    i += asciiPrefix(data + i, size - i);
+    if (i == size) {
+      break;
+    }
+    size_t end;
+    if (!sequenceAt(data, size, i, end)) {
+      return false;
+    }
+    i = end;
+  }
+  return true;
+}
+
+// The vector validators implement the "lookup" algorithm of John Keiser and
+// Daniel Lemire ("Validating UTF-8 In Less Than One Instruction Per Byte",
+// 2021). Three 16-entry tables, indexed by the high and low nibble of each
+// byte's predecessor and by its own high nibble, flag the possible errors of
+// each two-byte pair; a pair is invalid when all three agree on one. A
+// separate check requires continuation bytes two and three positions after
+// three- and four-byte leads.
+
+enum : uint8_t {
+  kTooShort = 1 << 0,     // lead followed by a non-continuation
+  kTooLong = 1 << 1,      // ASCII followed by a continuation
+  kOverlong3 = 1 << 2,    // E0 80..9F
+  kTooLarge = 1 << 3,     // F4 90..BF, F5..FF
+  kSurrogate = 1 << 4,    // ED A0..BF
+  kOverlong2 = 1 << 5,    // C0..C1
+  kTooLarge1000 = 1 << 6, // F5..FF 80..8F
+  kOverlong4 = 1 << 6,    // F0 80..8F
+  kTwoConts = 1 << 7,     // continuation after continuation
+  kCarry = kTooShort | kTooLong | kTwoConts,
+};
+
+#define UTF8_BYTE_1_HIGH                                                       \
+  kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,        \
+      kTooLong, kTwoConts, kTwoConts, kTwoConts, kTwoConts,                    \
+      kTooShort | kOverlong2, kTooShort,                                       \
+      kTooShort | kOverlong3 | kSurrogate,                                     \
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+#define UTF8_BYTE_1_LOW                                                        \
+  kCarry | kOverlong3 | kOverlong2 | kOverlong4, kCarry | kOverlong2, kCarry,  \
+      kCarry, kCarry | kTooLarge, kCarry | kTooLarge | kTooLarge1000,          \
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,  \
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,  \
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,  \
+      kCarry | kTooLarge | kTooLarge1000,                                      \
+      kCarry | kTooLarge | kTooLarge1000 | kSurrogate,                         \
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000
+#define UTF8_BYTE_2_HIGH                                                       \
+  kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, \
+      kTooShort,                                                               \
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 |         \
+          kOverlong4,                                                          \
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,              \
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,              \
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge, kTooShort,   \
+      kTooShort, kTooShort, kTooShort
+// Bytes a block may end with without leaving a sequence unfinished.
+#define UTF8_MAX_LAST_BYTES                                                    \
+  char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF),      \
+      char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF),  \
+      char(0xFF), char(0xEF), char(0xDF), char(0xBF)
+
+#if defined(IMGUI_RUNTIME_X86)
+
+IMGUI_RUNTIME_TARGET("ssse3")
+bool validateSsse3(const uint8_t *data, size_t size) {
+  const __m128i byte1High = _mm_setr_epi8(UTF8_BYTE_1_HIGH);
+  const __m128i byte1Low = _mm_setr_epi8(UTF8_BYTE_1_LOW);
+  const __m128i byte2High = _mm_setr_epi8(UTF8_BYTE_2_HIGH);
+  const __m128i maxLast = _mm_setr_epi8(UTF8_MAX_LAST_BYTES);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  __m128i error = _mm_setzero_si128();
+  __m128i previous = _mm_setzero_si128();
+  __m128i incomplete = _mm_setzero_si128();
+  uint8_t tail[16];
+  for (size_t i = 0; i < size; i += 16) {
+    __m128i input;
+    if (size - i >= 16) {
+      input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    } else {
+      // Padding with zeros (ASCII) exposes a sequence cut off by the end.
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, data + i, size - i);
+      input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail));
+    }
+    if (_mm_movemask_epi8(input) == 0) {
+      error = _mm_or_si128(error, incomplete);
+      incomplete = _mm_setzero_si128();
+      previous = input;
+      continue;
+    }
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i special = _mm_and_si128(
+        _mm_and_si128(
+            _mm_shuffle_epi8(byte1High,
+                             _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+            _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, nibble))),
+        _mm_shuffle_epi8(byte2High,
+                         _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+    __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+    __m128i must23 =
+        _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80))),
+                     _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80))));
+    __m128i must23x80 = _mm_and_si128(must23, _mm_set1_epi8(char(0x80)));
+    error = _mm_or_si128(error, _mm_xor_si128(must23x80, special));
+    incomplete = _mm_subs_epu8(input, maxLast);
+    previous = input;
+  }
+  error = _mm_or_si128(error, incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) ==
+         0xFFFF;
+}
+
+/// The bytes of \p input shifted up by \p N, with the last N bytes of
+/// \p previous shifted in.
+template <int N>
+IMGUI_RUNTIME_TARGET("avx2")
+inline __m256i precedingAvx2(__m256i input, __m256i previous) {
+  return _mm256_alignr_epi8(
+      input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+IMGUI_RUNTIME_TARGET("avx2")
+bool validateAvx2(const uint8_t *data, size_t size) {
+  const __m256i byte1High =
+      _mm256_setr_epi8(UTF8_BYTE_1_HIGH, UTF8_BYTE_1_HIGH);
+  const __m256i byte1Low = _mm256_setr_epi8(UTF8_BYTE_1_LOW, UTF8_BYTE_1_LOW);
+  const __m256i byte2High =
+      _mm256_setr_epi8(UTF8_BYTE_2_HIGH, UTF8_BYTE_2_HIGH);
+  const __m256i maxLast = _mm256_setr_epi8(
+      char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+      char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+      char(0xFF), char(0xFF), char(0xFF), char(0xFF), UTF8_MAX_LAST_BYTES);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  __m256i error = _mm256_setzero_si256();
+  __m256i previous = _mm256_setzero_si256();
+  __m256i incomplete = _mm256_setzero_si256();
+  uint8_t tail[32];
+  for (size_t i = 0; i < size; i += 32) {
+    __m256i input;
+    if (size - i >= 32) {
+      input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    } else {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, data + i, size - i);
+      input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(tail));
+    }
+    if (_mm256_movemask_epi8(input) == 0) {
+      error = _mm256_or_si256(error, incomplete);
+      incomplete = _mm256_setzero_si256();
+      previous = input;
+      continue;
+    }
+    __m256i prev1 = precedingAvx2<1>(input, previous);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(
+                byte1High,
+                _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+            _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(prev1, nibble))),
+        _mm256_shuffle_epi8(
+            byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+    __m256i prev2 = precedingAvx2<2>(input, previous);
+    __m256i prev3 = precedingAvx2<3>(input, previous);
+    __m256i must23 = _mm256_or_si256(
+        _mm256_subs_epu8(prev2, _mm256_set1_epi8(char(0xE0 - 0x80))),
+        _mm256_subs_epu8(prev3, _mm256_set1_epi8(char(0xF0 - 0x80))));
+    __m256i must23x80 =
+        _mm256_and_si256(must23, _mm256_set1_epi8(char(0x80)));
+    error = _mm256_or_si256(error, _mm256_xor_si256(must23x80, special));
+    incomplete = _mm256_subs_epu8(input, maxLast);
+    previous = input;
+  }
+  error = _mm256_or_si256(error, incomplete);
+  return _mm256_testz_si256(error, error) != 0;
+}
+
+#endif // IMGUI_RUNTIME_X86
+
+#if defined(IMGUI_RUNTIME_NEON)
+
+bool validateNeon(const uint8_t *data, size_t size) {
+  static const uint8_t kByte1High[16] = {UTF8_BYTE_1_HIGH};
+  static const uint8_t kByte1Low[16] = {UTF8_BYTE_1_LOW};
+  static const uint8_t kByte2High[16] = {UTF8_BYTE_2_HIGH};
+  static const uint8_t kMaxLast[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                       0xFF, 0xEF, 0xDF, 0xBF};
+  const uint8x16_t byte1High = vld1q_u8(kByte1High);
+  const uint8x16_t byte1Low = vld1q_u8(kByte1Low);
+  const uint8x16_t byte2High = vld1q_u8(kByte2High);
+  const uint8x16_t maxLast = vld1q_u8(kMaxLast);
+  const uint8x16_t nibble = vdupq_n_u8(0x0F);
+  uint8x16_t error = vdupq_n_u8(0);
+  uint8x16_t previous = vdupq_n_u8(0);
+  uint8x16_t incomplete = vdupq_n_u8(0);
+  uint8_t tail[16];
+  for (size_t i = 0; i < size; i += 16) {
+    uint8x16_t input;
+    if (size - i >= 16) {
+      input = vld1q_u8(data + i);
+    } else {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, data + i, size - i);
+      input = vld1q_u8(tail);
+    }
+    if (vmaxvq_u8(input) < 0x80) {
+      error = vorrq_u8(error, incomplete);
+      incomplete = vdupq_n_u8(0);
+      previous = input;
+      continue;
+    }
+    uint8x16_t prev1 = vextq_u8(previous, input, 15);
+    uint8x16_t special = vandq_u8(
+        vandq_u8(vqtbl1q_u8(byte1High, vshrq_n_u8(prev1, 4)),
+                 vqtbl1q_u8(byte1Low, vandq_u8(prev1, nibble))),
+        vqtbl1q_u8(byte2High, vshrq_n_u8(input, 4)));
+    uint8x16_t prev2 = vextq_u8(previous, input, 14);
+    uint8x16_t prev3 = vextq_u8(previous, input, 13);
+    uint8x16_t must23 = vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80)),
+                                 vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80)));
+    uint8x16_t must23x80 = vandq_u8(must23, vdupq_n_u8(0x80));
+    error = vorrq_u8(error, veorq_u8(must23x80, special));
+    incomplete = vqsubq_u8(input, maxLast);
+    previous = input;
+  }
+  error = vorrq_u8(error, incomplete);
+  return vmaxvq_u8(error) == 0;
+}
+
+#endif // IMGUI_RUNTIME_NEON
+
+#undef UTF8_BYTE_1_HIGH
+#undef UTF8_BYTE_1_LOW
+#undef UTF8_BYTE_2_HIGH
+#undef UTF8_MAX_LAST_BYTES
+
+using ValidateFn = bool (*)(const uint8_t *data, size_t size);
+
+ValidateFn selectValidator() {
+#if defined(IMGUI_RUNTIME_X86)
+  if (cpuHasAvx2()) {
+    return validateAvx2;
+  }
+  if (cpuHasSsse3()) {
+    return validateSsse3;
+  }
+#elif defined(IMGUI_RUNTIME_NEON)
+  return validateNeon;
+#endif
+  return validateScalar;
+}
+
+const ValidateFn s_validate = selectValidator();
+
+/// Inputs shorter than this are not worth a vector setup.
+constexpr size_t kVectorThreshold = 64;
+
+} // namespace
+
+Utf8Kind classifyUtf8(const uint8_t *data, size_t size) {
+  size_t ascii = asciiPrefix(data, size);
+  if (ascii == size) {
+    return Utf8Kind::Ascii;
+  }
+  // Start the check a few bytes early so that a vector validator sees the
+  // lead byte's ASCII predecessors rather than starting mid-stream.
+  size_t start = ascii & ~size_t(15);
+  ValidateFn validate =
+      size - start >= kVectorThreshold ? s_validate : validateScalar;
+  if (!validate(data + start, size - start)) {
+    return Utf8Kind::Invalid;
+  }
+  return Utf8Kind::Valid;
+}
+
+std::string replaceInvalidUtf8(const uint8_t *data, size_t size) {
+  static const char kReplacement[] = "\xEF\xBF\xBD";
+  std::string out;
+  out.reserve(size + size / 8);
+  size_t i = 0;
+  while (i < size) {
+    size_t ascii = asciiPrefix(data + i, size - i);
+    out.append(reinterpret_cast<const char *>(data + i), ascii);
+    i += ascii;
+    if (i == size) {
+      break;
+    }
+    size_t end;
+    if (sequenceAt(data, size, i, end)) {
+      out.append(reinterpret_cast<const char *>(data + i), end - i);
+    } else {
+      out.append(kReplacement, 3);
+    }
+    i = end;
+  }
+  return out;
+}
+
+size_t utf8PrefixWithin(const uint8_t *data, size_t size, size_t capacity) {
+  if (capacity >= size) {
+    return size;
+  }
+  while (capacity > 0 && (data[capacity] & 0xC0) == 0x80) {
+    --capacity;
+  }
+  return capacity;
+}
+
+size_t utf16Length(const uint8_t *data, size_t size) {
+  size_t units = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t byte = data[i];
+    // Every byte but a continuation starts a code point; four-byte ones
+    // become surrogate pairs.
+    units += (byte & 0xC0) != 0x80;
+    units += byte >= 0xF0;
+  }
+  return units;
+}
@@ -0,0 +1,29 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// UTF-8 helpers behind the native TextEncoder/TextDecoder.
+
+enum class Utf8Kind { Ascii, Valid, Invalid };
+
+/// Whether \p data is plain ASCII, other well-formed UTF-8 (no overlong forms,
+/// surrogates, code points past U+10FFFF or truncated sequences), or neither.
+/// Checks 32 or 16 bytes per step with AVX2, SSSE3 or NEON when available.
+Utf8Kind classifyUtf8(const uint8_t *data, size_t size);
+
+/// \p data with every ill-formed subsequence replaced by U+FFFD, following the
+/// WHATWG decoder (one replacement per maximal invalid subpart).
+std::string replaceInvalidUtf8(const uint8_t *data, size_t size);
+
+/// The length of the longest prefix of \p data, which is well-formed UTF-8,
+/// that fits in \p capacity bytes without splitting a character.
+size_t utf8PrefixWithin(const uint8_t *data, size_t size, size_t capacity);
+
+/// Number of UTF-16 code units well-formed UTF-8 \p data decodes to.
+size_t utf16Length(const uint8_t *data, size_t size);
@@ -0,0 +1,71 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "WorkerPool.h"
+#include "Trace.h"
+
+WorkerPool::WorkerPool(std::string name, size_t threadCount)
+    : name_(std::move(name)), threadCount_(threadCount ? threadCount : 1) {}
+
+WorkerPool::~WorkerPool() { shutdown(); }
+
+bool WorkerPool::post(Job job) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopping_) {
+    return false;
+  }
+  jobs_.push_back(std::move(job));
+  if (threads_.empty()) {
+    threads_.reserve(threadCount_);
+    for (size_t i = 0; i < threadCount_; ++i) {
+      threads_.emplace_back(&WorkerPool::run, this);
+    }
+  }
+  wake_.notify_one();
+  return true;
+}
+
+void WorkerPool::shutdown(bool drain) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      return;
+    }
+    stopping_ = true;
+    if (!drain) {
+      jobs_.clear();
+    }
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+size_t WorkerPool::pendingJobs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return jobs_.size() + running_;
+}
+
+void WorkerPool::run() {
+  traceSetThreadName(traceIntern(name_));
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+    // Only reached with an empty queue once stopping; a draining shutdown
+    // keeps the queue and runs it to the end.
+    if (jobs_.empty()) {
+      return;
+    }
+    Job job = std::move(jobs_.front());
+    jobs_.pop_front();
+    ++running_;
+    lock.unlock();
+    job();
+    lock.lock();
+    --running_;
+  }
+}
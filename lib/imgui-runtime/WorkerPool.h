@@ -0,0 +1,57 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Fixed-size pool of worker threads running jobs in submission order.
+///
+/// Used for blocking work that must stay off the main thread (file system
+/// calls). Jobs report back on their own, typically by queueing a completion
+/// for the frame loop. Threads are started on first use.
+class WorkerPool {
+public:
+  using Job = std::function<void()>;
+
+  /// \p name labels the threads in traces.
+  WorkerPool(std::string name, size_t threadCount);
+  /// Waits for running jobs and drops the queued ones, unless shutdown()
+  /// already ran.
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  /// Queue \p job. Thread-safe; returns false, dropping the job, after
+  /// shutdown().
+  bool post(Job job);
+
+  /// Stop the threads. Jobs already running finish; queued jobs are dropped,
+  /// or with \p drain run first, e.g. writes the app has already issued.
+  void shutdown(bool drain = false);
+
+  /// Jobs queued or running.
+  size_t pendingJobs() const;
+
+private:
+  void run();
+
+  std::string name_;
+  size_t threadCount_;
+  std::vector<std::thread> threads_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<Job> jobs_;
+  size_t running_ = 0;
+  bool stopping_ = false;
+};
@@ -3,13 +3,29 @@
 // See LICENSE file for full license text
 
 #include "imgui-runtime.h"
+#include "Base64.h"
+#include "BufferOps.h"
+#include "DirectoryScanner.h"
+#include "FetchClient.h"
+#include "FileWatcher.h"
+#include "FontAtlasCache.h"
+#include "FrameTimings.h"
+#include "ImageLoader.h"
+#include "MappedFileBuffer.h"
+#include "PixelFormat.h"
+#include "RawImage.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "TimerScheduler.h"
+#include "Trace.h"
+#include "Utf8.h"
+#include "WorkerPool.h"
 
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_glue.h"
 #include "sokol_log.h"
 #include "sokol_time.h"
-#include "stb_image.h"
 
 #include "sokol_imgui.h"
 #include "imgui/imgui.h"
@@ -43,9 +59,11 @@
 #include <cstdint>
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <cstring>
 #include <stdexcept>
 #include <mutex>
+#include <condition_variable>
 #include <queue>
 #include <thread>
 #include <atomic>
@@ -54,6 +72,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <chrono>
 #include <cstdlib>
@@ -61,6 +80,8 @@
 #include <cstdio>
 
 #if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/utsname.h>
 #include <unistd.h>
 #endif
@@ -73,6 +94,10 @@ namespace fs = std::filesystem;
 #define IMGUI_RUNTIME_HIDE_PERF_OVERLAY 0
 #endif
 
+#ifndef IMGUI_RUNTIME_HEADLESS
+#define IMGUI_RUNTIME_HEADLESS 0
+#endif
+
 #if defined(__APPLE__) || defined(__linux__) || defined(__unix__) ||          \
   defined(__EMSCRIPTEN__) || defined(__ANDROID__)
 extern char **environ;
@@ -83,15 +108,18 @@ class HermesApp {
 public:
   std::unique_ptr<SHRuntime, decltype(&_sh_done)> shRuntime;
   facebook::hermes::HermesRuntime *hermes = nullptr;
-  facebook::jsi::Function peekMacroTask;
-  facebook::jsi::Function runMacroTask;
-  facebook::jsi::Function flushRaf;
-
-  HermesApp(SHRuntime *shr, facebook::jsi::Function &&peek,
-            facebook::jsi::Function &&run, facebook::jsi::Function &&flushRaf)
+  /// jslib helpers invoking the JS callbacks of due timers and animation
+  /// frames by id.
+  facebook::jsi::Function runTimer;
+  facebook::jsi::Function runAnimationFrames;
+  /// Pending setTimeout/setInterval/requestAnimationFrame ids.
+  TimerScheduler timers;
+
+  HermesApp(SHRuntime *shr, facebook::jsi::Function &&runTimer,
+            facebook::jsi::Function &&runAnimationFrames)
       : shRuntime(shr, &_sh_done), hermes(_sh_get_hermes_runtime(shr)),
-        peekMacroTask(std::move(peek)), runMacroTask(std::move(run)),
-        flushRaf(std::move(flushRaf)) {}
+        runTimer(std::move(runTimer)),
+        runAnimationFrames(std::move(runAnimationFrames)) {}
 
   // Delete copy/move to ensure singleton behavior
   HermesApp(const HermesApp &) = delete;
@@ -102,7 +130,361 @@ public:
 
 static HermesApp *s_hermesApp = nullptr;
 
+// On-demand (idle) rendering. When enabled, app_frame() first waits until
+// something may have changed: input, the next macrotask deadline, a completed
+// native fetch or an explicit invalidation from JS. sokol_app cannot wait on
+// input by itself, so the wait is capped at s_idleMaxWaitMs and input is picked
+// up when it expires. After input, s_idleSettleFrames extra frames are rendered
+// so that ImGui animations (hover, scrolling, etc.) settle.
+static bool s_idleRendering = false;
+static double s_idleMaxWaitMs = 100.0;
+static int s_idleSettleFrames = 10;
+static int s_activeFramesRemaining = 0;
+
+static std::mutex s_frameWakeMutex;
+static std::condition_variable s_frameWakeCondition;
+static bool s_frameWakeRequested = false;
+
+/// Make sure the next frame is rendered, waking app_frame() if it is waiting.
+/// Safe to call from any thread.
+static void request_frame() {
+  {
+    std::lock_guard<std::mutex> lock(s_frameWakeMutex);
+    s_frameWakeRequested = true;
+  }
+  s_frameWakeCondition.notify_one();
+}
+
+/// Wait until the next frame has work to do. No-op unless idle rendering is
+/// enabled.
+static void wait_for_frame_work() {
+  if (!s_idleRendering || !s_hermesApp) {
+    return;
+  }
+  if (s_activeFramesRemaining > 0) {
+    --s_activeFramesRemaining;
+    return;
+  }
+  // Keep rendering while the user interacts with a widget (dragging, text
+  // cursor blinking).
+  const ImGuiIO &io = ImGui::GetIO();
+  if (io.WantTextInput || ImGui::IsAnyMouseDown()) {
+    return;
+  }
+
+  if (s_hermesApp->timers.hasAnimationFrames()) {
+    return;
+  }
+  double waitMs = s_idleMaxWaitMs;
+  double nextTimeMs = s_hermesApp->timers.nextDeadline();
+  if (nextTimeMs >= 0) {
+    waitMs = std::min(waitMs, nextTimeMs - stm_ms(stm_now()));
+  }
+
+  std::unique_lock<std::mutex> lock(s_frameWakeMutex);
+  if (waitMs > 0) {
+    s_frameWakeCondition.wait_for(
+        lock, std::chrono::duration<double, std::milli>(waitMs),
+        [] { return s_frameWakeRequested; });
+  }
+  s_frameWakeRequested = false;
+}
+
+/// Apply an idle rendering options object ({ enabled, maxWaitMs,
+/// settleFrames }); missing or invalid fields are left unchanged.
+static void apply_idle_rendering_options(facebook::jsi::Runtime &runtime,
+                                         const facebook::jsi::Object &options) {
+  if (options.hasProperty(runtime, "enabled")) {
+    auto value = options.getProperty(runtime, "enabled");
+    if (value.isBool()) {
+      s_idleRendering = value.getBool();
+    } else if (value.isNumber()) {
+      s_idleRendering = value.getNumber() != 0.0;
+    }
+  }
+  if (options.hasProperty(runtime, "maxWaitMs")) {
+    auto value = options.getProperty(runtime, "maxWaitMs");
+    if (value.isNumber() && std::isfinite(value.getNumber())) {
+      s_idleMaxWaitMs = std::max(0.0, value.getNumber());
+    }
+  }
+  if (options.hasProperty(runtime, "settleFrames")) {
+    auto value = options.getProperty(runtime, "settleFrames");
+    if (value.isNumber() && std::isfinite(value.getNumber())) {
+      s_idleSettleFrames =
+          (int)std::clamp(value.getNumber(), 0.0, 1000.0);
+    }
+  }
+  s_activeFramesRemaining = s_idleSettleFrames;
+  request_frame();
+}
+
+static facebook::jsi::Value
+configure_idle_rendering_host(facebook::jsi::Runtime &runtime,
+                              const facebook::jsi::Value &,
+                              const facebook::jsi::Value *args, size_t count) {
+  if (count >= 1 && args[0].isObject()) {
+    apply_idle_rendering_options(runtime, args[0].asObject(runtime));
+  } else if (count >= 1 && args[0].isBool()) {
+    s_idleRendering = args[0].getBool();
+    request_frame();
+  }
+
+  facebook::jsi::Object state(runtime);
+  state.setProperty(runtime, "enabled", s_idleRendering);
+  state.setProperty(runtime, "maxWaitMs", s_idleMaxWaitMs);
+  state.setProperty(runtime, "settleFrames", s_idleSettleFrames);
+  return state;
+}
+
+static facebook::jsi::Value
+invalidate_frame_host(facebook::jsi::Runtime &, const facebook::jsi::Value &,
+                      const facebook::jsi::Value *, size_t) {
+  request_frame();
+  return facebook::jsi::Value::undefined();
+}
+
+// Timer host functions backing jslib's setTimeout/setInterval and
+// requestAnimationFrame. JS keeps the callbacks keyed by the returned id; the
+// frame loop hands due ids back through HermesApp::runTimer and
+// HermesApp::runAnimationFrames.
+
+static double timer_number_arg(const facebook::jsi::Value *args, size_t count,
+                               size_t index) {
+  if (index >= count || !args[index].isNumber())
+    return 0;
+  double value = args[index].getNumber();
+  return std::isfinite(value) ? value : 0;
+}
+
+/// __timerSchedule(delayMs, intervalMs) -> id. A positive intervalMs makes
+/// the timer repeat until cancelled.
+static facebook::jsi::Value
+timer_schedule_host(facebook::jsi::Runtime &, const facebook::jsi::Value &,
+                    const facebook::jsi::Value *args, size_t count) {
+  return (double)s_hermesApp->timers.schedule(
+      timer_number_arg(args, count, 0), timer_number_arg(args, count, 1));
+}
+
+/// __timerCancel(id) -> whether the timer was still pending.
+static facebook::jsi::Value
+timer_cancel_host(facebook::jsi::Runtime &, const facebook::jsi::Value &,
+                  const facebook::jsi::Value *args, size_t count) {
+  double id = timer_number_arg(args, count, 0);
+  return id > 0 && s_hermesApp->timers.cancel((TimerScheduler::TimerId)id);
+}
+
+/// __rafRequest() -> id. Also makes sure the next frame is rendered in idle
+/// rendering mode.
+static facebook::jsi::Value
+raf_request_host(facebook::jsi::Runtime &, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *, size_t) {
+  auto id = s_hermesApp->timers.requestAnimationFrame();
+  request_frame();
+  return (double)id;
+}
+
+/// __rafCancel(id) -> whether the callback was still pending.
+static facebook::jsi::Value
+raf_cancel_host(facebook::jsi::Runtime &, const facebook::jsi::Value &,
+                const facebook::jsi::Value *args, size_t count) {
+  double id = timer_number_arg(args, count, 0);
+  return id > 0 &&
+         s_hermesApp->timers.cancelAnimationFrame((TimerScheduler::TimerId)id);
+}
+
+static void install_timer_host_functions(facebook::jsi::Runtime &runtime) {
+  const std::pair<const char *, facebook::jsi::HostFunctionType>
+      timerFunctions[] = {
+          {"__timerSchedule", timer_schedule_host},
+          {"__timerCancel", timer_cancel_host},
+          {"__rafRequest", raf_request_host},
+          {"__rafCancel", raf_cancel_host},
+      };
+  for (const auto &[name, fn] : timerFunctions) {
+    runtime.global().setProperty(
+        runtime, name,
+        facebook::jsi::Function::createFromHostFunction(
+            runtime, facebook::jsi::PropNameID::forAscii(runtime, name), 2,
+            fn));
+  }
+}
+
+/// Per-frame budget for the JS work started by the runtime (fetch completion
+/// callbacks and macrotasks), in milliseconds; 0 disables it. Once the budget
+/// is spent the remaining work is carried over to the next frame. Each kind of
+/// work still makes progress: at least one item of it runs per frame.
+static FrameBudgetStats s_budgetStats;
+
+const FrameBudgetStats &imgui_runtime_frame_budget_stats() {
+  return s_budgetStats;
+}
+
+class FrameBudget {
+public:
+  explicit FrameBudget(double budgetMs)
+      : start_(stm_now()), budgetMs_(budgetMs) {}
+
+  /// Whether more work may be started in this frame.
+  bool hasTimeLeft() const {
+    return budgetMs_ <= 0 || stm_ms(stm_since(start_)) < budgetMs_;
+  }
+
+  /// Record that work was left for the next frame.
+  void defer() { deferred_ = true; }
+
+  /// Account this frame in s_budgetStats.
+  void finish() {
+    if (budgetMs_ <= 0) {
+      return;
+    }
+    double overrunMs = stm_ms(stm_since(start_)) - budgetMs_;
+    if (overrunMs > 0) {
+      ++s_budgetStats.overrunFrames;
+      s_budgetStats.overrunTotalMs += overrunMs;
+      s_budgetStats.overrunMaxMs = std::max(s_budgetStats.overrunMaxMs, overrunMs);
+    }
+    if (deferred_) {
+      ++s_budgetStats.deferredFrames;
+    }
+  }
+
+private:
+  uint64_t start_;
+  double budgetMs_;
+  bool deferred_ = false;
+};
+
+static facebook::jsi::Object
+frame_budget_stats_to_js(facebook::jsi::Runtime &runtime) {
+  facebook::jsi::Object stats(runtime);
+  stats.setProperty(runtime, "budgetMs", s_budgetStats.budgetMs);
+  stats.setProperty(runtime, "overrunFrames",
+                    (double)s_budgetStats.overrunFrames);
+  stats.setProperty(runtime, "overrunTotalMs", s_budgetStats.overrunTotalMs);
+  stats.setProperty(runtime, "overrunMaxMs", s_budgetStats.overrunMaxMs);
+  stats.setProperty(runtime, "deferredFrames",
+                    (double)s_budgetStats.deferredFrames);
+  return stats;
+}
+
+/// __configureFrameBudget([budgetMs | { budgetMs, resetStats }]) updates the
+/// budget and returns the current statistics.
+static facebook::jsi::Value
+configure_frame_budget_host(facebook::jsi::Runtime &runtime,
+                            const facebook::jsi::Value &,
+                            const facebook::jsi::Value *args, size_t count) {
+  auto applyBudget = [](const facebook::jsi::Value &value) {
+    if (value.isNumber() && std::isfinite(value.getNumber())) {
+      s_budgetStats.budgetMs = std::max(0.0, value.getNumber());
+    }
+  };
+
+  if (count >= 1 && args[0].isNumber()) {
+    applyBudget(args[0]);
+  } else if (count >= 1 && args[0].isObject()) {
+    auto options = args[0].getObject(runtime);
+    if (options.hasProperty(runtime, "budgetMs")) {
+      applyBudget(options.getProperty(runtime, "budgetMs"));
+    }
+    if (options.hasProperty(runtime, "resetStats")) {
+      auto reset = options.getProperty(runtime, "resetStats");
+      if (reset.isBool() && reset.getBool()) {
+        s_budgetStats = FrameBudgetStats{s_budgetStats.budgetMs};
+      }
+    }
+  }
+  return frame_budget_stats_to_js(runtime);
+}
+
+/// Where the Chrome trace is written on exit. Set from the IMGUI_RUNTIME_TRACE
+/// environment variable or __traceSetEnabled(true, path); empty means no
+/// trace is written on exit.
+static std::string s_traceOutputPath;
+
+/// Interned trace name (or category) from a JS argument, \p fallback if the
+/// argument is missing or not a string.
+static const char *trace_string_arg(facebook::jsi::Runtime &runtime,
+                                    const facebook::jsi::Value *args,
+                                    size_t count, size_t index,
+                                    const char *fallback) {
+  if (index >= count || !args[index].isString()) {
+    return fallback;
+  }
+  return traceIntern(args[index].getString(runtime).utf8(runtime));
+}
+
+static facebook::jsi::Value
+trace_begin_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args, size_t count) {
+  if (traceEnabled()) {
+    traceBegin(trace_string_arg(runtime, args, count, 0, "anonymous"),
+               trace_string_arg(runtime, args, count, 1, "js"));
+  }
+  return facebook::jsi::Value::undefined();
+}
+
+static facebook::jsi::Value
+trace_end_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+               const facebook::jsi::Value *args, size_t count) {
+  if (traceEnabled()) {
+    traceEnd(trace_string_arg(runtime, args, count, 0, "anonymous"),
+             trace_string_arg(runtime, args, count, 1, "js"));
+  }
+  return facebook::jsi::Value::undefined();
+}
+
+static facebook::jsi::Value
+trace_set_enabled_host(facebook::jsi::Runtime &runtime,
+                       const facebook::jsi::Value &,
+                       const facebook::jsi::Value *args, size_t count) {
+  bool enabled = count >= 1 && args[0].isBool() && args[0].getBool();
+  if (count >= 2 && args[1].isString()) {
+    s_traceOutputPath = args[1].getString(runtime).utf8(runtime);
+  }
+  traceSetEnabled(enabled);
+  return facebook::jsi::Value(enabled);
+}
+
+static facebook::jsi::Value
+trace_dump_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                const facebook::jsi::Value *args, size_t count) {
+  std::string path = s_traceOutputPath.empty() ? "trace.json"
+                                               : s_traceOutputPath;
+  if (count >= 1 && args[0].isString()) {
+    path = args[0].getString(runtime).utf8(runtime);
+  }
+  if (!traceWriteJson(path.c_str())) {
+    throw facebook::jsi::JSError(runtime, "Failed to write trace: " + path);
+  }
+  return facebook::jsi::String::createFromUtf8(runtime, path);
+}
+
+/// Enable tracing at startup if IMGUI_RUNTIME_TRACE names an output file.
+static void initialize_tracing() {
+  traceSetThreadName("main");
+  const char *path = std::getenv("IMGUI_RUNTIME_TRACE");
+  if (path && path[0]) {
+    s_traceOutputPath = path;
+    traceSetEnabled(true);
+  }
+}
+
+static void write_trace_on_exit() {
+  if (s_traceOutputPath.empty()) {
+    return;
+  }
+  if (traceWriteJson(s_traceOutputPath.c_str())) {
+    printf("Trace written to '%s'\n", s_traceOutputPath.c_str());
+  } else {
+    std::string message = "Failed to write trace: " + s_traceOutputPath;
+    slog_func("ERROR", 1, 0, message.c_str(), __LINE__, __FILE__, nullptr);
+  }
+}
+
 static sg_sampler s_sampler = {};
+/// For images with mip levels, which s_sampler must not be used with.
+static sg_sampler s_mipSampler = {};
 static bool s_navKeyboardEnabled = true;
 static bool s_navGamepadEnabled = true;
 static double s_runtimeStartMs = 0.0;
@@ -354,6 +736,9 @@ static std::unordered_map<std::string, ImFont *> s_registeredFonts;
 static ImFont *s_defaultFont = nullptr;
 static float s_fontGlobalScale = 1.0f;
 static std::vector<ImVector<ImWchar>> s_fontRangeBuffers;
+/// Cache files kept in a font cache directory, for apps that switch between
+/// a few font configurations.
+static constexpr size_t kFontAtlasCacheFiles = 8;
 
 enum class ColorScheme { Unknown = 0, Light = 1, Dark = 2 };
 static ColorScheme s_colorScheme = ColorScheme::Unknown;
@@ -958,6 +1343,7 @@ configure_fonts_host(facebook::jsi::Runtime &runtime,
   }
 
   std::string defaultFontName;
+  std::string cacheDirectory;
   float globalScale = s_fontGlobalScale;
   if (count >= 2 && args[1].isObject()) {
     auto options = args[1].asObject(runtime);
@@ -967,6 +1353,12 @@ configure_fonts_host(facebook::jsi::Runtime &runtime,
         defaultFontName = df.asString(runtime).utf8(runtime);
       }
     }
+    if (options.hasProperty(runtime, "cacheDirectory")) {
+      auto dir = options.getProperty(runtime, "cacheDirectory");
+      if (dir.isString()) {
+        cacheDirectory = dir.asString(runtime).utf8(runtime);
+      }
+    }
     if (options.hasProperty(runtime, "globalScale")) {
       auto gs = options.getProperty(runtime, "globalScale");
       if (gs.isNumber()) {
@@ -1076,8 +1468,38 @@ configure_fonts_host(facebook::jsi::Runtime &runtime,
       defaultFontPtr = s_registeredFonts.begin()->second;
     }
 
-    if (!io.Fonts->Build()) {
-      throw facebook::jsi::JSError(runtime, "ImGui failed to build font atlas");
+    // With a cache directory, an atlas built for the same fonts before is
+    // restored from disk instead of being rasterized again.
+    bool fromCache = false;
+    uint64_t cacheKey = 0;
+    std::string cachePath;
+    if (!cacheDirectory.empty()) {
+      TraceScope trace("loadFontAtlasCache", "font");
+      cacheKey = fontAtlasCacheKey(*io.Fonts);
+      cachePath = (fs::path(cacheDirectory) / fontAtlasCacheFileName(cacheKey))
+                      .string();
+      std::error_code ec;
+      if (fs::exists(cachePath, ec)) {
+        try {
+          auto mapped = mapFileBuffer(cachePath.c_str());
+          fromCache = readFontAtlasCache(*io.Fonts, cacheKey, mapped->data(),
+                                         mapped->size());
+        } catch (const std::exception &) {
+          // Unreadable; rebuild and overwrite it.
+        }
+      }
+    }
+
+    if (!fromCache) {
+      TraceScope trace("buildFontAtlas", "font");
+      if (!io.Fonts->Build()) {
+        throw facebook::jsi::JSError(runtime,
+                                     "ImGui failed to build font atlas");
+      }
+      if (!cachePath.empty() &&
+          writeFontAtlasCache(*io.Fonts, cacheKey, cachePath)) {
+        pruneFontAtlasCache(cacheDirectory, kFontAtlasCacheFiles);
+      }
     }
 
     unsigned char *pixels = nullptr;
@@ -1135,6 +1557,7 @@ configure_fonts_host(facebook::jsi::Runtime &runtime,
     result.setProperty(runtime, "atlasWidth", static_cast<double>(width));
     result.setProperty(runtime, "atlasHeight", static_cast<double>(height));
     result.setProperty(runtime, "globalScale", static_cast<double>(globalScale));
+    result.setProperty(runtime, "cached", fromCache);
 
     if (defaultFontPtr) {
       double defaultHandle = static_cast<double>(
@@ -1197,130 +1620,419 @@ const EmbeddedImage *find_embedded_image(std::string_view key) {
 
 } // namespace
 
-struct NativeFetchRequest {
-  int id = 0;
-  std::string url;
-  std::string method = "GET";
-  std::vector<std::pair<std::string, std::string>> headers;
-  std::string body;
-  bool hasBody = false;
-  long timeoutMs = -1;
-  bool followRedirects = true;
-};
+/// Results produced on background threads (fetch I/O, fs workers) for the
+/// main thread. push() wakes the frame loop; drain() hands the items to JS
+/// under the frame budget and carries the rest over to the next frame.
+template <typename T> class CompletionQueue {
+public:
+  void push(T &&item) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      items_.push(std::move(item));
+    }
+    request_frame();
+  }
 
-struct NativeFetchResult {
-  int id = 0;
-  bool ok = false;
-  int status = 0;
-  std::string statusText;
-  std::string url;
-  std::string errorMessage;
-  std::vector<std::pair<std::string, std::string>> headers;
-  std::string bodyBase64;
+  bool empty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.empty();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_ = {};
+  }
+
+  /// Call \p dispatch for queued items while \p budget has time left. At
+  /// least one item is dispatched per call, so the queue always progresses.
+  template <typename Dispatch>
+  void drain(FrameBudget &budget, Dispatch &&dispatch) {
+    std::queue<T> localQueue;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (items_.empty()) {
+        return;
+      }
+      std::swap(localQueue, items_);
+    }
+
+    bool first = true;
+    while (!localQueue.empty()) {
+      if (!first && !budget.hasTimeLeft()) {
+        // Put the rest back in front of anything that completed meanwhile.
+        budget.defer();
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          while (!items_.empty()) {
+            localQueue.push(std::move(items_.front()));
+            items_.pop();
+          }
+          std::swap(localQueue, items_);
+        }
+        request_frame();
+        return;
+      }
+      first = false;
+
+      T item = std::move(localQueue.front());
+      localQueue.pop();
+      dispatch(std::move(item));
+    }
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::queue<T> items_;
 };
 
 static std::atomic<int> s_nextFetchRequestId{1};
-static std::mutex s_fetchQueueMutex;
-static std::queue<NativeFetchResult> s_completedFetches;
+static CompletionQueue<NativeFetchResult> s_completedFetches;
+/// Shared curl multi I/O thread running every __nativeFetch request.
+static std::unique_ptr<FetchClient> s_fetchClient;
+
+/// Converts the result of a background fs operation to JS on the main thread.
+using FsResultFn =
+    std::function<facebook::jsi::Value(facebook::jsi::Runtime &)>;
 
-static const char kBase64Alphabet[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+/// Outcome of an fs operation run on s_fsWorkers, reported to JS through
+/// __onNativeFsComplete.
+struct FsCompletion {
+  int id = 0;
+  /// Empty on success.
+  std::string error;
+  /// Node-style errno name (ENOENT, ...) when known.
+  std::string code;
+  FsResultFn result;
+};
 
-static inline char encodeBase64Char(unsigned char value) {
-  return kBase64Alphabet[value & 0x3F];
+static std::atomic<int> s_nextFsRequestId{1};
+static CompletionQueue<FsCompletion> s_completedFsOps;
+/// Threads running the asynchronous fs host functions, so slow disks or
+/// network mounts never block the frame. Created on first use.
+static std::unique_ptr<WorkerPool> s_fsWorkers;
+
+/// Events from s_fileWatcher, delivered to __onNativeFsWatch (fs.watch) or,
+/// for watches the runtime made itself, to s_runtimeWatchHandlers.
+static CompletionQueue<FileWatcher::Event> s_fileWatchEvents;
+static std::unordered_map<int, std::function<void(const FileWatcher::Event &)>>
+    s_runtimeWatchHandlers;
+/// Watches made from JS through fs.watch/fs.watchFile, dropped when hot
+/// reload replaces the bundle that made them.
+static std::unordered_set<int> s_jsWatchIds;
+static std::unique_ptr<FileWatcher> s_fileWatcher;
+
+static FileWatcher &fileWatcher() {
+  if (!s_fileWatcher) {
+    s_fileWatcher = std::make_unique<FileWatcher>(
+        [](FileWatcher::Event event) {
+          s_fileWatchEvents.push(std::move(event));
+        });
+  }
+  return *s_fileWatcher;
 }
 
-static std::string base64Encode(const std::vector<unsigned char> &input) {
-  if (input.empty()) {
-    return {};
+/// Hands a vector to JS as the backing store of an ArrayBuffer without
+/// copying it.
+template <typename T>
+class VectorBuffer : public facebook::jsi::MutableBuffer {
+public:
+  explicit VectorBuffer(std::vector<T> &&elements)
+      : elements_(std::move(elements)) {}
+
+  size_t size() const override { return elements_.size() * sizeof(T); }
+  uint8_t *data() override {
+    return reinterpret_cast<uint8_t *>(elements_.data());
   }
 
-  std::string encoded;
-  encoded.reserve(((input.size() + 2) / 3) * 4);
+private:
+  std::vector<T> elements_;
+};
+using ByteVectorBuffer = VectorBuffer<unsigned char>;
+
+template <typename T>
+static facebook::jsi::ArrayBuffer
+make_array_buffer(facebook::jsi::Runtime &runtime, std::vector<T> &&elements) {
+  return facebook::jsi::ArrayBuffer(
+      runtime, std::make_shared<VectorBuffer<T>>(std::move(elements)));
+}
+
+/// The byte range of args[0], an ArrayBuffer, selected by the optional
+/// byteOffset and byteLength in args[1] and args[2].
+static std::pair<const uint8_t *, size_t>
+array_buffer_range(facebook::jsi::Runtime &runtime,
+                   const facebook::jsi::Value *args, size_t count,
+                   const char *name) {
+  if (count < 1 || !args[0].isObject() ||
+      !args[0].getObject(runtime).isArrayBuffer(runtime)) {
+    throw facebook::jsi::JSError(
+        runtime, std::string(name) + " requires an ArrayBuffer");
+  }
+  auto buffer = args[0].getObject(runtime).getArrayBuffer(runtime);
+  size_t size = buffer.size(runtime);
+  size_t offset = 0;
+  if (count >= 2 && args[1].isNumber() && args[1].getNumber() > 0) {
+    offset = std::min((size_t)args[1].getNumber(), size);
+  }
+  size_t length = size - offset;
+  if (count >= 3 && args[2].isNumber() && args[2].getNumber() >= 0) {
+    length = std::min((size_t)args[2].getNumber(), length);
+  }
+  return {buffer.data(runtime) + offset, length};
+}
+
+/// Hands a string to JS as the backing store of an ArrayBuffer without
+/// copying it.
+class StringBuffer : public facebook::jsi::MutableBuffer {
+public:
+  explicit StringBuffer(std::string &&bytes) : bytes_(std::move(bytes)) {}
 
-  size_t i = 0;
-  while (i + 2 < input.size()) {
-    unsigned int triple = (input[i] << 16) | (input[i + 1] << 8) | input[i + 2];
-    encoded.push_back(encodeBase64Char((triple >> 18) & 0x3F));
-    encoded.push_back(encodeBase64Char((triple >> 12) & 0x3F));
-    encoded.push_back(encodeBase64Char((triple >> 6) & 0x3F));
-    encoded.push_back(encodeBase64Char(triple & 0x3F));
-    i += 3;
+  size_t size() const override { return bytes_.size(); }
+  uint8_t *data() override {
+    return reinterpret_cast<uint8_t *>(bytes_.data());
   }
 
-  if (i < input.size()) {
-    unsigned int triple = input[i] << 16;
-    encoded.push_back(encodeBase64Char((triple >> 18) & 0x3F));
-    if (i + 1 < input.size()) {
-      triple |= input[i + 1] << 8;
-      encoded.push_back(encodeBase64Char((triple >> 12) & 0x3F));
-      encoded.push_back(encodeBase64Char((triple >> 6) & 0x3F));
-      encoded.push_back('=');
-    } else {
-      encoded.push_back(encodeBase64Char((triple >> 12) & 0x3F));
-      encoded.push_back('=');
-      encoded.push_back('=');
-    }
+private:
+  std::string bytes_;
+};
+
+/// __decodeUtf8(arrayBuffer, byteOffset, byteLength, fatal) -> string.
+/// Backs TextDecoder and Buffer.toString(). ASCII input skips transcoding
+/// entirely; ill-formed input decodes with U+FFFD replacements, or to
+/// undefined when fatal is true so the caller can throw.
+static facebook::jsi::Value
+decode_utf8_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args, size_t count) {
+  auto [data, length] =
+      array_buffer_range(runtime, args, count, "__decodeUtf8");
+  bool fatal = count >= 4 && args[3].isBool() && args[3].getBool();
+  switch (classifyUtf8(data, length)) {
+  case Utf8Kind::Ascii:
+    return facebook::jsi::String::createFromAscii(
+        runtime, reinterpret_cast<const char *>(data), length);
+  case Utf8Kind::Valid:
+    return facebook::jsi::String::createFromUtf8(runtime, data, length);
+  case Utf8Kind::Invalid:
+    break;
+  }
+  if (fatal) {
+    return facebook::jsi::Value::undefined();
   }
+  return facebook::jsi::String::createFromUtf8(
+      runtime, replaceInvalidUtf8(data, length));
+}
 
-  return encoded;
+/// __encodeUtf8(string) -> ArrayBuffer. Backs TextEncoder.encode(); lone
+/// surrogates become U+FFFD.
+static facebook::jsi::Value
+encode_utf8_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args, size_t count) {
+  if (count < 1 || !args[0].isString()) {
+    throw facebook::jsi::JSError(runtime, "__encodeUtf8 requires a string");
+  }
+  return facebook::jsi::ArrayBuffer(
+      runtime, std::make_shared<StringBuffer>(
+                   args[0].getString(runtime).utf8(runtime)));
 }
 
-static std::vector<unsigned char>
-base64Decode(const std::string &input) {
-  if (input.empty()) {
-    return {};
+/// __encodeUtf8Into(string, arrayBuffer, byteOffset, byteLength) ->
+/// {read, written}. Backs TextEncoder.encodeInto(): writes the longest run of
+/// whole characters that fits and reports how many UTF-16 code units of the
+/// string that covered.
+static facebook::jsi::Value
+encode_utf8_into_host(facebook::jsi::Runtime &runtime,
+                      const facebook::jsi::Value &,
+                      const facebook::jsi::Value *args, size_t count) {
+  if (count < 2 || !args[0].isString()) {
+    throw facebook::jsi::JSError(runtime,
+                                 "__encodeUtf8Into requires a string");
   }
+  std::string text = args[0].getString(runtime).utf8(runtime);
+  if (!args[1].isObject() ||
+      !args[1].getObject(runtime).isArrayBuffer(runtime)) {
+    throw facebook::jsi::JSError(runtime,
+                                 "__encodeUtf8Into requires an ArrayBuffer");
+  }
+  auto [data, length] =
+      array_buffer_range(runtime, args + 1, count - 1, "__encodeUtf8Into");
+  auto bytes = reinterpret_cast<const uint8_t *>(text.data());
+  size_t written = utf8PrefixWithin(bytes, text.size(), length);
+  memcpy(const_cast<uint8_t *>(data), bytes, written);
+  facebook::jsi::Object result(runtime);
+  result.setProperty(runtime, "read",
+                     static_cast<double>(utf16Length(bytes, written)));
+  result.setProperty(runtime, "written", static_cast<double>(written));
+  return result;
+}
 
-    static const std::array<int, 256> kDecodeTable = []() {
-      std::array<int, 256> table{};
-      table.fill(-1);
-      for (int i = 0; i < 64; ++i) {
-        table[static_cast<unsigned char>(kBase64Alphabet[i])] = i;
-      }
-      table[static_cast<unsigned char>('=')] = 0;
-      return table;
-    }();
+/// __isUtf8(arrayBuffer, byteOffset, byteLength) -> boolean, for
+/// buffer.isUtf8().
+static facebook::jsi::Value
+is_utf8_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+             const facebook::jsi::Value *args, size_t count) {
+  auto [data, length] = array_buffer_range(runtime, args, count, "__isUtf8");
+  return classifyUtf8(data, length) != Utf8Kind::Invalid;
+}
 
-  std::vector<unsigned char> output;
-  output.reserve((input.size() * 3) / 4);
+/// __isAscii(arrayBuffer, byteOffset, byteLength) -> boolean, for
+/// buffer.isAscii().
+static facebook::jsi::Value
+is_ascii_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+              const facebook::jsi::Value *args, size_t count) {
+  auto [data, length] = array_buffer_range(runtime, args, count, "__isAscii");
+  return classifyUtf8(data, length) == Utf8Kind::Ascii;
+}
 
-  int accumulator = 0;
-  int bits = 0;
-  int padding = 0;
+/// __base64Encode(arrayBuffer, byteOffset, byteLength, url) -> string, with
+/// the base64url alphabet and no padding when url is true.
+static facebook::jsi::Value
+base64_encode_host(facebook::jsi::Runtime &runtime,
+                   const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args, size_t count) {
+  auto [data, length] =
+      array_buffer_range(runtime, args, count, "__base64Encode");
+  bool url = count >= 4 && args[3].isBool() && args[3].getBool();
+  return facebook::jsi::String::createFromAscii(
+      runtime, base64Encode(data, length, url));
+}
 
-  for (unsigned char ch : input) {
-    if (ch == '=') {
-      ++padding;
-      accumulator <<= 6;
-      bits += 6;
-    } else {
-  int value = kDecodeTable[static_cast<unsigned char>(ch)];
-      if (value < 0) {
-        if (ch == '\r' || ch == '\n' || ch == ' ' || ch == '\t') {
-          continue;
-        }
-        throw std::runtime_error("Invalid base64 input");
-      }
-      accumulator = (accumulator << 6) | value;
-      bits += 6;
-    }
+/// __base64Decode(string) -> ArrayBuffer. Accepts both alphabets and, like
+/// Buffer.from(string, 'base64'), skips characters outside them.
+static facebook::jsi::Value
+base64_decode_host(facebook::jsi::Runtime &runtime,
+                   const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args, size_t count) {
+  if (count < 1 || !args[0].isString()) {
+    throw facebook::jsi::JSError(runtime, "__base64Decode requires a string");
+  }
+  std::string text = args[0].getString(runtime).utf8(runtime);
+  std::vector<unsigned char> bytes(base64DecodedCapacity(text.size()));
+  bytes.resize(*base64Decode(text.data(), text.size(), bytes.data()));
+  return make_array_buffer(runtime, std::move(bytes));
+}
 
-    if (bits >= 8) {
-      bits -= 8;
-      unsigned char byte = static_cast<unsigned char>((accumulator >> bits) & 0xFF);
-      output.push_back(byte);
-    }
+/// __bufferCompare(a, aOffset, aLength, b, bOffset, bLength) -> -1, 0 or 1,
+/// ordering the two ArrayBuffer ranges like Buffer.compare().
+static facebook::jsi::Value
+buffer_compare_host(facebook::jsi::Runtime &runtime,
+                    const facebook::jsi::Value &,
+                    const facebook::jsi::Value *args, size_t count) {
+  if (count < 6) {
+    throw facebook::jsi::JSError(runtime,
+                                 "__bufferCompare requires two ranges");
+  }
+  auto [a, aLength] = array_buffer_range(runtime, args, 3, "__bufferCompare");
+  auto [b, bLength] =
+      array_buffer_range(runtime, args + 3, 3, "__bufferCompare");
+  int order = memcmp(a, b, std::min(aLength, bLength));
+  if (order == 0) {
+    order = aLength < bLength ? -1 : aLength > bLength ? 1 : 0;
   }
+  return order < 0 ? -1 : order > 0 ? 1 : 0;
+}
 
-  if (padding) {
-    if (static_cast<size_t>(padding) > output.size()) {
-      throw std::runtime_error("Invalid base64 padding");
+/// __bufferIndexOf(haystack, offset, length, needle, offset, length, from,
+/// last) -> index or -1, searching forwards from `from`, or backwards when
+/// `last` is true.
+static facebook::jsi::Value
+buffer_index_of_host(facebook::jsi::Runtime &runtime,
+                     const facebook::jsi::Value &,
+                     const facebook::jsi::Value *args, size_t count) {
+  if (count < 8 || !args[6].isNumber()) {
+    throw facebook::jsi::JSError(
+        runtime, "__bufferIndexOf requires two ranges and an offset");
+  }
+  auto [haystack, size] =
+      array_buffer_range(runtime, args, 3, "__bufferIndexOf");
+  auto [needle, needleSize] =
+      array_buffer_range(runtime, args + 3, 3, "__bufferIndexOf");
+  bool last = args[7].isBool() && args[7].getBool();
+  // Clamped like Buffer.indexOf: a negative offset counts from the end.
+  double offset = std::trunc(args[6].getNumber());
+  if (std::isnan(offset)) {
+    offset = last ? static_cast<double>(size) : 0.0;
+  } else if (offset < 0) {
+    offset += static_cast<double>(size);
+  }
+  if (offset < 0) {
+    if (last && needleSize > 0) {
+      return -1.0;
     }
-    output.resize(output.size() - padding);
+    offset = 0;
+  }
+  size_t from = static_cast<size_t>(std::min(offset, static_cast<double>(size)));
+  return static_cast<double>(
+      findBytes(haystack, size, needle, needleSize, from, last));
+}
+
+/// __bufferFill(target, offset, length, pattern, offset, length) fills the
+/// target range with repetitions of the pattern range.
+static facebook::jsi::Value
+buffer_fill_host(facebook::jsi::Runtime &runtime,
+                 const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args, size_t count) {
+  if (count < 6) {
+    throw facebook::jsi::JSError(runtime, "__bufferFill requires two ranges");
+  }
+  auto [target, size] = array_buffer_range(runtime, args, 3, "__bufferFill");
+  auto [pattern, patternSize] =
+      array_buffer_range(runtime, args + 3, 3, "__bufferFill");
+  fillPattern(const_cast<uint8_t *>(target), size, pattern, patternSize);
+  return facebook::jsi::Value::undefined();
+}
+
+/// __hexEncode(arrayBuffer, byteOffset, byteLength) -> lowercase hex string.
+static facebook::jsi::Value
+hex_encode_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                const facebook::jsi::Value *args, size_t count) {
+  auto [data, length] = array_buffer_range(runtime, args, count, "__hexEncode");
+  std::string text(length * 2, '\0');
+  hexEncode(data, length, text.data());
+  return facebook::jsi::String::createFromAscii(runtime, text);
+}
+
+/// __hexDecode(string) -> ArrayBuffer, stopping at the first invalid pair.
+static facebook::jsi::Value
+hex_decode_host(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                const facebook::jsi::Value *args, size_t count) {
+  if (count < 1 || !args[0].isString()) {
+    throw facebook::jsi::JSError(runtime, "__hexDecode requires a string");
   }
+  std::string text = args[0].getString(runtime).utf8(runtime);
+  std::vector<unsigned char> bytes(text.size() / 2);
+  bytes.resize(hexDecode(text.data(), text.size(), bytes.data()));
+  return make_array_buffer(runtime, std::move(bytes));
+}
+
+/// __latin1Decode(arrayBuffer, byteOffset, byteLength) -> string with one
+/// character per byte.
+static facebook::jsi::Value
+latin1_decode_host(facebook::jsi::Runtime &runtime,
+                   const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args, size_t count) {
+  auto [data, length] =
+      array_buffer_range(runtime, args, count, "__latin1Decode");
+  if (classifyUtf8(data, length) == Utf8Kind::Ascii) {
+    return facebook::jsi::String::createFromAscii(
+        runtime, reinterpret_cast<const char *>(data), length);
+  }
+  return facebook::jsi::String::createFromUtf8(runtime,
+                                               latin1ToUtf8(data, length));
+}
 
-  return output;
+/// __latin1Encode(string) -> ArrayBuffer holding the low byte of every
+/// character. JSI only hands out strings as UTF-8, where lone surrogates have
+/// already become U+FFFD, so those encode as 0xFD.
+static facebook::jsi::Value
+latin1_encode_host(facebook::jsi::Runtime &runtime,
+                   const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args, size_t count) {
+  if (count < 1 || !args[0].isString()) {
+    throw facebook::jsi::JSError(runtime, "__latin1Encode requires a string");
+  }
+  std::string text = args[0].getString(runtime).utf8(runtime);
+  std::vector<unsigned char> bytes(text.size());
+  bytes.resize(latin1FromUtf8(text.data(), text.size(), bytes.data()));
+  return make_array_buffer(runtime, std::move(bytes));
 }
 
 namespace nodecompat {
@@ -1395,11 +2107,147 @@ static StatInfo getStatInfo(const fs::path &target, bool followSymlinks) {
   return info;
 }
 
-static std::vector<unsigned char> readFileBytes(const fs::path &target) {
+/// Node-style errno name for \p error, empty if it has none.
+static const char *errnoName(int error) {
+  switch (error) {
+  case ENOENT:
+    return "ENOENT";
+  case EEXIST:
+    return "EEXIST";
+  case ENOTDIR:
+    return "ENOTDIR";
+  case EISDIR:
+    return "EISDIR";
+  case ENOTEMPTY:
+    return "ENOTEMPTY";
+  case EACCES:
+    return "EACCES";
+  case EPERM:
+    return "EPERM";
+  case EBUSY:
+    return "EBUSY";
+  case EMFILE:
+    return "EMFILE";
+  case ENOSPC:
+    return "ENOSPC";
+  case EROFS:
+    return "EROFS";
+  case EIO:
+    return "EIO";
+  case EBADF:
+    return "EBADF";
+  case EINVAL:
+    return "EINVAL";
+  default:
+    return "";
+  }
+}
+
+/// Failure of an fs operation. what() is the message the synchronous host
+/// functions throw; code is reported to the asynchronous callers as
+/// `error.code`.
+class FsError : public std::runtime_error {
+public:
+  FsError(const std::string &message, std::string code)
+      : std::runtime_error(message), code_(std::move(code)) {}
+  explicit FsError(const std::error_code &ec)
+      : FsError(ec.message(), ec.category() == std::generic_category() ||
+                                      ec.category() == std::system_category()
+                                  ? errnoName(ec.value())
+                                  : "") {}
+
+  const std::string &code() const { return code_; }
+
+private:
+  std::string code_;
+};
+
+#if !defined(_WIN32)
+/// Closes a POSIX file descriptor when the scope ends.
+struct FdCloser {
+  int fd;
+  ~FdCloser() { ::close(fd); }
+};
+#else
+/// Code of an fstream failure. The standard library does not promise to set
+/// errno, so callers clear it before the operation and EIO stands in when it
+/// is still clear.
+static std::string streamErrnoName() {
+  std::string name = errno != 0 ? errnoName(errno) : "";
+  return name.empty() ? "EIO" : name;
+}
+#endif
+
+/// Regular files at least this large are mapped rather than read when the
+/// caller asks for a mapping.
+static constexpr off_t kMapFileThreshold = 1 << 20;
+
+/// Contents of \p target as the backing store of an ArrayBuffer, in a single
+/// allocation, i.e. a snapshot of the file like Node returns. With \p map,
+/// large regular files are mapped copy-on-write instead, so their pages are
+/// loaded on demand and never copied; the caller then accepts that writes by
+/// other processes show through in pages not yet touched, and that touching
+/// the buffer after another process truncates the file kills the process.
+static std::shared_ptr<facebook::jsi::MutableBuffer>
+readFileBuffer(const fs::path &target, bool map) {
+#if !defined(_WIN32)
+  int fd = ::open(target.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw FsError("Failed to open file for reading: " + target.string(),
+                  errnoName(errno));
+  }
+  FdCloser closer{fd};
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    throw FsError("Failed to stat file: " + target.string(), errnoName(errno));
+  }
+  if (S_ISDIR(st.st_mode)) {
+    throw FsError("EISDIR: illegal operation on a directory, read", "EISDIR");
+  }
+  bool regular = S_ISREG(st.st_mode);
+  if (map && regular && st.st_size >= kMapFileThreshold) {
+    if (auto mapped =
+            mapFileCopyOnWrite(fd, static_cast<size_t>(st.st_size))) {
+      return mapped;
+    }
+  }
+
+  // Read up to the size reported by fstat, then until EOF: the file may have
+  // grown, and pipes or /proc entries report no size at all.
+  std::vector<unsigned char> bytes(regular ? static_cast<size_t>(st.st_size)
+                                           : 0);
+  size_t used = 0;
+  for (;;) {
+    unsigned char probe[4096];
+    bool full = used == bytes.size();
+    unsigned char *dest = full ? probe : bytes.data() + used;
+    size_t room = full ? sizeof(probe) : bytes.size() - used;
+    ssize_t n = ::read(fd, dest, room);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FsError("Failed to read file: " + target.string(),
+                    errnoName(errno));
+    }
+    if (n == 0) {
+      break;
+    }
+    if (full) {
+      bytes.insert(bytes.end(), probe, probe + n);
+    }
+    used += static_cast<size_t>(n);
+  }
+  bytes.resize(used);
+  return std::make_shared<ByteVectorBuffer>(std::move(bytes));
+#else
+  (void)map;
+  errno = 0;
   std::ifstream stream(target, std::ios::binary);
   if (!stream) {
-    throw std::runtime_error("Failed to open file for reading: " +
-                             target.string());
+    throw FsError("Failed to open file for reading: " + target.string(),
+                  streamErrnoName());
   }
 
   stream.seekg(0, std::ios::end);
@@ -1412,34 +2260,236 @@ static std::vector<unsigned char> readFileBytes(const fs::path &target) {
   std::vector<unsigned char> data(static_cast<size_t>(length));
   stream.seekg(0, std::ios::beg);
   if (length > 0) {
+    errno = 0;
     stream.read(reinterpret_cast<char *>(data.data()), length);
     if (!stream) {
-      throw std::runtime_error("Failed to read file: " + target.string());
+      throw FsError("Failed to read file: " + target.string(),
+                    streamErrnoName());
     }
   }
 
-  return data;
+  return std::make_shared<ByteVectorBuffer>(std::move(data));
+#endif
 }
 
 static void writeFileBytes(const fs::path &target,
                            const std::vector<unsigned char> &bytes,
                            bool append) {
-  auto mode = std::ios::binary | (append ? std::ios::app : std::ios::trunc);
-  std::ofstream stream(target, mode);
-  if (!stream) {
-    throw std::runtime_error("Failed to open file for writing: " +
-                             target.string());
+#if !defined(_WIN32)
+  int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+  int fd = ::open(target.c_str(), flags, 0666);
+  if (fd < 0) {
+    throw FsError("Failed to open file for writing: " + target.string(),
+                  errnoName(errno));
+  }
+  FdCloser closer{fd};
+
+  size_t written = 0;
+  while (written < bytes.size()) {
+    ssize_t n = ::write(fd, bytes.data() + written, bytes.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FsError("Failed to write file: " + target.string(),
+                    errnoName(errno));
+    }
+    written += static_cast<size_t>(n);
+  }
+#else
+  auto mode = std::ios::binary | (append ? std::ios::app : std::ios::trunc);
+  errno = 0;
+  std::ofstream stream(target, mode);
+  if (!stream) {
+    throw FsError("Failed to open file for writing: " + target.string(),
+                  streamErrnoName());
   }
 
   if (!bytes.empty()) {
+    errno = 0;
     stream.write(reinterpret_cast<const char *>(bytes.data()),
                  static_cast<std::streamsize>(bytes.size()));
   }
 
   if (!stream) {
-    throw std::runtime_error("Failed to write file: " + target.string());
+    throw FsError("Failed to write file: " + target.string(),
+                  streamErrnoName());
+  }
+#endif
+}
+
+static std::vector<std::string> listDirectory(const fs::path &directory) {
+  std::vector<std::string> entries;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(directory, ec)) {
+    entries.emplace_back(entry.path().filename().string());
+  }
+  if (ec) {
+    throw FsError(ec);
+  }
+  return entries;
+}
+
+static void makeDirectory(const fs::path &target, bool recursive) {
+  std::error_code ec;
+  if (recursive) {
+    fs::create_directories(target, ec);
+  } else {
+    fs::create_directory(target, ec);
+  }
+  if (ec) {
+    throw FsError(ec);
+  }
+}
+
+static void removePath(const fs::path &target, bool recursive, bool force) {
+  std::error_code ec;
+  if (recursive) {
+    fs::remove_all(target, ec);
+  } else {
+    fs::remove(target, ec);
+  }
+  if (ec && !force) {
+    throw FsError(ec);
+  }
+}
+
+#if !defined(_WIN32)
+/// Node-style error for a failed \p syscall, e.g.
+/// "ENOENT: no such file or directory, open 'a.txt'".
+static FsError syscallError(int error, const char *syscall,
+                            const std::string &path = {}) {
+  std::string code = errnoName(error);
+  std::string message = (code.empty() ? std::string("Error") : code) + ": " +
+                        std::strerror(error) + ", " + syscall;
+  if (!path.empty()) {
+    message += " '" + path + "'";
+  }
+  return FsError(message, code);
+}
+
+/// open(2) flags for a Node flag string such as "r", "w+" or "ax".
+static int parseOpenFlags(const std::string &flags) {
+  static const std::pair<const char *, int> kFlags[] = {
+      {"r", O_RDONLY},
+      {"rs", O_RDONLY | O_SYNC},
+      {"sr", O_RDONLY | O_SYNC},
+      {"r+", O_RDWR},
+      {"rs+", O_RDWR | O_SYNC},
+      {"sr+", O_RDWR | O_SYNC},
+      {"w", O_TRUNC | O_CREAT | O_WRONLY},
+      {"wx", O_TRUNC | O_CREAT | O_WRONLY | O_EXCL},
+      {"xw", O_TRUNC | O_CREAT | O_WRONLY | O_EXCL},
+      {"w+", O_TRUNC | O_CREAT | O_RDWR},
+      {"wx+", O_TRUNC | O_CREAT | O_RDWR | O_EXCL},
+      {"xw+", O_TRUNC | O_CREAT | O_RDWR | O_EXCL},
+      {"a", O_APPEND | O_CREAT | O_WRONLY},
+      {"ax", O_APPEND | O_CREAT | O_WRONLY | O_EXCL},
+      {"xa", O_APPEND | O_CREAT | O_WRONLY | O_EXCL},
+      {"as", O_APPEND | O_CREAT | O_WRONLY | O_SYNC},
+      {"sa", O_APPEND | O_CREAT | O_WRONLY | O_SYNC},
+      {"a+", O_APPEND | O_CREAT | O_RDWR},
+      {"ax+", O_APPEND | O_CREAT | O_RDWR | O_EXCL},
+      {"xa+", O_APPEND | O_CREAT | O_RDWR | O_EXCL},
+      {"as+", O_APPEND | O_CREAT | O_RDWR | O_SYNC},
+      {"sa+", O_APPEND | O_CREAT | O_RDWR | O_SYNC},
+  };
+  for (const auto &[name, value] : kFlags) {
+    if (flags == name) {
+      return value;
+    }
+  }
+  throw FsError("Invalid file open flag: " + flags, "EINVAL");
+}
+
+static int openFile(const fs::path &target, int flags, int mode) {
+  int fd;
+  do {
+    fd = ::open(target.c_str(), flags | O_CLOEXEC, mode);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    throw syscallError(errno, "open", target.string());
+  }
+  return fd;
+}
+
+/// One read(2), or pread(2) when \p position is not negative. Returns the
+/// byte count, 0 at end of file.
+static size_t readFd(int fd, uint8_t *data, size_t length, int64_t position) {
+  for (;;) {
+    ssize_t n = position >= 0
+                    ? ::pread(fd, data, length, static_cast<off_t>(position))
+                    : ::read(fd, data, length);
+    if (n >= 0) {
+      return static_cast<size_t>(n);
+    }
+    if (errno != EINTR) {
+      throw syscallError(errno, "read");
+    }
+  }
+}
+
+/// Write all of \p data with write(2), or pwrite(2) at \p position when it
+/// is not negative.
+static size_t writeFd(int fd, const uint8_t *data, size_t length,
+                      int64_t position) {
+  size_t written = 0;
+  while (written < length) {
+    ssize_t n =
+        position >= 0
+            ? ::pwrite(fd, data + written, length - written,
+                       static_cast<off_t>(position + written))
+            : ::write(fd, data + written, length - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw syscallError(errno, "write");
+    }
+    written += static_cast<size_t>(n);
+  }
+  return written;
+}
+
+static void closeFd(int fd) {
+  // The descriptor is released even if close(2) reports EINTR.
+  if (::close(fd) != 0 && errno != EINTR) {
+    throw syscallError(errno, "close");
+  }
+}
+
+static StatInfo statFd(int fd) {
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    throw syscallError(errno, "fstat");
+  }
+  StatInfo info;
+  info.exists = true;
+  if (S_ISREG(st.st_mode)) {
+    info.type = FsEntryType::File;
+  } else if (S_ISDIR(st.st_mode)) {
+    info.type = FsEntryType::Directory;
+  } else if (S_ISLNK(st.st_mode)) {
+    info.type = FsEntryType::Symlink;
+  } else {
+    info.type = FsEntryType::Other;
   }
+  if (info.type == FsEntryType::File) {
+    info.size = static_cast<uintmax_t>(st.st_size);
+  }
+#if defined(__APPLE__)
+  const struct timespec &mtime = st.st_mtimespec;
+  const struct timespec &ctime = st.st_ctimespec;
+#else
+  const struct timespec &mtime = st.st_mtim;
+  const struct timespec &ctime = st.st_ctim;
+#endif
+  info.mtimeMs = mtime.tv_sec * 1000.0 + mtime.tv_nsec / 1e6;
+  info.ctimeMs = ctime.tv_sec * 1000.0 + ctime.tv_nsec / 1e6;
+  info.mode = static_cast<uint32_t>(st.st_mode & 07777);
+  return info;
 }
+#endif
 
 static std::string detectArchitecture() {
 #if defined(__EMSCRIPTEN__)
@@ -1986,6 +3036,614 @@ convertVectorOfStrings(facebook::jsi::Runtime &runtime,
   return array;
 }
 
+/// How readFile hands the contents to JS: an ArrayBuffer over the native
+/// buffer, a UTF-8 decoded string, or (for older callers) base64 text.
+enum class FileContentsFormat { Buffer, MappedBuffer, Utf8, Base64 };
+
+static FileContentsFormat parseFileContentsFormat(facebook::jsi::Runtime &rt,
+                                                  const facebook::jsi::Value *args,
+                                                  size_t count) {
+  if (count < 2 || !args[1].isString()) {
+    return FileContentsFormat::Base64;
+  }
+  std::string encoding = toLowerAscii(args[1].asString(rt).utf8(rt));
+  if (encoding == "buffer") {
+    return FileContentsFormat::Buffer;
+  }
+  if (encoding == "mapped") {
+    return FileContentsFormat::MappedBuffer;
+  }
+  if (encoding == "utf8" || encoding == "utf-8") {
+    return FileContentsFormat::Utf8;
+  }
+  return FileContentsFormat::Base64;
+}
+
+static facebook::jsi::Value
+fileContentsToJs(facebook::jsi::Runtime &rt,
+                 std::shared_ptr<facebook::jsi::MutableBuffer> contents,
+                 FileContentsFormat format) {
+  switch (format) {
+  case FileContentsFormat::Buffer:
+  case FileContentsFormat::MappedBuffer:
+    return facebook::jsi::ArrayBuffer(rt, std::move(contents));
+  case FileContentsFormat::Utf8:
+    return facebook::jsi::String::createFromUtf8(rt, contents->data(),
+                                                 contents->size());
+  case FileContentsFormat::Base64:
+    break;
+  }
+  return facebook::jsi::String::createFromUtf8(
+      rt, base64Encode(contents->data(), contents->size()));
+}
+
+/// Arguments of writeFile(path, data, encoding | { encoding, flag, append,
+/// byteOffset, byteLength }): the target, whether to append, and the bytes to
+/// write. data is a string in the given encoding, or an ArrayBuffer of which
+/// byteLength bytes from byteOffset are written.
+static std::vector<unsigned char>
+parseWriteFileArgs(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                   size_t count, fs::path &target, bool &append) {
+  bool binary = count >= 2 && args[1].isObject() &&
+                args[1].getObject(rt).isArrayBuffer(rt);
+  if (count < 2 || !args[0].isString() || !(binary || args[1].isString())) {
+    throw facebook::jsi::JSError(rt, "fs.writeFile requires path and data");
+  }
+  target = fs::path(args[0].asString(rt).utf8(rt));
+  std::string encoding = "utf8";
+  size_t byteOffset = 0;
+  size_t byteLength = SIZE_MAX;
+  append = false;
+  if (count >= 3) {
+    const auto &third = args[2];
+    if (third.isString()) {
+      encoding = toLowerAscii(third.asString(rt).utf8(rt));
+    } else if (third.isObject()) {
+      auto opts = third.asObject(rt);
+      if (opts.hasProperty(rt, "encoding")) {
+        encoding = toLowerAscii(
+            opts.getProperty(rt, "encoding").toString(rt).utf8(rt));
+      }
+      if (opts.hasProperty(rt, "flag")) {
+        auto flag = opts.getProperty(rt, "flag").toString(rt).utf8(rt);
+        if (flag == "a" || flag == "a+" || flag == "as" || flag == "as+") {
+          append = true;
+        }
+      }
+      if (opts.hasProperty(rt, "append")) {
+        auto value = opts.getProperty(rt, "append");
+        if (value.isBool()) {
+          append = value.getBool();
+        }
+      }
+      auto offset = opts.getProperty(rt, "byteOffset");
+      if (offset.isNumber() && offset.getNumber() > 0) {
+        byteOffset = static_cast<size_t>(offset.getNumber());
+      }
+      auto length = opts.getProperty(rt, "byteLength");
+      if (length.isNumber() && length.getNumber() >= 0) {
+        byteLength = static_cast<size_t>(length.getNumber());
+      }
+    }
+  }
+
+  if (binary) {
+    auto buffer = args[1].getObject(rt).getArrayBuffer(rt);
+    size_t size = buffer.size(rt);
+    byteOffset = std::min(byteOffset, size);
+    byteLength = std::min(byteLength, size - byteOffset);
+    const uint8_t *begin = buffer.data(rt) + byteOffset;
+    return std::vector<unsigned char>(begin, begin + byteLength);
+  }
+  std::string data = args[1].asString(rt).utf8(rt);
+  if (encoding == "utf8" || encoding == "utf-8") {
+    return std::vector<unsigned char>(data.begin(), data.end());
+  }
+  if (encoding == "base64") {
+    std::vector<unsigned char> bytes(base64DecodedCapacity(data.size()));
+    auto size = base64Decode(data.data(), data.size(), bytes.data(), true);
+    if (!size) {
+      throw facebook::jsi::JSError(rt, "Invalid base64 input in writeFile");
+    }
+    bytes.resize(*size);
+    return bytes;
+  }
+  throw facebook::jsi::JSError(rt, "Unsupported encoding in writeFile");
+}
+
+static WorkerPool &fsWorkers() {
+  if (!s_fsWorkers) {
+    // Blocking calls on slow or network file systems overlap, so use a few
+    // threads even on small machines.
+    unsigned int threads =
+        std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+    s_fsWorkers = std::make_unique<WorkerPool>("fs worker", threads);
+  }
+  return *s_fsWorkers;
+}
+
+/// Run \p work on the fs worker pool and return the id its completion is
+/// reported under. \p work returns the converter for its result (empty for
+/// undefined) or throws.
+static int submitFsJob(std::function<FsResultFn()> work) {
+  int id = s_nextFsRequestId.fetch_add(1);
+  fsWorkers().post([id, work = std::move(work)]() {
+    FsCompletion completion;
+    completion.id = id;
+    try {
+      completion.result = work();
+    } catch (const FsError &error) {
+      completion.error = error.what();
+      completion.code = error.code();
+    } catch (const std::exception &error) {
+      completion.error = error.what();
+    }
+    s_completedFsOps.push(std::move(completion));
+  });
+  return id;
+}
+
+static bool fsBoolOption(facebook::jsi::Runtime &rt,
+                         const facebook::jsi::Value *args, size_t count,
+                         size_t index, const char *name, bool fallback) {
+  if (index >= count || !args[index].isObject()) {
+    return fallback;
+  }
+  auto value = args[index].asObject(rt).getProperty(rt, name);
+  return value.isBool() ? value.getBool() : fallback;
+}
+
+static fs::path fsPathArg(facebook::jsi::Runtime &rt,
+                          const facebook::jsi::Value *args, size_t count,
+                          const char *name) {
+  if (count < 1 || !args[0].isString()) {
+    throw facebook::jsi::JSError(rt, std::string(name) + " requires a path");
+  }
+  return fs::path(args[0].asString(rt).utf8(rt));
+}
+
+/// Asynchronous variants of the fs host functions. Each takes the same
+/// arguments as its synchronous counterpart, runs on the fs worker pool and
+/// returns a request id; the outcome is delivered to __onNativeFsComplete.
+static void installAsyncFsBindings(facebook::jsi::Runtime &runtime,
+                                   facebook::jsi::Object &native) {
+  const std::pair<const char *, facebook::jsi::HostFunctionType> functions[] = {
+      {"readFileAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path target = fsPathArg(rt, args, count, "fs.readFile");
+         auto format = parseFileContentsFormat(rt, args, count);
+         return submitFsJob([target, format]() -> FsResultFn {
+           auto contents = readFileBuffer(
+               target, format == FileContentsFormat::MappedBuffer);
+           return [contents = std::move(contents),
+                   format](facebook::jsi::Runtime &rt) -> facebook::jsi::Value {
+             return fileContentsToJs(rt, contents, format);
+           };
+         });
+       }},
+      {"writeFileAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path target;
+         bool append = false;
+         auto bytes = std::make_shared<std::vector<unsigned char>>(
+             parseWriteFileArgs(rt, args, count, target, append));
+         return submitFsJob([target, bytes, append]() -> FsResultFn {
+           writeFileBytes(target, *bytes, append);
+           return nullptr;
+         });
+       }},
+      {"readdirAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path directory = fsPathArg(rt, args, count, "fs.readdir");
+         return submitFsJob([directory]() -> FsResultFn {
+           return [entries = listDirectory(directory)](
+                      facebook::jsi::Runtime &rt) -> facebook::jsi::Value {
+             return convertVectorOfStrings(rt, entries);
+           };
+         });
+       }},
+      {"statAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path target = fsPathArg(rt, args, count, "fs.stat");
+         bool followSymlinks =
+             fsBoolOption(rt, args, count, 1, "followSymbolicLinks", true);
+         return submitFsJob([target, followSymlinks]() -> FsResultFn {
+           auto info = getStatInfo(target, followSymlinks);
+           if (!info.exists) {
+             throw FsError("ENOENT: no such file or directory", "ENOENT");
+           }
+           return [info](facebook::jsi::Runtime &rt) -> facebook::jsi::Value {
+             return makeStatObject(rt, info);
+           };
+         });
+       }},
+      {"mkdirAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path target = fsPathArg(rt, args, count, "fs.mkdir");
+         bool recursive = fsBoolOption(rt, args, count, 1, "recursive", false);
+         return submitFsJob([target, recursive]() -> FsResultFn {
+           makeDirectory(target, recursive);
+           return nullptr;
+         });
+       }},
+      {"rmAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path target = fsPathArg(rt, args, count, "fs.rm");
+         bool recursive = fsBoolOption(rt, args, count, 1, "recursive", false);
+         bool force = fsBoolOption(rt, args, count, 1, "force", false);
+         return submitFsJob([target, recursive, force]() -> FsResultFn {
+           removePath(target, recursive, force);
+           return nullptr;
+         });
+       }},
+  };
+  for (const auto &[name, fn] : functions) {
+    native.setProperty(
+        runtime, name,
+        facebook::jsi::Function::createFromHostFunction(
+            runtime, facebook::jsi::PropNameID::forAscii(runtime, name), 3,
+            fn));
+  }
+}
+
+#if !defined(_WIN32)
+/// Arguments of read/write(fd, arrayBuffer, offset, length, position): the
+/// byte range of the ArrayBuffer and the file position (-1 for the current
+/// one).
+struct FdTransfer {
+  int fd = -1;
+  uint8_t *data = nullptr;
+  size_t length = 0;
+  int64_t position = -1;
+};
+
+/// The file descriptor in args[0]: a non-negative integer, so that no
+/// fraction or out-of-range number is truncated into some other descriptor.
+static int fdArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                 size_t count, const char *name) {
+  if (count < 1 || !args[0].isNumber()) {
+    throw facebook::jsi::JSError(rt, std::string(name) +
+                                         " requires a file descriptor");
+  }
+  double fd = args[0].getNumber();
+  if (!(fd >= 0) || fd > INT_MAX || std::floor(fd) != fd) {
+    throw facebook::jsi::JSError(rt, std::string(name) +
+                                         ": invalid file descriptor");
+  }
+  return static_cast<int>(fd);
+}
+
+static FdTransfer parseFdTransfer(facebook::jsi::Runtime &rt,
+                                  const facebook::jsi::Value *args,
+                                  size_t count, const char *name) {
+  if (count < 4 || !args[0].isNumber() || !args[1].isObject() ||
+      !args[1].getObject(rt).isArrayBuffer(rt) || !args[2].isNumber() ||
+      !args[3].isNumber()) {
+    throw facebook::jsi::JSError(
+        rt, std::string(name) +
+                " requires (fd, arrayBuffer, offset, length[, position])");
+  }
+  auto buffer = args[1].getObject(rt).getArrayBuffer(rt);
+  double offset = args[2].getNumber();
+  double length = args[3].getNumber();
+  size_t size = buffer.size(rt);
+  if (offset < 0 || length < 0 || offset + length > static_cast<double>(size)) {
+    throw facebook::jsi::JSError(rt, std::string(name) +
+                                         ": range is outside of the buffer");
+  }
+  FdTransfer transfer;
+  transfer.fd = fdArg(rt, args, count, name);
+  transfer.data = buffer.data(rt) + static_cast<size_t>(offset);
+  transfer.length = static_cast<size_t>(length);
+  if (count >= 5 && args[4].isNumber() && args[4].getNumber() >= 0) {
+    transfer.position = static_cast<int64_t>(args[4].getNumber());
+  }
+  return transfer;
+}
+
+/// open(path, flags, mode) arguments; flags is a Node flag string or an
+/// open(2) flag number.
+static void parseOpenArgs(facebook::jsi::Runtime &rt,
+                          const facebook::jsi::Value *args, size_t count,
+                          fs::path &target, int &flags, int &mode) {
+  target = fsPathArg(rt, args, count, "fs.open");
+  flags = O_RDONLY;
+  if (count >= 2 && args[1].isString()) {
+    try {
+      flags = parseOpenFlags(args[1].asString(rt).utf8(rt));
+    } catch (const std::exception &error) {
+      throw facebook::jsi::JSError(rt, error.what());
+    }
+  } else if (count >= 2 && args[1].isNumber()) {
+    flags = static_cast<int>(args[1].getNumber());
+  }
+  mode = 0666;
+  if (count >= 3 && args[2].isNumber()) {
+    mode = static_cast<int>(args[2].getNumber());
+  }
+}
+
+/// File descriptor functions behind fs.open/read/write/close/fstat and
+/// FileHandle. Reads and writes go to a caller-supplied ArrayBuffer range;
+/// the *Async variants run on the fs worker pool, and JS keeps the buffer
+/// alive until they complete.
+static void installFileHandleBindings(facebook::jsi::Runtime &runtime,
+                                      facebook::jsi::Object &native) {
+  const std::pair<const char *, facebook::jsi::HostFunctionType> functions[] = {
+      {"open",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path target;
+         int flags, mode;
+         parseOpenArgs(rt, args, count, target, flags, mode);
+         try {
+           return facebook::jsi::Value(openFile(target, flags, mode));
+         } catch (const std::exception &error) {
+           throw facebook::jsi::JSError(rt, error.what());
+         }
+       }},
+      {"openAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path target;
+         int flags, mode;
+         parseOpenArgs(rt, args, count, target, flags, mode);
+         return submitFsJob([target, flags, mode]() -> FsResultFn {
+           int fd = openFile(target, flags, mode);
+           return [fd](facebook::jsi::Runtime &) -> facebook::jsi::Value {
+             return facebook::jsi::Value(fd);
+           };
+         });
+       }},
+      {"read",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         auto io = parseFdTransfer(rt, args, count, "fs.read");
+         try {
+           return facebook::jsi::Value(static_cast<double>(
+               readFd(io.fd, io.data, io.length, io.position)));
+         } catch (const std::exception &error) {
+           throw facebook::jsi::JSError(rt, error.what());
+         }
+       }},
+      {"readAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         auto io = parseFdTransfer(rt, args, count, "fs.read");
+         return submitFsJob([io]() -> FsResultFn {
+           size_t n = readFd(io.fd, io.data, io.length, io.position);
+           return [n](facebook::jsi::Runtime &) -> facebook::jsi::Value {
+             return facebook::jsi::Value(static_cast<double>(n));
+           };
+         });
+       }},
+      {"write",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         auto io = parseFdTransfer(rt, args, count, "fs.write");
+         try {
+           return facebook::jsi::Value(static_cast<double>(
+               writeFd(io.fd, io.data, io.length, io.position)));
+         } catch (const std::exception &error) {
+           throw facebook::jsi::JSError(rt, error.what());
+         }
+       }},
+      {"writeAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         auto io = parseFdTransfer(rt, args, count, "fs.write");
+         return submitFsJob([io]() -> FsResultFn {
+           size_t n = writeFd(io.fd, io.data, io.length, io.position);
+           return [n](facebook::jsi::Runtime &) -> facebook::jsi::Value {
+             return facebook::jsi::Value(static_cast<double>(n));
+           };
+         });
+       }},
+      {"close",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         int fd = fdArg(rt, args, count, "fs.close");
+         try {
+           closeFd(fd);
+         } catch (const std::exception &error) {
+           throw facebook::jsi::JSError(rt, error.what());
+         }
+         return facebook::jsi::Value::undefined();
+       }},
+      {"closeAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         int fd = fdArg(rt, args, count, "fs.close");
+         return submitFsJob([fd]() -> FsResultFn {
+           closeFd(fd);
+           return nullptr;
+         });
+       }},
+      {"fstat",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         int fd = fdArg(rt, args, count, "fs.fstat");
+         try {
+           return makeStatObject(rt, statFd(fd));
+         } catch (const std::exception &error) {
+           throw facebook::jsi::JSError(rt, error.what());
+         }
+       }},
+      {"fstatAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         int fd = fdArg(rt, args, count, "fs.fstat");
+         return submitFsJob([fd]() -> FsResultFn {
+           auto info = statFd(fd);
+           return [info](facebook::jsi::Runtime &rt) -> facebook::jsi::Value {
+             return makeStatObject(rt, info);
+           };
+         });
+       }},
+  };
+  for (const auto &[name, fn] : functions) {
+    native.setProperty(
+        runtime, name,
+        facebook::jsi::Function::createFromHostFunction(
+            runtime, facebook::jsi::PropNameID::forAscii(runtime, name), 5,
+            fn));
+  }
+}
+#endif
+
+/// watch(path, { recursive, debounceMs, mustExist }) -> id and unwatch(id),
+/// behind fs.watch and fs.watchFile. Events go to __onNativeFsWatch.
+static void installWatchBindings(facebook::jsi::Runtime &runtime,
+                                 facebook::jsi::Object &native) {
+  native.setProperty(
+      runtime, "watch",
+      facebook::jsi::Function::createFromHostFunction(
+          runtime, facebook::jsi::PropNameID::forAscii(runtime, "watch"), 2,
+          [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+             const facebook::jsi::Value *args,
+             size_t count) -> facebook::jsi::Value {
+            fs::path target = fsPathArg(rt, args, count, "fs.watch");
+            bool recursive =
+                fsBoolOption(rt, args, count, 1, "recursive", false);
+            bool mustExist = fsBoolOption(rt, args, count, 1, "mustExist", true);
+            int debounceMs = 50;
+            if (count >= 2 && args[1].isObject()) {
+              auto value =
+                  args[1].asObject(rt).getProperty(rt, "debounceMs");
+              if (value.isNumber()) {
+                debounceMs = static_cast<int>(value.getNumber());
+              }
+            }
+            try {
+              int id = fileWatcher().watch(target.string(), recursive,
+                                           debounceMs, mustExist);
+              s_jsWatchIds.insert(id);
+              return facebook::jsi::Value(id);
+            } catch (const std::exception &error) {
+              throw facebook::jsi::JSError(rt, error.what());
+            }
+          }));
+  native.setProperty(
+      runtime, "unwatch",
+      facebook::jsi::Function::createFromHostFunction(
+          runtime, facebook::jsi::PropNameID::forAscii(runtime, "unwatch"), 1,
+          [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+             const facebook::jsi::Value *args,
+             size_t count) -> facebook::jsi::Value {
+            if (count >= 1 && args[0].isNumber() && s_fileWatcher) {
+              int id = static_cast<int>(args[0].getNumber());
+              // Only JS watches; the runtime's own are not JS's to drop.
+              if (s_jsWatchIds.erase(id)) {
+                s_fileWatcher->unwatch(id);
+              }
+            }
+            return facebook::jsi::Value::undefined();
+          }));
+}
+
+/// Parse the { recursive, stat, parallel } options of scanDirectory.
+static DirectoryScanOptions
+parseScanOptions(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                 size_t count) {
+  DirectoryScanOptions options;
+  options.recursive = fsBoolOption(rt, args, count, 1, "recursive", false);
+  options.stat = fsBoolOption(rt, args, count, 1, "stat", true);
+  if (options.recursive &&
+      fsBoolOption(rt, args, count, 1, "parallel", false)) {
+    options.threads = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+  }
+  return options;
+}
+
+/// { count, names, parents, types, sizes, mtimes }: the columns of \p scan,
+/// names as one NUL-separated string and the rest as ArrayBuffers for
+/// Int32Array, Uint8Array and Float64Array views.
+static facebook::jsi::Value scanResultToJs(facebook::jsi::Runtime &rt,
+                                           DirectoryScanResult &&scan) {
+  facebook::jsi::Object result(rt);
+  result.setProperty(rt, "count", static_cast<double>(scan.size()));
+  result.setProperty(rt, "names",
+                     facebook::jsi::String::createFromUtf8(rt, scan.names));
+  result.setProperty(rt, "parents",
+                     make_array_buffer(rt, std::move(scan.parents)));
+  result.setProperty(rt, "types",
+                     make_array_buffer(rt, std::move(scan.types)));
+  result.setProperty(rt, "sizes",
+                     make_array_buffer(rt, std::move(scan.sizes)));
+  result.setProperty(rt, "mtimes",
+                     make_array_buffer(rt, std::move(scan.mtimes)));
+  return result;
+}
+
+/// scanDirectory(path, { recursive, stat, parallel }) and its async variant:
+/// a whole directory tree in one call, behind fs.scanDirectory and the
+/// withFileTypes/recursive forms of fs.readdir.
+static void installScanBindings(facebook::jsi::Runtime &runtime,
+                                facebook::jsi::Object &native) {
+  const std::pair<const char *, facebook::jsi::HostFunctionType> functions[] = {
+      {"scanDirectory",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path root = fsPathArg(rt, args, count, "fs.scanDirectory");
+         auto options = parseScanOptions(rt, args, count);
+         try {
+           return scanResultToJs(rt, scanDirectory(root.string(), options));
+         } catch (const std::exception &e) {
+           throw facebook::jsi::JSError(rt, e.what());
+         }
+       }},
+      {"scanDirectoryAsync",
+       [](facebook::jsi::Runtime &rt, const facebook::jsi::Value &,
+          const facebook::jsi::Value *args,
+          size_t count) -> facebook::jsi::Value {
+         fs::path root = fsPathArg(rt, args, count, "fs.scanDirectory");
+         auto options = parseScanOptions(rt, args, count);
+         return submitFsJob([root, options]() -> FsResultFn {
+           std::shared_ptr<DirectoryScanResult> scan;
+           try {
+             scan = std::make_shared<DirectoryScanResult>(
+                 scanDirectory(root.string(), options));
+           } catch (const std::system_error &e) {
+             throw FsError(e.what(), errnoName(e.code().value()));
+           }
+           return [scan](facebook::jsi::Runtime &rt) -> facebook::jsi::Value {
+             return scanResultToJs(rt, std::move(*scan));
+           };
+         });
+       }},
+  };
+  for (const auto &[name, fn] : functions) {
+    native.setProperty(
+        runtime, name,
+        facebook::jsi::Function::createFromHostFunction(
+            runtime, facebook::jsi::PropNameID::forAscii(runtime, name), 2,
+            fn));
+  }
+}
+
 static void installFsBindings(facebook::jsi::Runtime &runtime) {
   facebook::jsi::Object native(runtime);
 
@@ -2076,16 +3734,12 @@ static void installFsBindings(facebook::jsi::Runtime &runtime) {
                                  rt, "fs.readdir requires a path");
                            }
                            fs::path directory(args[0].asString(rt).utf8(rt));
-                           std::vector<std::string> entries;
-                           std::error_code ec;
-                           for (const auto &entry :
-                                fs::directory_iterator(directory, ec)) {
-                             entries.emplace_back(entry.path().filename().string());
-                           }
-                           if (ec) {
-                             throw facebook::jsi::JSError(rt, ec.message());
+                           try {
+                             return convertVectorOfStrings(
+                                 rt, listDirectory(directory));
+                           } catch (const std::exception &error) {
+                             throw facebook::jsi::JSError(rt, error.what());
                            }
-                           return convertVectorOfStrings(rt, entries);
                          }));
 
   native.setProperty(runtime, "readFile",
@@ -2101,22 +3755,15 @@ static void installFsBindings(facebook::jsi::Runtime &runtime) {
                                  rt, "fs.readFile requires a path");
                            }
                            fs::path target(args[0].asString(rt).utf8(rt));
-                           std::string encoding = "base64";
-                           if (count >= 2 && args[1].isString()) {
-                             encoding = toLowerAscii(
-                                 args[1].asString(rt).utf8(rt));
-                           }
+                           auto format = parseFileContentsFormat(rt, args, count);
 
                            try {
-                             auto bytes = readFileBytes(target);
-                             if (encoding == "utf8" || encoding == "utf-8") {
-                               std::string text(bytes.begin(), bytes.end());
-                               return facebook::jsi::String::createFromUtf8(rt,
-                                                                            text);
-                             }
-                             std::string base64 = base64Encode(bytes);
-                             return facebook::jsi::String::createFromUtf8(
-                                 rt, base64);
+                             return fileContentsToJs(
+                                 rt,
+                                 readFileBuffer(
+                                     target,
+                                     format == FileContentsFormat::MappedBuffer),
+                                 format);
                            } catch (const std::exception &error) {
                              throw facebook::jsi::JSError(rt, error.what());
                            }
@@ -2130,56 +3777,11 @@ static void installFsBindings(facebook::jsi::Runtime &runtime) {
                                const facebook::jsi::Value &,
                                const facebook::jsi::Value *args,
                                size_t count) -> facebook::jsi::Value {
-                           if (count < 2 || !args[0].isString() ||
-                               !args[1].isString()) {
-                             throw facebook::jsi::JSError(
-                                 rt, "fs.writeFile requires path and data");
-                           }
-                           fs::path target(args[0].asString(rt).utf8(rt));
-                           std::string data = args[1].asString(rt).utf8(rt);
-                           std::string encoding = "utf8";
-                           bool append = false;
-                           if (count >= 3) {
-                             const auto &third = args[2];
-                             if (third.isString()) {
-                               encoding = toLowerAscii(
-                                   third.asString(rt).utf8(rt));
-                             } else if (third.isObject()) {
-                               auto opts = third.asObject(rt);
-                               if (opts.hasProperty(rt, "encoding")) {
-                                 encoding = toLowerAscii(
-                                     opts.getProperty(rt, "encoding")
-                                         .toString(rt)
-                                         .utf8(rt));
-                               }
-                               if (opts.hasProperty(rt, "flag")) {
-                                 auto flag = opts.getProperty(rt, "flag")
-                                                  .toString(rt)
-                                                  .utf8(rt);
-                                 if (flag == "a" || flag == "a+" ||
-                                     flag == "as" || flag == "as+") {
-                                   append = true;
-                                 }
-                               }
-                               if (opts.hasProperty(rt, "append")) {
-                                 auto value = opts.getProperty(rt, "append");
-                                 if (value.isBool()) {
-                                   append = value.getBool();
-                                 }
-                               }
-                             }
-                           }
-
                            try {
-                             std::vector<unsigned char> bytes;
-                             if (encoding == "utf8" || encoding == "utf-8") {
-                               bytes.assign(data.begin(), data.end());
-                             } else if (encoding == "base64") {
-                               bytes = base64Decode(data);
-                             } else {
-                               throw facebook::jsi::JSError(
-                                   rt, "Unsupported encoding in writeFile");
-                             }
+                             fs::path target;
+                             bool append = false;
+                             auto bytes = parseWriteFileArgs(rt, args, count,
+                                                             target, append);
                              writeFileBytes(target, bytes, append);
                              return facebook::jsi::Value::undefined();
                            } catch (const std::exception &error) {
@@ -2210,14 +3812,10 @@ static void installFsBindings(facebook::jsi::Runtime &runtime) {
                                }
                              }
                            }
-                           std::error_code ec;
-                           if (recursive) {
-                             fs::create_directories(target, ec);
-                           } else {
-                             fs::create_directory(target, ec);
-                           }
-                           if (ec) {
-                             throw facebook::jsi::JSError(rt, ec.message());
+                           try {
+                             makeDirectory(target, recursive);
+                           } catch (const std::exception &error) {
+                             throw facebook::jsi::JSError(rt, error.what());
                            }
                            return facebook::jsi::Value::undefined();
                          }));
@@ -2252,14 +3850,10 @@ static void installFsBindings(facebook::jsi::Runtime &runtime) {
                                }
                              }
                            }
-                           std::error_code ec;
-                           if (recursive) {
-                             fs::remove_all(target, ec);
-                           } else {
-                             fs::remove(target, ec);
-                           }
-                           if (ec && !force) {
-                             throw facebook::jsi::JSError(rt, ec.message());
+                           try {
+                             removePath(target, recursive, force);
+                           } catch (const std::exception &error) {
+                             throw facebook::jsi::JSError(rt, error.what());
                            }
                            return facebook::jsi::Value::undefined();
                          }));
@@ -2286,6 +3880,12 @@ static void installFsBindings(facebook::jsi::Runtime &runtime) {
                                rt, resolved.string());
                          }));
 
+  installAsyncFsBindings(runtime, native);
+#if !defined(_WIN32)
+  installFileHandleBindings(runtime, native);
+#endif
+  installWatchBindings(runtime, native);
+  installScanBindings(runtime, native);
   runtime.global().setProperty(runtime, "__nodeFsNative", native);
 }
 
@@ -2377,282 +3977,156 @@ static void installProcessBindings(facebook::jsi::Runtime &runtime,
 
 } // namespace nodecompat
 
-static std::string trim(const std::string &value) {
-  size_t start = 0;
-  size_t end = value.size();
-
-  while (start < end && std::isspace(static_cast<unsigned char>(value[start]))) {
-    ++start;
-  }
-  while (end > start &&
-         std::isspace(static_cast<unsigned char>(value[end - 1]))) {
-    --end;
-  }
-
-  return value.substr(start, end - start);
+/// Event callback of s_fetchClient, called on the fetch I/O thread.
+static void enqueueFetchResult(NativeFetchResult &&result) {
+  s_completedFetches.push(std::move(result));
 }
 
-static std::string defaultReasonPhrase(int status) {
-  switch (status) {
-  case 200:
-    return "OK";
-  case 201:
-    return "Created";
-  case 202:
-    return "Accepted";
-  case 204:
-    return "No Content";
-  case 301:
-    return "Moved Permanently";
-  case 302:
-    return "Found";
-  case 304:
-    return "Not Modified";
-  case 400:
-    return "Bad Request";
-  case 401:
-    return "Unauthorized";
-  case 403:
-    return "Forbidden";
-  case 404:
-    return "Not Found";
-  case 405:
-    return "Method Not Allowed";
-  case 408:
-    return "Request Timeout";
-  case 409:
-    return "Conflict";
-  case 410:
-    return "Gone";
-  case 413:
-    return "Payload Too Large";
-  case 415:
-    return "Unsupported Media Type";
-  case 500:
-    return "Internal Server Error";
-  case 501:
-    return "Not Implemented";
-  case 502:
-    return "Bad Gateway";
-  case 503:
-    return "Service Unavailable";
-  default:
-    break;
+static void processFetchResults(facebook::hermes::HermesRuntime *hermes,
+                                FrameBudget &budget) {
+  if (s_completedFetches.empty()) {
+    return;
   }
-  return "";
-}
 
-static size_t writeBodyCallback(void *contents, size_t size, size_t nmemb,
-                                void *userp) {
-  auto *buffer = static_cast<std::vector<unsigned char> *>(userp);
-  size_t total = size * nmemb;
-  unsigned char *data = static_cast<unsigned char *>(contents);
-  buffer->insert(buffer->end(), data, data + total);
-  return total;
-}
+  auto global = hermes->global();
+  if (!global.hasProperty(*hermes, "__onNativeFetchComplete")) {
+    // Nothing to dispatch to; drop results
+    s_completedFetches.clear();
+    return;
+  }
 
-static size_t headerCallback(char *buffer, size_t size, size_t nitems,
-                             void *userp) {
-  auto *result = static_cast<NativeFetchResult *>(userp);
-  size_t total = size * nitems;
-  std::string line(buffer, total);
+  auto callback =
+      global.getPropertyAsFunction(*hermes, "__onNativeFetchComplete");
 
-  while (!line.empty() &&
-         (line.back() == '\r' || line.back() == '\n')) {
-    line.pop_back();
-  }
+  s_completedFetches.drain(budget, [&](NativeFetchResult &&result) {
+    facebook::jsi::Object resultObj(*hermes);
+    resultObj.setProperty(*hermes, "id",
+                          facebook::jsi::Value(result.id));
 
-  if (line.empty()) {
-    return total;
-  }
+    switch (result.kind) {
+    case NativeFetchResult::Kind::Head: {
+      resultObj.setProperty(*hermes, "type", "head");
+      resultObj.setProperty(*hermes, "ok",
+                            facebook::jsi::Value(result.ok));
+      resultObj.setProperty(*hermes, "status",
+                            facebook::jsi::Value(result.status));
+      resultObj.setProperty(
+          *hermes, "statusText",
+          facebook::jsi::String::createFromUtf8(*hermes, result.statusText));
+      resultObj.setProperty(
+          *hermes, "url",
+          facebook::jsi::String::createFromUtf8(*hermes, result.url));
 
-  if (line.rfind("HTTP/", 0) == 0) {
-    // Status line, reset headers for final response segment
-    result->headers.clear();
-    size_t firstSpace = line.find(' ');
-    if (firstSpace != std::string::npos) {
-      size_t secondSpace = line.find(' ', firstSpace + 1);
-      if (secondSpace != std::string::npos) {
-        std::string statusCodeStr = line.substr(firstSpace + 1,
-                                                secondSpace - firstSpace - 1);
-        try {
-          result->status = std::stoi(statusCodeStr);
-        } catch (...) {
-          result->status = 0;
-        }
-        result->statusText = trim(line.substr(secondSpace + 1));
+      facebook::jsi::Array headersArray(*hermes, result.headers.size());
+      for (size_t i = 0; i < result.headers.size(); ++i) {
+        const auto &header = result.headers[i];
+        facebook::jsi::Array headerPair(*hermes, 2);
+        headerPair.setValueAtIndex(
+            *hermes, 0,
+            facebook::jsi::String::createFromUtf8(*hermes, header.first));
+        headerPair.setValueAtIndex(
+            *hermes, 1,
+            facebook::jsi::String::createFromUtf8(*hermes, header.second));
+        headersArray.setValueAtIndex(*hermes, i, std::move(headerPair));
       }
+      resultObj.setProperty(*hermes, "headers", std::move(headersArray));
+      break;
     }
-  } else {
-    size_t colon = line.find(':');
-    if (colon != std::string::npos) {
-      std::string key = trim(line.substr(0, colon));
-      std::string value = trim(line.substr(colon + 1));
-      result->headers.emplace_back(std::move(key), std::move(value));
+    case NativeFetchResult::Kind::Data:
+      resultObj.setProperty(*hermes, "type", "data");
+      resultObj.setProperty(*hermes, "body",
+                            make_array_buffer(*hermes, std::move(result.body)));
+      break;
+    case NativeFetchResult::Kind::End:
+      resultObj.setProperty(*hermes, "type", "end");
+      if (!result.errorMessage.empty()) {
+        resultObj.setProperty(
+            *hermes, "error",
+            facebook::jsi::String::createFromUtf8(*hermes,
+                                                  result.errorMessage));
+      } else {
+        resultObj.setProperty(
+            *hermes, "body",
+            make_array_buffer(*hermes, std::move(result.body)));
+      }
+      break;
     }
-  }
 
-  return total;
+    callback.call(*hermes, resultObj);
+    hermes->drainMicrotasks();
+  });
 }
 
-static void enqueueFetchResult(NativeFetchResult &&result) {
-  std::lock_guard<std::mutex> lock(s_fetchQueueMutex);
-  s_completedFetches.push(std::move(result));
-}
-
-static void performFetchRequest(NativeFetchRequest request) {
-  NativeFetchResult result;
-  result.id = request.id;
-  result.url = request.url;
-
-  CURL *curl = curl_easy_init();
-  if (!curl) {
-    result.errorMessage = "Failed to initialize CURL";
-    enqueueFetchResult(std::move(result));
+/// Dispatch completed fs operations to __onNativeFsComplete({ id, error,
+/// code, value }).
+static void processFsResults(facebook::hermes::HermesRuntime *hermes,
+                             FrameBudget &budget) {
+  if (s_completedFsOps.empty()) {
     return;
   }
 
-  std::vector<unsigned char> responseBody;
-  struct curl_slist *headerList = nullptr;
-
-  curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION,
-                   request.followRedirects ? 1L : 0L);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeBodyCallback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseBody);
-  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
-  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &result);
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, "imgui-react-runtime/1.0");
-
-  if (request.timeoutMs >= 0) {
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, request.timeoutMs);
-  }
-
-  if (!request.headers.empty()) {
-    for (const auto &header : request.headers) {
-      std::string headerLine = header.first + ": " + header.second;
-      headerList = curl_slist_append(headerList, headerLine.c_str());
-    }
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
-  }
-
-  if (request.method == "GET") {
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-  } else if (request.method == "POST") {
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-  } else {
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request.method.c_str());
-  }
-
-  if (request.hasBody) {
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE,
-                     static_cast<long>(request.body.size()));
-  }
-
-  char errorBuffer[CURL_ERROR_SIZE];
-  errorBuffer[0] = '\0';
-  curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errorBuffer);
-
-  CURLcode code = curl_easy_perform(curl);
-  if (code != CURLE_OK) {
-    if (errorBuffer[0] != '\0') {
-      result.errorMessage = errorBuffer;
-    } else {
-      result.errorMessage = curl_easy_strerror(code);
-    }
-  } else {
-    long statusCode = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
-    result.status = static_cast<int>(statusCode);
-    result.ok = statusCode >= 200 && statusCode < 300;
-    if (result.statusText.empty()) {
-      result.statusText = defaultReasonPhrase(result.status);
-    }
-
-    char *effectiveUrl = nullptr;
-    if (curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effectiveUrl) ==
-            CURLE_OK &&
-        effectiveUrl) {
-      result.url = effectiveUrl;
-    }
-
-    result.bodyBase64 = base64Encode(responseBody);
-  }
-
-  if (headerList) {
-    curl_slist_free_all(headerList);
-  }
-
-  curl_easy_cleanup(curl);
-  enqueueFetchResult(std::move(result));
-}
-
-static void processFetchResults(facebook::hermes::HermesRuntime *hermes) {
-  std::queue<NativeFetchResult> localQueue;
-  {
-    std::lock_guard<std::mutex> lock(s_fetchQueueMutex);
-    if (s_completedFetches.empty()) {
-      return;
-    }
-    std::swap(localQueue, s_completedFetches);
-  }
-
   auto global = hermes->global();
-  if (!global.hasProperty(*hermes, "__onNativeFetchComplete")) {
-    // Nothing to dispatch to; drop results
+  if (!global.hasProperty(*hermes, "__onNativeFsComplete")) {
+    s_completedFsOps.clear();
     return;
   }
 
   auto callback =
-      global.getPropertyAsFunction(*hermes, "__onNativeFetchComplete");
-
-  while (!localQueue.empty()) {
-    NativeFetchResult result = std::move(localQueue.front());
-    localQueue.pop();
+      global.getPropertyAsFunction(*hermes, "__onNativeFsComplete");
 
+  s_completedFsOps.drain(budget, [&](FsCompletion &&completion) {
     facebook::jsi::Object resultObj(*hermes);
-    resultObj.setProperty(*hermes, "id",
-                          facebook::jsi::Value(result.id));
-
-    if (!result.errorMessage.empty()) {
+    resultObj.setProperty(*hermes, "id", facebook::jsi::Value(completion.id));
+    if (!completion.error.empty()) {
       resultObj.setProperty(
           *hermes, "error",
-          facebook::jsi::String::createFromUtf8(*hermes, result.errorMessage));
-    } else {
-      resultObj.setProperty(*hermes, "ok",
-                            facebook::jsi::Value(result.ok));
-      resultObj.setProperty(*hermes, "status",
-                            facebook::jsi::Value(result.status));
-      resultObj.setProperty(
-          *hermes, "statusText",
-          facebook::jsi::String::createFromUtf8(*hermes, result.statusText));
-      resultObj.setProperty(
-          *hermes, "url",
-          facebook::jsi::String::createFromUtf8(*hermes, result.url));
-
-      facebook::jsi::Array headersArray(*hermes, result.headers.size());
-      for (size_t i = 0; i < result.headers.size(); ++i) {
-        const auto &header = result.headers[i];
-        facebook::jsi::Array headerPair(*hermes, 2);
-        headerPair.setValueAtIndex(
-            *hermes, 0,
-            facebook::jsi::String::createFromUtf8(*hermes, header.first));
-        headerPair.setValueAtIndex(
-            *hermes, 1,
-            facebook::jsi::String::createFromUtf8(*hermes, header.second));
-        headersArray.setValueAtIndex(*hermes, i, std::move(headerPair));
+          facebook::jsi::String::createFromUtf8(*hermes, completion.error));
+      if (!completion.code.empty()) {
+        resultObj.setProperty(
+            *hermes, "code",
+            facebook::jsi::String::createFromUtf8(*hermes, completion.code));
       }
-      resultObj.setProperty(*hermes, "headers", std::move(headersArray));
-
-      resultObj.setProperty(
-          *hermes, "body",
-          facebook::jsi::String::createFromUtf8(*hermes, result.bodyBase64));
+    } else if (completion.result) {
+      resultObj.setProperty(*hermes, "value", completion.result(*hermes));
     }
 
     callback.call(*hermes, resultObj);
     hermes->drainMicrotasks();
+  });
+}
+
+static void processFileWatchEvents(facebook::hermes::HermesRuntime *hermes,
+                                   FrameBudget &budget) {
+  if (s_fileWatchEvents.empty()) {
+    return;
+  }
+
+  auto global = hermes->global();
+  std::optional<facebook::jsi::Function> callback;
+  if (global.hasProperty(*hermes, "__onNativeFsWatch")) {
+    callback = global.getPropertyAsFunction(*hermes, "__onNativeFsWatch");
   }
+
+  s_fileWatchEvents.drain(budget, [&](FileWatcher::Event &&event) {
+    auto handler = s_runtimeWatchHandlers.find(event.watchId);
+    if (handler != s_runtimeWatchHandlers.end()) {
+      handler->second(event);
+      return;
+    }
+    if (!callback) {
+      return;
+    }
+    facebook::jsi::Object eventObj(*hermes);
+    eventObj.setProperty(*hermes, "id", facebook::jsi::Value(event.watchId));
+    eventObj.setProperty(
+        *hermes, "eventType",
+        facebook::jsi::String::createFromAscii(*hermes, event.type));
+    eventObj.setProperty(
+        *hermes, "filename",
+        facebook::jsi::String::createFromUtf8(*hermes, event.filename));
+    callback->call(*hermes, eventObj);
+    hermes->drainMicrotasks();
+  });
 }
 
 static facebook::jsi::Value
@@ -2731,7 +4205,12 @@ nativeFetchStart(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
     if (init.hasProperty(runtime, "body")) {
       auto bodyValue = init.getProperty(runtime, "body");
       if (!bodyValue.isUndefined() && !bodyValue.isNull()) {
-        request.body = bodyValue.toString(runtime).utf8(runtime);
+        // ArrayBuffer and typed array bodies are copied out of the JS heap
+        // as raw bytes; anything else is sent as a UTF-8 string.
+        if (!copy_array_buffer(runtime, bodyValue, request.body)) {
+          std::string text = bodyValue.toString(runtime).utf8(runtime);
+          request.body.assign(text.begin(), text.end());
+        }
         request.hasBody = true;
       }
     }
@@ -2746,6 +4225,13 @@ nativeFetchStart(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
       }
     }
 
+    if (init.hasProperty(runtime, "cache")) {
+      auto cacheValue = init.getProperty(runtime, "cache");
+      if (cacheValue.isString()) {
+        request.cacheMode = cacheValue.getString(runtime).utf8(runtime);
+      }
+    }
+
     if (init.hasProperty(runtime, "redirect")) {
       auto redirectValue = init.getProperty(runtime, "redirect");
       if (redirectValue.isString()) {
@@ -2758,10 +4244,129 @@ nativeFetchStart(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
   }
 
   int requestId = request.id;
-  std::thread(performFetchRequest, std::move(request)).detach();
+  s_fetchClient->start(std::move(request));
   return facebook::jsi::Value(requestId);
 }
 
+static int fetch_request_id_arg(facebook::jsi::Runtime &runtime,
+                                const facebook::jsi::Value *args, size_t count,
+                                const char *name) {
+  if (count < 1 || !args[0].isNumber()) {
+    throw facebook::jsi::JSError(runtime,
+                                 std::string(name) + " requires a request id");
+  }
+  return (int)args[0].getNumber();
+}
+
+/// __nativeFetchStream(id): deliver the rest of the body as "data" events.
+static facebook::jsi::Value
+nativeFetchStream(facebook::jsi::Runtime &runtime,
+                  const facebook::jsi::Value &,
+                  const facebook::jsi::Value *args, size_t count) {
+  s_fetchClient->streamBody(
+      fetch_request_id_arg(runtime, args, count, "__nativeFetchStream"));
+  return facebook::jsi::Value::undefined();
+}
+
+/// __nativeFetchAck(id, bytes): streamed bytes consumed by the reader.
+static facebook::jsi::Value
+nativeFetchAck(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+               const facebook::jsi::Value *args, size_t count) {
+  int id = fetch_request_id_arg(runtime, args, count, "__nativeFetchAck");
+  if (count >= 2 && args[1].isNumber() && args[1].getNumber() > 0) {
+    s_fetchClient->acknowledge(id, (size_t)args[1].getNumber());
+  }
+  return facebook::jsi::Value::undefined();
+}
+
+/// __nativeFetchCancel(id, reason): abort the transfer.
+static facebook::jsi::Value
+nativeFetchCancel(facebook::jsi::Runtime &runtime,
+                  const facebook::jsi::Value &,
+                  const facebook::jsi::Value *args, size_t count) {
+  int id = fetch_request_id_arg(runtime, args, count, "__nativeFetchCancel");
+  std::string reason = "The operation was aborted";
+  if (count >= 2 && args[1].isString()) {
+    reason = args[1].getString(runtime).utf8(runtime);
+  }
+  s_fetchClient->cancel(id, reason);
+  return facebook::jsi::Value::undefined();
+}
+
+static facebook::jsi::Object
+fetch_cache_options_to_js(facebook::jsi::Runtime &runtime,
+                          const HttpCache::Options &options) {
+  facebook::jsi::Object result(runtime);
+  result.setProperty(runtime, "enabled", options.enabled);
+  result.setProperty(runtime, "maxMemoryBytes", (double)options.maxMemoryBytes);
+  result.setProperty(
+      runtime, "directory",
+      facebook::jsi::String::createFromUtf8(runtime, options.directory));
+  result.setProperty(runtime, "maxDiskBytes", (double)options.maxDiskBytes);
+  return result;
+}
+
+/// __configureFetchCache([{ enabled, maxMemoryBytes, directory, maxDiskBytes }])
+/// updates the HTTP cache of native fetch and returns its options.
+static facebook::jsi::Value
+configure_fetch_cache_host(facebook::jsi::Runtime &runtime,
+                           const facebook::jsi::Value &,
+                           const facebook::jsi::Value *args, size_t count) {
+  HttpCache &cache = s_fetchClient->cache();
+  HttpCache::Options options = cache.options();
+  if (count >= 1 && args[0].isObject()) {
+    auto init = args[0].getObject(runtime);
+    auto enabled = init.getProperty(runtime, "enabled");
+    if (enabled.isBool()) {
+      options.enabled = enabled.getBool();
+    }
+    auto applySize = [&](const char *name, size_t &target) {
+      auto value = init.getProperty(runtime, name);
+      if (value.isNumber() && std::isfinite(value.getNumber()) &&
+          value.getNumber() >= 0) {
+        target = (size_t)value.getNumber();
+      }
+    };
+    applySize("maxMemoryBytes", options.maxMemoryBytes);
+    applySize("maxDiskBytes", options.maxDiskBytes);
+    auto directory = init.getProperty(runtime, "directory");
+    if (directory.isString()) {
+      options.directory = directory.getString(runtime).utf8(runtime);
+    } else if (directory.isNull()) {
+      options.directory.clear();
+    }
+    cache.configure(options);
+  }
+  return fetch_cache_options_to_js(runtime, cache.options());
+}
+
+/// __fetchCacheStats(reset) returns the HTTP cache counters.
+static facebook::jsi::Value
+fetch_cache_stats_host(facebook::jsi::Runtime &runtime,
+                       const facebook::jsi::Value &,
+                       const facebook::jsi::Value *args, size_t count) {
+  bool reset = count >= 1 && args[0].isBool() && args[0].getBool();
+  HttpCache::Stats stats = s_fetchClient->cache().stats(reset);
+  facebook::jsi::Object result(runtime);
+  result.setProperty(runtime, "hits", (double)stats.hits);
+  result.setProperty(runtime, "revalidated", (double)stats.revalidated);
+  result.setProperty(runtime, "misses", (double)stats.misses);
+  result.setProperty(runtime, "stores", (double)stats.stores);
+  result.setProperty(runtime, "deduplicated", (double)stats.deduplicated);
+  result.setProperty(runtime, "evictions", (double)stats.evictions);
+  result.setProperty(runtime, "memoryBytes", (double)stats.memoryBytes);
+  result.setProperty(runtime, "memoryEntries", (double)stats.memoryEntries);
+  result.setProperty(runtime, "diskBytes", (double)stats.diskBytes);
+  return result;
+}
+
+static facebook::jsi::Value
+clear_fetch_cache_host(facebook::jsi::Runtime &, const facebook::jsi::Value &,
+                       const facebook::jsi::Value *, size_t) {
+  s_fetchClient->cache().clear();
+  return facebook::jsi::Value::undefined();
+}
+
   void imgui_register_embedded_image(const char *name,
                                      const unsigned char *data,
                                      unsigned size) {
@@ -2775,44 +4380,594 @@ nativeFetchStart(facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
 class Image {
 public:
   int w_ = 0, h_ = 0;
+  /// Invalid for images in an atlas page, which do not own their texture.
   sg_image image_ = {};
   simgui_image_t simguiImage_ = {};
+  /// The image within simguiImage_.
+  ImVec2 uv0_{0, 0};
+  ImVec2 uv1_{1, 1};
+
+  /// Upload \p image with its mip levels; returns null and sets \p error if
+  /// the GPU image could not be created, e.g. because the image pool is
+  /// exhausted.
+  static std::unique_ptr<Image> create(const DecodedImage &image,
+                                       std::string &error) {
+    auto result = std::make_unique<Image>();
+    result->w_ = image.width;
+    result->h_ = image.height;
+    sg_image_desc desc = {
+        .width = image.width,
+        .height = image.height,
+        .num_mipmaps = image.levels,
+    };
+    const uint8_t *level = image.pixels.get();
+    for (int i = 0; i < image.levels; ++i) {
+      size_t size = (size_t)rawImageLevelSize(image.width, i) *
+                    rawImageLevelSize(image.height, i) * 4;
+      desc.data.subimage[0][i] = {.ptr = level, .size = size};
+      level += size;
+    }
+    result->image_ = sg_make_image(desc);
+    if (sg_query_image_state(result->image_) != SG_RESOURCESTATE_VALID) {
+      error = "Failed to create GPU image";
+      return nullptr;
+    }
+    result->simguiImage_ = simgui_make_image(simgui_image_desc_t{
+        result->image_, image.levels > 1 ? s_mipSampler : s_sampler});
+    if (!result->simguiImage_.id) {
+      error = "Failed to create ImGui image";
+      return nullptr;
+    }
+    return result;
+  }
+
+  /// A blank texture whose pixels are set with sg_update_image():
+  /// SG_USAGE_DYNAMIC for atlas pages, which change now and then, and
+  /// SG_USAGE_STREAM for dynamic textures, which may change every frame.
+  static std::unique_ptr<Image> createUpdatable(int width, int height,
+                                                sg_usage usage) {
+    auto result = std::make_unique<Image>();
+    result->w_ = width;
+    result->h_ = height;
+    result->image_ = sg_make_image(sg_image_desc{
+        .width = width,
+        .height = height,
+        .usage = usage,
+    });
+    if (sg_query_image_state(result->image_) != SG_RESOURCESTATE_VALID) {
+      return nullptr;
+    }
+    result->simguiImage_ =
+        simgui_make_image(simgui_image_desc_t{result->image_, s_sampler});
+    if (!result->simguiImage_.id) {
+      return nullptr;
+    }
+    return result;
+  }
+
+  ~Image() {
+    if (!image_.id) {
+      return;
+    }
+    if (simguiImage_.id) {
+      simgui_destroy_image(simguiImage_);
+    }
+    sg_destroy_image(image_);
+  }
+};
+
+/// Uploaded images by s_textureCache handle, as returned by load_image() and
+/// __loadImageAsync(). Asynchronous loads appear once they are uploaded.
+static std::unordered_map<int, std::unique_ptr<Image>> s_images{};
+/// Deduplicates loads by source and decides which images to free.
+static TextureCache s_textureCache{256u << 20};
+/// Packs images of up to 128x128 into shared 1024x1024 pages so that they
+/// are drawn without texture switches.
+static TextureAtlas s_textureAtlas{1024, 128, 16};
+/// GPU textures of the s_textureAtlas pages, by page.
+static std::vector<std::unique_ptr<Image>> s_atlasPages{};
+
+/// A texture created by __createDynamicTexture() whose pixels JS replaces
+/// with __updateTexture().
+struct DynamicTexture {
+  PixelFormat format = PixelFormat::RGBA8;
+  /// RGBA8 pixels waiting for upload, or converted from another format.
+  std::vector<uint8_t> staging;
+  /// staging holds an update that could not be uploaded yet, because sokol
+  /// allows one upload per texture and frame.
+  bool pending = false;
+  /// s_frameNumber of the last upload.
+  uint64_t uploadedFrame = UINT64_MAX;
+};
 
-  explicit Image(const char *path) {
-    const EmbeddedImage *embedded = find_embedded_image(path ? path : "");
+/// Dynamic textures by handle; their Image is in s_images.
+static std::unordered_map<int, DynamicTexture> s_dynamicTextures{};
+/// Counts app_frame() calls, to upload each dynamic texture at most once per
+/// frame.
+static uint64_t s_frameNumber = 0;
+
+/// Capacity of the sokol_gfx and sokol_imgui image pools.
+static constexpr int kImagePoolSize = 4096;
+
+/// Decodes __loadImageAsync() sources off the main thread; created on first
+/// use.
+static std::unique_ptr<ImageLoader> s_imageLoader;
+/// Pixel bytes uploaded per frame from s_imageLoader; 0 means no limit.
+static size_t s_imageUploadBudgetBytes = 8 << 20;
+/// Shown by textures that are still loading, created on first use.
+static std::unique_ptr<Image> s_placeholderImage;
+
+static ImageLoader &imageLoader() {
+  if (!s_imageLoader) {
+    unsigned hardware = std::thread::hardware_concurrency();
+    size_t threads = std::clamp<size_t>(hardware > 1 ? hardware - 1 : 1, 1, 4);
+    s_imageLoader = std::make_unique<ImageLoader>(threads, request_frame);
+  }
+  return *s_imageLoader;
+}
 
-    unsigned char *data;
-    int n;
-    if (embedded) {
-      data = stbi_load_from_memory(embedded->data, embedded->size, &w_, &h_,
-                                   &n, 4);
+/// ImTextureID of the placeholder, or 0 before sokol is set up.
+static double placeholder_texture_id() {
+  if (!s_placeholderImage && sg_isvalid()) {
+    static const uint8_t kPixel[4] = {128, 128, 128, 96};
+    DecodedImage pixel;
+    pixel.width = 1;
+    pixel.height = 1;
+    pixel.pixels = std::shared_ptr<const uint8_t>(kPixel, [](const uint8_t *) {});
+    std::string error;
+    s_placeholderImage = Image::create(pixel, error);
+  }
+  if (!s_placeholderImage) {
+    return 0;
+  }
+  return static_cast<double>(s_placeholderImage->simguiImage_.id);
+}
+
+/// Free the images s_textureCache evicts.
+static void trim_texture_cache() {
+  for (int handle : s_textureCache.evict()) {
+    s_textureAtlas.remove(handle);
+    s_dynamicTextures.erase(handle);
+    s_images.erase(handle);
+  }
+}
+
+/// Point \p image at its rectangle in s_textureAtlas.
+static void place_in_atlas(Image &image, const TextureAtlas::Rect &rect) {
+  float size = static_cast<float>(s_textureAtlas.pageSize());
+  image.simguiImage_ = s_atlasPages[rect.page]->simguiImage_;
+  image.uv0_ = ImVec2(rect.x / size, rect.y / size);
+  image.uv1_ =
+      ImVec2((rect.x + rect.width) / size, (rect.y + rect.height) / size);
+}
+
+/// Upload \p decoded as the image of \p handle: into an atlas page if it is
+/// small enough, has no mip levels and there is room, otherwise as a texture
+/// of its own.
+static std::unique_ptr<Image> create_texture(int handle,
+                                             const DecodedImage &decoded,
+                                             std::string &error) {
+  if (decoded.levels == 1 &&
+      s_textureAtlas.accepts(decoded.width, decoded.height) &&
+      s_textureAtlas.insert(handle, decoded.pixels.get(), decoded.width,
+                            decoded.height)) {
+    const TextureAtlas::Rect &rect = *s_textureAtlas.find(handle);
+    if (s_atlasPages.size() <= static_cast<size_t>(rect.page)) {
+      s_atlasPages.resize(rect.page + 1);
+    }
+    if (!s_atlasPages[rect.page]) {
+      s_atlasPages[rect.page] = Image::createUpdatable(
+          s_textureAtlas.pageSize(), s_textureAtlas.pageSize(),
+          SG_USAGE_DYNAMIC);
+    }
+    if (s_atlasPages[rect.page]) {
+      auto image = std::make_unique<Image>();
+      image->w_ = decoded.width;
+      image->h_ = decoded.height;
+      place_in_atlas(*image, rect);
+      return image;
+    }
+    s_textureAtlas.remove(handle);
+  }
+  return Image::create(decoded, error);
+}
+
+/// Set the properties of a loaded texture on \p target: width, height,
+/// textureId and, for images in an atlas page, the rectangle uv0/uv1.
+static void set_image_properties(facebook::jsi::Runtime &runtime,
+                                 facebook::jsi::Object &target,
+                                 const Image &image) {
+  target.setProperty(runtime, "width", image.w_);
+  target.setProperty(runtime, "height", image.h_);
+  target.setProperty(runtime, "textureId",
+                     static_cast<double>(image.simguiImage_.id));
+  if (image.image_.id) {
+    return;
+  }
+  auto point = [&runtime](ImVec2 uv) {
+    facebook::jsi::Object result(runtime);
+    result.setProperty(runtime, "x", uv.x);
+    result.setProperty(runtime, "y", uv.y);
+    return result;
+  };
+  target.setProperty(runtime, "uv0", point(image.uv0_));
+  target.setProperty(runtime, "uv1", point(image.uv1_));
+}
+
+/// Repack the atlas pages that lost enough images and report the images that
+/// moved to __onNativeTexturesMoved([{ id, width, height, textureId, uv0,
+/// uv1 }]).
+static void compact_texture_atlas(facebook::hermes::HermesRuntime *hermes) {
+  std::vector<int> moved = s_textureAtlas.compact();
+  if (moved.empty()) {
+    return;
+  }
+  facebook::jsi::Array events(*hermes, moved.size());
+  for (size_t i = 0; i < moved.size(); ++i) {
+    Image &image = *s_images.at(moved[i]);
+    place_in_atlas(image, *s_textureAtlas.find(moved[i]));
+    facebook::jsi::Object event(*hermes);
+    event.setProperty(*hermes, "id", moved[i]);
+    set_image_properties(*hermes, event, image);
+    events.setValueAtIndex(*hermes, i, event);
+  }
+  auto global = hermes->global();
+  if (global.hasProperty(*hermes, "__onNativeTexturesMoved")) {
+    global.getPropertyAsFunction(*hermes, "__onNativeTexturesMoved")
+        .call(*hermes, events);
+  }
+}
+
+/// Upload the atlas pages that changed this frame, and free the emptied
+/// ones. sokol allows one update per texture and frame, so this runs once,
+/// after JS has drawn.
+static void flush_texture_atlas() {
+  for (int page : s_textureAtlas.takeDirtyPages()) {
+    const uint8_t *pixels = s_textureAtlas.pagePixels(page);
+    if (!pixels) {
+      s_atlasPages[page].reset();
+      continue;
+    }
+    if (page < static_cast<int>(s_atlasPages.size()) && s_atlasPages[page]) {
+      TraceScope trace("uploadAtlasPage", "image");
+      size_t size = static_cast<size_t>(s_textureAtlas.pageSize());
+      sg_image_data data{};
+      data.subimage[0][0] = {.ptr = pixels, .size = size * size * 4};
+      sg_update_image(s_atlasPages[page]->image_, &data);
+    }
+  }
+}
+
+/// __loadImageAsync(source, options) -> { id[, width, height, textureId] }.
+/// Acquires a reference to the texture of \p source, a path, the key of an
+/// embedded image, or an ArrayBuffer (the range given by
+/// options.byteOffset/byteLength, copied). A path or key that is already
+/// loading or loaded returns its id, with the texture's properties once it is
+/// uploaded. Otherwise \p source is decoded on the image workers and the
+/// outcome is reported to __onNativeImageComplete when it has been uploaded.
+static facebook::jsi::Value
+load_image_async_host(facebook::jsi::Runtime &runtime,
+                      const facebook::jsi::Value &,
+                      const facebook::jsi::Value *args, size_t count) {
+  if (count < 1) {
+    throw facebook::jsi::JSError(runtime,
+                                 "__loadImageAsync requires a source");
+  }
+  facebook::jsi::Object result(runtime);
+  if (args[0].isString()) {
+    std::string source = args[0].getString(runtime).utf8(runtime);
+    if (source.empty()) {
+      throw facebook::jsi::JSError(runtime,
+                                   "__loadImageAsync requires a source");
+    }
+    auto [id, hit] = s_textureCache.acquire(source);
+    result.setProperty(runtime, "id", id);
+    if (hit) {
+      auto image = s_images.find(id);
+      if (image != s_images.end()) {
+        set_image_properties(runtime, result, *image->second);
+      }
+      return result;
+    }
+    if (const EmbeddedImage *embedded = find_embedded_image(source)) {
+      imageLoader().decodeStatic(id, embedded->data, embedded->size);
     } else {
-      data = stbi_load(path, &w_, &h_, &n, 4);
+      imageLoader().decodeFile(id, std::move(source));
     }
+  } else {
+    facebook::jsi::Value range[3] = {
+        facebook::jsi::Value(runtime, args[0]),
+        facebook::jsi::Value::undefined(),
+        facebook::jsi::Value::undefined(),
+    };
+    if (count >= 2 && args[1].isObject()) {
+      auto options = args[1].getObject(runtime);
+      range[1] = options.getProperty(runtime, "byteOffset");
+      range[2] = options.getProperty(runtime, "byteLength");
+    }
+    auto [data, length] =
+        array_buffer_range(runtime, range, 3, "__loadImageAsync");
+    int id = s_textureCache.acquire(std::string()).handle;
+    result.setProperty(runtime, "id", id);
+    imageLoader().decodeBuffer(id, std::vector<uint8_t>(data, data + length));
+  }
+  return result;
+}
 
-    if (!data) {
-      slog_func("ERROR", 1, 0, "Failed to load image", __LINE__, __FILE__,
-                nullptr);
-      abort();
+/// Upload \p size bytes of RGBA8 \p pixels to the dynamic texture of
+/// \p handle.
+static void upload_dynamic_texture(int handle, DynamicTexture &texture,
+                                   const uint8_t *pixels, size_t size) {
+  TraceScope trace("uploadDynamicTexture", "image");
+  sg_image_data data{};
+  data.subimage[0][0] = {.ptr = pixels, .size = size};
+  sg_update_image(s_images.at(handle)->image_, &data);
+  texture.uploadedFrame = s_frameNumber;
+  texture.pending = false;
+}
+
+/// Upload the dynamic texture updates that were deferred because their
+/// texture had already been uploaded in their frame.
+static void flush_dynamic_textures() {
+  for (auto &[handle, texture] : s_dynamicTextures) {
+    if (texture.pending && texture.uploadedFrame != s_frameNumber) {
+      upload_dynamic_texture(handle, texture, texture.staging.data(),
+                             texture.staging.size());
     }
+  }
+}
 
-    image_ = sg_make_image(sg_image_desc{
-        .width = w_,
-        .height = h_,
-        .data{.subimage[0][0] = {.ptr = data, .size = (size_t)w_ * h_ * 4}},
-    });
+/// __createDynamicTexture(width, height, format) -> { id, width, height,
+/// textureId }. Creates a blank SG_USAGE_STREAM texture whose pixels are set
+/// with __updateTexture(). \p format is "rgba8" (the default), "bgra8" or
+/// "gray8". The texture holds a reference released with __releaseTexture().
+static facebook::jsi::Value
+create_dynamic_texture_host(facebook::jsi::Runtime &runtime,
+                            const facebook::jsi::Value &,
+                            const facebook::jsi::Value *args, size_t count) {
+  auto dimension = [&](size_t index) {
+    double value = count > index && args[index].isNumber()
+                       ? args[index].getNumber()
+                       : 0;
+    if (!(value >= 1 && value <= 16384) || value != std::floor(value)) {
+      throw facebook::jsi::JSError(
+          runtime, "__createDynamicTexture requires a width and height "
+                   "between 1 and 16384");
+    }
+    return static_cast<int>(value);
+  };
+  int width = dimension(0);
+  int height = dimension(1);
+  PixelFormat format = PixelFormat::RGBA8;
+  if (count >= 3 && !args[2].isUndefined() &&
+      (!args[2].isString() ||
+       !parsePixelFormat(args[2].getString(runtime).utf8(runtime), format))) {
+    throw facebook::jsi::JSError(
+        runtime, "__createDynamicTexture format must be 'rgba8', 'bgra8' or "
+                 "'gray8'");
+  }
+  if (!sg_isvalid()) {
+    throw facebook::jsi::JSError(
+        runtime, "Textures cannot be created before the renderer is set up");
+  }
+  auto image = Image::createUpdatable(width, height, SG_USAGE_STREAM);
+  if (!image) {
+    throw facebook::jsi::JSError(runtime, "Failed to create GPU image");
+  }
+  int handle = s_textureCache.acquire(std::string()).handle;
+  s_textureCache.setResident(handle, (size_t)width * height * 4);
+  facebook::jsi::Object result(runtime);
+  result.setProperty(runtime, "id", handle);
+  set_image_properties(runtime, result, *image);
+  s_images[handle] = std::move(image);
+  s_dynamicTextures[handle].format = format;
+  return result;
+}
 
-    stbi_image_free(data);
-    simguiImage_ = simgui_make_image(simgui_image_desc_t{image_, s_sampler});
+/// __updateTexture(id, buffer, byteOffset, byteLength) replaces the pixels of
+/// a dynamic texture with those in the ArrayBuffer range, which must hold
+/// width * height pixels of its format. The pixels are uploaded straight from
+/// the ArrayBuffer when possible; otherwise they are converted or kept in a
+/// staging buffer, and a texture that was already uploaded this frame gets
+/// the latest pixels next frame.
+static facebook::jsi::Value
+update_texture_host(facebook::jsi::Runtime &runtime,
+                    const facebook::jsi::Value &,
+                    const facebook::jsi::Value *args, size_t count) {
+  if (count < 2 || !args[0].isNumber()) {
+    throw facebook::jsi::JSError(
+        runtime, "__updateTexture requires a texture id and an ArrayBuffer");
+  }
+  int handle = static_cast<int>(args[0].getNumber());
+  auto found = s_dynamicTextures.find(handle);
+  if (found == s_dynamicTextures.end()) {
+    throw facebook::jsi::JSError(runtime,
+                                 "__updateTexture requires a dynamic texture");
+  }
+  DynamicTexture &texture = found->second;
+  const Image &image = *s_images.at(handle);
+  auto [data, length] =
+      array_buffer_range(runtime, args + 1, count - 1, "__updateTexture");
+  size_t pixels = (size_t)image.w_ * image.h_;
+  if (length < pixels * bytesPerPixel(texture.format)) {
+    throw facebook::jsi::JSError(
+        runtime, "__updateTexture data is smaller than the texture");
+  }
+  bool canUpload = texture.uploadedFrame != s_frameNumber;
+  if (canUpload && texture.format == PixelFormat::RGBA8) {
+    upload_dynamic_texture(handle, texture, data, pixels * 4);
+    return facebook::jsi::Value::undefined();
+  }
+  texture.staging.resize(pixels * 4);
+  convertToRgba8(texture.format, data, texture.staging.data(), pixels);
+  if (canUpload) {
+    upload_dynamic_texture(handle, texture, texture.staging.data(),
+                           texture.staging.size());
+  } else {
+    // Uploaded by flush_dynamic_textures(); in idle rendering mode nothing
+    // else may wake the next frame.
+    texture.pending = true;
+    request_frame();
   }
+  return facebook::jsi::Value::undefined();
+}
 
-  ~Image() {
-    simgui_destroy_image(simguiImage_);
-    sg_destroy_image(image_);
+/// __releaseTexture(id) -> the references left, -1 if \p id is unknown.
+/// Drops a reference acquired by __loadImageAsync(); the image is freed when
+/// s_textureCache evicts it.
+static facebook::jsi::Value
+release_texture_host(facebook::jsi::Runtime &runtime,
+                     const facebook::jsi::Value &,
+                     const facebook::jsi::Value *args, size_t count) {
+  if (count < 1 || !args[0].isNumber()) {
+    throw facebook::jsi::JSError(runtime,
+                                 "__releaseTexture requires a texture id");
   }
-};
+  int remaining = s_textureCache.release(static_cast<int>(args[0].getNumber()));
+  if (remaining == 0) {
+    trim_texture_cache();
+  }
+  return remaining;
+}
+
+/// __configureTextureCache([{ maxResidentBytes, atlasMaxImageSize }]) ->
+/// { maxResidentBytes, atlasMaxImageSize }. Images up to atlasMaxImageSize
+/// pixels wide and high are packed into atlas pages; 0 turns packing off.
+static facebook::jsi::Value
+configure_texture_cache_host(facebook::jsi::Runtime &runtime,
+                             const facebook::jsi::Value &,
+                             const facebook::jsi::Value *args, size_t count) {
+  if (count >= 1 && args[0].isObject()) {
+    auto options = args[0].getObject(runtime);
+    auto maxBytes = options.getProperty(runtime, "maxResidentBytes");
+    if (maxBytes.isNumber() && std::isfinite(maxBytes.getNumber())) {
+      s_textureCache.setMaxBytes(
+          static_cast<size_t>(std::max(0.0, maxBytes.getNumber())));
+      trim_texture_cache();
+    }
+    auto atlasSize = options.getProperty(runtime, "atlasMaxImageSize");
+    if (atlasSize.isNumber() && std::isfinite(atlasSize.getNumber())) {
+      s_textureAtlas.setMaxImageSize(static_cast<int>(std::clamp(
+          atlasSize.getNumber(), 0.0,
+          static_cast<double>(s_textureAtlas.pageSize()))));
+    }
+  }
+  facebook::jsi::Object result(runtime);
+  result.setProperty(runtime, "maxResidentBytes",
+                     static_cast<double>(s_textureCache.maxBytes()));
+  result.setProperty(runtime, "atlasMaxImageSize",
+                     s_textureAtlas.maxImageSize());
+  return result;
+}
+
+/// __textureCacheStats(reset) -> { residentBytes, residentTextures,
+/// unusedTextures, hits, misses, evictions }.
+static facebook::jsi::Value
+texture_cache_stats_host(facebook::jsi::Runtime &runtime,
+                         const facebook::jsi::Value &,
+                         const facebook::jsi::Value *args, size_t count) {
+  bool reset = count >= 1 && args[0].isBool() && args[0].getBool();
+  TextureCache::Stats stats = s_textureCache.stats(reset);
+  facebook::jsi::Object result(runtime);
+  result.setProperty(runtime, "residentBytes",
+                     static_cast<double>(stats.residentBytes));
+  result.setProperty(runtime, "residentTextures",
+                     static_cast<double>(stats.residentTextures));
+  result.setProperty(runtime, "unusedTextures",
+                     static_cast<double>(stats.unusedTextures));
+  result.setProperty(runtime, "hits", static_cast<double>(stats.hits));
+  result.setProperty(runtime, "misses", static_cast<double>(stats.misses));
+  result.setProperty(runtime, "evictions",
+                     static_cast<double>(stats.evictions));
+  return result;
+}
+
+/// __imagePlaceholderTextureId() -> the ImTextureID drawn for images that are
+/// still loading, 0 before the renderer is set up.
+static facebook::jsi::Value
+image_placeholder_texture_id_host(facebook::jsi::Runtime &,
+                                  const facebook::jsi::Value &,
+                                  const facebook::jsi::Value *, size_t) {
+  return placeholder_texture_id();
+}
+
+/// __configureImageLoader([{ uploadBudgetBytes }]) -> { uploadBudgetBytes,
+/// decoding, waitingForUpload }.
+static facebook::jsi::Value
+configure_image_loader_host(facebook::jsi::Runtime &runtime,
+                            const facebook::jsi::Value &,
+                            const facebook::jsi::Value *args, size_t count) {
+  if (count >= 1 && args[0].isObject()) {
+    auto budget =
+        args[0].getObject(runtime).getProperty(runtime, "uploadBudgetBytes");
+    if (budget.isNumber() && std::isfinite(budget.getNumber())) {
+      s_imageUploadBudgetBytes =
+          static_cast<size_t>(std::max(0.0, budget.getNumber()));
+    }
+  }
+  facebook::jsi::Object result(runtime);
+  result.setProperty(runtime, "uploadBudgetBytes",
+                     static_cast<double>(s_imageUploadBudgetBytes));
+  result.setProperty(
+      runtime, "decoding",
+      static_cast<double>(s_imageLoader ? s_imageLoader->decoding() : 0));
+  result.setProperty(
+      runtime, "waitingForUpload",
+      static_cast<double>(s_imageLoader ? s_imageLoader->ready() : 0));
+  return result;
+}
 
-static std::vector<std::unique_ptr<Image>> s_images{};
+/// Upload the images s_imageLoader finished, up to s_imageUploadBudgetBytes
+/// of pixels, and report each to __onNativeImageComplete({ id, width, height,
+/// textureId }) or, on failure, ({ id, error }). Images released while they
+/// were decoding are dropped without being uploaded.
+static void processImageUploads(facebook::hermes::HermesRuntime *hermes) {
+  if (!s_imageLoader || !s_imageLoader->ready()) {
+    return;
+  }
+  auto results = s_imageLoader->takeResults(s_imageUploadBudgetBytes);
+  if (s_imageLoader->ready()) {
+    request_frame();
+  }
+
+  std::optional<facebook::jsi::Function> callback;
+  auto global = hermes->global();
+  if (global.hasProperty(*hermes, "__onNativeImageComplete")) {
+    callback = global.getPropertyAsFunction(*hermes, "__onNativeImageComplete");
+  }
+  for (auto &result : results) {
+    if (!s_textureCache.contains(result.id)) {
+      continue;
+    }
+    // load_image() may have uploaded the same key in the meantime.
+    auto existing = s_images.find(result.id);
+    Image *image = existing != s_images.end() ? existing->second.get() : nullptr;
+    if (!image && result.error.empty()) {
+      TraceScope trace("uploadImage", "image");
+      if (auto created = create_texture(result.id, result.image, result.error)) {
+        image = created.get();
+        s_textureCache.setResident(result.id, result.image.byteSize());
+        s_images[result.id] = std::move(created);
+      }
+    }
+    facebook::jsi::Object event(*hermes);
+    event.setProperty(*hermes, "id", result.id);
+    if (image) {
+      set_image_properties(*hermes, event, *image);
+    } else {
+      s_textureCache.remove(result.id);
+      event.setProperty(
+          *hermes, "error",
+          facebook::jsi::String::createFromUtf8(*hermes, result.error));
+    }
+    if (callback) {
+      callback->call(*hermes, event);
+      hermes->drainMicrotasks();
+    }
+  }
+  trim_texture_cache();
+  compact_texture_atlas(hermes);
+}
 
 static bool s_started = false;
 static uint64_t s_start_time = 0;
@@ -2833,10 +4988,9 @@ static int s_bundleMode = 0;
 static std::string s_bundlePath{};
 
 #if !defined(NDEBUG)
-static std::filesystem::file_time_type s_bundleTimestamp{};
-static bool s_bundleWatchEnabled = false;
+/// FileWatcher id of the bundle, 0 when it is not watched.
+static int s_bundleWatchId = 0;
 static bool s_bundleReloadPending = false;
-static int s_bundleCooldownFrames = 0;
 #endif
 
 void imgui_runtime_set_bundle_info(int bundleMode, const char *bundlePath) {
@@ -2856,9 +5010,14 @@ void imgui_runtime_set_bundle_info(int bundleMode, const char *bundlePath) {
   }
 
 #if !defined(NDEBUG)
-  s_bundleWatchEnabled = false;
+  if (s_bundleWatchId != 0) {
+    if (s_fileWatcher) {
+      s_fileWatcher->unwatch(s_bundleWatchId);
+    }
+    s_runtimeWatchHandlers.erase(s_bundleWatchId);
+    s_bundleWatchId = 0;
+  }
   s_bundleReloadPending = false;
-  s_bundleCooldownFrames = 0;
 #endif
 }
 
@@ -2868,14 +5027,19 @@ static void initialize_bundle_watch() {
     return;
   }
 
-  std::error_code ec;
-  auto timestamp = std::filesystem::last_write_time(s_bundlePath, ec);
-  if (!ec) {
-    s_bundleTimestamp = timestamp;
-    s_bundleWatchEnabled = true;
+  try {
+    // Bundlers may write the file in several steps; the debounce waits for
+    // them to settle.
+    s_bundleWatchId = fileWatcher().watch(s_bundlePath, false, 100);
+    s_runtimeWatchHandlers[s_bundleWatchId] = [](const FileWatcher::Event &) {
+      if (!s_bundleReloadPending) {
+        printf("Detected bundle change. Scheduling hot reload...\n");
+      }
+      s_bundleReloadPending = true;
+    };
     printf("Hot reload watching: '%s'\n", s_bundlePath.c_str());
-  } else {
-    printf("Hot reload disabled: %s\n", ec.message().c_str());
+  } catch (const std::exception &e) {
+    printf("Hot reload disabled: %s\n", e.what());
   }
 }
 
@@ -2889,6 +5053,21 @@ static bool reload_react_bundle() {
 
   printf("Reloading React bundle...\n");
   try {
+    // Watches of the old bundle would keep firing into listeners the new one
+    // knows nothing about, piling up with every reload.
+    if (s_fileWatcher) {
+      for (int id : s_jsWatchIds) {
+        s_fileWatcher->unwatch(id);
+      }
+    }
+    s_jsWatchIds.clear();
+    auto jsGlobal = s_hermesApp->hermes->global();
+    if (jsGlobal.hasProperty(*s_hermesApp->hermes, "__onNativeFsUnwatchAll")) {
+      jsGlobal.getPropertyAsFunction(*s_hermesApp->hermes,
+                                     "__onNativeFsUnwatchAll")
+          .call(*s_hermesApp->hermes);
+    }
+
     imgui_load_unit(s_hermesApp->hermes, nullptr, false, s_bundlePath.c_str(),
                     "react-unit-bundle.js");
     s_hermesApp->hermes->drainMicrotasks();
@@ -2914,33 +5093,12 @@ static bool reload_react_bundle() {
 }
 
 static void maybe_handle_hot_reload() {
-  if (!s_bundleWatchEnabled || s_bundleMode != 2 || s_bundlePath.empty()) {
-    return;
-  }
-
-  std::error_code ec;
-  auto currentTime = std::filesystem::last_write_time(s_bundlePath, ec);
-  if (!ec && currentTime != s_bundleTimestamp && !s_bundleReloadPending) {
-    s_bundleTimestamp = currentTime;
-    s_bundleReloadPending = true;
-    s_bundleCooldownFrames = 2; // Wait a couple frames for write to finish
-    printf("Detected bundle change. Scheduling hot reload...\n");
-  }
-
   if (!s_bundleReloadPending) {
     return;
   }
-
-  if (s_bundleCooldownFrames > 0) {
-    --s_bundleCooldownFrames;
-    return;
-  }
-
-  if (reload_react_bundle()) {
-    s_bundleReloadPending = false;
-  } else {
-    s_bundleCooldownFrames = 2;
-  }
+  s_bundleReloadPending = false;
+  // A bundle that fails to load is retried on its next change.
+  reload_react_bundle();
 }
 #else
 static void maybe_handle_hot_reload() {}
@@ -2948,39 +5106,88 @@ static void initialize_bundle_watch() {}
 #endif
 
 
+/// Load and upload the image at \p path, or the embedded image of that key,
+/// synchronously. Returns a handle that holds a reference in s_textureCache,
+/// shared with earlier loads of \p path that are still resident, or -1.
+/// Images of up to 128x128 may be placed in an atlas page; see
+/// image_simgui_image().
 extern "C" int load_image(const char *path) {
-  s_images.emplace_back(std::make_unique<Image>(path));
-  return s_images.size() - 1;
+  std::string key = path ? path : "";
+  auto [handle, hit] = s_textureCache.acquire(key);
+  if (hit && s_images.count(handle)) {
+    return handle;
+  }
+  DecodedImage decoded;
+  std::string error;
+  const EmbeddedImage *embedded = find_embedded_image(key);
+  bool ok = embedded ? decodeStaticImage(embedded->data, embedded->size,
+                                         decoded, error)
+                     : decodeImageFile(key, decoded, error);
+  std::unique_ptr<Image> image;
+  if (ok) {
+    image = create_texture(handle, decoded, error);
+  }
+  if (!image) {
+    slog_func("ERROR", 1, 0, error.c_str(), __LINE__, __FILE__, nullptr);
+    s_textureCache.release(handle);
+    return -1;
+  }
+  // An asynchronous load of the same key may still be decoding; its result
+  // is discarded once this one is resident.
+  s_textureCache.setResident(handle, decoded.byteSize());
+  s_images[handle] = std::move(image);
+  trim_texture_cache();
+  return handle;
 }
-extern "C" int image_width(int index) {
-  if (index < 0 || index >= s_images.size()) {
-    slog_func("ERROR", 1, 0, "Invalid image index", __LINE__, __FILE__,
-              nullptr);
-    return 0;
+/// Drop the reference load_image() returned.
+extern "C" void unload_image(int index) {
+  if (s_textureCache.release(index) == 0) {
+    trim_texture_cache();
   }
-  return s_images[index]->w_;
 }
-extern "C" int image_height(int index) {
-  if (index < 0 || index >= s_images.size()) {
+static Image *find_image(int index) {
+  auto found = s_images.find(index);
+  if (found == s_images.end()) {
     slog_func("ERROR", 1, 0, "Invalid image index", __LINE__, __FILE__,
               nullptr);
-    return 0;
+    return nullptr;
   }
-  return s_images[index]->h_;
+  return found->second.get();
+}
+extern "C" int image_width(int index) {
+  Image *image = find_image(index);
+  return image ? image->w_ : 0;
 }
+extern "C" int image_height(int index) {
+  Image *image = find_image(index);
+  return image ? image->h_ : 0;
+}
+/// The texture to draw \p index with. Small images share an atlas page, so
+/// draw them with the UV rectangle of image_uv0() and image_uv1(), e.g.
+/// ImGui::Image(id, size, ImVec2(uv0[0], uv0[1]), ImVec2(uv1[0], uv1[1])).
 extern "C" const simgui_image_t *image_simgui_image(int index) {
-  if (index < 0 || index >= s_images.size()) {
-    slog_func("ERROR", 1, 0, "Invalid image index", __LINE__, __FILE__,
-              nullptr);
-    return 0;
-  }
-  return &s_images[index]->simguiImage_;
+  Image *image = find_image(index);
+  return image ? &image->simguiImage_ : nullptr;
+}
+/// Top-left and bottom-right texture coordinates of \p index as {u, v}; (0,
+/// 0) and (1, 1) unless it is in an atlas page. Packing moves images when a
+/// page is compacted, so read them each frame rather than keeping a copy.
+extern "C" const float *image_uv0(int index) {
+  Image *image = find_image(index);
+  return image ? &image->uv0_.x : nullptr;
+}
+extern "C" const float *image_uv1(int index) {
+  Image *image = find_image(index);
+  return image ? &image->uv1_.x : nullptr;
 }
 
 static void app_init() {
-  sg_desc desc = {.logger.func = slog_func, .context = sapp_sgcontext()};
+  // The default pools (128 images) are too small for image-heavy screens.
+  sg_desc desc = {.image_pool_size = kImagePoolSize,
+                  .logger.func = slog_func,
+                  .context = sapp_sgcontext()};
   sg_setup(&desc);
-  simgui_setup(simgui_desc_t{});
+  simgui_setup(simgui_desc_t{.image_pool_size = kImagePoolSize});
   apply_navigation_config();
   if (s_hermesApp && s_hermesApp->hermes) {
     update_navigation_state_js(*s_hermesApp->hermes);
@@ -2990,6 +5197,11 @@ static void app_init() {
       .min_filter = SG_FILTER_LINEAR,
       .mag_filter = SG_FILTER_LINEAR,
   });
+  s_mipSampler = sg_make_sampler(sg_sampler_desc{
+      .min_filter = SG_FILTER_LINEAR,
+      .mag_filter = SG_FILTER_LINEAR,
+      .mipmap_filter = SG_FILTER_LINEAR,
+  });
 
   sdtx_desc_t sdtx_desc = {.fonts = {sdtx_font_kc854()},
                            .logger.func = slog_func};
@@ -3010,36 +5222,218 @@ static void app_init() {
 }
 
 static void app_cleanup() {
+  write_trace_on_exit();
+  if (s_imageLoader) {
+    s_imageLoader->shutdown();
+  }
+  s_dynamicTextures.clear();
   s_images.clear();
+  s_atlasPages.clear();
+  s_textureCache = TextureCache(s_textureCache.maxBytes());
+  s_placeholderImage.reset();
   simgui_shutdown();
   sdtx_shutdown();
   sg_shutdown();
+  s_fetchClient.reset();
   curl_global_cleanup();
+  if (s_fsWorkers) {
+    // Finish the writes and closes the app already issued, as the
+    // microtask-based fs did; only their completions are dropped.
+    s_fsWorkers->shutdown(true);
+  }
+  s_completedFsOps.clear();
+  s_fileWatcher.reset();
+  s_fileWatchEvents.clear();
+  s_runtimeWatchHandlers.clear();
+  s_jsWatchIds.clear();
 
   delete s_hermesApp;
   s_hermesApp = nullptr;
 }
 
-static void app_event(const sapp_event *ev) {
-  if (ev->type == SAPP_EVENTTYPE_KEY_DOWN && ev->key_code == SAPP_KEYCODE_Q &&
-      (ev->modifiers & SAPP_MODIFIER_SUPER)) {
-    sapp_request_quit();
+// Input events are not passed to JS one by one. app_event() queues them in a
+// ring buffer and app_frame() hands the whole queue to JS once per frame
+// through a Float64Array that shares s_eventBatchBuffer (see
+// __dispatchNativeEvents in jslib). Consecutive mouse-move and scroll events
+// are coalesced into one entry.
+
+/// Number of Float64 slots per event in the batch, see jslib for the layout.
+static constexpr size_t kEventBatchStride = 12;
+/// Maximum number of queued events per frame. Beyond it, mouse-move and
+/// scroll entries are merged into later ones of the same type; state
+/// transitions (keys, buttons, focus) are never dropped, the queue is
+/// delivered early instead.
+static constexpr size_t kEventQueueCapacity = 256;
+
+struct QueuedEvent {
+  sapp_event event;
+  /// Number of sapp events merged into this entry.
+  int coalesced;
+};
+
+static std::array<QueuedEvent, kEventQueueCapacity> s_eventQueue;
+static size_t s_eventQueueHead = 0;
+static size_t s_eventQueueSize = 0;
+
+/// Native storage of the JS event batch (globalThis.__nativeEventBuffer).
+class EventBatchBuffer : public facebook::jsi::MutableBuffer {
+public:
+  EventBatchBuffer() : values_(kEventQueueCapacity * kEventBatchStride) {}
+
+  size_t size() const override { return values_.size() * sizeof(double); }
+  uint8_t *data() override {
+    return reinterpret_cast<uint8_t *>(values_.data());
+  }
+  double *values() { return values_.data(); }
+
+private:
+  std::vector<double> values_;
+};
+
+static std::shared_ptr<EventBatchBuffer> s_eventBatchBuffer;
+
+static void install_event_batch_buffer(facebook::jsi::Runtime &runtime) {
+  s_eventBatchBuffer = std::make_shared<EventBatchBuffer>();
+  runtime.global().setProperty(
+      runtime, "__nativeEventBuffer",
+      facebook::jsi::ArrayBuffer(runtime, s_eventBatchBuffer));
+}
+
+static void dispatch_queued_events();
+
+static QueuedEvent &queued_event(size_t index) {
+  return s_eventQueue[(s_eventQueueHead + index) % kEventQueueCapacity];
+}
+
+/// Fold the oldest mouse-move or scroll entry that has a later entry of the
+/// same type into that one. Returns false if there is none.
+static bool merge_queued_motion() {
+  for (size_t i = 0; i < s_eventQueueSize; ++i) {
+    sapp_event_type type = queued_event(i).event.type;
+    if (type != SAPP_EVENTTYPE_MOUSE_MOVE &&
+        type != SAPP_EVENTTYPE_MOUSE_SCROLL) {
+      continue;
+    }
+    for (size_t j = i + 1; j < s_eventQueueSize; ++j) {
+      QueuedEvent &later = queued_event(j);
+      if (later.event.type != type) {
+        continue;
+      }
+      const QueuedEvent &earlier = queued_event(i);
+      later.event.mouse_dx += earlier.event.mouse_dx;
+      later.event.mouse_dy += earlier.event.mouse_dy;
+      later.event.scroll_x += earlier.event.scroll_x;
+      later.event.scroll_y += earlier.event.scroll_y;
+      later.coalesced += earlier.coalesced;
+      for (size_t k = i; k + 1 < s_eventQueueSize; ++k) {
+        queued_event(k) = queued_event(k + 1);
+      }
+      --s_eventQueueSize;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void queue_event(const sapp_event &ev) {
+  if (s_eventQueueSize > 0) {
+    QueuedEvent &last =
+        s_eventQueue[(s_eventQueueHead + s_eventQueueSize - 1) %
+                     kEventQueueCapacity];
+    if (last.event.type == ev.type && last.event.modifiers == ev.modifiers) {
+      if (ev.type == SAPP_EVENTTYPE_MOUSE_MOVE) {
+        float dx = last.event.mouse_dx + ev.mouse_dx;
+        float dy = last.event.mouse_dy + ev.mouse_dy;
+        last.event = ev;
+        last.event.mouse_dx = dx;
+        last.event.mouse_dy = dy;
+        ++last.coalesced;
+        return;
+      }
+      if (ev.type == SAPP_EVENTTYPE_MOUSE_SCROLL) {
+        float sx = last.event.scroll_x + ev.scroll_x;
+        float sy = last.event.scroll_y + ev.scroll_y;
+        last.event = ev;
+        last.event.scroll_x = sx;
+        last.event.scroll_y = sy;
+        ++last.coalesced;
+        return;
+      }
+    }
+  }
+
+  if (s_eventQueueSize == kEventQueueCapacity && !merge_queued_motion()) {
+    dispatch_queued_events();
+    if (s_eventQueueSize == kEventQueueCapacity) {
+      // JS is not running yet; nothing can consume the queue, so the oldest
+      // entry goes.
+      s_eventQueueHead = (s_eventQueueHead + 1) % kEventQueueCapacity;
+      --s_eventQueueSize;
+    }
+  }
+  s_eventQueue[(s_eventQueueHead + s_eventQueueSize) % kEventQueueCapacity] = {
+      ev, 1};
+  ++s_eventQueueSize;
+}
+
+/// Deliver the queued events to JS in one call.
+static void dispatch_queued_events() {
+  if (s_eventQueueSize == 0 || !s_eventBatchBuffer || !s_hermesApp) {
     return;
   }
 
+  size_t count = s_eventQueueSize;
+  double *out = s_eventBatchBuffer->values();
+  for (size_t i = 0; i < count; ++i, out += kEventBatchStride) {
+    const QueuedEvent &queued =
+        s_eventQueue[(s_eventQueueHead + i) % kEventQueueCapacity];
+    const sapp_event &ev = queued.event;
+    out[0] = (double)ev.type;
+    out[1] = (double)ev.key_code;
+    out[2] = (double)ev.modifiers;
+    out[3] = (double)ev.char_code;
+    out[4] = (double)ev.mouse_button;
+    out[5] = ev.mouse_x;
+    out[6] = ev.mouse_y;
+    out[7] = ev.mouse_dx;
+    out[8] = ev.mouse_dy;
+    out[9] = ev.scroll_x;
+    out[10] = ev.scroll_y;
+    out[11] = (double)queued.coalesced;
+  }
+  s_eventQueueHead = 0;
+  s_eventQueueSize = 0;
+
   try {
     s_hermesApp->hermes->global()
-        .getPropertyAsFunction(*s_hermesApp->hermes, "on_event")
-        .call(*s_hermesApp->hermes, (double)ev->type, (double)ev->key_code,
-              (double)ev->modifiers);
-    // Drain microtasks after event (browser behavior)
+        .getPropertyAsFunction(*s_hermesApp->hermes, "__dispatchNativeEvents")
+        .call(*s_hermesApp->hermes, (double)count, (double)kEventBatchStride);
+    // Drain microtasks after the events (browser behavior)
     s_hermesApp->hermes->drainMicrotasks();
   } catch (facebook::jsi::JSIException &e) {
     slog_func("ERROR", 1, 0, e.what(), __LINE__, __FILE__, nullptr);
   }
+}
 
+static void app_event(const sapp_event *ev) {
+  s_activeFramesRemaining = s_idleSettleFrames;
+  // The next wait_for_frame_work() returns at once. Input that arrives while
+  // it is already waiting is only delivered once the wait ends, as sokol_app
+  // pumps events on this thread; s_idleMaxWaitMs bounds that latency.
+  request_frame();
+
+  if (ev->type == SAPP_EVENTTYPE_KEY_DOWN && ev->key_code == SAPP_KEYCODE_Q &&
+      (ev->modifiers & SAPP_MODIFIER_SUPER)) {
+    sapp_request_quit();
+    return;
+  }
+
+  queue_event(*ev);
+
+#if !IMGUI_RUNTIME_HEADLESS
   if (simgui_handle_event(ev))
     return;
+#endif
 }
 
 static float s_bg_color[4] = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -3073,17 +5467,63 @@ static void update_performance_metrics() {
   }
 }
 
+/// Phase timings of the last frame, see FrameTimings.h.
+static FramePhaseTimings s_frameTimings;
+
+const FramePhaseTimings &imgui_runtime_frame_timings() {
+  return s_frameTimings;
+}
+
 static void app_frame() {
+  {
+    TraceScope trace("idleWait", "frame");
+    wait_for_frame_work();
+  }
+
+  TraceScope frameTrace("app_frame", "frame");
+  ++s_frameNumber;
   uint64_t now = stm_now();
   double curTimeMs = stm_ms(now);
+  FramePhaseTimings timings;
+  if (s_hermesApp) {
+    s_hermesApp->timers.advance(curTimeMs);
+  }
 
+  FrameBudget budget(s_budgetStats.budgetMs);
+  if (s_hermesApp && s_hermesApp->hermes) {
+    TraceScope trace("processFetchResults", "frame");
+    processFetchResults(s_hermesApp->hermes, budget);
+  }
+  if (s_hermesApp && s_hermesApp->hermes) {
+    TraceScope trace("processFsResults", "frame");
+    processFsResults(s_hermesApp->hermes, budget);
+  }
+  if (s_hermesApp && s_hermesApp->hermes) {
+    TraceScope trace("processFileWatchEvents", "frame");
+    processFileWatchEvents(s_hermesApp->hermes, budget);
+  }
   if (s_hermesApp && s_hermesApp->hermes) {
-    processFetchResults(s_hermesApp->hermes);
+    TraceScope trace("processImageUploads", "frame");
+    processImageUploads(s_hermesApp->hermes);
+  }
+  {
+    TraceScope trace("flushDynamicTextures", "frame");
+    flush_dynamic_textures();
   }
 
-  maybe_handle_hot_reload();
-  push_window_metrics_to_js();
-  update_color_scheme_state();
+  {
+    TraceScope trace("hotReload", "frame");
+    maybe_handle_hot_reload();
+  }
+  {
+    TraceScope trace("windowMetrics", "frame");
+    push_window_metrics_to_js();
+    update_color_scheme_state();
+  }
+  {
+    TraceScope trace("events", "frame");
+    dispatch_queued_events();
+  }
 
   if (!s_started) {
     s_started = true;
@@ -3117,34 +5557,80 @@ static void app_frame() {
   // Begin and end pass
   sg_begin_default_pass(&pass_action, sapp_width(), sapp_height());
 
+  uint64_t phaseStart = stm_now();
   try {
     // Run all ready macrotasks before rendering frame
-    double nextTimeMs;
-    while ((nextTimeMs = s_hermesApp->peekMacroTask.call(*s_hermesApp->hermes)
-                             .getNumber()) >= 0 &&
-           nextTimeMs <= curTimeMs) {
-      s_hermesApp->runMacroTask.call(*s_hermesApp->hermes, curTimeMs);
-      s_hermesApp->hermes->drainMicrotasks();
+    {
+      TraceScope trace("macrotasks", "frame");
+      TimerScheduler &timers = s_hermesApp->timers;
+      TimerScheduler::TimerId timerId;
+      bool first = true;
+      while (timers.nextDeadline() >= 0 &&
+             timers.nextDeadline() <= timers.nowMs()) {
+        if (!first && !budget.hasTimeLeft()) {
+          // The remaining ready timers stay due and run next frame.
+          budget.defer();
+          break;
+        }
+        first = false;
+        if (!timers.popExpired(timerId))
+          break;
+        s_hermesApp->runTimer.call(*s_hermesApp->hermes, (double)timerId);
+        s_hermesApp->hermes->drainMicrotasks();
+      }
     }
+    budget.finish();
+    timings.macrotasksMs = stm_ms(stm_laptime(&phaseStart));
 
     // Flush RAF callbacks (also a macrotask)
-    s_hermesApp->flushRaf.call(*s_hermesApp->hermes);
+    {
+      TraceScope trace("flushRaf", "frame");
+      if (s_hermesApp->timers.hasAnimationFrames()) {
+        // Frames requested by these callbacks are deferred to the next frame.
+        std::vector<TimerScheduler::TimerId> ids =
+            s_hermesApp->timers.takeAnimationFrames();
+        facebook::jsi::Array idArray(*s_hermesApp->hermes, ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          idArray.setValueAtIndex(*s_hermesApp->hermes, i, (double)ids[i]);
+        }
+        s_hermesApp->runAnimationFrames.call(*s_hermesApp->hermes, idArray,
+                                             s_hermesApp->timers.nowMs());
+      }
+    }
+    timings.flushRafMs = stm_ms(stm_laptime(&phaseStart));
 
     // Render frame (this is also a macrotask)
-    s_hermesApp->hermes->global()
-        .getPropertyAsFunction(*s_hermesApp->hermes, "on_frame")
-        .call(*s_hermesApp->hermes, sapp_widthf(), sapp_heightf(),
-              stm_sec(stm_diff(now, s_start_time)));
+    {
+      TraceScope trace("on_frame", "frame");
+      s_hermesApp->hermes->global()
+          .getPropertyAsFunction(*s_hermesApp->hermes, "on_frame")
+          .call(*s_hermesApp->hermes, sapp_widthf(), sapp_heightf(),
+                stm_sec(stm_diff(now, s_start_time)));
+    }
 
     // Drain microtasks after frame rendering
-    s_hermesApp->hermes->drainMicrotasks();
+    {
+      TraceScope trace("drainMicrotasks", "frame");
+      s_hermesApp->hermes->drainMicrotasks();
+    }
+    timings.onFrameMs = stm_ms(stm_laptime(&phaseStart));
   } catch (facebook::jsi::JSIException &e) {
     slog_func("ERROR", 1, 0, e.what(), __LINE__, __FILE__, nullptr);
   }
 
   update_performance_metrics();
 
-  simgui_render();
+  {
+    TraceScope trace("flushTextureAtlas", "frame");
+    flush_texture_atlas();
+  }
+
+  phaseStart = stm_now();
+  {
+    TraceScope trace("simgui_render", "frame");
+    simgui_render();
+  }
+  timings.simguiRenderMs = stm_ms(stm_since(phaseStart));
 
 #if !IMGUI_RUNTIME_HIDE_PERF_OVERLAY
   sdtx_canvas((float)sapp_width(), (float)sapp_height());
@@ -3165,7 +5651,13 @@ static void app_frame() {
   sdtx_draw();
 #endif
   sg_end_pass();
-  sg_commit();
+  {
+    TraceScope trace("sg_commit", "frame");
+    sg_commit();
+  }
+
+  timings.frameMs = stm_ms(stm_since(now));
+  s_frameTimings = timings;
 }
 
 /// sapp_desc that will be populated from globalThis.sappConfig
@@ -3277,18 +5769,17 @@ static void populate_sapp_desc_from_config(facebook::hermes::HermesRuntime *herm
         auto iconStr = iconValue.asString(*hermes).utf8(*hermes);
 
         const EmbeddedImage *embedded = find_embedded_image(iconStr);
-        int width = 0;
-        int height = 0;
-        int comp = 0;
-        stbi_uc *pixels = nullptr;
+        DecodedImage icon;
+        std::string error;
+        bool loaded = false;
         std::string iconPathStr = iconStr;
 
         if (embedded) {
-          pixels = stbi_load_from_memory(embedded->data, embedded->size, &width,
-                                         &height, &comp, 4);
+          loaded = decodeStaticImage(embedded->data, embedded->size, icon,
+                                     error);
         }
 
-        if (!pixels) {
+        if (!loaded) {
           try {
             std::filesystem::path iconPath = iconStr;
             if (!iconPath.is_absolute()) {
@@ -3300,28 +5791,47 @@ static void populate_sapp_desc_from_config(facebook::hermes::HermesRuntime *herm
             if (!embedded) {
               embedded = find_embedded_image(iconPathStr);
               if (embedded) {
-                pixels = stbi_load_from_memory(embedded->data, embedded->size,
-                                               &width, &height, &comp, 4);
+                loaded = decodeStaticImage(embedded->data, embedded->size,
+                                           icon, error);
               }
             }
 
-            if (!pixels) {
-              pixels = stbi_load(iconPathStr.c_str(), &width, &height, &comp, 4);
+            if (!loaded) {
+              loaded = decodeImageFile(iconPathStr, icon, error);
             }
           } catch (const std::exception &e) {
             slog_func("ERROR", 1, 0, e.what(), __LINE__, __FILE__, nullptr);
           }
         }
 
-        if (pixels) {
-          s_windowIconPixels.assign(pixels, pixels + (width * height * 4));
-          stbi_image_free(pixels);
+        if (loaded) {
+          // Every mip level of a pre-decoded icon of at least 16x16 is
+          // offered, so the platform can pick the closest size instead of
+          // scaling the largest one.
+          std::vector<std::pair<int, int>> sizes;
+          size_t total = 0;
+          for (int i = 0; i < icon.levels && i < SAPP_MAX_ICONIMAGES; ++i) {
+            int width = rawImageLevelSize(icon.width, i);
+            int height = rawImageLevelSize(icon.height, i);
+            if (i > 0 && (width < 16 || height < 16)) {
+              break;
+            }
+            sizes.emplace_back(width, height);
+            total += (size_t)width * height * 4;
+          }
+          s_windowIconPixels.assign(icon.pixels.get(),
+                                    icon.pixels.get() + total);
 
           desc.icon = {};
-          desc.icon.images[0].width = width;
-          desc.icon.images[0].height = height;
-          desc.icon.images[0].pixels.ptr = s_windowIconPixels.data();
-          desc.icon.images[0].pixels.size = s_windowIconPixels.size();
+          size_t offset = 0;
+          for (size_t i = 0; i < sizes.size(); ++i) {
+            size_t size = (size_t)sizes[i].first * sizes[i].second * 4;
+            desc.icon.images[i].width = sizes[i].first;
+            desc.icon.images[i].height = sizes[i].second;
+            desc.icon.images[i].pixels.ptr = s_windowIconPixels.data() + offset;
+            desc.icon.images[i].pixels.size = size;
+            offset += size;
+          }
         } else {
           std::string message = "Failed to load icon: " + iconPathStr;
           slog_func("ERROR", 1, 0, message.c_str(), __LINE__, __FILE__, nullptr);
@@ -3358,6 +5868,29 @@ static void populate_sapp_desc_from_config(facebook::hermes::HermesRuntime *herm
       windowResizableValue = !nonresizeValue;
     }
 
+    // Idle rendering (not part of sapp_desc)
+    auto idleOptions = facebook::jsi::Object(*hermes);
+    if (config.hasProperty(*hermes, "idle_rendering")) {
+      idleOptions.setProperty(*hermes, "enabled",
+                              config.getProperty(*hermes, "idle_rendering"));
+    }
+    if (config.hasProperty(*hermes, "idle_max_wait_ms")) {
+      idleOptions.setProperty(*hermes, "maxWaitMs",
+                              config.getProperty(*hermes, "idle_max_wait_ms"));
+    }
+    if (config.hasProperty(*hermes, "idle_settle_frames")) {
+      idleOptions.setProperty(*hermes, "settleFrames",
+                              config.getProperty(*hermes, "idle_settle_frames"));
+    }
+    apply_idle_rendering_options(*hermes, idleOptions);
+
+    if (config.hasProperty(*hermes, "js_budget_ms")) {
+      auto value = config.getProperty(*hermes, "js_budget_ms");
+      if (value.isNumber() && std::isfinite(value.asNumber())) {
+        s_budgetStats.budgetMs = std::max(0.0, value.asNumber());
+      }
+    }
+
 #undef READ_INT_PROP
 #undef READ_BOOL_PROP
   }
@@ -3375,10 +5908,12 @@ sapp_desc sokol_main(int argc, char *argv[]) {
   // Initialize Sokol time before anything else
   stm_setup();
   s_runtimeStartMs = stm_ms(stm_now());
+  initialize_tracing();
   if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0) {
     printf("Failed to initialize libcurl\n");
     exit(1);
   }
+  s_fetchClient = std::make_unique<FetchClient>(enqueueFetchResult);
   // Enable microtask queue for Promise support
   auto runtimeConfig = ::hermes::vm::RuntimeConfig::Builder()
                            .withMicrotaskQueue(true)
@@ -3394,10 +5929,13 @@ sapp_desc sokol_main(int argc, char *argv[]) {
         hermes->evaluateSHUnit(sh_export_jslib).asObject(*hermes);
 
     // Create and initialize HermesApp
-    s_hermesApp =
-        new HermesApp(shr, helpers.getPropertyAsFunction(*hermes, "peek"),
-                      helpers.getPropertyAsFunction(*hermes, "run"),
-                      helpers.getPropertyAsFunction(*hermes, "flushRaf"));
+    s_hermesApp = new HermesApp(
+        shr, helpers.getPropertyAsFunction(*hermes, "runTimer"),
+        helpers.getPropertyAsFunction(*hermes, "runAnimationFrames"));
+    s_hermesApp->timers.advance(stm_ms(stm_now()));
+    install_timer_host_functions(*hermes);
+
+  install_event_batch_buffer(*hermes);
 
   PlatformInfo platformInfo = detect_platform_info();
   nodecompat::installNodeModules(*hermes, platformInfo);
@@ -3409,6 +5947,67 @@ sapp_desc sokol_main(int argc, char *argv[]) {
     nativeFetchStart);
   hermes->global().setProperty(*hermes, "__nativeFetch", nativeFetchFn);
 
+  const std::pair<const char *, facebook::jsi::HostFunctionType>
+      fetchControlFunctions[] = {
+          {"__nativeFetchStream", nativeFetchStream},
+          {"__nativeFetchAck", nativeFetchAck},
+          {"__nativeFetchCancel", nativeFetchCancel},
+          {"__configureFetchCache", configure_fetch_cache_host},
+          {"__fetchCacheStats", fetch_cache_stats_host},
+          {"__clearFetchCache", clear_fetch_cache_host},
+      };
+  for (const auto &[name, fn] : fetchControlFunctions) {
+    hermes->global().setProperty(
+        *hermes, name,
+        facebook::jsi::Function::createFromHostFunction(
+            *hermes, facebook::jsi::PropNameID::forAscii(*hermes, name), 2,
+            fn));
+  }
+
+  const std::pair<const char *, facebook::jsi::HostFunctionType>
+      bufferFunctions[] = {
+          {"__decodeUtf8", decode_utf8_host},
+          {"__encodeUtf8", encode_utf8_host},
+          {"__encodeUtf8Into", encode_utf8_into_host},
+          {"__isUtf8", is_utf8_host},
+          {"__isAscii", is_ascii_host},
+          {"__base64Encode", base64_encode_host},
+          {"__base64Decode", base64_decode_host},
+          {"__hexEncode", hex_encode_host},
+          {"__hexDecode", hex_decode_host},
+          {"__latin1Encode", latin1_encode_host},
+          {"__latin1Decode", latin1_decode_host},
+          {"__bufferCompare", buffer_compare_host},
+          {"__bufferIndexOf", buffer_index_of_host},
+          {"__bufferFill", buffer_fill_host},
+      };
+  for (const auto &[name, fn] : bufferFunctions) {
+    hermes->global().setProperty(
+        *hermes, name,
+        facebook::jsi::Function::createFromHostFunction(
+            *hermes, facebook::jsi::PropNameID::forAscii(*hermes, name), 3,
+            fn));
+  }
+
+  const std::pair<const char *, facebook::jsi::HostFunctionType>
+      imageFunctions[] = {
+          {"__loadImageAsync", load_image_async_host},
+          {"__imagePlaceholderTextureId", image_placeholder_texture_id_host},
+          {"__configureImageLoader", configure_image_loader_host},
+          {"__releaseTexture", release_texture_host},
+          {"__createDynamicTexture", create_dynamic_texture_host},
+          {"__updateTexture", update_texture_host},
+          {"__configureTextureCache", configure_texture_cache_host},
+          {"__textureCacheStats", texture_cache_stats_host},
+      };
+  for (const auto &[name, fn] : imageFunctions) {
+    hermes->global().setProperty(
+        *hermes, name,
+        facebook::jsi::Function::createFromHostFunction(
+            *hermes, facebook::jsi::PropNameID::forAscii(*hermes, name), 2,
+            fn));
+  }
+
   auto navConfigureFn = facebook::jsi::Function::createFromHostFunction(
       *hermes,
       facebook::jsi::PropNameID::forAscii(*hermes, "__configureImGuiNavigation"),
@@ -3416,6 +6015,40 @@ sapp_desc sokol_main(int argc, char *argv[]) {
   hermes->global().setProperty(*hermes, "__configureImGuiNavigation",
                                navConfigureFn);
 
+  auto idleConfigureFn = facebook::jsi::Function::createFromHostFunction(
+      *hermes,
+      facebook::jsi::PropNameID::forAscii(*hermes, "__configureIdleRendering"),
+      1, configure_idle_rendering_host);
+  hermes->global().setProperty(*hermes, "__configureIdleRendering",
+                               idleConfigureFn);
+
+  auto frameBudgetFn = facebook::jsi::Function::createFromHostFunction(
+      *hermes,
+      facebook::jsi::PropNameID::forAscii(*hermes, "__configureFrameBudget"),
+      1, configure_frame_budget_host);
+  hermes->global().setProperty(*hermes, "__configureFrameBudget",
+                               frameBudgetFn);
+
+  auto invalidateFrameFn = facebook::jsi::Function::createFromHostFunction(
+      *hermes, facebook::jsi::PropNameID::forAscii(*hermes, "__invalidateFrame"),
+      0, invalidate_frame_host);
+  hermes->global().setProperty(*hermes, "__invalidateFrame", invalidateFrameFn);
+
+  const std::pair<const char *, facebook::jsi::HostFunctionType>
+      traceFunctions[] = {
+          {"__traceBegin", trace_begin_host},
+          {"__traceEnd", trace_end_host},
+          {"__traceSetEnabled", trace_set_enabled_host},
+          {"__traceDump", trace_dump_host},
+      };
+  for (const auto &[name, fn] : traceFunctions) {
+    hermes->global().setProperty(
+        *hermes, name,
+        facebook::jsi::Function::createFromHostFunction(
+            *hermes, facebook::jsi::PropNameID::forAscii(*hermes, name), 2,
+            fn));
+  }
+
   auto fontConfigureFn = facebook::jsi::Function::createFromHostFunction(
     *hermes,
     facebook::jsi::PropNameID::forAscii(*hermes, "__configureImGuiFonts"), 2,
@@ -3436,10 +6069,6 @@ sapp_desc sokol_main(int argc, char *argv[]) {
     .getPropertyAsObject(*hermes, "env")
     .setProperty(*hermes, "NODE_ENV", nodeEnv);
 
-    // Initialize jslib's current time
-    double curTimeMs = stm_ms(stm_now());
-    s_hermesApp->runMacroTask.call(*s_hermesApp->hermes, curTimeMs);
-
     // Add performance.now() host function using Sokol time
     auto perf = facebook::jsi::Object(*s_hermesApp->hermes);
     perf.setProperty(
@@ -3491,6 +6120,7 @@ sapp_desc sokol_main(int argc, char *argv[]) {
   }
 
   _sh_done(shr);
+  s_fetchClient.reset();
   curl_global_cleanup();
   exit(1);
 }
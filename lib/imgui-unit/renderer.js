@@ -2862,16 +2862,51 @@ function renderInputScalar(node) {
   }
 }
 
+// The texture of an <image>/<imagebutton>: its `texture` prop, an object from
+// Textures.load() whose textureId, size and sub-rectangle (uv0/uv1, for
+// images packed into an atlas page) are read every frame so that it switches
+// from the placeholder to the image once loaded, or else `textureId`.
+function imageTexture(props, tag) {
+  if (!props || (props.texture === undefined && props.textureId === undefined)) {
+    logErrorMessage(`<${tag}> requires a texture or textureId prop.`);
+    return undefined;
+  }
+  const texture = props.texture;
+  const textureId = texture && typeof texture === "object" ? Number(texture.textureId) : Number(props.textureId);
+  if (!Number.isFinite(textureId)) {
+    logErrorMessage(`<${tag}> textureId must be a finite number. Got: ${String(props.textureId)}`);
+    return undefined;
+  }
+  const uv0 = texture && texture.uv0;
+  const uv1 = texture && texture.uv1;
+  const hasRect = !!(uv0 && uv1);
+  return {
+    textureId: textureId,
+    width: texture && typeof texture.width === "number" ? texture.width : 0,
+    height: texture && typeof texture.height === "number" ? texture.height : 0,
+    u0: hasRect ? uv0.x : 0,
+    v0: hasRect ? uv0.y : 0,
+    u1: hasRect ? uv1.x : 1,
+    v1: hasRect ? uv1.y : 1
+  };
+}
+
+// Write the uv (u, v), relative to the image, in texture coordinates.
+function setTextureUv(ptr, texture, u, v) {
+  set_ImVec2_x(ptr, texture.u0 + u * (texture.u1 - texture.u0));
+  set_ImVec2_y(ptr, texture.v0 + v * (texture.v1 - texture.v0));
+}
+
 function renderImage(node, vec2, vec4) {
   const props = node.props;
 
-  if (!props || props.textureId === undefined) {
-    logErrorMessage("<image> requires a textureId prop.");
+  const texture = imageTexture(props, "image");
+  if (!texture) {
     return;
   }
 
-  const width = validateNumber(props.width, 0, "image width");
-  const height = validateNumber(props.height, 0, "image height");
+  const width = props.width === undefined ? texture.width : validateNumber(props.width, texture.width, "image width");
+  const height = props.height === undefined ? texture.height : validateNumber(props.height, texture.height, "image height");
   set_ImVec2_x(vec2, width);
   set_ImVec2_y(vec2, height);
 
@@ -2903,23 +2938,16 @@ function renderImage(node, vec2, vec4) {
       uv1y = validateNumber(uv1ValueY, 1, "image uv1.y");
     }
   }
-  set_ImVec2_x(uv0Ptr, uv0x);
-  set_ImVec2_y(uv0Ptr, uv0y);
-  set_ImVec2_x(uv1Ptr, uv1x);
-  set_ImVec2_y(uv1Ptr, uv1y);
+  setTextureUv(uv0Ptr, texture, uv0x, uv0y);
+  setTextureUv(uv1Ptr, texture, uv1x, uv1y);
 
   const tintPtr = allocTmp(_sizeof_ImVec4);
   const borderPtr = allocTmp(_sizeof_ImVec4);
   parseColorToImVec4(tintPtr, props && props.tintColor !== undefined ? props.tintColor : { r: 255, g: 255, b: 255, a: 255 });
   parseColorToImVec4(borderPtr, props && props.borderColor !== undefined ? props.borderColor : { r: 0, g: 0, b: 0, a: 0 });
 
-  const textureId = Number(props.textureId);
-  if (!Number.isFinite(textureId)) {
-    logErrorMessage(`<image> textureId must be a finite number. Got: ${String(props.textureId)}`);
-    return;
-  }
   const texturePtr = allocTmp(SIZEOF_C_PTR);
-  _sh_ptr_write_c_ptr(texturePtr, 0, textureId);
+  _sh_ptr_write_c_ptr(texturePtr, 0, texture.textureId);
 
   _igImage(texturePtr, vec2, uv0Ptr, uv1Ptr, tintPtr, borderPtr);
 
@@ -2933,8 +2961,8 @@ function renderImage(node, vec2, vec4) {
 function renderImageButton(node, vec2, vec4) {
   const props = node.props;
 
-  if (!props || props.textureId === undefined) {
-    logErrorMessage("<imagebutton> requires a textureId prop.");
+  const texture = imageTexture(props, "imagebutton");
+  if (!texture) {
     return;
   }
   if (!props.id) {
@@ -2942,8 +2970,8 @@ function renderImageButton(node, vec2, vec4) {
     return;
   }
 
-  const width = validateNumber(props.width, 0, "imagebutton width");
-  const height = validateNumber(props.height, 0, "imagebutton height");
+  const width = props.width === undefined ? texture.width : validateNumber(props.width, texture.width, "imagebutton width");
+  const height = props.height === undefined ? texture.height : validateNumber(props.height, texture.height, "imagebutton height");
   set_ImVec2_x(vec2, width);
   set_ImVec2_y(vec2, height);
 
@@ -2975,23 +3003,16 @@ function renderImageButton(node, vec2, vec4) {
       uv1y = validateNumber(uv1ValueY, 1, "imagebutton uv1.y");
     }
   }
-  set_ImVec2_x(uv0Ptr, uv0x);
-  set_ImVec2_y(uv0Ptr, uv0y);
-  set_ImVec2_x(uv1Ptr, uv1x);
-  set_ImVec2_y(uv1Ptr, uv1y);
+  setTextureUv(uv0Ptr, texture, uv0x, uv0y);
+  setTextureUv(uv1Ptr, texture, uv1x, uv1y);
 
   const bgPtr = allocTmp(_sizeof_ImVec4);
   const tintPtr = allocTmp(_sizeof_ImVec4);
   parseColorToImVec4(bgPtr, props && props.backgroundColor !== undefined ? props.backgroundColor : { r: 0, g: 0, b: 0, a: 0 });
   parseColorToImVec4(tintPtr, props && props.tintColor !== undefined ? props.tintColor : { r: 255, g: 255, b: 255, a: 255 });
 
-  const textureId = Number(props.textureId);
-  if (!Number.isFinite(textureId)) {
-    logErrorMessage(`<imagebutton> textureId must be a finite number. Got: ${String(props.textureId)}`);
-    return;
-  }
   const texturePtr = allocTmp(SIZEOF_C_PTR);
-  _sh_ptr_write_c_ptr(texturePtr, 0, textureId);
+  _sh_ptr_write_c_ptr(texturePtr, 0, texture.textureId);
 
   const pressed = _igImageButton(tmpUtf8(String(props.id)), texturePtr, vec2, uv0Ptr, uv1Ptr, bgPtr, tintPtr) !== 0;
   if (pressed && props && props.onClick) {
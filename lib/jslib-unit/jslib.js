@@ -137,6 +137,9 @@
         if (lowered === 'base64') {
             return 'base64';
         }
+        if (lowered === 'base64url') {
+            return 'base64url';
+        }
         if (lowered === 'hex') {
             return 'hex';
         }
@@ -664,6 +667,17 @@
         return native;
     }
 
+    // Callbacks of fs operations running on the native worker pool, keyed by
+    // request id; settled by __onNativeFsComplete.
+    const sFsPending = new Map();
+    // fs.watch/fs.watchFile listeners, keyed by native watch id; called by
+    // __onNativeFsWatch with (eventType, filename).
+    const sFsWatchers = new Map();
+    // watchFile listeners keyed by path. Instead of polling every
+    // `interval` ms like Node, the file is stat'ed when the native
+    // watcher reports a change; listeners run if its mtime or size moved.
+    const sStatWatchers = new Map();
+
     function toBuffer(data, encoding, BufferClass) {
         if (BufferClass.isBuffer && BufferClass.isBuffer(data)) {
             return data;
@@ -731,53 +745,122 @@
         const { Buffer: BufferClass } = require('buffer');
         const pathModule = require('path');
 
-        function readFileSync(pathLike, options) {
-            const { encoding } = normalizeFileEncoding(options, null);
-            const encodingToUse = encoding === 'utf8' ? 'utf8' : 'base64';
-            const result = native.readFile(String(pathLike), encodingToUse);
+        // Runs the native `asyncName` operation on the fs worker pool and
+        // passes its result through `transform`. Runtimes without the async
+        // host functions run `fallback` in a microtask instead.
+        function runFsOperation(asyncName, nativeArgs, fallback, transform, callback) {
+            if (typeof callback !== 'function') {
+                throw new TypeError('Callback must be a function');
+            }
+            const start = native[asyncName];
+            if (typeof start !== 'function') {
+                scheduleMicrotask(() => {
+                    let result;
+                    try {
+                        result = fallback();
+                    } catch (error) {
+                        callback(error);
+                        return;
+                    }
+                    callback(null, result);
+                });
+                return;
+            }
+            let id;
+            try {
+                id = start(...nativeArgs);
+            } catch (error) {
+                scheduleMicrotask(() => callback(error));
+                return;
+            }
+            const settle = (error, value) => {
+                if (error) {
+                    callback(error);
+                    return;
+                }
+                let result;
+                try {
+                    result = transform ? transform(value) : undefined;
+                } catch (transformError) {
+                    callback(transformError);
+                    return;
+                }
+                callback(null, result);
+            };
+            // ArrayBuffers in nativeArgs are read or filled by a worker
+            // thread; keep them reachable until the operation completes.
+            settle.retained = nativeArgs;
+            sFsPending.set(id, settle);
+        }
+
+        // Binary reads come back as an ArrayBuffer over the native buffer;
+        // the Buffer is a view of it, not a copy. With { map: true } large
+        // files are mapped instead of read, which is only safe for files no
+        // other process truncates or rewrites while the Buffer is in use.
+        function nativeReadEncoding(encoding, options) {
+            if (encoding === 'utf8') {
+                return 'utf8';
+            }
+            return options && typeof options === 'object' && options.map === true
+                ? 'mapped'
+                : 'buffer';
+        }
+
+        function decodeFileContents(result, encoding) {
             if (encoding === 'utf8') {
                 return result;
             }
-            const buffer = BufferClass.from(result, 'base64');
+            const buffer = result instanceof ArrayBuffer
+                ? BufferClass.from(result)
+                : BufferClass.from(result, 'base64');
             if (!encoding) {
                 return buffer;
             }
             return buffer.toString(encoding);
         }
 
+        function readFileSync(pathLike, options) {
+            const { encoding } = normalizeFileEncoding(options, null);
+            return decodeFileContents(
+                native.readFile(String(pathLike), nativeReadEncoding(encoding, options)),
+                encoding);
+        }
+
         function readFile(pathLike, options, callback) {
             if (typeof options === 'function') {
                 callback = options;
                 options = undefined;
             }
-            if (typeof callback !== 'function') {
-                throw new TypeError('Callback must be a function');
-            }
-            const opts = options;
-            scheduleMicrotask(() => {
-                try {
-                    const result = readFileSync(pathLike, opts);
-                    callback(null, result);
-                } catch (error) {
-                    callback(error);
-                }
-            });
+            const { encoding } = normalizeFileEncoding(options, null);
+            runFsOperation('readFileAsync', [String(pathLike), nativeReadEncoding(encoding, options)],
+                () => readFileSync(pathLike, options),
+                (result) => decodeFileContents(result, encoding),
+                callback);
         }
 
-        function writeFileSync(pathLike, data, options) {
+        // Arguments for native.writeFile/writeFileAsync. UTF-8 strings are
+        // passed as they are; everything else as a byte range of its
+        // ArrayBuffer, so binary data is never base64-encoded on the way.
+        function writeFileArgs(pathLike, data, options) {
             const isBinaryInput = (BufferClass.isBuffer && BufferClass.isBuffer(data)) || data instanceof Uint8Array;
             const { encoding } = normalizeFileEncoding(options, isBinaryInput ? null : 'utf8');
-            const buffer = toBuffer(data, encoding, BufferClass);
-            const encodingToUse = !encoding ? 'base64' : (encoding === 'utf8' ? 'utf8' : 'base64');
-            const payload = encodingToUse === 'utf8'
-                ? buffer.toString('utf8')
-                : buffer.toString('base64');
             const append = options && typeof options === 'object' && options.flag && String(options.flag).startsWith('a');
-            const nativeOptions = { encoding: encodingToUse };
+            const nativeOptions = {};
             if (append) {
                 nativeOptions.append = true;
             }
-            native.writeFile(String(pathLike), payload, nativeOptions);
+            if (typeof data === 'string' && encoding === 'utf8') {
+                nativeOptions.encoding = 'utf8';
+                return [String(pathLike), data, nativeOptions];
+            }
+            const buffer = toBuffer(data, encoding, BufferClass);
+            nativeOptions.byteOffset = buffer.byteOffset;
+            nativeOptions.byteLength = buffer.byteLength;
+            return [String(pathLike), buffer.buffer, nativeOptions];
+        }
+
+        function writeFileSync(pathLike, data, options) {
+            native.writeFile(...writeFileArgs(pathLike, data, options));
         }
 
         function writeFile(pathLike, data, options, callback) {
@@ -788,14 +871,15 @@
             if (typeof callback !== 'function') {
                 throw new TypeError('Callback must be a function');
             }
-            scheduleMicrotask(() => {
-                try {
-                    writeFileSync(pathLike, data, options);
-                    callback(null);
-                } catch (error) {
-                    callback(error);
-                }
-            });
+            let nativeArgs;
+            try {
+                nativeArgs = writeFileArgs(pathLike, data, options);
+            } catch (error) {
+                scheduleMicrotask(() => callback(error));
+                return;
+            }
+            runFsOperation('writeFileAsync', nativeArgs,
+                () => native.writeFile(...nativeArgs), null, callback);
         }
 
         function existsSync(pathLike) {
@@ -818,26 +902,142 @@
             return stat;
         }
 
-        function readdirSync(pathLike, options) {
-            const { encoding } = normalizeFileEncoding(options, 'utf8');
-            const entries = native.readdir(String(pathLike));
+        function encodeDirEntries(entries, encoding) {
             if (encoding && encoding !== 'utf8') {
                 return entries.map((item) => BufferClass.from(item, 'utf8').toString(encoding));
             }
             return entries;
         }
 
-        function mkdirSync(pathLike, options) {
+        // Entry types as reported by native.stat and native.scanDirectory.
+        const kTypeFile = 1;
+        const kTypeDirectory = 2;
+        const kTypeSymlink = 3;
+
+        class Dirent {
+            constructor(name, parentPath, type) {
+                this.name = name;
+                this.parentPath = parentPath;
+                this.path = parentPath;
+                this._type = type;
+            }
+
+            isFile() { return this._type === kTypeFile; }
+            isDirectory() { return this._type === kTypeDirectory; }
+            isSymbolicLink() { return this._type === kTypeSymlink; }
+            isBlockDevice() { return false; }
+            isCharacterDevice() { return false; }
+            isFIFO() { return false; }
+            isSocket() { return false; }
+        }
+
+        // A directory tree listed by native.scanDirectory, one column per
+        // field. Entry i lives in the directory of entry parents[i] (-1 for
+        // the root), which always comes before it.
+        class DirectoryScan {
+            constructor(root, result) {
+                this.root = root;
+                this.count = result.count;
+                this.names = result.count > 0 ? result.names.split('\0') : [];
+                this.parents = new Int32Array(result.parents);
+                this.types = new Uint8Array(result.types);
+                this.sizes = new Float64Array(result.sizes);
+                this.mtimes = new Float64Array(result.mtimes);
+            }
+
+            // '/'-separated paths relative to the root, in entry order.
+            relativePaths() {
+                const paths = new Array(this.count);
+                for (let i = 0; i < this.count; i++) {
+                    const parent = this.parents[i];
+                    paths[i] = parent < 0 ? this.names[i] : `${paths[parent]}/${this.names[i]}`;
+                }
+                return paths;
+            }
+
+            dirent(index, relativePaths) {
+                const parent = this.parents[index];
+                const parentPath = parent < 0
+                    ? this.root
+                    : joinScanPath(this.root, relativePaths[parent]);
+                return new Dirent(this.names[index], parentPath, this.types[index]);
+            }
+        }
+
+        function joinScanPath(root, relative) {
+            return root.endsWith('/') ? root + relative : `${root}/${relative}`;
+        }
+
+        function scanOptions(options) {
+            const opts = { recursive: false, stat: true, parallel: false };
+            if (options && typeof options === 'object') {
+                opts.recursive = !!options.recursive;
+                opts.stat = options.stat !== false;
+                opts.parallel = !!options.parallel;
+            }
+            return opts;
+        }
+
+        function scanDirectorySync(pathLike, options) {
+            const root = String(pathLike);
+            return new DirectoryScan(root, native.scanDirectory(root, scanOptions(options)));
+        }
+
+        function scanDirectory(pathLike, options, callback) {
+            if (typeof options === 'function') {
+                callback = options;
+                options = undefined;
+            }
+            const root = String(pathLike);
+            runFsOperation('scanDirectoryAsync', [root, scanOptions(options)],
+                () => scanDirectorySync(pathLike, options),
+                (result) => new DirectoryScan(root, result),
+                callback);
+        }
+
+        // withFileTypes and recursive listings come from one scan of the tree;
+        // types are read from the directory entries, so nothing is stat'ed.
+        function usesDirectoryScan(options) {
+            return !!options && typeof options === 'object' &&
+                (!!options.withFileTypes || !!options.recursive);
+        }
+
+        function readdirScanOptions(options) {
+            return { recursive: !!options.recursive, stat: false, parallel: !!options.recursive };
+        }
+
+        function scanToDirEntries(scan, options, encoding) {
+            const paths = options.recursive ? scan.relativePaths() : scan.names;
+            if (!options.withFileTypes) {
+                return encodeDirEntries(paths, encoding);
+            }
+            const entries = new Array(scan.count);
+            for (let i = 0; i < scan.count; i++) {
+                entries[i] = scan.dirent(i, paths);
+            }
+            return entries;
+        }
+
+        function readdirSync(pathLike, options) {
+            const { encoding } = normalizeFileEncoding(options, 'utf8');
+            if (usesDirectoryScan(options)) {
+                return scanToDirEntries(
+                    scanDirectorySync(pathLike, readdirScanOptions(options)), options, encoding);
+            }
+            return encodeDirEntries(native.readdir(String(pathLike)), encoding);
+        }
+
+        function mkdirOptions(options) {
             const opts = {};
             if (options && typeof options === 'object') {
                 if (options.recursive) {
                     opts.recursive = true;
                 }
             }
-            native.mkdir(String(pathLike), opts);
+            return opts;
         }
 
-        function rmSync(pathLike, options) {
+        function rmOptions(options) {
             const opts = {};
             if (options && typeof options === 'object') {
                 if (options.recursive) {
@@ -847,7 +1047,15 @@
                     opts.force = true;
                 }
             }
-            native.rm(String(pathLike), opts);
+            return opts;
+        }
+
+        function mkdirSync(pathLike, options) {
+            native.mkdir(String(pathLike), mkdirOptions(options));
+        }
+
+        function rmSync(pathLike, options) {
+            native.rm(String(pathLike), rmOptions(options));
         }
 
         function realpathSync(pathLike) {
@@ -859,17 +1067,8 @@
                 callback = options;
                 options = undefined;
             }
-            if (typeof callback !== 'function') {
-                throw new TypeError('Callback must be a function');
-            }
-            scheduleMicrotask(() => {
-                try {
-                    mkdirSync(pathLike, options);
-                    callback(null);
-                } catch (error) {
-                    callback(error);
-                }
-            });
+            runFsOperation('mkdirAsync', [String(pathLike), mkdirOptions(options)],
+                () => mkdirSync(pathLike, options), null, callback);
         }
 
         function rm(pathLike, options, callback) {
@@ -877,17 +1076,8 @@
                 callback = options;
                 options = undefined;
             }
-            if (typeof callback !== 'function') {
-                throw new TypeError('Callback must be a function');
-            }
-            scheduleMicrotask(() => {
-                try {
-                    rmSync(pathLike, options);
-                    callback(null);
-                } catch (error) {
-                    callback(error);
-                }
-            });
+            runFsOperation('rmAsync', [String(pathLike), rmOptions(options)],
+                () => rmSync(pathLike, options), null, callback);
         }
 
         function readdir(pathLike, options, callback) {
@@ -895,20 +1085,24 @@
                 callback = options;
                 options = undefined;
             }
-            if (typeof callback !== 'function') {
-                throw new TypeError('Callback must be a function');
+            const { encoding } = normalizeFileEncoding(options, 'utf8');
+            if (usesDirectoryScan(options)) {
+                const root = String(pathLike);
+                runFsOperation('scanDirectoryAsync', [root, readdirScanOptions(options)],
+                    () => readdirSync(pathLike, options),
+                    (result) => scanToDirEntries(new DirectoryScan(root, result), options, encoding),
+                    callback);
+                return;
             }
-            scheduleMicrotask(() => {
-                try {
-                    const result = readdirSync(pathLike, options);
-                    callback(null, result);
-                } catch (error) {
-                    callback(error);
-                }
-            });
+            runFsOperation('readdirAsync', [String(pathLike)],
+                () => readdirSync(pathLike, options),
+                (entries) => encodeDirEntries(entries, encoding),
+                callback);
         }
 
-        function stat(pathLike, options, callback) {
+        // Shared by stat and lstat: a missing entry fails with ENOENT unless
+        // throwIfNoEntry is false.
+        function statAsync(pathLike, options, callback, followSymbolicLinks, fallback) {
             if (typeof options === 'function') {
                 callback = options;
                 options = undefined;
@@ -916,128 +1110,785 @@
             if (typeof callback !== 'function') {
                 throw new TypeError('Callback must be a function');
             }
-            scheduleMicrotask(() => {
-                try {
-                    const result = statSync(pathLike, options);
-                    callback(null, result);
-                } catch (error) {
-                    callback(error);
-                }
-            });
+            const allowMissing = !!options && options.throwIfNoEntry === false;
+            runFsOperation('statAsync', [String(pathLike), { followSymbolicLinks }],
+                () => fallback(pathLike, options),
+                (result) => result,
+                (error, result) => {
+                    if (error && allowMissing && error.code === 'ENOENT') {
+                        callback(null, undefined);
+                        return;
+                    }
+                    callback(error, result);
+                });
+        }
+
+        function stat(pathLike, options, callback) {
+            statAsync(pathLike, options, callback, true, statSync);
         }
 
         function lstat(pathLike, options, callback) {
-            if (typeof options === 'function') {
-                callback = options;
-                options = undefined;
+            statAsync(pathLike, options, callback, false, lstatSync);
+        }
+
+        // File descriptors. Buffers go to the host as their ArrayBuffer and a
+        // byte range, so reads land directly in the caller's memory.
+        function ensureFdSupport(name) {
+            if (typeof native.open !== 'function') {
+                throw new Error(`fs.${name} is not supported on this platform`);
+            }
+        }
+
+        function openArgs(pathLike, flags, mode) {
+            return [
+                String(pathLike),
+                flags === undefined || flags === null ? 'r' : flags,
+                mode === undefined || mode === null ? 0o666 : mode,
+            ];
+        }
+
+        // [arrayBuffer, byteOffset, length, position] for the host; position
+        // -1 uses (and advances) the current file position.
+        function fdRange(buffer, offset, length, position) {
+            if (!ArrayBuffer.isView(buffer)) {
+                throw new TypeError('The "buffer" argument must be a Buffer, TypedArray or DataView');
+            }
+            if (offset !== null && typeof offset === 'object') {
+                ({ offset, length, position } = offset);
+            }
+            offset = offset === undefined || offset === null ? 0 : Number(offset);
+            length = length === undefined || length === null ? buffer.byteLength - offset : Number(length);
+            if (!(offset >= 0) || !(length >= 0) || offset + length > buffer.byteLength) {
+                throw new RangeError('The value of "offset" or "length" is out of range');
+            }
+            if (typeof position === 'bigint') {
+                position = Number(position);
+            }
+            return [
+                buffer.buffer,
+                buffer.byteOffset + offset,
+                length,
+                typeof position === 'number' && position >= 0 ? position : -1,
+            ];
+        }
+
+        // write(fd, buffer[, offset[, length[, position]]]) or
+        // write(fd, string[, position[, encoding]]).
+        function writeArgs(fd, data, offset, length, position) {
+            if (typeof data === 'string') {
+                const encoding = normalizeEncodingValue(typeof length === 'string' ? length : null, 'utf8');
+                const buffer = BufferClass.from(data, encoding);
+                return [fd, ...fdRange(buffer, 0, buffer.length, offset)];
             }
+            return [fd, ...fdRange(data, offset, length, position)];
+        }
+
+        function splitCallback(args) {
+            const callback = args.pop();
             if (typeof callback !== 'function') {
                 throw new TypeError('Callback must be a function');
             }
-            scheduleMicrotask(() => {
-                try {
-                    const result = lstatSync(pathLike, options);
-                    callback(null, result);
-                } catch (error) {
-                    callback(error);
-                }
-            });
+            return callback;
         }
 
-        const promises = {
-            readFile: (...args) => promiseFromCallback(readFile, args),
-            writeFile: (...args) => promiseFromCallback(writeFile, args),
-            mkdir: (...args) => promiseFromCallback(mkdir, args),
-            rm: (...args) => promiseFromCallback(rm, args),
-            readdir: (...args) => promiseFromCallback(readdir, args),
-            stat: (...args) => promiseFromCallback(stat, args),
-            lstat: (...args) => promiseFromCallback(lstat, args),
-            realpath: (pathLike) => Promise.resolve().then(() => realpathSync(pathLike)),
-            exists: (pathLike) => Promise.resolve().then(() => existsSync(pathLike)),
-        };
+        function openSync(pathLike, flags, mode) {
+            ensureFdSupport('open');
+            return native.open(...openArgs(pathLike, flags, mode));
+        }
 
-        function createReadStream(pathLike, options = {}) {
-            const { Readable } = require('stream');
-            const encoding = options.encoding ? normalizeEncodingValue(options.encoding, 'utf8') : null;
-            const readable = new Readable({ read() {} });
-            scheduleMicrotask(() => {
-                try {
-                    const content = readFileSync(pathLike, encoding || undefined);
-                    if (encoding) {
-                        readable.push(content, encoding);
-                    } else {
-                        readable.push(content);
-                    }
-                    readable.push(null);
-                } catch (error) {
-                    readable.destroy(error);
-                }
-            });
-            return readable;
+        function open(pathLike, ...rest) {
+            const callback = splitCallback(rest);
+            ensureFdSupport('open');
+            const nativeArgs = openArgs(pathLike, rest[0], rest[1]);
+            runFsOperation('openAsync', nativeArgs,
+                () => native.open(...nativeArgs), (fd) => fd, callback);
         }
 
-        function createWriteStream(pathLike, options = {}) {
-            const { Writable } = require('stream');
-            const encoding = options.encoding ? normalizeEncodingValue(options.encoding, 'utf8') : 'utf8';
-            let append = false;
-            if (options.flags && options.flags.startsWith('a')) {
-                append = true;
+        function readSync(fd, buffer, offset, length, position) {
+            ensureFdSupport('read');
+            return native.read(fd, ...fdRange(buffer, offset, length, position));
+        }
+
+        function read(fd, buffer, ...rest) {
+            const callback = splitCallback(rest);
+            ensureFdSupport('read');
+            let nativeArgs;
+            try {
+                nativeArgs = [fd, ...fdRange(buffer, rest[0], rest[1], rest[2])];
+            } catch (error) {
+                scheduleMicrotask(() => callback(error));
+                return;
             }
-            const writable = new Writable({
-                write(chunk, enc, callback) {
-                    try {
-                        const resolvedEncoding = typeof chunk === 'string' ? (encoding || enc || 'utf8') : undefined;
-                        writeFileSync(pathLike, chunk, { encoding: resolvedEncoding, flag: append ? 'a' : 'w', append: append });
-                        append = true;
-                        callback();
-                    } catch (error) {
-                        callback(error);
-                    }
-                },
-            });
-            return writable;
+            runFsOperation('readAsync', nativeArgs,
+                () => native.read(...nativeArgs), (bytesRead) => bytesRead,
+                (error, bytesRead) => callback(error, bytesRead, buffer));
         }
 
-        const fsModule = {
-            readFileSync,
-            readFile,
-            writeFileSync,
-            writeFile,
-            existsSync,
-            statSync,
-            lstatSync,
-            readdirSync,
-            readdir,
-            mkdirSync,
-            mkdir,
-            rmSync,
-            rm,
-            realpathSync,
-            stat,
-            lstat,
-            promises,
-            createReadStream,
-            createWriteStream,
-            constants: {
-                F_OK: 0,
-                R_OK: 4,
-                W_OK: 2,
-                X_OK: 1,
-            },
-        };
+        function writeSync(fd, data, offset, length, position) {
+            ensureFdSupport('write');
+            return native.write(...writeArgs(fd, data, offset, length, position));
+        }
 
-        module.exports = fsModule;
-    });
+        function write(fd, data, ...rest) {
+            const callback = splitCallback(rest);
+            ensureFdSupport('write');
+            let nativeArgs;
+            try {
+                nativeArgs = writeArgs(fd, data, rest[0], rest[1], rest[2]);
+            } catch (error) {
+                scheduleMicrotask(() => callback(error));
+                return;
+            }
+            runFsOperation('writeAsync', nativeArgs,
+                () => native.write(...nativeArgs), (written) => written,
+                (error, written) => callback(error, written, data));
+        }
 
-    defineNodeModule(['fs/promises', 'node:fs/promises'], (module, exports, require) => {
-        const fs = require('fs');
-        module.exports = fs.promises;
-    });
+        function closeSync(fd) {
+            ensureFdSupport('close');
+            native.close(fd);
+        }
 
-    function createEventEmitter() {
-        return class EventEmitter {
-            constructor() {
-                this._events = Object.create(null);
+        function close(fd, callback) {
+            if (callback === undefined) {
+                callback = () => {};
+            }
+            ensureFdSupport('close');
+            runFsOperation('closeAsync', [fd], () => native.close(fd), null, callback);
+        }
+
+        function fstatSync(fd) {
+            ensureFdSupport('fstat');
+            return native.fstat(fd);
+        }
+
+        function fstat(fd, ...rest) {
+            const callback = splitCallback(rest);
+            ensureFdSupport('fstat');
+            runFsOperation('fstatAsync', [fd], () => native.fstat(fd), (result) => result, callback);
+        }
+
+        const promisify = (fn) => (...args) => promiseFromCallback(fn, args);
+        const readAsync = (fd, buffer, offset, length, position) => new Promise((resolve, reject) => {
+            read(fd, buffer, offset, length, position, (error, bytesRead) => {
+                if (error) {
+                    reject(error);
+                } else {
+                    resolve({ bytesRead, buffer });
+                }
+            });
+        });
+        const writeAsync = (fd, data, offset, length, position) => new Promise((resolve, reject) => {
+            write(fd, data, offset, length, position, (error, bytesWritten) => {
+                if (error) {
+                    reject(error);
+                } else {
+                    resolve({ bytesWritten, buffer: data });
+                }
+            });
+        });
+
+        // fs.promises.open() result, a thin wrapper over the descriptor.
+        // Operations still queued on the fs workers hold the descriptor open:
+        // close() waits for them, since a closed descriptor number may be
+        // reused by the next open() before they run.
+        class FileHandle {
+            constructor(fd) {
+                this.fd = fd;
+                this._pending = 0;
+                this._onIdle = null;
+                this._closing = null;
+            }
+
+            _checkOpen() {
+                if (this.fd < 0) {
+                    const error = new Error('file closed');
+                    error.code = 'EBADF';
+                    throw error;
+                }
+            }
+
+            async _run(operation) {
+                this._checkOpen();
+                this._pending++;
+                try {
+                    return await operation(this.fd);
+                } finally {
+                    if (--this._pending === 0 && this._onIdle) {
+                        const onIdle = this._onIdle;
+                        this._onIdle = null;
+                        onIdle();
+                    }
+                }
+            }
+
+            async read(buffer, offset, length, position) {
+                if (buffer === undefined || (buffer !== null && !ArrayBuffer.isView(buffer) && typeof buffer === 'object')) {
+                    const options = buffer || {};
+                    buffer = options.buffer || BufferClass.alloc(16384);
+                    return this._run((fd) => readAsync(fd, buffer, options));
+                }
+                return this._run((fd) => readAsync(fd, buffer, offset, length, position));
+            }
+
+            async write(data, offset, length, position) {
+                return this._run((fd) => writeAsync(fd, data, offset, length, position));
+            }
+
+            async readFile(options) {
+                const { encoding } = normalizeFileEncoding(options, null);
+                return this._run(async (fd) => {
+                    const chunks = [];
+                    let total = 0;
+                    for (;;) {
+                        const chunk = BufferClass.allocUnsafe(kFileChunkSize);
+                        const { bytesRead } = await readAsync(fd, chunk, 0, chunk.length, null);
+                        if (bytesRead === 0) {
+                            break;
+                        }
+                        chunks.push(bytesRead < chunk.length ? chunk.subarray(0, bytesRead) : chunk);
+                        total += bytesRead;
+                    }
+                    const buffer = BufferClass.concat(chunks, total);
+                    return encoding ? buffer.toString(encoding) : buffer;
+                });
+            }
+
+            async writeFile(data, options) {
+                const isBinaryInput = ArrayBuffer.isView(data);
+                const { encoding } = normalizeFileEncoding(options, isBinaryInput ? null : 'utf8');
+                await this._run((fd) => writeAsync(fd, toBuffer(data, encoding, BufferClass), 0, undefined, null));
+            }
+
+            async appendFile(data, options) {
+                return this.writeFile(data, options);
+            }
+
+            async stat() {
+                return this._run((fd) => promisify(fstat)(fd));
+            }
+
+            createReadStream(options = {}) {
+                return createReadStream(null, Object.assign({}, options, { fd: this }));
+            }
+
+            createWriteStream(options = {}) {
+                return createWriteStream(null, Object.assign({}, options, { fd: this }));
+            }
+
+            close() {
+                if (this._closing) {
+                    return this._closing;
+                }
+                if (this.fd < 0) {
+                    return Promise.resolve();
+                }
+                const fd = this.fd;
+                // New operations fail with EBADF from here on.
+                this.fd = -1;
+                const idle = this._pending === 0
+                    ? Promise.resolve()
+                    : new Promise((resolve) => { this._onIdle = resolve; });
+                this._closing = idle.then(() => promisify(close)(fd));
+                return this._closing;
+            }
+        }
+
+        // Events arrive from a native watcher (inotify on Linux), coalesced
+        // over this many milliseconds.
+        const kWatchDebounceMs = 50;
+
+        function ensureWatchSupport(name) {
+            if (typeof native.watch !== 'function') {
+                throw new Error(`fs.${name} is not supported by this runtime`);
+            }
+        }
+
+        class FSWatcher extends BaseEventEmitter {
+            constructor(id, encoding) {
+                super();
+                this._id = id;
+                sFsWatchers.set(id, (eventType, filename) => {
+                    this.emit('change', eventType,
+                        encoding === 'buffer' ? BufferClass.from(filename, 'utf8') : filename);
+                });
+            }
+
+            close() {
+                if (this._id === null) {
+                    return;
+                }
+                native.unwatch(this._id);
+                sFsWatchers.delete(this._id);
+                this._id = null;
+                this.emit('close');
+            }
+
+            ref() {
+                return this;
+            }
+
+            unref() {
+                return this;
+            }
+        }
+
+        function watch(filename, options, listener) {
+            if (typeof options === 'function') {
+                listener = options;
+                options = undefined;
+            }
+            if (typeof options === 'string') {
+                options = { encoding: options };
+            }
+            options = options || {};
+            ensureWatchSupport('watch');
+            const id = native.watch(String(filename), {
+                recursive: !!options.recursive,
+                debounceMs: kWatchDebounceMs,
+            });
+            const watcher = new FSWatcher(id, options.encoding);
+            if (typeof listener === 'function') {
+                watcher.on('change', listener);
+            }
+            return watcher;
+        }
+
+        // Stats of a missing file, as passed to watchFile listeners.
+        function missingStats() {
+            return {
+                size: 0,
+                mtimeMs: 0,
+                ctimeMs: 0,
+                mode: 0,
+                exists: false,
+                type: 0,
+                isFile: () => false,
+                isDirectory: () => false,
+                isSymbolicLink: () => false,
+            };
+        }
+
+        function watchFile(filename, options, listener) {
+            if (typeof options === 'function') {
+                listener = options;
+                options = undefined;
+            }
+            if (typeof listener !== 'function') {
+                throw new TypeError('"listener" must be a function');
+            }
+            ensureWatchSupport('watchFile');
+            const key = String(filename);
+            let entry = sStatWatchers.get(key);
+            if (!entry) {
+                entry = { listeners: [], previous: null, watcher: new BaseEventEmitter() };
+                entry.watcher.ref = () => entry.watcher;
+                entry.watcher.unref = () => entry.watcher;
+                entry.id = native.watch(key, { debounceMs: kWatchDebounceMs, mustExist: false });
+                const current = (callback) => stat(key, { throwIfNoEntry: false }, (error, stats) => {
+                    callback(error || !stats ? missingStats() : stats);
+                });
+                current((stats) => {
+                    if (!entry.previous) {
+                        entry.previous = stats;
+                    }
+                });
+                sFsWatchers.set(entry.id, () => {
+                    current((stats) => {
+                        const previous = entry.previous || missingStats();
+                        if (stats.exists === previous.exists && stats.mtimeMs === previous.mtimeMs &&
+                            stats.size === previous.size) {
+                            return;
+                        }
+                        entry.previous = stats;
+                        for (const fn of entry.listeners.slice()) {
+                            fn(stats, previous);
+                        }
+                        entry.watcher.emit('change', stats, previous);
+                    });
+                });
+                sStatWatchers.set(key, entry);
+            }
+            entry.listeners.push(listener);
+            return entry.watcher;
+        }
+
+        function unwatchFile(filename, listener) {
+            const key = String(filename);
+            const entry = sStatWatchers.get(key);
+            if (!entry) {
+                return;
+            }
+            entry.listeners = typeof listener === 'function'
+                ? entry.listeners.filter((fn) => fn !== listener)
+                : [];
+            if (entry.listeners.length === 0) {
+                native.unwatch(entry.id);
+                sFsWatchers.delete(entry.id);
+                sStatWatchers.delete(key);
+            }
+        }
+
+        const promises = {
+            open: async (pathLike, flags, mode) => new FileHandle(await promisify(open)(pathLike, flags, mode)),
+            readFile: (...args) => promiseFromCallback(readFile, args),
+            writeFile: (...args) => promiseFromCallback(writeFile, args),
+            mkdir: (...args) => promiseFromCallback(mkdir, args),
+            rm: (...args) => promiseFromCallback(rm, args),
+            readdir: (...args) => promiseFromCallback(readdir, args),
+            scanDirectory: (...args) => promiseFromCallback(scanDirectory, args),
+            stat: (...args) => promiseFromCallback(stat, args),
+            lstat: (...args) => promiseFromCallback(lstat, args),
+            realpath: (pathLike) => Promise.resolve().then(() => realpathSync(pathLike)),
+            exists: (pathLike) => Promise.resolve().then(() => existsSync(pathLike)),
+        };
+
+        // Chunk size of file streams and FileHandle.readFile.
+        const kFileChunkSize = 64 * 1024;
+
+        let fileStreamClasses = null;
+
+        // ReadStream/WriteStream are built on first use, once the stream
+        // module is available.
+        function getFileStreamClasses() {
+            if (fileStreamClasses) {
+                return fileStreamClasses;
+            }
+            const { Readable, Writable } = require('stream');
+
+            // Streams take a path or an `fd` option (a number or FileHandle);
+            // a descriptor they opened themselves is closed at the end.
+            function streamDescriptor(stream, pathLike, options, defaultFlags, onReady) {
+                stream.path = pathLike;
+                stream.fd = null;
+                stream._autoClose = options.autoClose !== false;
+                stream._handle = null;
+                const given = options.fd;
+                if (given !== undefined && given !== null) {
+                    if (typeof given === 'object') {
+                        stream._handle = given;
+                        stream.fd = given.fd;
+                    } else {
+                        stream.fd = given;
+                    }
+                    scheduleMicrotask(onReady);
+                    return;
+                }
+                open(pathLike, options.flags || defaultFlags, options.mode, (error, fd) => {
+                    if (error) {
+                        stream.destroy(error);
+                        return;
+                    }
+                    if (stream.destroyed) {
+                        close(fd);
+                        return;
+                    }
+                    stream.fd = fd;
+                    stream.emit('open', fd);
+                    stream.emit('ready');
+                    onReady();
+                });
+            }
+
+            function releaseDescriptor(stream) {
+                const fd = stream.fd;
+                if (fd === null || !stream._autoClose) {
+                    return;
+                }
+                stream.fd = null;
+                const onClosed = (error) => {
+                    if (error) {
+                        stream.emit('error', error);
+                    }
+                };
+                if (stream._handle) {
+                    stream._handle.close().then(() => onClosed(null), onClosed);
+                } else {
+                    close(fd, onClosed);
+                }
+            }
+
+            // Transfers through the FileHandle when the stream was given one,
+            // so that closing the handle waits for them.
+            function streamTransfer(stream, isRead, buffer, length, position, callback) {
+                if (stream._handle) {
+                    const handle = stream._handle;
+                    const pending = isRead
+                        ? handle.read(buffer, 0, length, position)
+                        : handle.write(buffer, 0, length, position);
+                    pending.then(
+                        (result) => callback(null, isRead ? result.bytesRead : result.bytesWritten),
+                        (error) => callback(error));
+                    return;
+                }
+                (isRead ? read : write)(stream.fd, buffer, 0, length, position, callback);
+            }
+
+            // Reads one chunk of at most highWaterMark bytes per request, from
+            // `start` through `end` (inclusive). While 'data' listeners are
+            // attached and the stream is not paused, the next chunk is
+            // requested as soon as the previous one is delivered.
+            class ReadStream extends Readable {
+                constructor(pathLike, options) {
+                    super({ highWaterMark: options.highWaterMark || kFileChunkSize });
+                    if (options.encoding) {
+                        this.setEncoding(options.encoding);
+                    }
+                    this.start = options.start;
+                    this.end = options.end === undefined ? Infinity : options.end;
+                    this.pos = options.start;
+                    this.bytesRead = 0;
+                    this.destroyed = false;
+                    this._reading = false;
+                    this._paused = false;
+                    this._read = () => this._readChunk();
+                    streamDescriptor(this, pathLike, options, 'r', () => this._readChunk());
+                }
+
+                _flowing() {
+                    const listeners = this._events.data;
+                    return !this._paused && !!listeners && listeners.length > 0;
+                }
+
+                _readChunk() {
+                    if (this._reading || this.fd === null || this.destroyed || this.readableEnded) {
+                        return;
+                    }
+                    const offset = this.pos === undefined ? this.bytesRead : this.pos - this.start;
+                    const remaining = this.end - (this.start || 0) + 1 - offset;
+                    const size = Math.min(this.readableHighWaterMark, remaining);
+                    if (!(size > 0)) {
+                        this._finish();
+                        return;
+                    }
+                    const chunk = BufferClass.allocUnsafe(size);
+                    this._reading = true;
+                    streamTransfer(this, true, chunk, size, this.pos === undefined ? null : this.pos, (error, bytesRead) => {
+                        this._reading = false;
+                        if (this.destroyed) {
+                            releaseDescriptor(this);
+                            return;
+                        }
+                        if (error) {
+                            this.destroy(error);
+                            return;
+                        }
+                        if (bytesRead === 0) {
+                            this._finish();
+                            return;
+                        }
+                        if (this.pos !== undefined) {
+                            this.pos += bytesRead;
+                        }
+                        this.bytesRead += bytesRead;
+                        this.push(bytesRead < size ? chunk.subarray(0, bytesRead) : chunk);
+                        if (this._flowing()) {
+                            this._readChunk();
+                        }
+                    });
+                }
+
+                _finish() {
+                    releaseDescriptor(this);
+                    this.push(null);
+                }
+
+                pause() {
+                    this._paused = true;
+                    return super.pause();
+                }
+
+                resume() {
+                    this._paused = false;
+                    return super.resume();
+                }
+
+                destroy(error) {
+                    if (this.destroyed) {
+                        return this;
+                    }
+                    this.destroyed = true;
+                    if (!this._reading) {
+                        releaseDescriptor(this);
+                    }
+                    return super.destroy(error);
+                }
+            }
+
+            // Writes chunks in order, one at a time, at `start` and onwards
+            // (or at the end of the file for append flags). 'finish' is
+            // emitted once everything written before end() is on disk.
+            class WriteStream extends Writable {
+                constructor(pathLike, options) {
+                    super({ highWaterMark: options.highWaterMark });
+                    this._encoding = normalizeEncodingValue(options.encoding, 'utf8');
+                    this.start = options.start;
+                    this.pos = options.start;
+                    this.bytesWritten = 0;
+                    this.destroyed = false;
+                    this._queue = [];
+                    this._writing = false;
+                    this._ending = null;
+                    this._writeImpl = (chunk, encoding, callback) => {
+                        const buffer = typeof chunk === 'string'
+                            ? BufferClass.from(chunk, normalizeEncodingValue(encoding, this._encoding))
+                            : toBuffer(chunk, null, BufferClass);
+                        this._queue.push({ buffer, callback });
+                        this._flush();
+                    };
+                    streamDescriptor(this, pathLike, options, 'w', () => this._flush());
+                }
+
+                _flush() {
+                    if (this._writing || this.fd === null || this.destroyed) {
+                        return;
+                    }
+                    const entry = this._queue.shift();
+                    if (!entry) {
+                        if (this._ending) {
+                            this._finishWrites();
+                        }
+                        return;
+                    }
+                    this._writing = true;
+                    streamTransfer(this, false, entry.buffer, entry.buffer.length, this.pos === undefined ? null : this.pos, (error, written) => {
+                        this._writing = false;
+                        if (this.destroyed) {
+                            releaseDescriptor(this);
+                            return;
+                        }
+                        if (error) {
+                            entry.callback(error);
+                            this.destroy(error);
+                            return;
+                        }
+                        if (this.pos !== undefined) {
+                            this.pos += written;
+                        }
+                        this.bytesWritten += written;
+                        entry.callback();
+                        this._flush();
+                    });
+                }
+
+                _finishWrites() {
+                    const callback = this._ending;
+                    this._ending = null;
+                    releaseDescriptor(this);
+                    this.writableFinished = true;
+                    this.emit('finish');
+                    if (typeof callback === 'function') {
+                        callback();
+                    }
+                    this.emit('close');
+                }
+
+                end(chunk, encoding, callback) {
+                    if (typeof chunk === 'function') {
+                        callback = chunk;
+                        chunk = undefined;
+                    } else if (typeof encoding === 'function') {
+                        callback = encoding;
+                        encoding = undefined;
+                    }
+                    if (chunk !== undefined && chunk !== null) {
+                        this.write(chunk, encoding);
+                    }
+                    this.writable = false;
+                    this._ending = callback || true;
+                    this._flush();
+                    return this;
+                }
+
+                destroy(error) {
+                    if (this.destroyed) {
+                        return this;
+                    }
+                    this.destroyed = true;
+                    this._queue.length = 0;
+                    if (!this._writing) {
+                        releaseDescriptor(this);
+                    }
+                    return super.destroy(error);
+                }
+            }
+
+            fileStreamClasses = { ReadStream, WriteStream };
+            return fileStreamClasses;
+        }
+
+        function createReadStream(pathLike, options) {
+            if (typeof options === 'string') {
+                options = { encoding: options };
+            }
+            const { ReadStream } = getFileStreamClasses();
+            return new ReadStream(pathLike, options || {});
+        }
+
+        function createWriteStream(pathLike, options) {
+            if (typeof options === 'string') {
+                options = { encoding: options };
+            }
+            const { WriteStream } = getFileStreamClasses();
+            return new WriteStream(pathLike, options || {});
+        }
+
+        const fsModule = {
+            readFileSync,
+            readFile,
+            writeFileSync,
+            writeFile,
+            existsSync,
+            statSync,
+            lstatSync,
+            readdirSync,
+            readdir,
+            scanDirectorySync,
+            scanDirectory,
+            Dirent,
+            mkdirSync,
+            mkdir,
+            rmSync,
+            rm,
+            realpathSync,
+            stat,
+            lstat,
+            promises,
+            createReadStream,
+            createWriteStream,
+            openSync,
+            open,
+            readSync,
+            read,
+            writeSync,
+            write,
+            closeSync,
+            close,
+            fstatSync,
+            fstat,
+            watch,
+            watchFile,
+            unwatchFile,
+            constants: {
+                F_OK: 0,
+                R_OK: 4,
+                W_OK: 2,
+                X_OK: 1,
+            },
+        };
+
+        module.exports = fsModule;
+    });
+
+    defineNodeModule(['fs/promises', 'node:fs/promises'], (module, exports, require) => {
+        const fs = require('fs');
+        module.exports = fs.promises;
+    });
+
+    function createEventEmitter() {
+        return class EventEmitter {
+            constructor() {
+                this._events = Object.create(null);
             }
 
             on(event, listener) {
@@ -1104,10 +1955,16 @@
 
         class Stream extends BaseEventEmitter {
             pipe(destination, options = {}) {
+                let waitingForDrain = false;
                 this.on('data', (chunk) => {
                     const writable = destination.write(chunk);
-                    if (writable === false) {
-                        this.pause?.();
+                    if (writable === false && !waitingForDrain && this.pause) {
+                        waitingForDrain = true;
+                        this.pause();
+                        destination.once('drain', () => {
+                            waitingForDrain = false;
+                            this.resume?.();
+                        });
                     }
                 });
                 this.once('end', () => {
@@ -1161,8 +2018,13 @@
                         chunk = chunk.toString(this._encoding);
                     }
                 }
-                this._buffer.push(chunk);
-                this.emit('data', chunk);
+                // Chunks delivered to 'data' listeners are not kept for read().
+                const listeners = this._events.data;
+                if (listeners && listeners.length > 0) {
+                    this.emit('data', chunk);
+                } else {
+                    this._buffer.push(chunk);
+                }
                 return this._buffer.length < this.readableHighWaterMark;
             }
 
@@ -1207,6 +2069,9 @@
                     if (immediate !== null && immediate !== undefined) {
                         return { value: immediate, done: false };
                     }
+                    if (source.readableEnded) {
+                        return { value: undefined, done: true };
+                    }
                     return new Promise((resolve, reject) => {
                         let settled = false;
                         const onData = (chunk) => {
@@ -1319,6 +2184,11 @@
             _initWritable(options = {}) {
                 this.writable = true;
                 this.writableFinished = false;
+                this.writableHighWaterMark = options.highWaterMark || 16384;
+                // Bytes (objects in object mode) passed to write() whose
+                // callback has not run yet.
+                this.writableLength = 0;
+                this._needDrain = false;
                 this._writeImpl = options.write || null;
                 this._objectModeWritable = !!options.objectMode;
             }
@@ -1334,16 +2204,39 @@
                 if (!this._objectModeWritable && typeof data === 'string' && enc) {
                     data = BufferClass.from(data, normalizeEncodingValue(enc, 'utf8'));
                 }
+                const size = this._objectModeWritable
+                    ? 1
+                    : (data && (data.byteLength !== undefined ? data.byteLength : data.length)) || 0;
+                this.writableLength += size;
+                let completed = false;
+                const done = (error) => {
+                    if (completed) {
+                        return;
+                    }
+                    completed = true;
+                    this.writableLength -= size;
+                    cb?.(error);
+                    if (this._needDrain && this.writableLength === 0) {
+                        this._needDrain = false;
+                        this.emit('drain');
+                    }
+                };
                 try {
                     if (this._writeImpl) {
-                        this._writeImpl(data, enc || 'utf8', cb || (() => {}));
+                        this._writeImpl(data, enc || 'utf8', done);
                     } else {
                         this.emit('data', data);
-                        cb?.();
+                        done();
                     }
                 } catch (error) {
                     this.emit('error', error);
-                    cb?.(error);
+                    done(error);
+                    return false;
+                }
+                // Like Node, ask the producer to wait for 'drain' once the
+                // queued data reaches the high water mark.
+                if (this.writableLength >= this.writableHighWaterMark) {
+                    this._needDrain = true;
                     return false;
                 }
                 return true;
@@ -1509,49 +2402,86 @@
 (function () {
   'use strict';
 
-  var tasks = [];
-  var nextTaskID = 0;
-  var curTime = 0;
-  var intervals = {}; // Map of interval IDs to their state
+  // Timers and animation frames are scheduled natively (see TimerScheduler in
+  // imgui-runtime); only the callbacks live here, keyed by the native id. The
+  // host functions are installed after this unit is evaluated, so they are
+  // looked up on first use.
+  var timerCallbacks = new Map(); // id -> { fn, args, repeat }
+  var rafCallbacks = new Map(); // id -> callback
+
+  function nativeTimerFunction(name) {
+    var fn = globalThis[name];
+    if (typeof fn !== 'function') {
+      throw new Error(name + ' is not available');
+    }
+    return fn;
+  }
+
+  var timerSchedule = function (delay, interval) {
+    timerSchedule = nativeTimerFunction('__timerSchedule');
+    return timerSchedule(delay, interval);
+  };
+  var timerCancel = function (id) {
+    timerCancel = nativeTimerFunction('__timerCancel');
+    return timerCancel(id);
+  };
+  var rafRequest = function () {
+    rafRequest = nativeTimerFunction('__rafRequest');
+    return rafRequest();
+  };
+  var rafCancel = function (id) {
+    rafCancel = nativeTimerFunction('__rafCancel');
+    return rafCancel(id);
+  };
 
-  // Return the deadline of the next task, or -1 if there is no task.
-  function peekMacroTask() {
-    return tasks.length ? tasks[0].deadline : -1;
+  function reportCallbackError(e) {
+    try {
+      if (
+        globalThis &&
+        globalThis.console &&
+        typeof globalThis.console.error === 'function'
+      ) {
+        globalThis.console.error(e);
+      } else if (typeof print === 'function') {
+        print('ERROR:', String(e && e.message ? e.message : e));
+      }
+    } catch (_) {}
   }
 
-  // Run the next task if it's time.
-  // `tm` is the current time in milliseconds.
-  function runMacroTask(tm) {
-    curTime = tm;
-    if (tasks.length && tasks[0].deadline <= tm) {
-      var task = tasks.shift();
-      task.fn.apply(undefined, task.args);
+  // Called by the host for every due timer. Interval timers stay registered
+  // until cleared; the native side has already rescheduled them.
+  function runTimer(id) {
+    var timer = timerCallbacks.get(id);
+    if (!timer) {
+      return;
     }
+    if (!timer.repeat) {
+      timerCallbacks.delete(id);
+    }
+    timer.fn.apply(undefined, timer.args);
   }
 
-  function setTimeout(fn, ms = 0, ...args) {
-    var id = nextTaskID++;
-    var task = { id, fn, deadline: curTime + Math.max(0, ms | 0), args };
-    // Insert the task in the sorted list.
-    var i = 0;
-    for (i = 0; i < tasks.length; ++i) {
-      if (tasks[i].deadline > task.deadline) {
-        break;
-      }
-    }
-    tasks.splice(i, 0, task);
+  function addTimer(fn, ms, args, repeat) {
+    var delay = Math.max(0, ms | 0);
+    var id = timerSchedule(delay, repeat ? Math.max(1, delay) : 0);
+    timerCallbacks.set(id, { fn, args, repeat });
     return id;
   }
 
-  function clearTimeout(id) {
-    for (var i = 0; i < tasks.length; i++) {
-      if (tasks[i].id === id) {
-        tasks.splice(i, 1);
-        break;
-      }
+  function removeTimer(id) {
+    if (timerCallbacks.delete(id)) {
+      timerCancel(id);
     }
   }
 
+  function setTimeout(fn, ms = 0, ...args) {
+    return addTimer(fn, ms, args, false);
+  }
+
+  function clearTimeout(id) {
+    removeTimer(id);
+  }
+
   function setImmediate(fn, ...args) {
     return setTimeout(fn, 0, ...args);
   }
@@ -1560,89 +2490,41 @@
   }
 
   function setInterval(fn, ms = 0, ...args) {
-    var id = nextTaskID++;
-    intervals[id] = {
-      fn: fn,
-      ms: ms,
-      args: args,
-      timeoutId: null,
-    };
-
-    function repeat() {
-      // Check if interval was cleared
-      if (!intervals[id]) {
-        return;
-      }
-
-      // Call the function
-      fn.apply(undefined, args);
-
-      // Schedule next execution
-      if (intervals[id]) {
-        intervals[id].timeoutId = setTimeout(repeat, ms);
-      }
-    }
-
-    // Start the interval
-    intervals[id].timeoutId = setTimeout(repeat, ms);
-    return id;
+    return addTimer(fn, ms, args, true);
   }
 
   function clearInterval(id) {
-    if (intervals[id]) {
-      if (intervals[id].timeoutId !== null) {
-        clearTimeout(intervals[id].timeoutId);
-      }
-      delete intervals[id];
-    }
+    removeTimer(id);
   }
 
-  // requestAnimationFrame polyfill that adapts to the host's tick rate.
-  // We batch callbacks and flush them on the next macro task, so the
-  // frequency naturally follows the platform refresh cadence (e.g., 60/90/120Hz)
-  // if the host drives the event loop once per frame.
-  var rafQueue = {};
-  var rafNextId = 1;
-
-  function flushRaf() {
-    // Take a snapshot of callbacks and clear the queue so rAFs scheduled
-    // inside a callback run on the next tick (matching browser semantics).
-    var cbs = [];
-    for (var id in rafQueue) {
-      if (Object.prototype.hasOwnProperty.call(rafQueue, id)) {
-        cbs.push(rafQueue[id]);
-        delete rafQueue[id];
+  // requestAnimationFrame callbacks run once per rendered frame, so the
+  // frequency follows the platform refresh cadence (e.g., 60/90/120Hz).
+  // The host passes the ids taken for this frame; rAFs requested inside a
+  // callback run on the next frame (matching browser semantics).
+  function runAnimationFrames(ids, ts) {
+    for (var i = 0; i < ids.length; i++) {
+      var cb = rafCallbacks.get(ids[i]);
+      if (cb === undefined) {
+        continue;
       }
-    }
-    var ts = curTime;
-    for (var i = 0; i < cbs.length; i++) {
+      rafCallbacks.delete(ids[i]);
       try {
-        cbs[i](ts);
+        cb(ts);
       } catch (e) {
-        try {
-          if (
-            globalThis &&
-            globalThis.console &&
-            typeof globalThis.console.error === 'function'
-          ) {
-            globalThis.console.error(e);
-          } else if (typeof print === 'function') {
-            print('ERROR:', String(e && e.message ? e.message : e));
-          }
-        } catch (_) {}
+        reportCallbackError(e);
       }
     }
   }
 
   function requestAnimationFrame(callback) {
-    var id = rafNextId++;
-    rafQueue[id] = callback;
+    var id = rafRequest();
+    rafCallbacks.set(id, callback);
     return id;
   }
 
   function cancelAnimationFrame(id) {
-    if (rafQueue[id]) {
-      delete rafQueue[id];
+    if (rafCallbacks.delete(id)) {
+      rafCancel(id);
     }
   }
 
@@ -1718,6 +2600,41 @@
     },
   };
 
+    // Native input events are queued by the host and delivered once per frame
+    // as a batch in the shared globalThis.__nativeEventBuffer. Each event takes
+    // `stride` Float64 slots: [type, key_code, modifiers, char_code,
+    // mouse_button, mouse_x, mouse_y, mouse_dx, mouse_dy, scroll_x, scroll_y,
+    // coalesced]. Consecutive mouse moves and scrolls arrive already merged
+    // (deltas summed, `coalesced` counts the merged events).
+    //
+    // Apps can handle the whole batch by defining globalThis.on_events(view,
+    // count, stride); otherwise on_event(type, key_code, modifiers) is called
+    // for each event.
+    let nativeEventView = null;
+    globalThis.__dispatchNativeEvents = function(count, stride) {
+        if (!nativeEventView || nativeEventView.buffer !== globalThis.__nativeEventBuffer) {
+            nativeEventView = new Float64Array(globalThis.__nativeEventBuffer);
+        }
+        if (typeof globalThis.on_events === 'function') {
+            globalThis.on_events(nativeEventView, count, stride);
+            return;
+        }
+        const onEvent = globalThis.on_event;
+        if (typeof onEvent !== 'function') {
+            return;
+        }
+        for (let i = 0; i < count; i++) {
+            const base = i * stride;
+            try {
+                onEvent(nativeEventView[base], nativeEventView[base + 1], nativeEventView[base + 2]);
+            } catch (error) {
+                if (globalThis.console && typeof globalThis.console.error === 'function') {
+                    globalThis.console.error('on_event error', error);
+                }
+            }
+        }
+    };
+
     const sFetchPending = new Map();
     function isFiniteNumber(value) {
         return typeof value === 'number' && isFinite(value);
@@ -1920,111 +2837,293 @@
         for (let i = 0; i < BASE64_TABLE.length; i++) {
             table[BASE64_TABLE.charCodeAt(i)] = i;
         }
+        table['-'.charCodeAt(0)] = 62;
+        table['_'.charCodeAt(0)] = 63;
         return table;
     })();
 
-    const textDecoder = (typeof TextDecoder === 'function') ? new TextDecoder('utf-8') : null;
-    const textEncoder = (typeof TextEncoder === 'function') ? new TextEncoder() : null;
+    // TextEncoder/TextDecoder for hosts without them (Hermes has neither).
+    // Transcoding runs natively through __encodeUtf8/__decodeUtf8, which
+    // validate with SIMD and hand ASCII to the engine without conversion; the
+    // loops below only run where the host does not provide them.
+    const UTF8_LABELS = ['utf-8', 'utf8', 'unicode-1-1-utf-8', 'unicode11utf8', 'unicode20utf8', 'x-unicode20utf8'];
 
-    function encodeUtf8String(value) {
-        if (!value || typeof value !== 'string') {
-            return new Uint8Array(0);
+    function utf8SequenceLength(lead) {
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            return 2;
         }
-        if (textEncoder) {
-            return textEncoder.encode(value);
+        if (lead >= 0xE0 && lead <= 0xEF) {
+            return 3;
         }
-        const encoded = unescape(encodeURIComponent(value));
-        const result = new Uint8Array(encoded.length);
-        for (let i = 0; i < encoded.length; i++) {
-            result[i] = encoded.charCodeAt(i) & 0xff;
+        if (lead >= 0xF0 && lead <= 0xF4) {
+            return 4;
         }
-        return result;
+        return 1;
     }
 
-    function decodeUtf8(bytes) {
-        if (!bytes || bytes.length === 0) {
+    // Number of trailing bytes that start a character the chunk cuts off,
+    // which a streaming TextDecoder holds back for the next call.
+    function utf8IncompleteTail(bytes) {
+        const length = bytes.length;
+        for (let back = 1; back <= 3 && back <= length; back++) {
+            const byte = bytes[length - back];
+            if ((byte & 0xC0) !== 0x80) {
+                return utf8SequenceLength(byte) > back ? back : 0;
+            }
+        }
+        return 0;
+    }
+
+    // Stores code point `code` at `target[index]`; returns the byte count.
+    function writeUtf8CodePoint(target, index, code) {
+        if (code < 0x80) {
+            target[index] = code;
+            return 1;
+        }
+        if (code < 0x800) {
+            target[index] = 0xC0 | (code >> 6);
+            target[index + 1] = 0x80 | (code & 0x3F);
+            return 2;
+        }
+        if (code < 0x10000) {
+            target[index] = 0xE0 | (code >> 12);
+            target[index + 1] = 0x80 | ((code >> 6) & 0x3F);
+            target[index + 2] = 0x80 | (code & 0x3F);
+            return 3;
+        }
+        target[index] = 0xF0 | (code >> 18);
+        target[index + 1] = 0x80 | ((code >> 12) & 0x3F);
+        target[index + 2] = 0x80 | ((code >> 6) & 0x3F);
+        target[index + 3] = 0x80 | (code & 0x3F);
+        return 4;
+    }
+
+    // The code point at `value[index]`, with lone surrogates as U+FFFD.
+    function wellFormedCodePointAt(value, index) {
+        const code = value.codePointAt(index);
+        return code >= 0xD800 && code <= 0xDFFF ? 0xFFFD : code;
+    }
+
+    function encodeUtf8Into(value, target) {
+        if (typeof globalThis.__encodeUtf8Into === 'function' && target.buffer instanceof ArrayBuffer) {
+            return globalThis.__encodeUtf8Into(value, target.buffer, target.byteOffset, target.byteLength);
+        }
+        let read = 0;
+        let written = 0;
+        while (read < value.length) {
+            const code = wellFormedCodePointAt(value, read);
+            const size = code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+            if (written + size > target.length) {
+                break;
+            }
+            written += writeUtf8CodePoint(target, written, code);
+            read += code > 0xFFFF ? 2 : 1;
+        }
+        return { read, written };
+    }
+
+    // Decodes `bytes` with one U+FFFD per maximal ill-formed subsequence, as
+    // the WHATWG decoder does, or returns undefined for ill-formed input when
+    // `fatal` is set.
+    function decodeUtf8Bytes(bytes, fatal) {
+        if (bytes.length === 0) {
             return '';
         }
-        if (textDecoder) {
-            return textDecoder.decode(bytes);
+        if (typeof globalThis.__decodeUtf8 === 'function' && bytes.buffer instanceof ArrayBuffer) {
+            return globalThis.__decodeUtf8(bytes.buffer, bytes.byteOffset, bytes.byteLength, !!fatal);
         }
         let out = '';
         let i = 0;
         while (i < bytes.length) {
-            let c = bytes[i++];
-            if (c < 0x80) {
-                out += String.fromCharCode(c);
+            const lead = bytes[i++];
+            if (lead < 0x80) {
+                out += String.fromCharCode(lead);
                 continue;
             }
-            if ((c & 0xe0) === 0xc0) {
-                const c2 = bytes[i++] & 0x3f;
-                const code = ((c & 0x1f) << 6) | c2;
-                out += String.fromCharCode(code);
+            const needed = utf8SequenceLength(lead) - 1;
+            let lower = lead === 0xE0 ? 0xA0 : lead === 0xF0 ? 0x90 : 0x80;
+            let upper = lead === 0xED ? 0x9F : lead === 0xF4 ? 0x8F : 0xBF;
+            let code = lead & (0x3F >> needed);
+            let seen = 0;
+            while (seen < needed && i < bytes.length && bytes[i] >= lower && bytes[i] <= upper) {
+                code = (code << 6) | (bytes[i++] & 0x3F);
+                lower = 0x80;
+                upper = 0xBF;
+                seen++;
+            }
+            if (needed === 0 || seen < needed) {
+                if (fatal) {
+                    return undefined;
+                }
+                out += '\uFFFD';
                 continue;
             }
-            if ((c & 0xf0) === 0xe0) {
-                const c2 = bytes[i++] & 0x3f;
-                const c3 = bytes[i++] & 0x3f;
-                const code = ((c & 0x0f) << 12) | (c2 << 6) | c3;
-                out += String.fromCharCode(code);
-                continue;
+            out += String.fromCodePoint(code);
+        }
+        return out;
+    }
+
+    function decoderInputBytes(input) {
+        if (input === undefined) {
+            return new Uint8Array(0);
+        }
+        if (input instanceof ArrayBuffer) {
+            return new Uint8Array(input);
+        }
+        if (ArrayBuffer.isView(input)) {
+            return new Uint8Array(input.buffer, input.byteOffset, input.byteLength);
+        }
+        throw new TypeError('The "input" argument must be an ArrayBuffer or ArrayBufferView');
+    }
+
+    class TextEncoderPolyfill {
+        get encoding() {
+            return 'utf-8';
+        }
+
+        encode(input) {
+            const value = input === undefined ? '' : String(input);
+            if (value.length === 0) {
+                return new Uint8Array(0);
             }
-            if ((c & 0xf8) === 0xf0) {
-                const c2 = bytes[i++] & 0x3f;
-                const c3 = bytes[i++] & 0x3f;
-                const c4 = bytes[i++] & 0x3f;
-                let code = ((c & 0x07) << 18) | (c2 << 12) | (c3 << 6) | c4;
-                if (code > 0xFFFF) {
-                    code -= 0x10000;
-                    out += String.fromCharCode(0xD800 + ((code >> 10) & 0x3FF));
-                    out += String.fromCharCode(0xDC00 + (code & 0x3FF));
-                } else {
-                    out += String.fromCharCode(code);
+            if (typeof globalThis.__encodeUtf8 === 'function') {
+                return new Uint8Array(globalThis.__encodeUtf8(value));
+            }
+            const result = new Uint8Array(value.length * 3);
+            return result.slice(0, encodeUtf8Into(value, result).written);
+        }
+
+        encodeInto(source, destination) {
+            if (!(destination instanceof Uint8Array)) {
+                throw new TypeError('The "destination" argument must be a Uint8Array');
+            }
+            return encodeUtf8Into(String(source), destination);
+        }
+    }
+
+    class TextDecoderPolyfill {
+        constructor(label, options) {
+            const normalized = label === undefined ? 'utf-8' : String(label).trim().toLowerCase();
+            if (UTF8_LABELS.indexOf(normalized) < 0) {
+                throw new RangeError(`The "${label}" encoding is not supported`);
+            }
+            const opts = options || {};
+            this._fatal = !!opts.fatal;
+            this._ignoreBOM = !!opts.ignoreBOM;
+            // Bytes of a character split across decode({ stream: true }) calls.
+            this._pending = null;
+            this._started = false;
+        }
+
+        get encoding() {
+            return 'utf-8';
+        }
+
+        get fatal() {
+            return this._fatal;
+        }
+
+        get ignoreBOM() {
+            return this._ignoreBOM;
+        }
+
+        decode(input, options) {
+            const stream = !!(options && options.stream);
+            let bytes = decoderInputBytes(input);
+            if (this._pending) {
+                const joined = new Uint8Array(this._pending.length + bytes.length);
+                joined.set(this._pending);
+                joined.set(bytes, this._pending.length);
+                bytes = joined;
+                this._pending = null;
+            }
+            if (stream) {
+                const tail = utf8IncompleteTail(bytes);
+                if (tail > 0) {
+                    this._pending = bytes.slice(bytes.length - tail);
+                    bytes = bytes.subarray(0, bytes.length - tail);
                 }
-                continue;
             }
-            out += '?';
+            if (!this._started && bytes.length > 0) {
+                this._started = true;
+                if (!this._ignoreBOM && bytes.length >= 3 &&
+                    bytes[0] === 0xEF && bytes[1] === 0xBB && bytes[2] === 0xBF) {
+                    bytes = bytes.subarray(3);
+                }
+            }
+            if (!stream) {
+                this._started = false;
+            }
+            const text = decodeUtf8Bytes(bytes, this._fatal);
+            if (text === undefined) {
+                this._pending = null;
+                this._started = false;
+                throw new TypeError('The encoded data was not valid for encoding utf-8');
+            }
+            return text;
         }
-        return out;
     }
 
+    if (typeof globalThis.TextEncoder !== 'function') {
+        globalThis.TextEncoder = TextEncoderPolyfill;
+    }
+    if (typeof globalThis.TextDecoder !== 'function') {
+        globalThis.TextDecoder = TextDecoderPolyfill;
+    }
+
+    const textDecoder = new TextDecoder('utf-8');
+    const textEncoder = new TextEncoder();
+
+    function encodeUtf8String(value) {
+        if (!value || typeof value !== 'string') {
+            return new Uint8Array(0);
+        }
+        return textEncoder.encode(value);
+    }
+
+    // Buffer semantics: no BOM stripping, U+FFFD for ill-formed input.
+    function decodeUtf8(bytes) {
+        if (!bytes || bytes.length === 0) {
+            return '';
+        }
+        return decodeUtf8Bytes(bytes, false);
+    }
+
+    // Base64 goes through the native codec (__base64Encode/__base64Decode),
+    // which converts whole blocks with SIMD; the loops below only run where
+    // the host does not provide it.
     function decodeBase64ToUint8Array(base64) {
         if (!base64) {
             return new Uint8Array(0);
         }
-        const clean = base64.replace(/[^A-Za-z0-9+/=]/g, '');
-        let padding = 0;
-        if (clean.endsWith('==')) {
-            padding = 2;
-        } else if (clean.endsWith('=')) {
-            padding = 1;
+        if (typeof globalThis.__base64Decode === 'function') {
+            return new Uint8Array(globalThis.__base64Decode(base64));
         }
-        const byteLength = ((clean.length * 3) >> 2) - padding;
+        const end = base64.indexOf('=');
+        const clean = (end < 0 ? base64 : base64.slice(0, end)).replace(/[^A-Za-z0-9+/\-_]/g, '');
+        const byteLength = (clean.length * 3) >> 2;
         const output = new Uint8Array(byteLength);
         let buffer = 0;
         let bits = 0;
         let index = 0;
         for (let i = 0; i < clean.length; i++) {
-            const code = base64Lookup[clean.charCodeAt(i) & 0xff];
-            if (code === -1) {
-                continue;
-            }
-            buffer = (buffer << 6) | code;
+            buffer = ((buffer << 6) | base64Lookup[clean.charCodeAt(i)]) & 0xffffff;
             bits += 6;
             if (bits >= 8) {
                 bits -= 8;
-                if (index < byteLength) {
-                    output[index++] = (buffer >> bits) & 0xff;
-                }
+                output[index++] = (buffer >> bits) & 0xff;
             }
         }
         return output;
     }
 
-    function encodeUint8ArrayToBase64(bytes) {
+    function encodeUint8ArrayToBase64(bytes, url) {
         if (!bytes || bytes.length === 0) {
             return '';
         }
+        if (typeof globalThis.__base64Encode === 'function' && bytes.buffer instanceof ArrayBuffer) {
+            return globalThis.__base64Encode(bytes.buffer, bytes.byteOffset, bytes.byteLength, !!url);
+        }
         let result = '';
         let i = 0;
         while (i + 2 < bytes.length) {
@@ -2046,20 +3145,57 @@
             result += remaining === 2 ? BASE64_TABLE[(triple >> 6) & 0x3f] : '=';
             result += '=';
         }
+        if (url) {
+            return result.replace(/\+/g, '-').replace(/\//g, '_').replace(/=+$/, '');
+        }
         return result;
     }
 
     defineNodeModule(['buffer', 'node:buffer'], (module, exports, require) => {
+        // Searching, comparing, filling and the hex/latin1 conversions run
+        // natively over the ArrayBuffer memory (__bufferIndexOf,
+        // __bufferCompare, __bufferFill, __hexEncode, ...); the loops below
+        // only run where the host does not provide them. Copies go through
+        // TypedArray.prototype.set, which the engine already does with memmove.
+        function hasNative(name) {
+            return typeof globalThis[name] === 'function';
+        }
+
+        // A Uint8Array over the same memory as a TypedArray, DataView or
+        // ArrayBuffer.
+        function byteView(value) {
+            if (value instanceof Uint8Array) {
+                return value;
+            }
+            if (value instanceof ArrayBuffer) {
+                return new Uint8Array(value);
+            }
+            if (ArrayBuffer.isView(value)) {
+                return new Uint8Array(value.buffer, value.byteOffset, value.byteLength);
+            }
+            return null;
+        }
+
+        function isNativeRange(bytes) {
+            return bytes.buffer instanceof ArrayBuffer;
+        }
+
         function decodeHexString(input) {
             if (!input || typeof input !== 'string') {
                 return new Uint8Array(0);
             }
-            const clean = input.length % 2 === 0 ? input : '0' + input;
-            const length = Math.floor(clean.length / 2);
+            if (hasNative('__hexDecode')) {
+                return new Uint8Array(globalThis.__hexDecode(input));
+            }
+            // Like Node, stop at the first pair that is not two hex digits.
+            const length = input.length >> 1;
             const result = new Uint8Array(length);
             for (let i = 0; i < length; i++) {
-                const byte = parseInt(clean.substr(i * 2, 2), 16);
-                result[i] = Number.isFinite(byte) ? (byte & 0xff) : 0;
+                const pair = input.substr(i * 2, 2);
+                if (!/^[0-9a-fA-F]{2}$/.test(pair)) {
+                    return result.slice(0, i);
+                }
+                result[i] = parseInt(pair, 16);
             }
             return result;
         }
@@ -2068,6 +3204,9 @@
             if (!bytes || bytes.length === 0) {
                 return '';
             }
+            if (hasNative('__hexEncode') && isNativeRange(bytes)) {
+                return globalThis.__hexEncode(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+            }
             let result = '';
             for (let i = 0; i < bytes.length; i++) {
                 const value = bytes[i] & 0xff;
@@ -2078,6 +3217,9 @@
         }
 
         function encodeLatin1String(value) {
+            if (value.length > 0 && hasNative('__latin1Encode')) {
+                return new Uint8Array(globalThis.__latin1Encode(value));
+            }
             const result = new Uint8Array(value.length);
             for (let i = 0; i < value.length; i++) {
                 result[i] = value.charCodeAt(i) & 0xff;
@@ -2085,6 +3227,139 @@
             return result;
         }
 
+        function decodeLatin1(bytes) {
+            if (bytes.length === 0) {
+                return '';
+            }
+            if (hasNative('__latin1Decode') && isNativeRange(bytes)) {
+                return globalThis.__latin1Decode(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+            }
+            let out = '';
+            for (let i = 0; i < bytes.length; i++) {
+                out += String.fromCharCode(bytes[i]);
+            }
+            return out;
+        }
+
+        function compareBytes(a, b) {
+            if (hasNative('__bufferCompare') && isNativeRange(a) && isNativeRange(b)) {
+                return globalThis.__bufferCompare(a.buffer, a.byteOffset, a.byteLength,
+                    b.buffer, b.byteOffset, b.byteLength);
+            }
+            const length = Math.min(a.length, b.length);
+            for (let i = 0; i < length; i++) {
+                if (a[i] !== b[i]) {
+                    return a[i] < b[i] ? -1 : 1;
+                }
+            }
+            if (a.length === b.length) {
+                return 0;
+            }
+            return a.length < b.length ? -1 : 1;
+        }
+
+        function findBytes(haystack, needle, from, last) {
+            if (needle.length === 0) {
+                return Math.min(from, haystack.length);
+            }
+            if (hasNative('__bufferIndexOf') && isNativeRange(haystack) && isNativeRange(needle)) {
+                return globalThis.__bufferIndexOf(haystack.buffer, haystack.byteOffset, haystack.byteLength,
+                    needle.buffer, needle.byteOffset, needle.byteLength, from, last);
+            }
+            const lastStart = haystack.length - needle.length;
+            const matchesAt = (index) => {
+                for (let j = 0; j < needle.length; j++) {
+                    if (haystack[index + j] !== needle[j]) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            if (last) {
+                for (let i = Math.min(from, lastStart); i >= 0; i--) {
+                    if (matchesAt(i)) {
+                        return i;
+                    }
+                }
+                return -1;
+            }
+            for (let i = from; i <= lastStart; i++) {
+                if (matchesAt(i)) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        function fillBytes(target, pattern) {
+            if (pattern.length === 0 || target.length === 0) {
+                return;
+            }
+            if (hasNative('__bufferFill') && isNativeRange(target) && isNativeRange(pattern)) {
+                globalThis.__bufferFill(target.buffer, target.byteOffset, target.byteLength,
+                    pattern.buffer, pattern.byteOffset, pattern.byteLength);
+                return;
+            }
+            if (pattern.length === 1) {
+                Uint8Array.prototype.fill.call(target, pattern[0]);
+                return;
+            }
+            for (let i = 0; i < target.length; i++) {
+                target[i] = pattern[i % pattern.length];
+            }
+        }
+
+        // The bytes Buffer#indexOf and Buffer#fill look for or write: a
+        // number is a single byte, strings are encoded with `encoding`.
+        function valueBytes(value, encoding) {
+            if (typeof value === 'number') {
+                return Uint8Array.of(value & 0xff);
+            }
+            if (typeof value === 'string') {
+                return BufferPolyfill._toUint8Array(value, encoding);
+            }
+            const view = byteView(value);
+            if (!view) {
+                throw new TypeError('The "value" argument must be of type number or string or an instance of Buffer or Uint8Array');
+            }
+            return view;
+        }
+
+        // Integer offset argument `name`, throwing like Node when it is
+        // negative or past `limit`.
+        function offsetArgument(value, fallback, name, limit) {
+            if (value === undefined) {
+                return fallback;
+            }
+            const number = Math.trunc(Number(value)) || 0;
+            if (number < 0 || number > (limit === undefined ? 0x7fffffff : limit)) {
+                throw new RangeError(`The value of "${name}" is out of range`);
+            }
+            return number;
+        }
+
+        function indexOfValue(buffer, value, byteOffset, encoding, last) {
+            if (typeof byteOffset === 'string') {
+                encoding = byteOffset;
+                byteOffset = undefined;
+            }
+            const length = buffer.length;
+            let from = Math.trunc(Number(byteOffset));
+            if (byteOffset === undefined || Number.isNaN(from)) {
+                from = last ? length : 0;
+            } else if (from < 0) {
+                from += length;
+            }
+            const needle = valueBytes(value, encoding);
+            if (from < 0) {
+                if (last && needle.length > 0) {
+                    return -1;
+                }
+                from = 0;
+            }
+            return findBytes(buffer, needle, from, last);
+        }
+
         function toSize(value) {
             const number = Number(value);
             if (!Number.isFinite(number) || number < 0) {
@@ -2094,11 +3369,27 @@
         }
 
         class BufferPolyfill extends Uint8Array {
-            constructor(value, encoding) {
+            constructor(value, encoding, length) {
                 if (typeof value === 'number') {
                     super(toSize(value));
                     return;
                 }
+                // Like Node, a Buffer made from an ArrayBuffer shares its
+                // memory. This is also the form subarray() constructs.
+                if (value instanceof ArrayBuffer) {
+                    const byteOffset = typeof encoding === 'number' ? toSize(encoding) : 0;
+                    if (byteOffset > value.byteLength) {
+                        throw new RangeError('"offset" is outside of buffer bounds');
+                    }
+                    const byteLength = length === undefined
+                        ? value.byteLength - byteOffset
+                        : toSize(length);
+                    if (byteOffset + byteLength > value.byteLength) {
+                        throw new RangeError('"length" is outside of buffer bounds');
+                    }
+                    super(value, byteOffset, byteLength);
+                    return;
+                }
                 const bytes = BufferPolyfill._toUint8Array(value, encoding);
                 super(bytes.length);
                 this.set(bytes, 0);
@@ -2128,7 +3419,7 @@
                 }
                 if (typeof value === 'string') {
                     const normalized = normalizeEncodingValue(encoding, 'utf8');
-                    if (normalized === 'base64') {
+                    if (normalized === 'base64' || normalized === 'base64url') {
                         return decodeBase64ToUint8Array(value);
                     }
                     if (normalized === 'hex') {
@@ -2145,11 +3436,11 @@
                 throw new TypeError('Unsupported Buffer input type');
             }
 
-            static from(value, encoding) {
+            static from(value, encodingOrOffset, length) {
                 if (typeof value === 'number') {
                     throw new TypeError('The "value" argument must not be of type number');
                 }
-                return new BufferPolyfill(value, encoding);
+                return new BufferPolyfill(value, encodingOrOffset, length);
             }
 
             static alloc(size, fill, encoding) {
@@ -2193,30 +3484,25 @@
                 const buffer = BufferPolyfill.alloc(length);
                 let offset = 0;
                 for (const item of list) {
-                    const bytes = BufferPolyfill._toUint8Array(item);
-                    buffer.set(bytes, offset);
-                    offset += bytes.length;
+                    if (offset >= length) {
+                        break;
+                    }
+                    const bytes = byteView(item) || BufferPolyfill._toUint8Array(item);
+                    const count = Math.min(bytes.length, length - offset);
+                    buffer.set(count === bytes.length ? bytes : bytes.subarray(0, count), offset);
+                    offset += count;
                 }
                 return buffer;
             }
 
             static compare(a, b) {
-                if (!BufferPolyfill.isBuffer(a) || !BufferPolyfill.isBuffer(b)) {
-                    throw new TypeError('Arguments must be Buffers');
+                if (!(a instanceof Uint8Array) || !(b instanceof Uint8Array)) {
+                    throw new TypeError('Arguments must be Buffers or Uint8Arrays');
                 }
                 if (a === b) {
                     return 0;
                 }
-                const length = Math.min(a.length, b.length);
-                for (let i = 0; i < length; i++) {
-                    if (a[i] !== b[i]) {
-                        return a[i] < b[i] ? -1 : 1;
-                    }
-                }
-                if (a.length === b.length) {
-                    return 0;
-                }
-                return a.length < b.length ? -1 : 1;
+                return compareBytes(a, b);
             }
 
             toString(encoding, start, end) {
@@ -2227,68 +3513,123 @@
                 if (normalized === 'base64') {
                     return encodeUint8ArrayToBase64(segment);
                 }
+                if (normalized === 'base64url') {
+                    return encodeUint8ArrayToBase64(segment, true);
+                }
                 if (normalized === 'hex') {
                     return encodeHexString(segment);
                 }
                 if (normalized === 'latin1') {
-                    let out = '';
-                    for (let i = 0; i < segment.length; i++) {
-                        out += String.fromCharCode(segment[i]);
-                    }
-                    return out;
+                    return decodeLatin1(segment);
                 }
                 return decodeUtf8(segment);
             }
 
             equals(other) {
-                if (!BufferPolyfill.isBuffer(other)) {
-                    return false;
+                if (!(other instanceof Uint8Array)) {
+                    throw new TypeError('The "otherBuffer" argument must be an instance of Buffer or Uint8Array');
                 }
                 if (other.length !== this.length) {
                     return false;
                 }
-                for (let i = 0; i < this.length; i++) {
-                    if (this[i] !== other[i]) {
-                        return false;
-                    }
+                return this === other || compareBytes(this, other) === 0;
+            }
+
+            compare(target, targetStart, targetEnd, sourceStart, sourceEnd) {
+                if (!(target instanceof Uint8Array)) {
+                    throw new TypeError('The "target" argument must be an instance of Buffer or Uint8Array');
                 }
-                return true;
+                const targetFrom = offsetArgument(targetStart, 0, 'targetStart');
+                const targetTo = offsetArgument(targetEnd, target.length, 'targetEnd', target.length);
+                const sourceFrom = offsetArgument(sourceStart, 0, 'sourceStart');
+                const sourceTo = offsetArgument(sourceEnd, this.length, 'sourceEnd', this.length);
+                if (sourceFrom >= sourceTo) {
+                    return targetFrom >= targetTo ? 0 : -1;
+                }
+                if (targetFrom >= targetTo) {
+                    return 1;
+                }
+                return compareBytes(
+                    new Uint8Array(this.buffer, this.byteOffset + sourceFrom, sourceTo - sourceFrom),
+                    new Uint8Array(target.buffer, target.byteOffset + targetFrom, targetTo - targetFrom));
+            }
+
+            copy(target, targetStart, sourceStart, sourceEnd) {
+                if (!(target instanceof Uint8Array)) {
+                    throw new TypeError('The "target" argument must be an instance of Buffer or Uint8Array');
+                }
+                const targetOffset = offsetArgument(targetStart, 0, 'targetStart');
+                const start = offsetArgument(sourceStart, 0, 'sourceStart', this.length);
+                const end = Math.min(this.length, offsetArgument(sourceEnd, this.length, 'sourceEnd'));
+                if (targetOffset >= target.length || start >= end) {
+                    return 0;
+                }
+                const count = Math.min(end - start, target.length - targetOffset);
+                // set() copies as if through a temporary, so overlapping
+                // ranges of one ArrayBuffer behave like memmove.
+                Uint8Array.prototype.set.call(target,
+                    new Uint8Array(this.buffer, this.byteOffset + start, count), targetOffset);
+                return count;
+            }
+
+            indexOf(value, byteOffset, encoding) {
+                return indexOfValue(this, value, byteOffset, encoding, false);
+            }
+
+            lastIndexOf(value, byteOffset, encoding) {
+                return indexOfValue(this, value, byteOffset, encoding, true);
+            }
+
+            includes(value, byteOffset, encoding) {
+                return this.indexOf(value, byteOffset, encoding) !== -1;
             }
 
             fill(value, start, end, encoding) {
-                const length = this.length;
-                let startIndex = start === undefined ? 0 : Math.max(0, start | 0);
-                let endIndex = end === undefined ? length : Math.min(length, end | 0);
+                if (typeof start === 'string') {
+                    encoding = start;
+                    start = undefined;
+                    end = undefined;
+                } else if (typeof end === 'string') {
+                    encoding = end;
+                    end = undefined;
+                }
+                const startIndex = offsetArgument(start, 0, 'offset', this.length);
+                const endIndex = offsetArgument(end, this.length, 'end', this.length);
                 if (startIndex >= endIndex) {
                     return this;
                 }
-                if (typeof value === 'string') {
-                    const bytes = BufferPolyfill._toUint8Array(value, encoding);
-                    if (bytes.length === 0) {
-                        return this;
-                    }
-                    for (let i = startIndex; i < endIndex; i++) {
-                        this[i] = bytes[(i - startIndex) % bytes.length];
+                let pattern = typeof value === 'string' || byteView(value)
+                    ? valueBytes(value, encoding)
+                    : Uint8Array.of(Number(value) & 0xff);
+                if (pattern.length === 0) {
+                    if (typeof value !== 'string') {
+                        throw new TypeError('The argument "value" is invalid');
                     }
-                    return this;
-                }
-                const numeric = Number(value) & 0xff;
-                for (let i = startIndex; i < endIndex; i++) {
-                    this[i] = numeric;
+                    // Node fills with zeros when a string encodes to nothing.
+                    pattern = Uint8Array.of(0);
                 }
+                fillBytes(new Uint8Array(this.buffer, this.byteOffset + startIndex, endIndex - startIndex), pattern);
                 return this;
             }
 
             write(string, offset, length, encoding) {
                 const start = offset === undefined ? 0 : offset | 0;
                 const remaining = this.length - start;
+                if (normalizeEncodingValue(encoding, 'utf8') === 'utf8') {
+                    // Encodes straight into this buffer, stopping before a
+                    // character that would not fit.
+                    const limit = length === undefined ? remaining : Math.min(length | 0, remaining);
+                    const target = new Uint8Array(this.buffer, this.byteOffset + start, Math.max(0, limit));
+                    return textEncoder.encodeInto(String(string), target).written;
+                }
                 const bytes = BufferPolyfill._toUint8Array(string, encoding);
                 const writeLength = length === undefined
                     ? Math.min(bytes.length, remaining)
                     : Math.min(length | 0, remaining, bytes.length);
-                for (let i = 0; i < writeLength; i++) {
-                    this[start + i] = bytes[i];
+                if (writeLength <= 0) {
+                    return 0;
                 }
+                Uint8Array.prototype.set.call(this, bytes.subarray(0, writeLength), start);
                 return writeLength;
             }
 
@@ -2310,6 +3651,19 @@
             }
         }
 
+        // Runs the native check `nativeName` over a TypedArray, DataView or
+        // ArrayBuffer, or `fallback` where the host does not provide it.
+        function isEncodedAs(input, nativeName, fallback) {
+            if (!(input instanceof ArrayBuffer) && !ArrayBuffer.isView(input)) {
+                throw new TypeError('The "input" argument must be an ArrayBuffer or ArrayBufferView');
+            }
+            const bytes = decoderInputBytes(input);
+            if (typeof globalThis[nativeName] === 'function' && bytes.buffer instanceof ArrayBuffer) {
+                return globalThis[nativeName](bytes.buffer, bytes.byteOffset, bytes.byteLength);
+            }
+            return fallback(bytes);
+        }
+
         Object.defineProperty(BufferPolyfill.prototype, Symbol.toStringTag, {
             value: 'Buffer'
         });
@@ -2324,6 +3678,12 @@
             MAX_LENGTH: 0x7fffffff,
             MAX_STRING_LENGTH: 0x7fffffff
         };
+        module.exports.isUtf8 = function isUtf8(input) {
+            return isEncodedAs(input, '__isUtf8', (bytes) => decodeUtf8Bytes(bytes, true) !== undefined);
+        };
+        module.exports.isAscii = function isAscii(input) {
+            return isEncodedAs(input, '__isAscii', (bytes) => bytes.every((byte) => byte < 0x80));
+        };
         module.exports.__esModule = true;
 
         if (typeof globalThis.Buffer !== 'function') {
@@ -2444,10 +3804,394 @@
 
     HeadersPolyfill.prototype[Symbol.iterator] = HeadersPolyfill.prototype.entries;
 
+    // Minimal WHATWG ReadableStream (default reader only), used for
+    // Response.body. Installed as globalThis.ReadableStream when the engine
+    // does not provide one.
+    class ReadableStreamPolyfill {
+        constructor(source, strategy) {
+            const underlying = source || {};
+            const highWaterMark = strategy && strategy.highWaterMark !== undefined
+                ? Number(strategy.highWaterMark) : 1;
+            this._source = underlying;
+            this._highWaterMark = Number.isFinite(highWaterMark) && highWaterMark >= 0 ? highWaterMark : 1;
+            this._queue = [];
+            this._readRequests = [];
+            this._state = 'readable';
+            this._storedError = undefined;
+            this._reader = null;
+            this._started = false;
+            this._pulling = false;
+            this._pullAgain = false;
+            this._closeRequested = false;
+
+            const stream = this;
+            this._controller = {
+                get desiredSize() {
+                    return stream._desiredSize();
+                },
+                enqueue(chunk) {
+                    stream._enqueue(chunk);
+                },
+                close() {
+                    stream._requestClose();
+                },
+                error(e) {
+                    stream._error(e);
+                }
+            };
+
+            const startResult = underlying.start ? underlying.start(this._controller) : undefined;
+            Promise.resolve(startResult).then(() => {
+                this._started = true;
+                this._callPullIfNeeded();
+            }, (e) => this._error(e));
+        }
+
+        get locked() {
+            return this._reader !== null;
+        }
+
+        getReader() {
+            return new ReadableStreamDefaultReaderPolyfill(this);
+        }
+
+        cancel(reason) {
+            if (this.locked) {
+                return Promise.reject(new TypeError('Cannot cancel a locked stream'));
+            }
+            return this._cancel(reason);
+        }
+
+        [Symbol.asyncIterator]() {
+            const reader = this.getReader();
+            return {
+                next() {
+                    return reader.read();
+                },
+                return(value) {
+                    return reader.cancel().then(() => ({ value, done: true }));
+                },
+                [Symbol.asyncIterator]() {
+                    return this;
+                }
+            };
+        }
+
+        _desiredSize() {
+            if (this._state === 'errored') {
+                return null;
+            }
+            if (this._state === 'closed') {
+                return 0;
+            }
+            return this._highWaterMark - this._queue.length;
+        }
+
+        _enqueue(chunk) {
+            if (this._closeRequested || this._state !== 'readable') {
+                throw new TypeError('Cannot enqueue into a closed stream');
+            }
+            if (this._readRequests.length > 0) {
+                this._readRequests.shift().resolve({ value: chunk, done: false });
+            } else {
+                this._queue.push(chunk);
+            }
+            this._callPullIfNeeded();
+        }
+
+        _requestClose() {
+            if (this._closeRequested || this._state !== 'readable') {
+                return;
+            }
+            this._closeRequested = true;
+            if (this._queue.length === 0) {
+                this._close();
+            }
+        }
+
+        _close() {
+            this._state = 'closed';
+            const requests = this._readRequests;
+            this._readRequests = [];
+            requests.forEach((request) => request.resolve({ value: undefined, done: true }));
+            if (this._reader) {
+                this._reader._closedResolve();
+            }
+        }
+
+        _error(e) {
+            if (this._state !== 'readable') {
+                return;
+            }
+            this._state = 'errored';
+            this._storedError = e;
+            this._queue = [];
+            const requests = this._readRequests;
+            this._readRequests = [];
+            requests.forEach((request) => request.reject(e));
+            if (this._reader) {
+                this._reader._closedReject(e);
+            }
+        }
+
+        _read() {
+            if (this._queue.length > 0) {
+                const chunk = this._queue.shift();
+                if (this._closeRequested && this._queue.length === 0) {
+                    this._close();
+                } else {
+                    this._callPullIfNeeded();
+                }
+                return Promise.resolve({ value: chunk, done: false });
+            }
+            if (this._state === 'closed') {
+                return Promise.resolve({ value: undefined, done: true });
+            }
+            if (this._state === 'errored') {
+                return Promise.reject(this._storedError);
+            }
+            const promise = new Promise((resolve, reject) => {
+                this._readRequests.push({ resolve, reject });
+            });
+            this._callPullIfNeeded();
+            return promise;
+        }
+
+        _cancel(reason) {
+            if (this._state === 'closed') {
+                return Promise.resolve();
+            }
+            if (this._state === 'errored') {
+                return Promise.reject(this._storedError);
+            }
+            this._queue = [];
+            this._close();
+            const cancel = this._source.cancel;
+            return Promise.resolve(cancel ? cancel.call(this._source, reason) : undefined).then(() => undefined);
+        }
+
+        _callPullIfNeeded() {
+            if (!this._started || this._state !== 'readable' || this._closeRequested) {
+                return;
+            }
+            if (this._readRequests.length === 0 && !(this._desiredSize() > 0)) {
+                return;
+            }
+            if (this._pulling) {
+                this._pullAgain = true;
+                return;
+            }
+            const pull = this._source.pull;
+            if (!pull) {
+                return;
+            }
+            this._pulling = true;
+            Promise.resolve().then(() => pull.call(this._source, this._controller)).then(() => {
+                this._pulling = false;
+                if (this._pullAgain) {
+                    this._pullAgain = false;
+                    this._callPullIfNeeded();
+                }
+            }, (e) => this._error(e));
+        }
+    }
+
+    class ReadableStreamDefaultReaderPolyfill {
+        constructor(stream) {
+            if (stream._reader) {
+                throw new TypeError('ReadableStream is already locked to a reader');
+            }
+            stream._reader = this;
+            this._stream = stream;
+            this.closed = new Promise((resolve, reject) => {
+                this._closedResolve = resolve;
+                this._closedReject = reject;
+            });
+            this.closed.catch(() => {});
+            if (stream._state === 'closed') {
+                this._closedResolve();
+            } else if (stream._state === 'errored') {
+                this._closedReject(stream._storedError);
+            }
+        }
+
+        read() {
+            if (!this._stream) {
+                return Promise.reject(new TypeError('Reader has been released'));
+            }
+            return this._stream._read();
+        }
+
+        cancel(reason) {
+            if (!this._stream) {
+                return Promise.reject(new TypeError('Reader has been released'));
+            }
+            return this._stream._cancel(reason);
+        }
+
+        releaseLock() {
+            if (this._stream) {
+                this._stream._reader = null;
+                this._stream = null;
+            }
+        }
+    }
+
+    if (typeof globalThis.ReadableStream !== 'function') {
+        globalThis.ReadableStream = ReadableStreamPolyfill;
+    }
+
+    function createAbortError(name, message) {
+        if (typeof globalThis.DOMException === 'function') {
+            return new globalThis.DOMException(message, name);
+        }
+        const error = new Error(message);
+        error.name = name;
+        return error;
+    }
+
+    class AbortSignalPolyfill {
+        constructor() {
+            this.aborted = false;
+            this.reason = undefined;
+            this.onabort = null;
+            this._listeners = [];
+        }
+
+        addEventListener(type, listener, options) {
+            if (type !== 'abort' || !listener) {
+                return;
+            }
+            if (this._listeners.some((entry) => entry.listener === listener)) {
+                return;
+            }
+            const once = !!(options && typeof options === 'object' && options.once);
+            this._listeners.push({ listener, once });
+        }
+
+        removeEventListener(type, listener) {
+            if (type === 'abort') {
+                this._listeners = this._listeners.filter((entry) => entry.listener !== listener);
+            }
+        }
+
+        dispatchEvent(event) {
+            if (!event || event.type !== 'abort') {
+                return true;
+            }
+            if (typeof this.onabort === 'function') {
+                this.onabort.call(this, event);
+            }
+            const listeners = this._listeners.slice();
+            this._listeners = this._listeners.filter((entry) => !entry.once);
+            listeners.forEach((entry) => {
+                try {
+                    if (typeof entry.listener === 'function') {
+                        entry.listener.call(this, event);
+                    } else if (typeof entry.listener.handleEvent === 'function') {
+                        entry.listener.handleEvent(event);
+                    }
+                } catch (error) {
+                    reportCallbackError(error);
+                }
+            });
+            return true;
+        }
+
+        throwIfAborted() {
+            if (this.aborted) {
+                throw this.reason;
+            }
+        }
+
+        _abort(reason) {
+            if (this.aborted) {
+                return;
+            }
+            this.aborted = true;
+            this.reason = reason !== undefined
+                ? reason
+                : createAbortError('AbortError', 'This operation was aborted');
+            this.dispatchEvent({ type: 'abort', target: this });
+        }
+
+        static abort(reason) {
+            const signal = new AbortSignalPolyfill();
+            signal._abort(reason);
+            return signal;
+        }
+
+        static timeout(milliseconds) {
+            const signal = new AbortSignalPolyfill();
+            setTimeout(() => {
+                signal._abort(createAbortError('TimeoutError', 'The operation timed out'));
+            }, milliseconds);
+            return signal;
+        }
+
+        static any(signals) {
+            const signal = new AbortSignalPolyfill();
+            for (const source of signals) {
+                if (source.aborted) {
+                    signal._abort(source.reason);
+                    return signal;
+                }
+            }
+            for (const source of signals) {
+                source.addEventListener('abort', () => signal._abort(source.reason), { once: true });
+            }
+            return signal;
+        }
+    }
+
+    class AbortControllerPolyfill {
+        constructor() {
+            this.signal = new AbortSignalPolyfill();
+        }
+
+        abort(reason) {
+            this.signal._abort(reason);
+        }
+    }
+
+    if (typeof globalThis.AbortController !== 'function') {
+        globalThis.AbortController = AbortControllerPolyfill;
+        globalThis.AbortSignal = AbortSignalPolyfill;
+    }
+
+    function concatByteChunks(chunks) {
+        if (chunks.length === 1) {
+            return chunks[0];
+        }
+        let total = 0;
+        for (let i = 0; i < chunks.length; i++) {
+            total += chunks[i].byteLength;
+        }
+        const out = new Uint8Array(total);
+        let offset = 0;
+        for (let i = 0; i < chunks.length; i++) {
+            out.set(chunks[i], offset);
+            offset += chunks[i].byteLength;
+        }
+        return out;
+    }
+
+    // The body of a native response arrives after the head: buffered natively
+    // and delivered in one piece when the transfer ends, or, once
+    // `response.body` is used, as a stream of chunks. Streamed chunks are
+    // acknowledged to the native side as the reader pulls them; if the reader
+    // falls behind, the transfer is paused.
     class FetchResponse {
         constructor(nativeResult, bodyBytes) {
-            this._bodyBytes = bodyBytes;
+            this._requestId = undefined;
+            this._bodyBytes = bodyBytes || null;
+            this._bodyDone = bodyBytes !== undefined;
+            this._bodyError = null;
+            this._bodyWaiters = [];
             this._bodyUsed = false;
+            this._stream = null;
+            this._streamChunks = [];
+            this._pullWaiter = null;
             this.status = nativeResult.status | 0;
             this.statusText = nativeResult.statusText || '';
             this.ok = !!nativeResult.ok;
@@ -2459,25 +4203,131 @@
             return this._bodyUsed;
         }
 
-        _consumeBody() {
+        get body() {
+            if (!this._stream) {
+                const response = this;
+                if (!this._bodyDone && this._requestId !== undefined) {
+                    globalThis.__nativeFetchStream(this._requestId);
+                } else if (this._bodyBytes && this._bodyBytes.byteLength > 0) {
+                    this._streamChunks.push(this._bodyBytes);
+                }
+                this._bodyBytes = null;
+                // highWaterMark 0: chunks are only pulled for pending reads,
+                // so an idle reader leaves them unacknowledged.
+                this._stream = new globalThis.ReadableStream({
+                    pull(controller) {
+                        return response._pullChunk(controller);
+                    },
+                    cancel(reason) {
+                        response._cancelBody(reason);
+                    }
+                }, { highWaterMark: 0 });
+            }
+            return this._stream;
+        }
+
+        _attachNativeBody(requestId) {
+            this._requestId = requestId;
+        }
+
+        _onNativeData(bytes) {
+            this._streamChunks.push(bytes);
+            this._wakePull();
+        }
+
+        _onNativeEnd(error, bytes) {
+            this._bodyDone = true;
+            this._bodyError = error;
+            if (this._stream) {
+                if (bytes && bytes.byteLength > 0) {
+                    this._streamChunks.push(bytes);
+                }
+                this._wakePull();
+            } else {
+                this._bodyBytes = bytes;
+            }
+            const waiters = this._bodyWaiters;
+            this._bodyWaiters = [];
+            waiters.forEach((resolve) => resolve());
+        }
+
+        _wakePull() {
+            const wake = this._pullWaiter;
+            if (wake) {
+                this._pullWaiter = null;
+                wake();
+            }
+        }
+
+        async _pullChunk(controller) {
+            this._bodyUsed = true;
+            while (this._streamChunks.length === 0 && !this._bodyDone) {
+                await new Promise((resolve) => {
+                    this._pullWaiter = resolve;
+                });
+            }
+            if (this._streamChunks.length > 0) {
+                const chunk = this._streamChunks.shift();
+                if (!this._bodyDone && this._requestId !== undefined) {
+                    globalThis.__nativeFetchAck(this._requestId, chunk.byteLength);
+                }
+                controller.enqueue(chunk);
+                return;
+            }
+            if (this._bodyError) {
+                controller.error(this._bodyError);
+            } else {
+                controller.close();
+            }
+        }
+
+        _cancelBody(reason) {
+            this._streamChunks = [];
+            if (!this._bodyDone && this._requestId !== undefined) {
+                globalThis.__nativeFetchCancel(this._requestId, 'Response body was cancelled');
+            }
+        }
+
+        async _consumeBody() {
             if (this._bodyUsed) {
                 throw new TypeError('Body has already been consumed');
             }
             this._bodyUsed = true;
+            if (this._stream) {
+                const reader = this._stream.getReader();
+                const chunks = [];
+                for (;;) {
+                    const { value, done } = await reader.read();
+                    if (done) {
+                        break;
+                    }
+                    chunks.push(value);
+                }
+                return chunks.length ? concatByteChunks(chunks) : new Uint8Array(0);
+            }
+            if (!this._bodyDone) {
+                await new Promise((resolve) => this._bodyWaiters.push(resolve));
+            }
+            if (this._bodyError) {
+                throw this._bodyError;
+            }
             const bytes = this._bodyBytes || new Uint8Array(0);
             this._bodyBytes = null;
             return bytes;
         }
 
         async arrayBuffer() {
-            const bytes = this._consumeBody();
-            const buffer = bytes.buffer.slice(bytes.byteOffset, bytes.byteOffset + bytes.byteLength);
-            return buffer;
+            const bytes = await this._consumeBody();
+            if (bytes.byteOffset === 0 && bytes.byteLength === bytes.buffer.byteLength) {
+                // The native body buffer is not shared with anything else.
+                return bytes.buffer;
+            }
+            return bytes.buffer.slice(bytes.byteOffset, bytes.byteOffset + bytes.byteLength);
         }
 
         async text() {
-            const bytes = this._consumeBody();
-            return decodeUtf8(bytes);
+            const bytes = await this._consumeBody();
+            return textDecoder.decode(bytes);
         }
 
         async json() {
@@ -2496,6 +4346,8 @@
         let bodyValue;
         let timeoutValue;
         let redirectValue;
+        let cacheValue;
+        let signalValue;
 
         if (input && typeof input === 'object' && input.url !== undefined) {
             urlValue = input.url;
@@ -2504,6 +4356,8 @@
             bodyValue = input.body;
             timeoutValue = input.timeout;
             redirectValue = input.redirect;
+            cacheValue = input.cache;
+            signalValue = input.signal;
         }
 
         const options = init || {};
@@ -2522,6 +4376,12 @@
         if (options.redirect !== undefined) {
             redirectValue = options.redirect;
         }
+        if (options.cache !== undefined) {
+            cacheValue = options.cache;
+        }
+        if (options.signal !== undefined) {
+            signalValue = options.signal;
+        }
 
         if (urlValue === undefined || urlValue === null) {
             throw new TypeError('fetch requires a resource');
@@ -2530,10 +4390,12 @@
         const method = methodValue ? String(methodValue).toUpperCase() : 'GET';
         const headers = new HeadersPolyfill(headersSource);
         let body = bodyValue;
-        if (body !== undefined && body !== null && typeof body !== 'string') {
-            body = String(body);
-        } else if (body === undefined || body === null) {
+        if (body === undefined || body === null) {
             body = undefined;
+        } else if (body instanceof ArrayBuffer || ArrayBuffer.isView(body)) {
+            // Binary bodies are handed to the native side as is.
+        } else if (typeof body !== 'string') {
+            body = String(body);
         }
         if ((method === 'GET' || method === 'HEAD') && body !== undefined) {
             throw new TypeError(method + ' request cannot have a body');
@@ -2548,6 +4410,7 @@
         }
 
         const redirect = redirectValue !== undefined ? String(redirectValue) : undefined;
+        const cache = cacheValue !== undefined ? String(cacheValue) : 'default';
 
         return {
             url: String(urlValue),
@@ -2555,7 +4418,9 @@
             headers,
             body,
             timeout,
-            redirect
+            redirect,
+            cache,
+            signal: signalValue || null
         };
     }
 
@@ -2568,6 +4433,8 @@
             this.body = normalized.body;
             this.timeout = normalized.timeout;
             this.redirect = normalized.redirect;
+            this.cache = normalized.cache;
+            this.signal = normalized.signal;
         }
 
         clone() {
@@ -2579,18 +4446,43 @@
     globalThis.Response = FetchResponse;
     globalThis.Request = RequestPolyfill;
 
+    // Native fetch events, in order per request: 'head' resolves the fetch
+    // promise, 'data' carries a streamed body chunk and 'end' finishes the
+    // body (or rejects the fetch if it failed before a response arrived).
     globalThis.__onNativeFetchComplete = function(result) {
         const entry = sFetchPending.get(result.id);
         if (!entry) {
             return;
         }
+        if (result.type === 'head') {
+            const response = new FetchResponse(result);
+            response._attachNativeBody(result.id);
+            entry.response = response;
+            entry.resolve(response);
+            return;
+        }
+        if (result.type === 'data') {
+            if (entry.response) {
+                entry.response._onNativeData(new Uint8Array(result.body));
+            }
+            return;
+        }
         sFetchPending.delete(result.id);
-        if (result.error) {
-            entry.reject(new TypeError(result.error));
+        if (entry.signal) {
+            entry.signal.removeEventListener('abort', entry.onAbort);
+        }
+        // An aborted request fails with the signal's reason.
+        const error = result.error
+            ? (entry.abortReason !== undefined ? entry.abortReason : new TypeError(result.error))
+            : null;
+        if (!entry.response) {
+            entry.reject(error || new TypeError('Network request failed'));
             return;
         }
-        const bytes = decodeBase64ToUint8Array(result.body || '');
-        entry.resolve(new FetchResponse(result, bytes));
+        // The body arrives as an ArrayBuffer backed by the native buffer.
+        entry.response._onNativeEnd(
+            error,
+            result.body instanceof ArrayBuffer ? new Uint8Array(result.body) : new Uint8Array(0));
     };
 
     globalThis.fetch = function(input, init) {
@@ -2602,6 +4494,12 @@
             return NativePromise.reject(new TypeError('Native fetch is not available'));
         }
         const request = normalizeFetchArgs(input, init);
+        const signal = request.signal;
+        if (signal && signal.aborted) {
+            return NativePromise.reject(signal.reason !== undefined
+                ? signal.reason
+                : createAbortError('AbortError', 'This operation was aborted'));
+        }
         return new NativePromise(function(resolve, reject) {
             const nativeInit = {
                 method: request.method,
@@ -2616,17 +4514,251 @@
             if (request.redirect) {
                 nativeInit.redirect = request.redirect;
             }
+            if (request.cache !== 'default') {
+                nativeInit.cache = request.cache;
+            }
             try {
                 const requestId = globalThis.__nativeFetch(request.url, nativeInit);
-                sFetchPending.set(requestId, { resolve: resolve, reject: reject });
+                const entry = { resolve: resolve, reject: reject };
+                if (signal && typeof signal.addEventListener === 'function') {
+                    // Aborting removes the transfer natively; its 'end' event
+                    // then settles the fetch (or the body) with the reason.
+                    entry.signal = signal;
+                    entry.onAbort = function() {
+                        entry.abortReason = signal.reason !== undefined
+                            ? signal.reason
+                            : createAbortError('AbortError', 'This operation was aborted');
+                        if (!entry.response) {
+                            reject(entry.abortReason);
+                        }
+                        globalThis.__nativeFetchCancel(requestId, 'The operation was aborted');
+                    };
+                    signal.addEventListener('abort', entry.onAbort, { once: true });
+                }
+                sFetchPending.set(requestId, entry);
             } catch (error) {
                 reject(error);
             }
         });
     };
 
+    // Completion of a *Async fs host function, which ran on a native worker
+    // thread: { id, value } on success, { id, error, code } on failure.
+    globalThis.__onNativeFsComplete = function(result) {
+        const callback = sFsPending.get(result.id);
+        if (!callback) {
+            return;
+        }
+        sFsPending.delete(result.id);
+        let error = null;
+        if (result.error !== undefined) {
+            error = new Error(result.error);
+            if (result.code) {
+                error.code = result.code;
+            }
+        }
+        try {
+            callback(error, result.value);
+        } catch (e) {
+            reportCallbackError(e);
+        }
+    };
+
+    // Debounced file system event from the native watcher thread:
+    // { id, eventType: 'change' | 'rename', filename }.
+    globalThis.__onNativeFsWatch = function(event) {
+        const listener = sFsWatchers.get(event.id);
+        if (!listener) {
+            return;
+        }
+        try {
+            listener(event.eventType, event.filename);
+        } catch (e) {
+            reportCallbackError(e);
+        }
+    };
+
+    // Every fs.watch/fs.watchFile watch was dropped natively because hot
+    // reload replaced the bundle that made them.
+    globalThis.__onNativeFsUnwatchAll = function() {
+        sFsWatchers.clear();
+        sStatWatchers.clear();
+    };
+
+    // Textures from __loadTexture() are decoded on native worker threads and
+    // uploaded a few megabytes per frame. Each is returned at once, draws a
+    // placeholder while loading and is updated in place by
+    // __onNativeImageComplete. Loads of the same path or embedded image share
+    // one texture, which holds a native reference per load until release().
+    const sTextures = new Map();
+    let sPlaceholderTextureId = 0;
+
+    function placeholderTextureId() {
+        if (sPlaceholderTextureId === 0 && typeof globalThis.__imagePlaceholderTextureId === 'function') {
+            sPlaceholderTextureId = globalThis.__imagePlaceholderTextureId();
+        }
+        return sPlaceholderTextureId;
+    }
+
+    class NativeTexture {
+        constructor(id) {
+            this.id = id;
+            // 'loading', 'ready', 'error' or 'released'.
+            this.status = 'loading';
+            this.width = 0;
+            this.height = 0;
+            this.error = null;
+            // The image's rectangle in its texture, which is shared with
+            // other images when it was packed into an atlas page.
+            this.uv0 = { x: 0, y: 0 };
+            this.uv1 = { x: 1, y: 1 };
+            this._textureId = 0;
+            this.ready = new Promise((resolve, reject) => {
+                this._resolve = resolve;
+                this._reject = reject;
+            });
+            // Failures are also visible through status and error, so awaiting
+            // `ready` is optional.
+            this.ready.catch(() => {});
+        }
+
+        // The ImTextureID to draw: the image once it is uploaded, the
+        // placeholder until then or after it is released.
+        get textureId() {
+            return this.status === 'ready' ? this._textureId : placeholderTextureId();
+        }
+
+        // Drop the reference taken by one load of this texture. After the last
+        // one the image may be evicted and must no longer be drawn.
+        release() {
+            if (this.status === 'released' || !sTextures.has(this.id)) {
+                return;
+            }
+            if (globalThis.__releaseTexture(this.id) <= 0) {
+                sTextures.delete(this.id);
+                if (this.status === 'loading') {
+                    this._reject(new Error('The texture was released before it loaded'));
+                }
+                this.status = 'released';
+            }
+        }
+
+        // Takes { width, height, textureId[, uv0, uv1] } from native code.
+        _update(info) {
+            this.width = info.width;
+            this.height = info.height;
+            this._textureId = info.textureId;
+            if (info.uv0 !== undefined) {
+                this.uv0 = info.uv0;
+                this.uv1 = info.uv1;
+            }
+        }
+
+        _loaded(info) {
+            this._update(info);
+            this.status = 'ready';
+            this._resolve(this);
+        }
+    }
+
+    // A texture whose pixels JS replaces, e.g. with camera frames or a
+    // spectrogram. It is ready as soon as it is created.
+    class DynamicTexture extends NativeTexture {
+        constructor(info, format) {
+            super(info.id);
+            this.format = format;
+            this._loaded(info);
+        }
+
+        // Replace the pixels with `data`, an ArrayBuffer or view holding
+        // width * height pixels of the texture's format. The bytes are read
+        // by native code; the GPU copy is updated at most once per frame, with
+        // the latest pixels.
+        update(data) {
+            if (this.status !== 'ready') {
+                throw new Error('The texture has been released');
+            }
+            if (ArrayBuffer.isView(data)) {
+                globalThis.__updateTexture(this.id, data.buffer, data.byteOffset, data.byteLength);
+            } else if (data instanceof ArrayBuffer) {
+                globalThis.__updateTexture(this.id, data);
+            } else {
+                throw new TypeError('The texture data must be an ArrayBuffer or a typed array');
+            }
+        }
+    }
+
+    // Creates a dynamic texture: { width, height, format }, where format is
+    // 'rgba8' (the default), 'bgra8' or 'gray8'.
+    globalThis.__createTexture = function(options) {
+        if (typeof globalThis.__createDynamicTexture !== 'function') {
+            throw new Error('Dynamic textures are not supported by this runtime');
+        }
+        const format = (options && options.format) || 'rgba8';
+        const info = globalThis.__createDynamicTexture(options && options.width, options && options.height, format);
+        const texture = new DynamicTexture(info, format);
+        sTextures.set(info.id, texture);
+        return texture;
+    };
+
+    // Starts loading `source`: a file path, the name of an embedded image, or
+    // the encoded bytes in an ArrayBuffer or typed array (e.g. a fetch body).
+    globalThis.__loadTexture = function(source) {
+        if (typeof globalThis.__loadImageAsync !== 'function') {
+            throw new Error('Image loading is not supported by this runtime');
+        }
+        let info;
+        if (ArrayBuffer.isView(source)) {
+            info = globalThis.__loadImageAsync(source.buffer, {
+                byteOffset: source.byteOffset,
+                byteLength: source.byteLength
+            });
+        } else if (typeof source === 'string' || source instanceof ArrayBuffer) {
+            info = globalThis.__loadImageAsync(source);
+        } else {
+            throw new TypeError('The texture source must be a path, an embedded image name or an ArrayBuffer');
+        }
+        let texture = sTextures.get(info.id);
+        if (!texture) {
+            texture = new NativeTexture(info.id);
+            sTextures.set(info.id, texture);
+            // A cached image that nothing referenced any more.
+            if (info.textureId !== undefined) {
+                texture._loaded(info);
+            }
+        }
+        return texture;
+    };
+
+    // An image finished loading: { id, width, height, textureId } once it is
+    // uploaded, { id, error } if it could not be read, decoded or uploaded.
+    globalThis.__onNativeImageComplete = function(result) {
+        const texture = sTextures.get(result.id);
+        if (!texture || texture.status !== 'loading') {
+            return;
+        }
+        if (result.error !== undefined) {
+            // The native side forgot the id, so there is nothing to release.
+            sTextures.delete(result.id);
+            texture.status = 'error';
+            texture.error = new Error(result.error);
+            texture._reject(texture.error);
+            return;
+        }
+        texture._loaded(result);
+    };
+
+    // Atlas pages were repacked and these images moved: [{ id, width, height,
+    // textureId, uv0, uv1 }].
+    globalThis.__onNativeTexturesMoved = function(moved) {
+        for (let i = 0; i < moved.length; i++) {
+            const texture = sTextures.get(moved[i].id);
+            if (texture) {
+                texture._update(moved[i]);
+            }
+        }
+    };
+
     // Return helper functions for C++ to use
-    //return {peek: peekMacroTask, run: runMacroTask};
-  // Return helper functions for C++ to use
-    return { peek: peekMacroTask, run: runMacroTask, flushRaf };
+    return { runTimer, runAnimationFrames };
 })();
@@ -17,6 +17,8 @@ function resolveBufferModule() {
 			kMaxLength: globalThis.Buffer.kMaxLength || 0x7fffffff,
 			kStringMaxLength: globalThis.Buffer.kStringMaxLength || 0x7fffffff,
 			INSPECT_MAX_BYTES: globalThis.Buffer.INSPECT_MAX_BYTES || 50,
+			isUtf8: globalThis.Buffer.isUtf8,
+			isAscii: globalThis.Buffer.isAscii,
 			constants: globalThis.Buffer.constants || {
 				MAX_LENGTH: 0x7fffffff,
 				MAX_STRING_LENGTH: 0x7fffffff,
@@ -40,3 +42,5 @@ export const constants = bufferModule.constants || {
 	MAX_LENGTH: 0x7fffffff,
 	MAX_STRING_LENGTH: 0x7fffffff,
 };
+export const isUtf8 = bufferModule.isUtf8;
+export const isAscii = bufferModule.isAscii;
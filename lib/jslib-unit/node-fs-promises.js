@@ -4,11 +4,13 @@ const fsPromises = requireNodeModule('fs/promises');
 
 export default fsPromises;
 export const {
+  open,
   readFile,
   writeFile,
   mkdir,
   rm,
   readdir,
+  scanDirectory,
   stat,
   lstat,
   realpath,
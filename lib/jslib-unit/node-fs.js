@@ -20,6 +20,9 @@ export const lstat = bind(fs.lstat);
 export const lstatSync = bind(fs.lstatSync);
 export const readdir = bind(fs.readdir);
 export const readdirSync = bind(fs.readdirSync);
+export const scanDirectory = bind(fs.scanDirectory);
+export const scanDirectorySync = bind(fs.scanDirectorySync);
+export const Dirent = fs.Dirent;
 export const mkdir = bind(fs.mkdir);
 export const mkdirSync = bind(fs.mkdirSync);
 export const rm = bind(fs.rm);
@@ -27,3 +30,16 @@ export const rmSync = bind(fs.rmSync);
 export const realpathSync = bind(fs.realpathSync);
 export const createReadStream = bind(fs.createReadStream);
 export const createWriteStream = bind(fs.createWriteStream);
+export const open = bind(fs.open);
+export const openSync = bind(fs.openSync);
+export const read = bind(fs.read);
+export const readSync = bind(fs.readSync);
+export const write = bind(fs.write);
+export const writeSync = bind(fs.writeSync);
+export const close = bind(fs.close);
+export const closeSync = bind(fs.closeSync);
+export const fstat = bind(fs.fstat);
+export const fstatSync = bind(fs.fstatSync);
+export const watch = bind(fs.watch);
+export const watchFile = bind(fs.watchFile);
+export const unwatchFile = bind(fs.unwatchFile);
@@ -399,6 +399,9 @@ const hostConfig = {
    */
   prepareForCommit(containerInfo) {
     reconciliationStartTime = performance.now();
+    if (typeof globalThis.__traceBegin === 'function') {
+      globalThis.__traceBegin('React commit', 'react');
+    }
     return null;
   },
 
@@ -408,6 +411,10 @@ const hostConfig = {
    * This syncs our tree to globalThis so the ImGui renderer can access it.
    */
   resetAfterCommit(containerInfo) {
+    if (typeof globalThis.__traceEnd === 'function') {
+      globalThis.__traceEnd('React commit', 'react');
+    }
+
     // Measure reconciliation time
     if (reconciliationStartTime > 0) {
       const duration = performance.now() - reconciliationStartTime;
@@ -420,6 +427,11 @@ const hostConfig = {
     if (globalThis.reactApp) {
       globalThis.reactApp.rootChildren = containerInfo.rootChildren || [];
     }
+
+    // The committed tree must be drawn even when the host renders on demand
+    if (typeof globalThis.__invalidateFrame === 'function') {
+      globalThis.__invalidateFrame();
+    }
   },
 
   /**
@@ -395,6 +395,9 @@ const StyleSheet = {
         }
         hostOptions.globalScale = scale;
       }
+      if (options.cacheDirectory !== undefined && options.cacheDirectory !== null) {
+        hostOptions.cacheDirectory = String(options.cacheDirectory);
+      }
     }
 
     const result = globalThis.__configureImGuiFonts(normalizedDescriptors, hostOptions);
@@ -425,7 +428,8 @@ const StyleSheet = {
         : undefined,
       atlasWidth: result && typeof result.atlasWidth === 'number' ? result.atlasWidth : undefined,
       atlasHeight: result && typeof result.atlasHeight === 'number' ? result.atlasHeight : undefined,
-      globalScale: result && typeof result.globalScale === 'number' ? result.globalScale : undefined
+      globalScale: result && typeof result.globalScale === 'number' ? result.globalScale : undefined,
+      cached: !!(result && result.cached)
     });
 
     latestFontConfiguration = summary;
@@ -139,6 +139,8 @@ export interface FontDescriptor {
 export interface ConfigureFontsOptions {
   defaultFont?: string;
   globalScale?: number;
+  /** Directory where built atlases are kept, so the same fonts load without rasterizing them again. */
+  cacheDirectory?: string;
 }
 
 export interface FontConfigurationSummary {
@@ -147,6 +149,8 @@ export interface FontConfigurationSummary {
   atlasWidth?: number;
   atlasHeight?: number;
   globalScale?: number;
+  /** Whether the atlas was restored from the cache directory. */
+  cached: boolean;
 }
 
 export interface RootProps {
@@ -556,9 +560,15 @@ export interface ColorButtonProps {
 }
 
 export interface ImageProps {
-  textureId: number;
-  width: number;
-  height: number;
+  /**
+   * A texture from `Textures.load()`; takes precedence over `textureId`.
+   * `uv0`/`uv1` are then relative to the image.
+   */
+  texture?: Texture;
+  textureId?: number;
+  /** Defaults to the texture's size when `texture` is given. */
+  width?: number;
+  height?: number;
   uv0?: { x: number; y: number };
   uv1?: { x: number; y: number };
   tintColor?: ImColor;
@@ -621,6 +631,116 @@ export interface NavigationModule {
   getState(): NavigationState;
 }
 
+export interface RenderingState {
+  idle: boolean;
+  /**
+   * Longest idle wait between frames. Input is only picked up when a wait
+   * ends, so while idle a keypress or click can take up to this long to show.
+   */
+  maxWaitMs: number;
+  settleFrames: number;
+}
+
+export interface FrameBudgetStats {
+  budgetMs: number;
+  overrunFrames: number;
+  overrunTotalMs: number;
+  overrunMaxMs: number;
+  deferredFrames: number;
+}
+
+export interface RenderingModule {
+  configure(options: Partial<RenderingState>): RenderingState;
+  invalidate(): void;
+  setFrameBudget(budgetMs: number): FrameBudgetStats | null;
+  getFrameBudgetStats(options?: { reset?: boolean }): FrameBudgetStats | null;
+  getState(): RenderingState;
+}
+
+export interface FetchCacheOptions {
+  enabled: boolean;
+  maxMemoryBytes: number;
+  /** Directory of the on-disk tier; empty keeps the cache in memory only. */
+  directory: string;
+  maxDiskBytes: number;
+}
+
+export interface FetchCacheStats {
+  hits: number;
+  revalidated: number;
+  misses: number;
+  stores: number;
+  deduplicated: number;
+  evictions: number;
+  memoryBytes: number;
+  memoryEntries: number;
+  diskBytes: number;
+}
+
+export interface FetchCacheModule {
+  configure(options: Partial<FetchCacheOptions>): FetchCacheOptions | null;
+  getStats(options?: { reset?: boolean }): FetchCacheStats | null;
+  clear(): void;
+}
+
+export interface Texture {
+  readonly id: number;
+  readonly status: 'loading' | 'ready' | 'error' | 'released';
+  readonly width: number;
+  readonly height: number;
+  readonly error: Error | null;
+  /** The placeholder's id until the image is uploaded. */
+  readonly textureId: number;
+  /** The image's rectangle in the texture, shared when packed in an atlas. */
+  readonly uv0: { x: number; y: number };
+  readonly uv1: { x: number; y: number };
+  readonly ready: Promise<Texture>;
+  /** Drop the reference taken by one `Textures.load()` of this texture. */
+  release(): void;
+}
+
+export type DynamicTextureFormat = 'rgba8' | 'bgra8' | 'gray8';
+
+export interface DynamicTexture extends Texture {
+  readonly format: DynamicTextureFormat;
+  /** Replace the pixels; `data` holds width * height pixels of `format`. */
+  update(data: ArrayBuffer | ArrayBufferView): void;
+}
+
+export interface DynamicTextureOptions {
+  width: number;
+  height: number;
+  format?: DynamicTextureFormat;
+}
+
+export interface TexturesOptions {
+  uploadBudgetBytes: number;
+  /** Memory that released textures may keep cached for reuse. */
+  maxResidentBytes: number;
+  /** Largest width and height packed into shared atlas pages; 0 disables. */
+  atlasMaxImageSize: number;
+}
+
+export interface TexturesStats extends TexturesOptions {
+  decoding: number;
+  waitingForUpload: number;
+  residentBytes: number;
+  residentTextures: number;
+  /** Resident textures nothing references, kept for reuse. */
+  unusedTextures: number;
+  hits: number;
+  misses: number;
+  evictions: number;
+}
+
+export interface TexturesModule {
+  load(source: string | ArrayBuffer | ArrayBufferView): Texture | null;
+  createDynamic(options: DynamicTextureOptions): DynamicTexture | null;
+  updateTexture(texture: DynamicTexture, data: ArrayBuffer | ArrayBufferView): void;
+  configure(options: Partial<TexturesOptions>): TexturesOptions | null;
+  getStats(options?: { reset?: boolean }): TexturesStats | null;
+}
+
 export interface StyleSheetStatic {
   create<T extends { [key: string]: ImguiStyle }>(styles: T): { [K in keyof T]: ImguiStyle };
   compose<T>(style1?: StyleProp<T>, style2?: StyleProp<T>): StyleProp<T>;
@@ -700,6 +820,9 @@ export declare const DockSpace: (props: DockSpaceProps) => JSX.Element;
 export declare const Platform: PlatformModule;
 export declare const Dimensions: DimensionsModule;
 export declare const Navigation: NavigationModule;
+export declare const Rendering: RenderingModule;
+export declare const FetchCache: FetchCacheModule;
+export declare const Textures: TexturesModule;
 export declare const StyleSheet: StyleSheetStatic;
 export declare const Appearance: AppearanceModule;
 
@@ -148,3 +148,166 @@ const Navigation = Object.freeze({
 });
 
 export { Navigation };
+
+const Rendering = Object.freeze({
+  /**
+   * Configure on-demand rendering. With `idle: true` the runtime only renders
+   * after input, expiring timers, completed fetches, React commits or
+   * `Rendering.invalidate()`.
+   */
+  configure(options = {}) {
+    if (typeof globalThis.__configureIdleRendering !== 'function') {
+      return Rendering.getState();
+    }
+    const request = {};
+    if (options.idle !== undefined) {
+      request.enabled = !!options.idle;
+    }
+    if (typeof options.maxWaitMs === 'number') {
+      request.maxWaitMs = options.maxWaitMs;
+    }
+    if (typeof options.settleFrames === 'number') {
+      request.settleFrames = options.settleFrames;
+    }
+    return normalizeRenderingState(globalThis.__configureIdleRendering(request));
+  },
+
+  /** Request that the next frame be rendered. */
+  invalidate() {
+    if (typeof globalThis.__invalidateFrame === 'function') {
+      globalThis.__invalidateFrame();
+    }
+  },
+
+  /**
+   * Limit the JS work (fetch callbacks and timers) the runtime starts per
+   * frame; the rest is carried over to the next frame. 0 disables the limit.
+   */
+  setFrameBudget(budgetMs) {
+    if (typeof globalThis.__configureFrameBudget === 'function') {
+      return globalThis.__configureFrameBudget(budgetMs);
+    }
+    return null;
+  },
+
+  /** How often and by how much the frame budget was exceeded. */
+  getFrameBudgetStats(options) {
+    if (typeof globalThis.__configureFrameBudget === 'function') {
+      return globalThis.__configureFrameBudget(options && options.reset ? { resetStats: true } : undefined);
+    }
+    return null;
+  },
+
+  getState() {
+    if (typeof globalThis.__configureIdleRendering === 'function') {
+      return normalizeRenderingState(globalThis.__configureIdleRendering());
+    }
+    return { idle: false, maxWaitMs: 0, settleFrames: 0 };
+  }
+});
+
+function normalizeRenderingState(state) {
+  return {
+    idle: !!(state && state.enabled),
+    maxWaitMs: state && typeof state.maxWaitMs === 'number' ? state.maxWaitMs : 0,
+    settleFrames: state && typeof state.settleFrames === 'number' ? state.settleFrames : 0
+  };
+}
+
+export { Rendering };
+
+const FetchCache = Object.freeze({
+  /**
+   * Configure the HTTP cache used by `fetch()`. It is disabled by default;
+   * `directory` adds an on-disk tier that survives restarts.
+   */
+  configure(options = {}) {
+    if (typeof globalThis.__configureFetchCache === 'function') {
+      return globalThis.__configureFetchCache(options);
+    }
+    return null;
+  },
+
+  /** Hit, revalidation, miss and in-flight deduplication counters. */
+  getStats(options) {
+    if (typeof globalThis.__fetchCacheStats === 'function') {
+      return globalThis.__fetchCacheStats(!!(options && options.reset));
+    }
+    return null;
+  },
+
+  /** Drop every cached response, in memory and on disk. */
+  clear() {
+    if (typeof globalThis.__clearFetchCache === 'function') {
+      globalThis.__clearFetchCache();
+    }
+  }
+});
+
+export { FetchCache };
+
+const Textures = Object.freeze({
+  /**
+   * Start decoding an image off the main thread. `source` is a file path, an
+   * embedded image name, or an ArrayBuffer/view of encoded bytes. The returned
+   * texture can be passed to `<Image texture={...}>` right away; it draws a
+   * placeholder until the image is uploaded. Loads of the same path share a
+   * texture; call `texture.release()` once per load when it is no longer
+   * shown.
+   */
+  load(source) {
+    if (typeof globalThis.__loadTexture === 'function') {
+      return globalThis.__loadTexture(source);
+    }
+    return null;
+  },
+
+  /**
+   * Create a texture whose pixels are replaced with `updateTexture()`, e.g.
+   * for a camera preview: `{ width, height, format }`, where format is
+   * 'rgba8' (the default), 'bgra8' or 'gray8'. Release it when done.
+   */
+  createDynamic(options) {
+    if (typeof globalThis.__createTexture === 'function') {
+      return globalThis.__createTexture(options);
+    }
+    return null;
+  },
+
+  /**
+   * Replace the pixels of a dynamic texture with `data`, an ArrayBuffer or
+   * typed array of width * height pixels in its format.
+   */
+  updateTexture(texture, data) {
+    texture.update(data);
+  },
+
+  /**
+   * Set `uploadBudgetBytes`, the texture bytes uploaded per frame, and
+   * `maxResidentBytes`, how much memory released textures may keep cached
+   * for reuse before the least recently released are freed, and
+   * `atlasMaxImageSize`, the largest images packed into shared atlas pages.
+   */
+  configure(options = {}) {
+    if (typeof globalThis.__configureImageLoader !== 'function') {
+      return null;
+    }
+    const result = globalThis.__configureImageLoader(options);
+    return Object.assign(result, globalThis.__configureTextureCache(options));
+  },
+
+  /**
+   * Loader and cache state: images decoding or waiting for upload, resident
+   * bytes and textures, and cache hit, miss and eviction counters.
+   */
+  getStats(options) {
+    if (typeof globalThis.__configureImageLoader !== 'function') {
+      return null;
+    }
+    const result = globalThis.__configureImageLoader();
+    Object.assign(result, globalThis.__configureTextureCache());
+    return Object.assign(result, globalThis.__textureCacheStats(!!(options && options.reset)));
+  }
+});
+
+export { Textures };
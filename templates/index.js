@@ -24,6 +24,9 @@ function configureSapp(options = {}) {
     maxDroppedFilePathLength: 'max_dropped_file_path_length',
     glMajorVersion: 'gl_major_version',
     glMinorVersion: 'gl_minor_version',
+    idleMaxWaitMs: 'idle_max_wait_ms',
+    idleSettleFrames: 'idle_settle_frames',
+    jsBudgetMs: 'js_budget_ms',
   };
 
   const booleanFields = {
@@ -40,6 +43,7 @@ function configureSapp(options = {}) {
     win32ConsoleUTF8: 'win32_console_utf8',
     win32ConsoleCreate: 'win32_console_create',
     win32ConsoleAttach: 'win32_console_attach',
+    idleRendering: 'idle_rendering',
   };
 
   for (const [key, field] of Object.entries(stringFields)) {